@@ -0,0 +1,244 @@
+#ifndef CAPTURE_FORMAT
+#define CAPTURE_FORMAT
+
+#include "vulkan/vulkan.h"
+#include <cstddef>
+#include <cstdint>
+
+// Layout of a Vulkan capture. A header, then the call stream cut into blocks,
+// each LzCodec compressed unless that saves nothing, a stored size equal to the
+// size marks a block kept as is. Blocks end on record boundaries, the stream is
+// their concatenation.
+//
+// A record is its CAPTURE_CALL followed by the call's arguments. Values are
+// written as they lie in memory, each at an offset aligned for its type counted
+// from the start of the stream, so the replayer reads them in place. Structs
+// are written whole and their pointers follow as counted arrays, the struct's
+// own pointer values are meaningless on replay. Handles keep their capture time
+// values, the replayer maps them to the objects it creates.
+//
+// Struct layouts differ between 32 and 64 bit builds, a capture replays on
+// builds of the pointer size it was made with.
+constexpr uint32_t CAPTURE_FILE_MAGIC = 0x50434E53; // "SNCP"
+constexpr uint32_t CAPTURE_FILE_VERSION = 1;
+
+struct CaptureFileHeader {
+	uint32_t magic{ CAPTURE_FILE_MAGIC };
+	uint32_t version{ CAPTURE_FILE_VERSION };
+	uint32_t pointer_size{ sizeof(void *) };
+	// Frame ends in the stream, written once the capture closes
+	uint32_t frame_count{ 0 };
+};
+
+struct CaptureBlockHeader {
+	uint64_t size{ 0 };
+	uint64_t stored_size{ 0 };
+};
+
+static_assert(sizeof(CaptureFileHeader) == 16, "Capture file header layout changed");
+static_assert(sizeof(CaptureBlockHeader) == 16, "Capture block header layout changed");
+
+enum CAPTURE_CALL : uint32_t
+{
+	CC_CREATE_INSTANCE = 0,
+	CC_CREATE_DEVICE,
+	CC_GET_DEVICE_QUEUE,
+	CC_DEVICE_WAIT_IDLE,
+	CC_QUEUE_WAIT_IDLE,
+	CC_QUEUE_SUBMIT,
+	CC_ALLOCATE_MEMORY,
+	CC_FREE_MEMORY,
+	CC_MAP_MEMORY,
+	CC_UNMAP_MEMORY,
+	// Host writes to mapped memory, not a Vulkan call
+	CC_MEMORY_WRITE,
+	CC_BIND_BUFFER_MEMORY,
+	CC_BIND_IMAGE_MEMORY,
+	CC_CREATE_BUFFER,
+	CC_CREATE_IMAGE,
+	CC_CREATE_IMAGE_VIEW,
+	CC_CREATE_SAMPLER,
+	CC_CREATE_SEMAPHORE,
+	CC_CREATE_FENCE,
+	CC_WAIT_FOR_FENCES,
+	CC_RESET_FENCES,
+	CC_WAIT_SEMAPHORES,
+	CC_CREATE_QUERY_POOL,
+	CC_GET_QUERY_POOL_RESULTS,
+	CC_CREATE_SHADER_MODULE,
+	CC_CREATE_DESCRIPTOR_SET_LAYOUT,
+	CC_CREATE_PIPELINE_LAYOUT,
+	CC_CREATE_RENDER_PASS,
+	CC_CREATE_FRAMEBUFFER,
+	CC_CREATE_GRAPHICS_PIPELINES,
+	CC_CREATE_COMPUTE_PIPELINES,
+	CC_CREATE_DESCRIPTOR_POOL,
+	CC_RESET_DESCRIPTOR_POOL,
+	CC_ALLOCATE_DESCRIPTOR_SETS,
+	CC_FREE_DESCRIPTOR_SETS,
+	CC_UPDATE_DESCRIPTOR_SETS,
+	CC_CREATE_COMMAND_POOL,
+	CC_RESET_COMMAND_POOL,
+	CC_ALLOCATE_COMMAND_BUFFERS,
+	CC_FREE_COMMAND_BUFFERS,
+	CC_BEGIN_COMMAND_BUFFER,
+	CC_END_COMMAND_BUFFER,
+	CC_RESET_COMMAND_BUFFER,
+	// Any vkDestroy call, the object type says which
+	CC_DESTROY,
+	CC_CMD_BIND_PIPELINE,
+	CC_CMD_BIND_DESCRIPTOR_SETS,
+	CC_CMD_BIND_VERTEX_BUFFERS,
+	CC_CMD_BIND_INDEX_BUFFER,
+	CC_CMD_SET_VIEWPORT,
+	CC_CMD_SET_SCISSOR,
+	CC_CMD_PUSH_CONSTANTS,
+	CC_CMD_DRAW,
+	CC_CMD_DRAW_INDEXED,
+	CC_CMD_DRAW_INDIRECT,
+	CC_CMD_DRAW_INDEXED_INDIRECT,
+	CC_CMD_DRAW_INDIRECT_COUNT,
+	CC_CMD_DISPATCH,
+	CC_CMD_COPY_BUFFER,
+	CC_CMD_COPY_IMAGE,
+	CC_CMD_COPY_BUFFER_TO_IMAGE,
+	CC_CMD_COPY_IMAGE_TO_BUFFER,
+	CC_CMD_BLIT_IMAGE,
+	CC_CMD_FILL_BUFFER,
+	CC_CMD_UPDATE_BUFFER,
+	CC_CMD_PIPELINE_BARRIER,
+	CC_CMD_BEGIN_RENDER_PASS,
+	CC_CMD_NEXT_SUBPASS,
+	CC_CMD_END_RENDER_PASS,
+	CC_CMD_RESET_QUERY_POOL,
+	CC_CMD_WRITE_TIMESTAMP,
+	CC_CREATE_SWAPCHAIN,
+	CC_GET_SWAPCHAIN_IMAGES,
+	CC_ACQUIRE_NEXT_IMAGE,
+	CC_QUEUE_PRESENT,
+	// The configured frame call returned, not a Vulkan call
+	CC_FRAME_END,
+	CC_COUNT
+};
+
+// Entry point each call records, for reports and for naming the frame call
+constexpr char const * CAPTURE_CALL_NAMES[CC_COUNT] = {
+	"vkCreateInstance",
+	"vkCreateDevice",
+	"vkGetDeviceQueue",
+	"vkDeviceWaitIdle",
+	"vkQueueWaitIdle",
+	"vkQueueSubmit",
+	"vkAllocateMemory",
+	"vkFreeMemory",
+	"vkMapMemory",
+	"vkUnmapMemory",
+	"Memory Write",
+	"vkBindBufferMemory",
+	"vkBindImageMemory",
+	"vkCreateBuffer",
+	"vkCreateImage",
+	"vkCreateImageView",
+	"vkCreateSampler",
+	"vkCreateSemaphore",
+	"vkCreateFence",
+	"vkWaitForFences",
+	"vkResetFences",
+	"vkWaitSemaphores",
+	"vkCreateQueryPool",
+	"vkGetQueryPoolResults",
+	"vkCreateShaderModule",
+	"vkCreateDescriptorSetLayout",
+	"vkCreatePipelineLayout",
+	"vkCreateRenderPass",
+	"vkCreateFramebuffer",
+	"vkCreateGraphicsPipelines",
+	"vkCreateComputePipelines",
+	"vkCreateDescriptorPool",
+	"vkResetDescriptorPool",
+	"vkAllocateDescriptorSets",
+	"vkFreeDescriptorSets",
+	"vkUpdateDescriptorSets",
+	"vkCreateCommandPool",
+	"vkResetCommandPool",
+	"vkAllocateCommandBuffers",
+	"vkFreeCommandBuffers",
+	"vkBeginCommandBuffer",
+	"vkEndCommandBuffer",
+	"vkResetCommandBuffer",
+	"vkDestroy",
+	"vkCmdBindPipeline",
+	"vkCmdBindDescriptorSets",
+	"vkCmdBindVertexBuffers",
+	"vkCmdBindIndexBuffer",
+	"vkCmdSetViewport",
+	"vkCmdSetScissor",
+	"vkCmdPushConstants",
+	"vkCmdDraw",
+	"vkCmdDrawIndexed",
+	"vkCmdDrawIndirect",
+	"vkCmdDrawIndexedIndirect",
+	"vkCmdDrawIndirectCount",
+	"vkCmdDispatch",
+	"vkCmdCopyBuffer",
+	"vkCmdCopyImage",
+	"vkCmdCopyBufferToImage",
+	"vkCmdCopyImageToBuffer",
+	"vkCmdBlitImage",
+	"vkCmdFillBuffer",
+	"vkCmdUpdateBuffer",
+	"vkCmdPipelineBarrier",
+	"vkCmdBeginRenderPass",
+	"vkCmdNextSubpass",
+	"vkCmdEndRenderPass",
+	"vkCmdResetQueryPool",
+	"vkCmdWriteTimestamp",
+	"vkCreateSwapchainKHR",
+	"vkGetSwapchainImagesKHR",
+	"vkAcquireNextImageKHR",
+	"vkQueuePresentKHR",
+	"Frame End"
+};
+
+// Extension structs are captured by value when they hold nothing but plain
+// members, this gives their size and 0 for any other. Chains end with
+// VK_STRUCTURE_TYPE_MAX_ENUM; VkTimelineSemaphoreSubmitInfo is the one struct
+// with arrays the stream also carries.
+constexpr size_t GetPlainNextSize(VkStructureType t_type) noexcept
+{
+	switch (t_type) {
+	case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2:
+		return sizeof(VkPhysicalDeviceFeatures2);
+	case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES:
+		return sizeof(VkPhysicalDeviceVulkan11Features);
+	case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES:
+		return sizeof(VkPhysicalDeviceVulkan12Features);
+	case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES:
+		return sizeof(VkPhysicalDeviceTimelineSemaphoreFeatures);
+	case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES:
+		return sizeof(VkPhysicalDeviceDescriptorIndexingFeatures);
+	case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES:
+		return sizeof(VkPhysicalDeviceHostQueryResetFeatures);
+	case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SCALAR_BLOCK_LAYOUT_FEATURES:
+		return sizeof(VkPhysicalDeviceScalarBlockLayoutFeatures);
+	case VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO:
+		return sizeof(VkSemaphoreTypeCreateInfo);
+	case VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO:
+		return sizeof(VkMemoryAllocateFlagsInfo);
+	default:
+		return 0;
+	}
+}
+
+// What the device a capture was made on reported, so the replayer can pick the
+// same one and translate memory types
+struct CaptureDeviceInfo {
+	uint32_t vendor_id{ 0 };
+	uint32_t device_id{ 0 };
+	uint32_t driver_version{ 0 };
+	uint32_t api_version{ 0 };
+	char device_name[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE]{};
+	VkPhysicalDeviceMemoryProperties memory_properties{};
+};
+
+#endif // !CAPTURE_FORMAT
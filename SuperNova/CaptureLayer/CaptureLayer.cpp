@@ -0,0 +1,1465 @@
+#include "CaptureLayer.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+// Granularity of the mapped memory comparison
+constexpr VkDeviceSize CAPTURE_PAGE_SIZE = 256;
+
+// Hooks an entry point reached in the layer_factory defaults
+constexpr uint32_t GENERIC_PRE = 1;
+constexpr uint32_t GENERIC_POST = 2;
+constexpr uint32_t GENERIC_REPORTED = 4;
+
+// Calls the replay does without, besides the vkGet and vkEnumerate queries.
+// Mapped memory is compared at every submit, explicit flushes add nothing, and
+// the replay builds pipelines without a cache.
+constexpr char const * UNRECORDED_CALLS[] = {
+	"vkDestroyInstance",
+	"vkCreatePipelineCache",
+	"vkDestroyPipelineCache",
+	"vkMergePipelineCaches",
+	"vkDestroyDevice",
+	"vkCreateWin32SurfaceKHR",
+	"vkDestroySurfaceKHR",
+	"vkFlushMappedMemoryRanges",
+	"vkInvalidateMappedMemoryRanges",
+	"vkCreateDebugUtilsMessengerEXT",
+	"vkDestroyDebugUtilsMessengerEXT",
+	"vkCreateDebugReportCallbackEXT",
+	"vkDestroyDebugReportCallbackEXT"
+};
+
+namespace
+{
+	template<typename T>
+	uint64_t HandleValue(T t_handle) noexcept
+	{
+		if constexpr (std::is_pointer_v<T>) {
+			return reinterpret_cast<uint64_t>(t_handle);
+		}
+		else {
+			return static_cast<uint64_t>(t_handle);
+		}
+	}
+
+	bool IsUnrecorded(char const * t_api_name)
+	{
+		if (std::strncmp(t_api_name, "vkGet", 5) == 0 || std::strncmp(t_api_name, "vkEnumerate", 11) == 0) {
+			return true;
+		}
+		return std::any_of(std::begin(UNRECORDED_CALLS), std::end(UNRECORDED_CALLS), [t_api_name](char const * t_name) {
+			return std::strcmp(t_api_name, t_name) == 0;
+		});
+	}
+
+	void WriteStage(CaptureWriter & t_writer, VkPipelineShaderStageCreateInfo const & t_stage)
+	{
+		t_writer.Write(t_stage);
+		t_writer.WriteString(t_stage.pName);
+		t_writer.WriteOptional(t_stage.pSpecializationInfo);
+		if (t_stage.pSpecializationInfo != nullptr) {
+			auto const & specialization = *t_stage.pSpecializationInfo;
+			t_writer.WriteArray(specialization.pMapEntries, specialization.mapEntryCount);
+			t_writer.WriteBytes(specialization.pData, specialization.dataSize);
+		}
+	}
+
+	void WriteGraphicsPipeline(CaptureWriter & t_writer, VkGraphicsPipelineCreateInfo const & t_info)
+	{
+		t_writer.Write(t_info);
+		for (auto i = uint32_t{ 0 }; i < t_info.stageCount; ++i) {
+			WriteStage(t_writer, t_info.pStages[i]);
+		}
+
+		t_writer.WriteOptional(t_info.pVertexInputState);
+		if (auto state = t_info.pVertexInputState) {
+			t_writer.WriteArray(state->pVertexBindingDescriptions, state->vertexBindingDescriptionCount);
+			t_writer.WriteArray(state->pVertexAttributeDescriptions, state->vertexAttributeDescriptionCount);
+		}
+		t_writer.WriteOptional(t_info.pInputAssemblyState);
+		t_writer.WriteOptional(t_info.pTessellationState);
+		t_writer.WriteOptional(t_info.pViewportState);
+		if (auto state = t_info.pViewportState) {
+			t_writer.WriteArray(state->pViewports, state->viewportCount);
+			t_writer.WriteArray(state->pScissors, state->scissorCount);
+		}
+		t_writer.WriteOptional(t_info.pRasterizationState);
+		t_writer.WriteOptional(t_info.pMultisampleState);
+		if (auto state = t_info.pMultisampleState) {
+			t_writer.WriteArray(state->pSampleMask, (static_cast<uint32_t>(state->rasterizationSamples) + 31) / 32);
+		}
+		t_writer.WriteOptional(t_info.pDepthStencilState);
+		t_writer.WriteOptional(t_info.pColorBlendState);
+		if (auto state = t_info.pColorBlendState) {
+			t_writer.WriteArray(state->pAttachments, state->attachmentCount);
+		}
+		t_writer.WriteOptional(t_info.pDynamicState);
+		if (auto state = t_info.pDynamicState) {
+			t_writer.WriteArray(state->pDynamicStates, state->dynamicStateCount);
+		}
+	}
+}
+
+CaptureLayer::CaptureLayer()
+{
+	layer_name = "SuperNovaCapture";
+
+	if (auto file_path = std::getenv("SUPERNOVA_CAPTURE_FILE")) {
+		m_file_path = file_path;
+	}
+	if (auto frames = std::getenv("SUPERNOVA_CAPTURE_FRAMES")) {
+		m_frame_limit = std::max(static_cast<uint32_t>(std::strtoul(frames, nullptr, 10)), 1u);
+	}
+	if (auto frame_call = std::getenv("SUPERNOVA_CAPTURE_FRAME_CALL")) {
+		auto call = std::find_if(std::begin(CAPTURE_CALL_NAMES), std::end(CAPTURE_CALL_NAMES), [frame_call](char const * t_name) {
+			return std::strcmp(frame_call, t_name) == 0;
+		});
+		if (call != std::end(CAPTURE_CALL_NAMES)) {
+			m_frame_call = static_cast<CAPTURE_CALL>(call - std::begin(CAPTURE_CALL_NAMES));
+		}
+	}
+}
+
+CaptureLayer::~CaptureLayer() noexcept
+{
+	// The debug callbacks are gone by now, a failure here goes unreported
+	try {
+		auto lock = std::lock_guard<std::mutex>{ m_mutex };
+		m_writer.Destroy();
+	}
+	catch (std::exception &) {
+	}
+}
+
+void CaptureLayer::PreCallApiFunction(char const * t_api_name)
+{
+	NoteGenericCall(t_api_name, GENERIC_PRE);
+}
+
+void CaptureLayer::PostCallApiFunction(char const * t_api_name)
+{
+	NoteGenericCall(t_api_name, GENERIC_POST);
+}
+
+void CaptureLayer::PostCallApiFunction(char const * t_api_name, VkResult)
+{
+	NoteGenericCall(t_api_name, GENERIC_POST);
+}
+
+void CaptureLayer::PostCallGetPhysicalDeviceProperties(VkPhysicalDevice t_physical_device, VkPhysicalDeviceProperties * t_properties)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	auto & info = m_physical_devices[t_physical_device];
+	info.vendor_id = t_properties->vendorID;
+	info.device_id = t_properties->deviceID;
+	info.driver_version = t_properties->driverVersion;
+	info.api_version = t_properties->apiVersion;
+	std::memcpy(info.device_name, t_properties->deviceName, sizeof(info.device_name));
+}
+
+void CaptureLayer::PostCallGetPhysicalDeviceMemoryProperties(VkPhysicalDevice t_physical_device, VkPhysicalDeviceMemoryProperties * t_properties)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	m_physical_devices[t_physical_device].memory_properties = *t_properties;
+}
+
+void CaptureLayer::PostCallGetPhysicalDeviceMemoryProperties2(VkPhysicalDevice t_physical_device, VkPhysicalDeviceMemoryProperties2 * t_properties)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	m_physical_devices[t_physical_device].memory_properties = t_properties->memoryProperties;
+}
+
+VkResult CaptureLayer::PostCallCreateInstance(VkInstanceCreateInfo const * t_info, VkAllocationCallbacks const *, VkInstance *, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	// One capture per process, from the first instance on
+	if (t_result != VK_SUCCESS || m_writer.IsOpen() || m_call != CC_COUNT) {
+		return VK_SUCCESS;
+	}
+
+	try {
+		m_writer.Create(m_file_path);
+	}
+	catch (std::exception & error) {
+		Fail(error.what());
+		return VK_SUCCESS;
+	}
+
+	m_capturing = true;
+	if (Begin(CC_CREATE_INSTANCE)) {
+		auto application = t_info->pApplicationInfo;
+		m_writer.Write(application != nullptr && application->apiVersion != 0 ? application->apiVersion : VK_API_VERSION_1_0);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallCreateDevice(VkPhysicalDevice t_physical_device, VkDeviceCreateInfo const * t_info, VkAllocationCallbacks const *, VkDevice * t_device, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result != VK_SUCCESS || !Begin(CC_CREATE_DEVICE)) {
+		return VK_SUCCESS;
+	}
+
+	m_device_info = m_physical_devices[t_physical_device];
+	m_writer.Write(*t_device);
+	m_writer.Write(m_device_info);
+	m_writer.Write(*t_info);
+	WriteNext(t_info->pNext);
+	for (auto i = uint32_t{ 0 }; i < t_info->queueCreateInfoCount; ++i) {
+		auto const & queue_info = t_info->pQueueCreateInfos[i];
+		m_writer.Write(queue_info);
+		m_writer.WriteArray(queue_info.pQueuePriorities, queue_info.queueCount);
+	}
+	for (auto i = uint32_t{ 0 }; i < t_info->enabledExtensionCount; ++i) {
+		m_writer.WriteString(t_info->ppEnabledExtensionNames[i]);
+	}
+	m_writer.WriteOptional(t_info->pEnabledFeatures);
+	End();
+	return VK_SUCCESS;
+}
+
+void CaptureLayer::PostCallGetDeviceQueue(VkDevice, uint32_t t_family, uint32_t t_index, VkQueue * t_queue)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_GET_DEVICE_QUEUE)) {
+		m_writer.Write(t_family);
+		m_writer.Write(t_index);
+		m_writer.Write(*t_queue);
+		End();
+	}
+}
+
+VkResult CaptureLayer::PostCallDeviceWaitIdle(VkDevice, VkResult)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_DEVICE_WAIT_IDLE)) {
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallQueueWaitIdle(VkQueue t_queue, VkResult)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_QUEUE_WAIT_IDLE)) {
+		m_writer.Write(t_queue);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PreCallQueueSubmit(VkQueue t_queue, uint32_t t_count, VkSubmitInfo const * t_submits, VkFence t_fence)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	for (auto & memory : m_memory) {
+		FlushMemory(memory.first, memory.second);
+	}
+
+	if (!Begin(CC_QUEUE_SUBMIT)) {
+		return VK_SUCCESS;
+	}
+	m_writer.Write(t_queue);
+	m_writer.Write(t_fence);
+	m_writer.Write(t_count);
+	for (auto i = uint32_t{ 0 }; i < t_count; ++i) {
+		auto const & submit = t_submits[i];
+		m_writer.Write(submit);
+		WriteNext(submit.pNext);
+		m_writer.WriteArray(submit.pWaitSemaphores, submit.waitSemaphoreCount);
+		m_writer.WriteArray(submit.pWaitDstStageMask, submit.waitSemaphoreCount);
+		m_writer.WriteArray(submit.pCommandBuffers, submit.commandBufferCount);
+		m_writer.WriteArray(submit.pSignalSemaphores, submit.signalSemaphoreCount);
+	}
+	End();
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallAllocateMemory(VkDevice, VkMemoryAllocateInfo const * t_info, VkAllocationCallbacks const *, VkDeviceMemory * t_memory, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result != VK_SUCCESS || !Begin(CC_ALLOCATE_MEMORY)) {
+		return VK_SUCCESS;
+	}
+
+	auto const & memory_properties = m_device_info.memory_properties;
+	auto flags = t_info->memoryTypeIndex < memory_properties.memoryTypeCount ?
+		memory_properties.memoryTypes[t_info->memoryTypeIndex].propertyFlags : VkMemoryPropertyFlags{ 0 };
+	m_writer.Write(*t_memory);
+	m_writer.Write(*t_info);
+	m_writer.Write(flags);
+	WriteNext(t_info->pNext);
+	End();
+
+	auto & state = m_memory[*t_memory];
+	state.size = t_info->allocationSize;
+	state.host_cached_only = (flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) != 0 && (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0;
+	return VK_SUCCESS;
+}
+
+void CaptureLayer::PreCallFreeMemory(VkDevice, VkDeviceMemory t_memory, VkAllocationCallbacks const *)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_memory != VK_NULL_HANDLE && Begin(CC_FREE_MEMORY)) {
+		m_writer.Write(t_memory);
+		End();
+	}
+	m_memory.erase(t_memory);
+}
+
+VkResult CaptureLayer::PostCallMapMemory(VkDevice, VkDeviceMemory t_memory, VkDeviceSize t_offset, VkDeviceSize t_size, VkMemoryMapFlags t_flags, void ** t_data, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	auto memory = m_memory.find(t_memory);
+	if (t_result != VK_SUCCESS || memory == m_memory.end() || !Begin(CC_MAP_MEMORY)) {
+		return VK_SUCCESS;
+	}
+
+	m_writer.Write(t_memory);
+	m_writer.Write(t_offset);
+	m_writer.Write(t_size);
+	m_writer.Write(t_flags);
+	End();
+
+	auto & state = memory->second;
+	state.mapped = static_cast<uint8_t *>(*t_data);
+	state.mapped_offset = t_offset;
+	state.mapped_size = t_size == VK_WHOLE_SIZE ? state.size - t_offset : t_size;
+	if (state.shadow.empty()) {
+		state.shadow.resize(static_cast<size_t>(state.size));
+	}
+	return VK_SUCCESS;
+}
+
+void CaptureLayer::PreCallUnmapMemory(VkDevice, VkDeviceMemory t_memory)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	auto memory = m_memory.find(t_memory);
+	if (memory == m_memory.end()) {
+		return;
+	}
+
+	FlushMemory(t_memory, memory->second);
+	memory->second.mapped = nullptr;
+	if (Begin(CC_UNMAP_MEMORY)) {
+		m_writer.Write(t_memory);
+		End();
+	}
+}
+
+VkResult CaptureLayer::PostCallBindBufferMemory(VkDevice, VkBuffer t_buffer, VkDeviceMemory t_memory, VkDeviceSize t_offset, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	auto usage = m_unbound_buffers.find(t_buffer);
+	auto memory = m_memory.find(t_memory);
+	if (t_result == VK_SUCCESS && usage != m_unbound_buffers.end() && memory != m_memory.end()) {
+		if (usage->second == VK_BUFFER_USAGE_TRANSFER_DST_BIT) {
+			memory->second.readback_bound = true;
+		}
+		else {
+			memory->second.other_bound = true;
+		}
+	}
+	if (usage != m_unbound_buffers.end()) {
+		m_unbound_buffers.erase(usage);
+	}
+
+	if (t_result == VK_SUCCESS && Begin(CC_BIND_BUFFER_MEMORY)) {
+		m_writer.Write(t_buffer);
+		m_writer.Write(t_memory);
+		m_writer.Write(t_offset);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallBindImageMemory(VkDevice, VkImage t_image, VkDeviceMemory t_memory, VkDeviceSize t_offset, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	auto memory = m_memory.find(t_memory);
+	if (t_result == VK_SUCCESS && memory != m_memory.end()) {
+		memory->second.other_bound = true;
+	}
+
+	if (t_result == VK_SUCCESS && Begin(CC_BIND_IMAGE_MEMORY)) {
+		m_writer.Write(t_image);
+		m_writer.Write(t_memory);
+		m_writer.Write(t_offset);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallCreateBuffer(VkDevice, VkBufferCreateInfo const * t_info, VkAllocationCallbacks const *, VkBuffer * t_buffer, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS) {
+		m_unbound_buffers[*t_buffer] = t_info->usage;
+	}
+
+	if (t_result == VK_SUCCESS && Begin(CC_CREATE_BUFFER)) {
+		m_writer.Write(*t_buffer);
+		m_writer.Write(*t_info);
+		m_writer.WriteArray(t_info->pQueueFamilyIndices, t_info->sharingMode == VK_SHARING_MODE_CONCURRENT ? t_info->queueFamilyIndexCount : 0);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallCreateImage(VkDevice, VkImageCreateInfo const * t_info, VkAllocationCallbacks const *, VkImage * t_image, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS && Begin(CC_CREATE_IMAGE)) {
+		m_writer.Write(*t_image);
+		m_writer.Write(*t_info);
+		m_writer.WriteArray(t_info->pQueueFamilyIndices, t_info->sharingMode == VK_SHARING_MODE_CONCURRENT ? t_info->queueFamilyIndexCount : 0);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallCreateImageView(VkDevice, VkImageViewCreateInfo const * t_info, VkAllocationCallbacks const *, VkImageView * t_view, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS && Begin(CC_CREATE_IMAGE_VIEW)) {
+		m_writer.Write(*t_view);
+		m_writer.Write(*t_info);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallCreateSampler(VkDevice, VkSamplerCreateInfo const * t_info, VkAllocationCallbacks const *, VkSampler * t_sampler, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS && Begin(CC_CREATE_SAMPLER)) {
+		m_writer.Write(*t_sampler);
+		m_writer.Write(*t_info);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallCreateSemaphore(VkDevice, VkSemaphoreCreateInfo const * t_info, VkAllocationCallbacks const *, VkSemaphore * t_semaphore, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS && Begin(CC_CREATE_SEMAPHORE)) {
+		m_writer.Write(*t_semaphore);
+		m_writer.Write(*t_info);
+		WriteNext(t_info->pNext);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallCreateFence(VkDevice, VkFenceCreateInfo const * t_info, VkAllocationCallbacks const *, VkFence * t_fence, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS && Begin(CC_CREATE_FENCE)) {
+		m_writer.Write(*t_fence);
+		m_writer.Write(*t_info);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallWaitForFences(VkDevice, uint32_t t_count, VkFence const * t_fences, VkBool32 t_wait_all, uint64_t, VkResult t_result)
+{
+	if (t_result == VK_SUCCESS) {
+		auto lock = std::lock_guard<std::mutex>{ m_mutex };
+		RecordFenceWait(t_count, t_fences, t_wait_all);
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallResetFences(VkDevice, uint32_t t_count, VkFence const * t_fences, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS && Begin(CC_RESET_FENCES)) {
+		m_writer.WriteArray(t_fences, t_count);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallGetFenceStatus(VkDevice, VkFence t_fence, VkResult t_result)
+{
+	if (t_result == VK_SUCCESS) {
+		auto lock = std::lock_guard<std::mutex>{ m_mutex };
+		RecordFenceWait(1, &t_fence, VK_TRUE);
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallWaitSemaphores(VkDevice, VkSemaphoreWaitInfo const * t_info, uint64_t, VkResult t_result)
+{
+	if (t_result == VK_SUCCESS) {
+		auto lock = std::lock_guard<std::mutex>{ m_mutex };
+		RecordSemaphoreWait(*t_info);
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallWaitSemaphoresKHR(VkDevice t_device, VkSemaphoreWaitInfo const * t_info, uint64_t t_timeout, VkResult t_result)
+{
+	return PostCallWaitSemaphores(t_device, t_info, t_timeout, t_result);
+}
+
+VkResult CaptureLayer::PostCallGetSemaphoreCounterValue(VkDevice, VkSemaphore t_semaphore, uint64_t * t_value, VkResult t_result)
+{
+	if (t_result == VK_SUCCESS && *t_value > 0) {
+		auto wait_info = VkSemaphoreWaitInfo{};
+		wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		wait_info.semaphoreCount = 1;
+		wait_info.pSemaphores = &t_semaphore;
+		wait_info.pValues = t_value;
+
+		auto lock = std::lock_guard<std::mutex>{ m_mutex };
+		RecordSemaphoreWait(wait_info);
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallGetSemaphoreCounterValueKHR(VkDevice t_device, VkSemaphore t_semaphore, uint64_t * t_value, VkResult t_result)
+{
+	return PostCallGetSemaphoreCounterValue(t_device, t_semaphore, t_value, t_result);
+}
+
+VkResult CaptureLayer::PostCallCreateQueryPool(VkDevice, VkQueryPoolCreateInfo const * t_info, VkAllocationCallbacks const *, VkQueryPool * t_pool, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS && Begin(CC_CREATE_QUERY_POOL)) {
+		m_writer.Write(*t_pool);
+		m_writer.Write(*t_info);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallGetQueryPoolResults(VkDevice, VkQueryPool t_pool, uint32_t t_first, uint32_t t_count, size_t t_data_size, void *,
+	VkDeviceSize t_stride, VkQueryResultFlags t_flags, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS && Begin(CC_GET_QUERY_POOL_RESULTS)) {
+		m_writer.Write(t_pool);
+		m_writer.Write(t_first);
+		m_writer.Write(t_count);
+		m_writer.Write(uint64_t{ t_data_size });
+		m_writer.Write(t_stride);
+		m_writer.Write(t_flags);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallCreateShaderModule(VkDevice, VkShaderModuleCreateInfo const * t_info, VkAllocationCallbacks const *, VkShaderModule * t_module, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS && Begin(CC_CREATE_SHADER_MODULE)) {
+		m_writer.Write(*t_module);
+		m_writer.Write(*t_info);
+		m_writer.WriteBytes(t_info->pCode, t_info->codeSize);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallCreateDescriptorSetLayout(VkDevice, VkDescriptorSetLayoutCreateInfo const * t_info, VkAllocationCallbacks const *, VkDescriptorSetLayout * t_layout, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result != VK_SUCCESS || !Begin(CC_CREATE_DESCRIPTOR_SET_LAYOUT)) {
+		return VK_SUCCESS;
+	}
+
+	m_writer.Write(*t_layout);
+	m_writer.Write(*t_info);
+	WriteNext(t_info->pNext);
+	for (auto i = uint32_t{ 0 }; i < t_info->bindingCount; ++i) {
+		auto const & binding = t_info->pBindings[i];
+		m_writer.Write(binding);
+		m_writer.WriteArray(binding.pImmutableSamplers, binding.descriptorCount);
+	}
+	End();
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallCreatePipelineLayout(VkDevice, VkPipelineLayoutCreateInfo const * t_info, VkAllocationCallbacks const *, VkPipelineLayout * t_layout, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS && Begin(CC_CREATE_PIPELINE_LAYOUT)) {
+		m_writer.Write(*t_layout);
+		m_writer.Write(*t_info);
+		m_writer.WriteArray(t_info->pSetLayouts, t_info->setLayoutCount);
+		m_writer.WriteArray(t_info->pPushConstantRanges, t_info->pushConstantRangeCount);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallCreateRenderPass(VkDevice, VkRenderPassCreateInfo const * t_info, VkAllocationCallbacks const *, VkRenderPass * t_render_pass, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result != VK_SUCCESS || !Begin(CC_CREATE_RENDER_PASS)) {
+		return VK_SUCCESS;
+	}
+
+	m_writer.Write(*t_render_pass);
+	m_writer.Write(*t_info);
+	m_writer.WriteArray(t_info->pAttachments, t_info->attachmentCount);
+	for (auto i = uint32_t{ 0 }; i < t_info->subpassCount; ++i) {
+		auto const & subpass = t_info->pSubpasses[i];
+		m_writer.Write(subpass);
+		m_writer.WriteArray(subpass.pInputAttachments, subpass.inputAttachmentCount);
+		m_writer.WriteArray(subpass.pColorAttachments, subpass.colorAttachmentCount);
+		m_writer.WriteArray(subpass.pResolveAttachments, subpass.colorAttachmentCount);
+		m_writer.WriteOptional(subpass.pDepthStencilAttachment);
+		m_writer.WriteArray(subpass.pPreserveAttachments, subpass.preserveAttachmentCount);
+	}
+	m_writer.WriteArray(t_info->pDependencies, t_info->dependencyCount);
+	End();
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallCreateFramebuffer(VkDevice, VkFramebufferCreateInfo const * t_info, VkAllocationCallbacks const *, VkFramebuffer * t_framebuffer, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS && Begin(CC_CREATE_FRAMEBUFFER)) {
+		m_writer.Write(*t_framebuffer);
+		m_writer.Write(*t_info);
+		m_writer.WriteArray(t_info->pAttachments, t_info->attachmentCount);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallCreateGraphicsPipelines(VkDevice, VkPipelineCache, uint32_t t_count, VkGraphicsPipelineCreateInfo const * t_infos,
+	VkAllocationCallbacks const *, VkPipeline * t_pipelines, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result != VK_SUCCESS || !Begin(CC_CREATE_GRAPHICS_PIPELINES)) {
+		return VK_SUCCESS;
+	}
+
+	// Pipeline caches are not captured, the replay builds every pipeline
+	m_writer.WriteArray(t_pipelines, t_count);
+	for (auto i = uint32_t{ 0 }; i < t_count; ++i) {
+		WriteGraphicsPipeline(m_writer, t_infos[i]);
+	}
+	End();
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallCreateComputePipelines(VkDevice, VkPipelineCache, uint32_t t_count, VkComputePipelineCreateInfo const * t_infos,
+	VkAllocationCallbacks const *, VkPipeline * t_pipelines, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result != VK_SUCCESS || !Begin(CC_CREATE_COMPUTE_PIPELINES)) {
+		return VK_SUCCESS;
+	}
+
+	m_writer.WriteArray(t_pipelines, t_count);
+	for (auto i = uint32_t{ 0 }; i < t_count; ++i) {
+		m_writer.Write(t_infos[i]);
+		WriteStage(m_writer, t_infos[i].stage);
+	}
+	End();
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallCreateDescriptorPool(VkDevice, VkDescriptorPoolCreateInfo const * t_info, VkAllocationCallbacks const *, VkDescriptorPool * t_pool, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS && Begin(CC_CREATE_DESCRIPTOR_POOL)) {
+		m_writer.Write(*t_pool);
+		m_writer.Write(*t_info);
+		m_writer.WriteArray(t_info->pPoolSizes, t_info->poolSizeCount);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallResetDescriptorPool(VkDevice, VkDescriptorPool t_pool, VkDescriptorPoolResetFlags t_flags, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS && Begin(CC_RESET_DESCRIPTOR_POOL)) {
+		m_writer.Write(t_pool);
+		m_writer.Write(t_flags);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallAllocateDescriptorSets(VkDevice, VkDescriptorSetAllocateInfo const * t_info, VkDescriptorSet * t_sets, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS && Begin(CC_ALLOCATE_DESCRIPTOR_SETS)) {
+		m_writer.Write(*t_info);
+		WriteNext(t_info->pNext);
+		m_writer.WriteArray(t_info->pSetLayouts, t_info->descriptorSetCount);
+		m_writer.WriteArray(t_sets, t_info->descriptorSetCount);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PreCallFreeDescriptorSets(VkDevice, VkDescriptorPool t_pool, uint32_t t_count, VkDescriptorSet const * t_sets)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_FREE_DESCRIPTOR_SETS)) {
+		m_writer.Write(t_pool);
+		m_writer.WriteArray(t_sets, t_count);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+void CaptureLayer::PreCallUpdateDescriptorSets(VkDevice, uint32_t t_write_count, VkWriteDescriptorSet const * t_writes, uint32_t t_copy_count, VkCopyDescriptorSet const * t_copies)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (!Begin(CC_UPDATE_DESCRIPTOR_SETS)) {
+		return;
+	}
+
+	m_writer.Write(t_write_count);
+	for (auto i = uint32_t{ 0 }; i < t_write_count; ++i) {
+		auto const & write = t_writes[i];
+		m_writer.Write(write);
+		switch (write.descriptorType) {
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+			m_writer.WriteArray(write.pImageInfo, write.descriptorCount);
+			break;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+			m_writer.WriteArray(write.pTexelBufferView, write.descriptorCount);
+			break;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+			m_writer.WriteArray(write.pBufferInfo, write.descriptorCount);
+			break;
+		default:
+			// Inline and acceleration structure writes live in pNext, which is not captured
+			m_writer.WriteArray(static_cast<VkDescriptorBufferInfo const *>(nullptr), 0);
+			break;
+		}
+	}
+	m_writer.WriteArray(t_copies, t_copy_count);
+	End();
+}
+
+VkResult CaptureLayer::PostCallCreateCommandPool(VkDevice, VkCommandPoolCreateInfo const * t_info, VkAllocationCallbacks const *, VkCommandPool * t_pool, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS && Begin(CC_CREATE_COMMAND_POOL)) {
+		m_writer.Write(*t_pool);
+		m_writer.Write(*t_info);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallResetCommandPool(VkDevice, VkCommandPool t_pool, VkCommandPoolResetFlags t_flags, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS && Begin(CC_RESET_COMMAND_POOL)) {
+		m_writer.Write(t_pool);
+		m_writer.Write(t_flags);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallAllocateCommandBuffers(VkDevice, VkCommandBufferAllocateInfo const * t_info, VkCommandBuffer * t_command_buffers, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS && Begin(CC_ALLOCATE_COMMAND_BUFFERS)) {
+		m_writer.Write(*t_info);
+		m_writer.WriteArray(t_command_buffers, t_info->commandBufferCount);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+void CaptureLayer::PreCallFreeCommandBuffers(VkDevice, VkCommandPool t_pool, uint32_t t_count, VkCommandBuffer const * t_command_buffers)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_FREE_COMMAND_BUFFERS)) {
+		m_writer.Write(t_pool);
+		m_writer.WriteArray(t_command_buffers, t_count);
+		End();
+	}
+}
+
+VkResult CaptureLayer::PreCallBeginCommandBuffer(VkCommandBuffer t_command_buffer, VkCommandBufferBeginInfo const * t_info)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_BEGIN_COMMAND_BUFFER)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(*t_info);
+		m_writer.WriteOptional(t_info->pInheritanceInfo);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PreCallEndCommandBuffer(VkCommandBuffer t_command_buffer)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_END_COMMAND_BUFFER)) {
+		m_writer.Write(t_command_buffer);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PreCallResetCommandBuffer(VkCommandBuffer t_command_buffer, VkCommandBufferResetFlags t_flags)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_RESET_COMMAND_BUFFER)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_flags);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+void CaptureLayer::PreCallDestroyBuffer(VkDevice, VkBuffer t_buffer, VkAllocationCallbacks const *)
+{
+	{
+		auto lock = std::lock_guard<std::mutex>{ m_mutex };
+		m_unbound_buffers.erase(t_buffer);
+	}
+	RecordDestroy(VK_OBJECT_TYPE_BUFFER, HandleValue(t_buffer));
+}
+
+void CaptureLayer::PreCallDestroyImage(VkDevice, VkImage t_image, VkAllocationCallbacks const *)
+{
+	RecordDestroy(VK_OBJECT_TYPE_IMAGE, HandleValue(t_image));
+}
+
+void CaptureLayer::PreCallDestroyImageView(VkDevice, VkImageView t_view, VkAllocationCallbacks const *)
+{
+	RecordDestroy(VK_OBJECT_TYPE_IMAGE_VIEW, HandleValue(t_view));
+}
+
+void CaptureLayer::PreCallDestroySampler(VkDevice, VkSampler t_sampler, VkAllocationCallbacks const *)
+{
+	RecordDestroy(VK_OBJECT_TYPE_SAMPLER, HandleValue(t_sampler));
+}
+
+void CaptureLayer::PreCallDestroySemaphore(VkDevice, VkSemaphore t_semaphore, VkAllocationCallbacks const *)
+{
+	RecordDestroy(VK_OBJECT_TYPE_SEMAPHORE, HandleValue(t_semaphore));
+}
+
+void CaptureLayer::PreCallDestroyFence(VkDevice, VkFence t_fence, VkAllocationCallbacks const *)
+{
+	RecordDestroy(VK_OBJECT_TYPE_FENCE, HandleValue(t_fence));
+}
+
+void CaptureLayer::PreCallDestroyQueryPool(VkDevice, VkQueryPool t_pool, VkAllocationCallbacks const *)
+{
+	RecordDestroy(VK_OBJECT_TYPE_QUERY_POOL, HandleValue(t_pool));
+}
+
+void CaptureLayer::PreCallDestroyShaderModule(VkDevice, VkShaderModule t_module, VkAllocationCallbacks const *)
+{
+	RecordDestroy(VK_OBJECT_TYPE_SHADER_MODULE, HandleValue(t_module));
+}
+
+void CaptureLayer::PreCallDestroyDescriptorSetLayout(VkDevice, VkDescriptorSetLayout t_layout, VkAllocationCallbacks const *)
+{
+	RecordDestroy(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, HandleValue(t_layout));
+}
+
+void CaptureLayer::PreCallDestroyPipelineLayout(VkDevice, VkPipelineLayout t_layout, VkAllocationCallbacks const *)
+{
+	RecordDestroy(VK_OBJECT_TYPE_PIPELINE_LAYOUT, HandleValue(t_layout));
+}
+
+void CaptureLayer::PreCallDestroyRenderPass(VkDevice, VkRenderPass t_render_pass, VkAllocationCallbacks const *)
+{
+	RecordDestroy(VK_OBJECT_TYPE_RENDER_PASS, HandleValue(t_render_pass));
+}
+
+void CaptureLayer::PreCallDestroyFramebuffer(VkDevice, VkFramebuffer t_framebuffer, VkAllocationCallbacks const *)
+{
+	RecordDestroy(VK_OBJECT_TYPE_FRAMEBUFFER, HandleValue(t_framebuffer));
+}
+
+void CaptureLayer::PreCallDestroyPipeline(VkDevice, VkPipeline t_pipeline, VkAllocationCallbacks const *)
+{
+	RecordDestroy(VK_OBJECT_TYPE_PIPELINE, HandleValue(t_pipeline));
+}
+
+void CaptureLayer::PreCallDestroyDescriptorPool(VkDevice, VkDescriptorPool t_pool, VkAllocationCallbacks const *)
+{
+	RecordDestroy(VK_OBJECT_TYPE_DESCRIPTOR_POOL, HandleValue(t_pool));
+}
+
+void CaptureLayer::PreCallDestroyCommandPool(VkDevice, VkCommandPool t_pool, VkAllocationCallbacks const *)
+{
+	RecordDestroy(VK_OBJECT_TYPE_COMMAND_POOL, HandleValue(t_pool));
+}
+
+void CaptureLayer::PreCallDestroySwapchainKHR(VkDevice, VkSwapchainKHR t_swapchain, VkAllocationCallbacks const *)
+{
+	RecordDestroy(VK_OBJECT_TYPE_SWAPCHAIN_KHR, HandleValue(t_swapchain));
+}
+
+void CaptureLayer::PreCallCmdBindPipeline(VkCommandBuffer t_command_buffer, VkPipelineBindPoint t_bind_point, VkPipeline t_pipeline)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_BIND_PIPELINE)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_bind_point);
+		m_writer.Write(t_pipeline);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdBindDescriptorSets(VkCommandBuffer t_command_buffer, VkPipelineBindPoint t_bind_point, VkPipelineLayout t_layout,
+	uint32_t t_first_set, uint32_t t_set_count, VkDescriptorSet const * t_sets, uint32_t t_dynamic_offset_count, uint32_t const * t_dynamic_offsets)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_BIND_DESCRIPTOR_SETS)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_bind_point);
+		m_writer.Write(t_layout);
+		m_writer.Write(t_first_set);
+		m_writer.WriteArray(t_sets, t_set_count);
+		m_writer.WriteArray(t_dynamic_offsets, t_dynamic_offset_count);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdBindVertexBuffers(VkCommandBuffer t_command_buffer, uint32_t t_first_binding, uint32_t t_binding_count, VkBuffer const * t_buffers, VkDeviceSize const * t_offsets)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_BIND_VERTEX_BUFFERS)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_first_binding);
+		m_writer.WriteArray(t_buffers, t_binding_count);
+		m_writer.WriteArray(t_offsets, t_binding_count);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdBindIndexBuffer(VkCommandBuffer t_command_buffer, VkBuffer t_buffer, VkDeviceSize t_offset, VkIndexType t_index_type)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_BIND_INDEX_BUFFER)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_buffer);
+		m_writer.Write(t_offset);
+		m_writer.Write(t_index_type);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdSetViewport(VkCommandBuffer t_command_buffer, uint32_t t_first_viewport, uint32_t t_viewport_count, VkViewport const * t_viewports)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_SET_VIEWPORT)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_first_viewport);
+		m_writer.WriteArray(t_viewports, t_viewport_count);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdSetScissor(VkCommandBuffer t_command_buffer, uint32_t t_first_scissor, uint32_t t_scissor_count, VkRect2D const * t_scissors)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_SET_SCISSOR)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_first_scissor);
+		m_writer.WriteArray(t_scissors, t_scissor_count);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdPushConstants(VkCommandBuffer t_command_buffer, VkPipelineLayout t_layout, VkShaderStageFlags t_stages, uint32_t t_offset, uint32_t t_size, void const * t_values)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_PUSH_CONSTANTS)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_layout);
+		m_writer.Write(t_stages);
+		m_writer.Write(t_offset);
+		m_writer.WriteBytes(t_values, t_size);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdDraw(VkCommandBuffer t_command_buffer, uint32_t t_vertex_count, uint32_t t_instance_count, uint32_t t_first_vertex, uint32_t t_first_instance)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_DRAW)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_vertex_count);
+		m_writer.Write(t_instance_count);
+		m_writer.Write(t_first_vertex);
+		m_writer.Write(t_first_instance);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdDrawIndexed(VkCommandBuffer t_command_buffer, uint32_t t_index_count, uint32_t t_instance_count, uint32_t t_first_index, int32_t t_vertex_offset, uint32_t t_first_instance)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_DRAW_INDEXED)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_index_count);
+		m_writer.Write(t_instance_count);
+		m_writer.Write(t_first_index);
+		m_writer.Write(t_vertex_offset);
+		m_writer.Write(t_first_instance);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdDrawIndirect(VkCommandBuffer t_command_buffer, VkBuffer t_buffer, VkDeviceSize t_offset, uint32_t t_draw_count, uint32_t t_stride)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_DRAW_INDIRECT)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_buffer);
+		m_writer.Write(t_offset);
+		m_writer.Write(t_draw_count);
+		m_writer.Write(t_stride);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdDrawIndexedIndirect(VkCommandBuffer t_command_buffer, VkBuffer t_buffer, VkDeviceSize t_offset, uint32_t t_draw_count, uint32_t t_stride)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_DRAW_INDEXED_INDIRECT)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_buffer);
+		m_writer.Write(t_offset);
+		m_writer.Write(t_draw_count);
+		m_writer.Write(t_stride);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdDrawIndirectCount(VkCommandBuffer t_command_buffer, VkBuffer t_buffer, VkDeviceSize t_offset, VkBuffer t_count_buffer,
+	VkDeviceSize t_count_offset, uint32_t t_max_draw_count, uint32_t t_stride)
+{
+	RecordDrawIndirectCount(t_command_buffer, t_buffer, t_offset, t_count_buffer, t_count_offset, t_max_draw_count, t_stride);
+}
+
+void CaptureLayer::PreCallCmdDrawIndirectCountKHR(VkCommandBuffer t_command_buffer, VkBuffer t_buffer, VkDeviceSize t_offset, VkBuffer t_count_buffer,
+	VkDeviceSize t_count_offset, uint32_t t_max_draw_count, uint32_t t_stride)
+{
+	RecordDrawIndirectCount(t_command_buffer, t_buffer, t_offset, t_count_buffer, t_count_offset, t_max_draw_count, t_stride);
+}
+
+void CaptureLayer::PreCallCmdDispatch(VkCommandBuffer t_command_buffer, uint32_t t_x, uint32_t t_y, uint32_t t_z)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_DISPATCH)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_x);
+		m_writer.Write(t_y);
+		m_writer.Write(t_z);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdCopyBuffer(VkCommandBuffer t_command_buffer, VkBuffer t_source, VkBuffer t_destination, uint32_t t_region_count, VkBufferCopy const * t_regions)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_COPY_BUFFER)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_source);
+		m_writer.Write(t_destination);
+		m_writer.WriteArray(t_regions, t_region_count);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdCopyImage(VkCommandBuffer t_command_buffer, VkImage t_source, VkImageLayout t_source_layout, VkImage t_destination,
+	VkImageLayout t_destination_layout, uint32_t t_region_count, VkImageCopy const * t_regions)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_COPY_IMAGE)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_source);
+		m_writer.Write(t_source_layout);
+		m_writer.Write(t_destination);
+		m_writer.Write(t_destination_layout);
+		m_writer.WriteArray(t_regions, t_region_count);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdCopyBufferToImage(VkCommandBuffer t_command_buffer, VkBuffer t_source, VkImage t_destination, VkImageLayout t_layout,
+	uint32_t t_region_count, VkBufferImageCopy const * t_regions)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_COPY_BUFFER_TO_IMAGE)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_source);
+		m_writer.Write(t_destination);
+		m_writer.Write(t_layout);
+		m_writer.WriteArray(t_regions, t_region_count);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdCopyImageToBuffer(VkCommandBuffer t_command_buffer, VkImage t_source, VkImageLayout t_layout, VkBuffer t_destination,
+	uint32_t t_region_count, VkBufferImageCopy const * t_regions)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_COPY_IMAGE_TO_BUFFER)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_source);
+		m_writer.Write(t_layout);
+		m_writer.Write(t_destination);
+		m_writer.WriteArray(t_regions, t_region_count);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdBlitImage(VkCommandBuffer t_command_buffer, VkImage t_source, VkImageLayout t_source_layout, VkImage t_destination,
+	VkImageLayout t_destination_layout, uint32_t t_region_count, VkImageBlit const * t_regions, VkFilter t_filter)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_BLIT_IMAGE)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_source);
+		m_writer.Write(t_source_layout);
+		m_writer.Write(t_destination);
+		m_writer.Write(t_destination_layout);
+		m_writer.WriteArray(t_regions, t_region_count);
+		m_writer.Write(t_filter);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdFillBuffer(VkCommandBuffer t_command_buffer, VkBuffer t_buffer, VkDeviceSize t_offset, VkDeviceSize t_size, uint32_t t_data)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_FILL_BUFFER)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_buffer);
+		m_writer.Write(t_offset);
+		m_writer.Write(t_size);
+		m_writer.Write(t_data);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdUpdateBuffer(VkCommandBuffer t_command_buffer, VkBuffer t_buffer, VkDeviceSize t_offset, VkDeviceSize t_size, void const * t_data)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_UPDATE_BUFFER)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_buffer);
+		m_writer.Write(t_offset);
+		m_writer.WriteBytes(t_data, t_size);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdPipelineBarrier(VkCommandBuffer t_command_buffer, VkPipelineStageFlags t_source_stages, VkPipelineStageFlags t_destination_stages,
+	VkDependencyFlags t_dependencies, uint32_t t_memory_count, VkMemoryBarrier const * t_memory_barriers, uint32_t t_buffer_count,
+	VkBufferMemoryBarrier const * t_buffer_barriers, uint32_t t_image_count, VkImageMemoryBarrier const * t_image_barriers)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_PIPELINE_BARRIER)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_source_stages);
+		m_writer.Write(t_destination_stages);
+		m_writer.Write(t_dependencies);
+		m_writer.WriteArray(t_memory_barriers, t_memory_count);
+		m_writer.WriteArray(t_buffer_barriers, t_buffer_count);
+		m_writer.WriteArray(t_image_barriers, t_image_count);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdBeginRenderPass(VkCommandBuffer t_command_buffer, VkRenderPassBeginInfo const * t_info, VkSubpassContents t_contents)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_BEGIN_RENDER_PASS)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(*t_info);
+		m_writer.WriteArray(t_info->pClearValues, t_info->clearValueCount);
+		m_writer.Write(t_contents);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdNextSubpass(VkCommandBuffer t_command_buffer, VkSubpassContents t_contents)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_NEXT_SUBPASS)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_contents);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdEndRenderPass(VkCommandBuffer t_command_buffer)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_END_RENDER_PASS)) {
+		m_writer.Write(t_command_buffer);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdResetQueryPool(VkCommandBuffer t_command_buffer, VkQueryPool t_pool, uint32_t t_first, uint32_t t_count)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_RESET_QUERY_POOL)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_pool);
+		m_writer.Write(t_first);
+		m_writer.Write(t_count);
+		End();
+	}
+}
+
+void CaptureLayer::PreCallCmdWriteTimestamp(VkCommandBuffer t_command_buffer, VkPipelineStageFlagBits t_stage, VkQueryPool t_pool, uint32_t t_query)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_WRITE_TIMESTAMP)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_stage);
+		m_writer.Write(t_pool);
+		m_writer.Write(t_query);
+		End();
+	}
+}
+
+VkResult CaptureLayer::PostCallCreateSwapchainKHR(VkDevice, VkSwapchainCreateInfoKHR const * t_info, VkAllocationCallbacks const *, VkSwapchainKHR * t_swapchain, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_result == VK_SUCCESS && Begin(CC_CREATE_SWAPCHAIN)) {
+		m_writer.Write(*t_swapchain);
+		m_writer.Write(*t_info);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallGetSwapchainImagesKHR(VkDevice, VkSwapchainKHR t_swapchain, uint32_t * t_count, VkImage * t_images, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	// The count query has nothing to replay
+	if ((t_result == VK_SUCCESS || t_result == VK_INCOMPLETE) && t_images != nullptr && Begin(CC_GET_SWAPCHAIN_IMAGES)) {
+		m_writer.Write(t_swapchain);
+		m_writer.WriteArray(t_images, *t_count);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PostCallAcquireNextImageKHR(VkDevice, VkSwapchainKHR t_swapchain, uint64_t, VkSemaphore t_semaphore, VkFence t_fence, uint32_t * t_index, VkResult t_result)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if ((t_result == VK_SUCCESS || t_result == VK_SUBOPTIMAL_KHR) && Begin(CC_ACQUIRE_NEXT_IMAGE)) {
+		m_writer.Write(t_swapchain);
+		m_writer.Write(t_semaphore);
+		m_writer.Write(t_fence);
+		m_writer.Write(*t_index);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+VkResult CaptureLayer::PreCallQueuePresentKHR(VkQueue t_queue, VkPresentInfoKHR const * t_info)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_QUEUE_PRESENT)) {
+		m_writer.Write(t_queue);
+		m_writer.WriteArray(t_info->pWaitSemaphores, t_info->waitSemaphoreCount);
+		End();
+	}
+	return VK_SUCCESS;
+}
+
+bool CaptureLayer::Begin(CAPTURE_CALL t_call)
+{
+	if (!m_capturing) {
+		return false;
+	}
+
+	try {
+		m_writer.Begin(t_call);
+	}
+	catch (std::exception & error) {
+		Fail(error.what());
+		return false;
+	}
+	m_call = t_call;
+	return true;
+}
+
+void CaptureLayer::End()
+{
+	if (m_call != m_frame_call) {
+		return;
+	}
+
+	try {
+		m_writer.EndFrame();
+		if (m_writer.GetFrameCount() >= m_frame_limit) {
+			Finish();
+		}
+	}
+	catch (std::exception & error) {
+		Fail(error.what());
+	}
+}
+
+void CaptureLayer::Finish()
+{
+	m_writer.Destroy();
+	m_capturing = false;
+	m_memory.clear();
+	Information("SuperNova capture - " + std::to_string(m_frame_limit) + " frames written to " + m_file_path);
+}
+
+void CaptureLayer::Fail(char const * t_error) noexcept
+{
+	m_capturing = false;
+	m_memory.clear();
+	try {
+		Error(std::string{ "SuperNova capture - Capture abandoned, " } + t_error);
+		m_writer.Destroy();
+	}
+	catch (std::exception &) {
+	}
+}
+
+void CaptureLayer::NoteGenericCall(char const * t_api_name, uint32_t t_hook)
+{
+	// Every recorded entry point overrides its pre or its post hook, one that
+	// reaches both defaults has no record
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (!m_capturing) {
+		return;
+	}
+
+	auto & hooks = m_generic_calls[t_api_name];
+	hooks |= t_hook;
+	if (hooks != (GENERIC_PRE | GENERIC_POST)) {
+		return;
+	}
+	hooks |= GENERIC_REPORTED;
+	if (!IsUnrecorded(t_api_name)) {
+		Warning("SuperNova capture - " + std::string{ t_api_name } + " is not captured, the replay leaves it out");
+	}
+}
+
+void CaptureLayer::RecordDestroy(VkObjectType t_type, uint64_t t_handle)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (t_handle != 0 && Begin(CC_DESTROY)) {
+		m_writer.Write(t_type);
+		m_writer.Write(t_handle);
+		End();
+	}
+}
+
+void CaptureLayer::RecordFenceWait(uint32_t t_count, VkFence const * t_fences, VkBool32 t_wait_all)
+{
+	if (Begin(CC_WAIT_FOR_FENCES)) {
+		m_writer.WriteArray(t_fences, t_count);
+		m_writer.Write(t_wait_all);
+		End();
+	}
+}
+
+void CaptureLayer::RecordSemaphoreWait(VkSemaphoreWaitInfo const & t_info)
+{
+	if (Begin(CC_WAIT_SEMAPHORES)) {
+		m_writer.Write(t_info);
+		m_writer.WriteArray(t_info.pSemaphores, t_info.semaphoreCount);
+		m_writer.WriteArray(t_info.pValues, t_info.semaphoreCount);
+		End();
+	}
+}
+
+void CaptureLayer::RecordDrawIndirectCount(VkCommandBuffer t_command_buffer, VkBuffer t_buffer, VkDeviceSize t_offset, VkBuffer t_count_buffer,
+	VkDeviceSize t_count_offset, uint32_t t_max_draw_count, uint32_t t_stride)
+{
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	if (Begin(CC_CMD_DRAW_INDIRECT_COUNT)) {
+		m_writer.Write(t_command_buffer);
+		m_writer.Write(t_buffer);
+		m_writer.Write(t_offset);
+		m_writer.Write(t_count_buffer);
+		m_writer.Write(t_count_offset);
+		m_writer.Write(t_max_draw_count);
+		m_writer.Write(t_stride);
+		End();
+	}
+}
+
+void CaptureLayer::WriteNext(void const * t_next)
+{
+	if (m_writer.WriteNext(t_next)) {
+		return;
+	}
+
+	for (auto next = static_cast<VkBaseInStructure const *>(t_next); next != nullptr; next = next->pNext) {
+		auto captured = next->sType == VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO || GetPlainNextSize(next->sType) > 0;
+		if (captured || std::find(m_dropped_structs.begin(), m_dropped_structs.end(), next->sType) != m_dropped_structs.end()) {
+			continue;
+		}
+		m_dropped_structs.emplace_back(next->sType);
+		Warning("SuperNova capture - Extension struct " + std::to_string(next->sType) + " is not captured, the replay leaves it out");
+	}
+}
+
+void CaptureLayer::FlushMemory(VkDeviceMemory t_memory, MemoryState & t_state)
+{
+	// Whatever changed in readback memory was written by the GPU
+	auto readback = t_state.host_cached_only || (t_state.readback_bound && !t_state.other_bound);
+	if (t_state.mapped == nullptr || readback) {
+		return;
+	}
+
+	auto const begin = t_state.mapped_offset;
+	auto const end = begin + t_state.mapped_size;
+	auto differs = [&t_state, begin, end](VkDeviceSize t_page) {
+		auto size = static_cast<size_t>(std::min(t_page + CAPTURE_PAGE_SIZE, end) - t_page);
+		return std::memcmp(t_state.shadow.data() + t_page, t_state.mapped + (t_page - begin), size) != 0;
+	};
+
+	for (auto page = begin; page < end;) {
+		if (!differs(page)) {
+			page += CAPTURE_PAGE_SIZE;
+			continue;
+		}
+
+		auto run_begin = page;
+		while (page < end && differs(page)) {
+			page += CAPTURE_PAGE_SIZE;
+		}
+		auto run_end = std::min(page, end);
+		auto size = static_cast<size_t>(run_end - run_begin);
+		std::memcpy(t_state.shadow.data() + run_begin, t_state.mapped + (run_begin - begin), size);
+
+		if (Begin(CC_MEMORY_WRITE)) {
+			m_writer.Write(t_memory);
+			m_writer.Write(run_begin);
+			m_writer.WriteBytes(t_state.shadow.data() + run_begin, size);
+			End();
+		}
+	}
+}
@@ -0,0 +1,202 @@
+#ifndef CAPTURE_LAYER
+#define CAPTURE_LAYER
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "vk_layer_logging.h"
+#include "layer_factory.h"
+#include "CaptureWriter.h"
+
+// Vulkan layer recording what the application asks of one device for a number
+// of frames, for the replayer to issue again. The stream starts at instance
+// creation, so every object the frames use is created in it, and closes once
+// the frames are captured, the application runs on untouched.
+//
+// Host writes to mapped memory are found by comparing every mapped allocation
+// with a copy of what the stream already holds, page by page, before each
+// submit and unmap; only the pages that changed are written. The copy starts
+// zeroed and the replayer zeroes memory it maps the first time, so both sides
+// agree on bytes the application never wrote. Readback memory is never compared,
+// the GPU writes it and the replay does the same: memory of a host cached type
+// that is not coherent, or memory holding nothing but transfer destination
+// buffers.
+//
+// Queries, waits and polls the application made are replayed as waits once the
+// capture saw them succeed, a replay never runs ahead of what the application
+// observed. Swapchains become plain images on replay, presents and acquires
+// only keep semaphores and fences in step. Calls the stream has no record for
+// are reported once through the debug callbacks, the replay may differ from
+// the application where they matter.
+//
+// Environment:
+//     SUPERNOVA_CAPTURE_FILE        capture to write, VulkanCapture.sncap by default
+//     SUPERNOVA_CAPTURE_FRAMES      frames to capture, 10 by default
+//     SUPERNOVA_CAPTURE_FRAME_CALL  entry point ending each frame, vkQueuePresentKHR
+//                                   by default, vkCmdResetQueryPool for --headless
+class CaptureLayer : public layer_factory
+{
+public:
+	explicit CaptureLayer();
+	CaptureLayer(CaptureLayer const &) = delete;
+	CaptureLayer(CaptureLayer &&) = delete;
+	CaptureLayer & operator = (CaptureLayer const &) = delete;
+	CaptureLayer & operator = (CaptureLayer &&) = delete;
+	~CaptureLayer() noexcept;
+
+	void PreCallApiFunction(char const *) final;
+	void PostCallApiFunction(char const *) final;
+	void PostCallApiFunction(char const *, VkResult) final;
+
+	void PostCallGetPhysicalDeviceProperties(VkPhysicalDevice, VkPhysicalDeviceProperties *) final;
+	void PostCallGetPhysicalDeviceMemoryProperties(VkPhysicalDevice, VkPhysicalDeviceMemoryProperties *) final;
+	void PostCallGetPhysicalDeviceMemoryProperties2(VkPhysicalDevice, VkPhysicalDeviceMemoryProperties2 *) final;
+
+	VkResult PostCallCreateInstance(VkInstanceCreateInfo const *, VkAllocationCallbacks const *, VkInstance *, VkResult) final;
+	VkResult PostCallCreateDevice(VkPhysicalDevice, VkDeviceCreateInfo const *, VkAllocationCallbacks const *, VkDevice *, VkResult) final;
+	void PostCallGetDeviceQueue(VkDevice, uint32_t, uint32_t, VkQueue *) final;
+	VkResult PostCallDeviceWaitIdle(VkDevice, VkResult) final;
+	VkResult PostCallQueueWaitIdle(VkQueue, VkResult) final;
+	VkResult PreCallQueueSubmit(VkQueue, uint32_t, VkSubmitInfo const *, VkFence) final;
+
+	VkResult PostCallAllocateMemory(VkDevice, VkMemoryAllocateInfo const *, VkAllocationCallbacks const *, VkDeviceMemory *, VkResult) final;
+	void PreCallFreeMemory(VkDevice, VkDeviceMemory, VkAllocationCallbacks const *) final;
+	VkResult PostCallMapMemory(VkDevice, VkDeviceMemory, VkDeviceSize, VkDeviceSize, VkMemoryMapFlags, void **, VkResult) final;
+	void PreCallUnmapMemory(VkDevice, VkDeviceMemory) final;
+	VkResult PostCallBindBufferMemory(VkDevice, VkBuffer, VkDeviceMemory, VkDeviceSize, VkResult) final;
+	VkResult PostCallBindImageMemory(VkDevice, VkImage, VkDeviceMemory, VkDeviceSize, VkResult) final;
+
+	VkResult PostCallCreateBuffer(VkDevice, VkBufferCreateInfo const *, VkAllocationCallbacks const *, VkBuffer *, VkResult) final;
+	VkResult PostCallCreateImage(VkDevice, VkImageCreateInfo const *, VkAllocationCallbacks const *, VkImage *, VkResult) final;
+	VkResult PostCallCreateImageView(VkDevice, VkImageViewCreateInfo const *, VkAllocationCallbacks const *, VkImageView *, VkResult) final;
+	VkResult PostCallCreateSampler(VkDevice, VkSamplerCreateInfo const *, VkAllocationCallbacks const *, VkSampler *, VkResult) final;
+	VkResult PostCallCreateSemaphore(VkDevice, VkSemaphoreCreateInfo const *, VkAllocationCallbacks const *, VkSemaphore *, VkResult) final;
+	VkResult PostCallCreateFence(VkDevice, VkFenceCreateInfo const *, VkAllocationCallbacks const *, VkFence *, VkResult) final;
+	VkResult PostCallWaitForFences(VkDevice, uint32_t, VkFence const *, VkBool32, uint64_t, VkResult) final;
+	VkResult PostCallResetFences(VkDevice, uint32_t, VkFence const *, VkResult) final;
+	VkResult PostCallGetFenceStatus(VkDevice, VkFence, VkResult) final;
+	VkResult PostCallWaitSemaphores(VkDevice, VkSemaphoreWaitInfo const *, uint64_t, VkResult) final;
+	VkResult PostCallWaitSemaphoresKHR(VkDevice, VkSemaphoreWaitInfo const *, uint64_t, VkResult) final;
+	VkResult PostCallGetSemaphoreCounterValue(VkDevice, VkSemaphore, uint64_t *, VkResult) final;
+	VkResult PostCallGetSemaphoreCounterValueKHR(VkDevice, VkSemaphore, uint64_t *, VkResult) final;
+	VkResult PostCallCreateQueryPool(VkDevice, VkQueryPoolCreateInfo const *, VkAllocationCallbacks const *, VkQueryPool *, VkResult) final;
+	VkResult PostCallGetQueryPoolResults(VkDevice, VkQueryPool, uint32_t, uint32_t, size_t, void *, VkDeviceSize, VkQueryResultFlags, VkResult) final;
+
+	VkResult PostCallCreateShaderModule(VkDevice, VkShaderModuleCreateInfo const *, VkAllocationCallbacks const *, VkShaderModule *, VkResult) final;
+	VkResult PostCallCreateDescriptorSetLayout(VkDevice, VkDescriptorSetLayoutCreateInfo const *, VkAllocationCallbacks const *, VkDescriptorSetLayout *, VkResult) final;
+	VkResult PostCallCreatePipelineLayout(VkDevice, VkPipelineLayoutCreateInfo const *, VkAllocationCallbacks const *, VkPipelineLayout *, VkResult) final;
+	VkResult PostCallCreateRenderPass(VkDevice, VkRenderPassCreateInfo const *, VkAllocationCallbacks const *, VkRenderPass *, VkResult) final;
+	VkResult PostCallCreateFramebuffer(VkDevice, VkFramebufferCreateInfo const *, VkAllocationCallbacks const *, VkFramebuffer *, VkResult) final;
+	VkResult PostCallCreateGraphicsPipelines(VkDevice, VkPipelineCache, uint32_t, VkGraphicsPipelineCreateInfo const *, VkAllocationCallbacks const *, VkPipeline *, VkResult) final;
+	VkResult PostCallCreateComputePipelines(VkDevice, VkPipelineCache, uint32_t, VkComputePipelineCreateInfo const *, VkAllocationCallbacks const *, VkPipeline *, VkResult) final;
+	VkResult PostCallCreateDescriptorPool(VkDevice, VkDescriptorPoolCreateInfo const *, VkAllocationCallbacks const *, VkDescriptorPool *, VkResult) final;
+	VkResult PostCallResetDescriptorPool(VkDevice, VkDescriptorPool, VkDescriptorPoolResetFlags, VkResult) final;
+	VkResult PostCallAllocateDescriptorSets(VkDevice, VkDescriptorSetAllocateInfo const *, VkDescriptorSet *, VkResult) final;
+	VkResult PreCallFreeDescriptorSets(VkDevice, VkDescriptorPool, uint32_t, VkDescriptorSet const *) final;
+	void PreCallUpdateDescriptorSets(VkDevice, uint32_t, VkWriteDescriptorSet const *, uint32_t, VkCopyDescriptorSet const *) final;
+
+	VkResult PostCallCreateCommandPool(VkDevice, VkCommandPoolCreateInfo const *, VkAllocationCallbacks const *, VkCommandPool *, VkResult) final;
+	VkResult PostCallResetCommandPool(VkDevice, VkCommandPool, VkCommandPoolResetFlags, VkResult) final;
+	VkResult PostCallAllocateCommandBuffers(VkDevice, VkCommandBufferAllocateInfo const *, VkCommandBuffer *, VkResult) final;
+	void PreCallFreeCommandBuffers(VkDevice, VkCommandPool, uint32_t, VkCommandBuffer const *) final;
+	VkResult PreCallBeginCommandBuffer(VkCommandBuffer, VkCommandBufferBeginInfo const *) final;
+	VkResult PreCallEndCommandBuffer(VkCommandBuffer) final;
+	VkResult PreCallResetCommandBuffer(VkCommandBuffer, VkCommandBufferResetFlags) final;
+
+	void PreCallDestroyBuffer(VkDevice, VkBuffer, VkAllocationCallbacks const *) final;
+	void PreCallDestroyImage(VkDevice, VkImage, VkAllocationCallbacks const *) final;
+	void PreCallDestroyImageView(VkDevice, VkImageView, VkAllocationCallbacks const *) final;
+	void PreCallDestroySampler(VkDevice, VkSampler, VkAllocationCallbacks const *) final;
+	void PreCallDestroySemaphore(VkDevice, VkSemaphore, VkAllocationCallbacks const *) final;
+	void PreCallDestroyFence(VkDevice, VkFence, VkAllocationCallbacks const *) final;
+	void PreCallDestroyQueryPool(VkDevice, VkQueryPool, VkAllocationCallbacks const *) final;
+	void PreCallDestroyShaderModule(VkDevice, VkShaderModule, VkAllocationCallbacks const *) final;
+	void PreCallDestroyDescriptorSetLayout(VkDevice, VkDescriptorSetLayout, VkAllocationCallbacks const *) final;
+	void PreCallDestroyPipelineLayout(VkDevice, VkPipelineLayout, VkAllocationCallbacks const *) final;
+	void PreCallDestroyRenderPass(VkDevice, VkRenderPass, VkAllocationCallbacks const *) final;
+	void PreCallDestroyFramebuffer(VkDevice, VkFramebuffer, VkAllocationCallbacks const *) final;
+	void PreCallDestroyPipeline(VkDevice, VkPipeline, VkAllocationCallbacks const *) final;
+	void PreCallDestroyDescriptorPool(VkDevice, VkDescriptorPool, VkAllocationCallbacks const *) final;
+	void PreCallDestroyCommandPool(VkDevice, VkCommandPool, VkAllocationCallbacks const *) final;
+	void PreCallDestroySwapchainKHR(VkDevice, VkSwapchainKHR, VkAllocationCallbacks const *) final;
+
+	void PreCallCmdBindPipeline(VkCommandBuffer, VkPipelineBindPoint, VkPipeline) final;
+	void PreCallCmdBindDescriptorSets(VkCommandBuffer, VkPipelineBindPoint, VkPipelineLayout, uint32_t, uint32_t, VkDescriptorSet const *, uint32_t, uint32_t const *) final;
+	void PreCallCmdBindVertexBuffers(VkCommandBuffer, uint32_t, uint32_t, VkBuffer const *, VkDeviceSize const *) final;
+	void PreCallCmdBindIndexBuffer(VkCommandBuffer, VkBuffer, VkDeviceSize, VkIndexType) final;
+	void PreCallCmdSetViewport(VkCommandBuffer, uint32_t, uint32_t, VkViewport const *) final;
+	void PreCallCmdSetScissor(VkCommandBuffer, uint32_t, uint32_t, VkRect2D const *) final;
+	void PreCallCmdPushConstants(VkCommandBuffer, VkPipelineLayout, VkShaderStageFlags, uint32_t, uint32_t, void const *) final;
+	void PreCallCmdDraw(VkCommandBuffer, uint32_t, uint32_t, uint32_t, uint32_t) final;
+	void PreCallCmdDrawIndexed(VkCommandBuffer, uint32_t, uint32_t, uint32_t, int32_t, uint32_t) final;
+	void PreCallCmdDrawIndirect(VkCommandBuffer, VkBuffer, VkDeviceSize, uint32_t, uint32_t) final;
+	void PreCallCmdDrawIndexedIndirect(VkCommandBuffer, VkBuffer, VkDeviceSize, uint32_t, uint32_t) final;
+	void PreCallCmdDrawIndirectCount(VkCommandBuffer, VkBuffer, VkDeviceSize, VkBuffer, VkDeviceSize, uint32_t, uint32_t) final;
+	void PreCallCmdDrawIndirectCountKHR(VkCommandBuffer, VkBuffer, VkDeviceSize, VkBuffer, VkDeviceSize, uint32_t, uint32_t) final;
+	void PreCallCmdDispatch(VkCommandBuffer, uint32_t, uint32_t, uint32_t) final;
+	void PreCallCmdCopyBuffer(VkCommandBuffer, VkBuffer, VkBuffer, uint32_t, VkBufferCopy const *) final;
+	void PreCallCmdCopyImage(VkCommandBuffer, VkImage, VkImageLayout, VkImage, VkImageLayout, uint32_t, VkImageCopy const *) final;
+	void PreCallCmdCopyBufferToImage(VkCommandBuffer, VkBuffer, VkImage, VkImageLayout, uint32_t, VkBufferImageCopy const *) final;
+	void PreCallCmdCopyImageToBuffer(VkCommandBuffer, VkImage, VkImageLayout, VkBuffer, uint32_t, VkBufferImageCopy const *) final;
+	void PreCallCmdBlitImage(VkCommandBuffer, VkImage, VkImageLayout, VkImage, VkImageLayout, uint32_t, VkImageBlit const *, VkFilter) final;
+	void PreCallCmdFillBuffer(VkCommandBuffer, VkBuffer, VkDeviceSize, VkDeviceSize, uint32_t) final;
+	void PreCallCmdUpdateBuffer(VkCommandBuffer, VkBuffer, VkDeviceSize, VkDeviceSize, void const *) final;
+	void PreCallCmdPipelineBarrier(VkCommandBuffer, VkPipelineStageFlags, VkPipelineStageFlags, VkDependencyFlags, uint32_t, VkMemoryBarrier const *,
+		uint32_t, VkBufferMemoryBarrier const *, uint32_t, VkImageMemoryBarrier const *) final;
+	void PreCallCmdBeginRenderPass(VkCommandBuffer, VkRenderPassBeginInfo const *, VkSubpassContents) final;
+	void PreCallCmdNextSubpass(VkCommandBuffer, VkSubpassContents) final;
+	void PreCallCmdEndRenderPass(VkCommandBuffer) final;
+	void PreCallCmdResetQueryPool(VkCommandBuffer, VkQueryPool, uint32_t, uint32_t) final;
+	void PreCallCmdWriteTimestamp(VkCommandBuffer, VkPipelineStageFlagBits, VkQueryPool, uint32_t) final;
+
+	VkResult PostCallCreateSwapchainKHR(VkDevice, VkSwapchainCreateInfoKHR const *, VkAllocationCallbacks const *, VkSwapchainKHR *, VkResult) final;
+	VkResult PostCallGetSwapchainImagesKHR(VkDevice, VkSwapchainKHR, uint32_t *, VkImage *, VkResult) final;
+	VkResult PostCallAcquireNextImageKHR(VkDevice, VkSwapchainKHR, uint64_t, VkSemaphore, VkFence, uint32_t *, VkResult) final;
+	VkResult PreCallQueuePresentKHR(VkQueue, VkPresentInfoKHR const *) final;
+
+private:
+	struct MemoryState {
+		VkDeviceSize size{ 0 };
+		// Where the mapped range starts, null while unmapped
+		uint8_t * mapped{ nullptr };
+		VkDeviceSize mapped_offset{ 0 };
+		VkDeviceSize mapped_size{ 0 };
+		// The whole allocation as the stream has it, made on first map
+		std::vector<uint8_t> shadow{};
+		bool host_cached_only{ false };
+		// What is bound to it, readback buffers only take transfer writes
+		bool readback_bound{ false };
+		bool other_bound{ false };
+	};
+
+	[[nodiscard]] bool Begin(CAPTURE_CALL);
+	void End();
+	void Finish();
+	void Fail(char const *) noexcept;
+	void NoteGenericCall(char const *, uint32_t);
+	void RecordDestroy(VkObjectType, uint64_t);
+	void RecordFenceWait(uint32_t, VkFence const *, VkBool32);
+	void RecordSemaphoreWait(VkSemaphoreWaitInfo const &);
+	void RecordDrawIndirectCount(VkCommandBuffer, VkBuffer, VkDeviceSize, VkBuffer, VkDeviceSize, uint32_t, uint32_t);
+	void WriteNext(void const *);
+	void FlushMemory(VkDeviceMemory, MemoryState &);
+
+	std::mutex m_mutex{};
+	CaptureWriter m_writer{};
+	bool m_capturing{ false };
+	CAPTURE_CALL m_call{ CC_COUNT };
+	CAPTURE_CALL m_frame_call{ CC_QUEUE_PRESENT };
+	uint32_t m_frame_limit{ 10 };
+	std::string m_file_path{ "VulkanCapture.sncap" };
+	std::unordered_map<VkPhysicalDevice, CaptureDeviceInfo> m_physical_devices{};
+	CaptureDeviceInfo m_device_info{};
+	std::unordered_map<VkDeviceMemory, MemoryState> m_memory{};
+	// Usage of each buffer not bound to memory yet
+	std::unordered_map<VkBuffer, VkBufferUsageFlags> m_unbound_buffers{};
+	// Generic hooks each entry point reached, see NoteGenericCall
+	std::unordered_map<char const *, uint32_t> m_generic_calls{};
+	std::vector<VkStructureType> m_dropped_structs{};
+};
+
+#endif // !CAPTURE_LAYER
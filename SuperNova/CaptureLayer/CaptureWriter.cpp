@@ -0,0 +1,128 @@
+#include "CaptureWriter.h"
+#include "LzCodec.h"
+#include <stdexcept>
+
+constexpr size_t CAPTURE_BLOCK_SIZE = size_t{ 4 } << 20;
+
+void CaptureWriter::Create(std::string const & t_path)
+{
+	m_file.open(t_path, std::ios::binary | std::ios::trunc);
+	if (!m_file) {
+		throw std::runtime_error("Capture writer - Could not create " + t_path);
+	}
+
+	auto header = CaptureFileHeader{};
+	m_file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+	m_block.reserve(CAPTURE_BLOCK_SIZE + CAPTURE_BLOCK_SIZE / 4);
+	m_block_position = 0;
+	m_frame_count = 0;
+}
+
+void CaptureWriter::Destroy()
+{
+	if (!m_file.is_open()) {
+		return;
+	}
+
+	FlushBlock();
+	auto header = CaptureFileHeader{};
+	header.frame_count = m_frame_count;
+	m_file.seekp(0);
+	m_file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+	m_file.close();
+	m_block = std::vector<uint8_t>{};
+}
+
+bool CaptureWriter::IsOpen() const noexcept
+{
+	return m_file.is_open();
+}
+
+uint32_t CaptureWriter::GetFrameCount() const noexcept
+{
+	return m_frame_count;
+}
+
+void CaptureWriter::Begin(CAPTURE_CALL t_call)
+{
+	if (m_block.size() >= CAPTURE_BLOCK_SIZE) {
+		FlushBlock();
+	}
+	Write(t_call);
+}
+
+void CaptureWriter::EndFrame()
+{
+	Begin(CC_FRAME_END);
+	++m_frame_count;
+	FlushBlock();
+}
+
+void CaptureWriter::WriteBytes(void const * t_data, uint64_t t_size)
+{
+	Write(t_size);
+	if (t_size > 0) {
+		Append(t_data, static_cast<size_t>(t_size), alignof(uint64_t));
+	}
+}
+
+void CaptureWriter::WriteString(char const * t_string)
+{
+	WriteArray(t_string, t_string != nullptr ? static_cast<uint32_t>(std::strlen(t_string) + 1) : 0);
+}
+
+bool CaptureWriter::WriteNext(void const * t_next)
+{
+	auto complete = true;
+	for (auto next = static_cast<VkBaseInStructure const *>(t_next); next != nullptr; next = next->pNext) {
+		if (next->sType == VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO) {
+			auto const & timeline = *reinterpret_cast<VkTimelineSemaphoreSubmitInfo const *>(next);
+			Write(next->sType);
+			Write(timeline);
+			WriteArray(timeline.pWaitSemaphoreValues, timeline.waitSemaphoreValueCount);
+			WriteArray(timeline.pSignalSemaphoreValues, timeline.signalSemaphoreValueCount);
+		}
+		else if (auto size = GetPlainNextSize(next->sType)) {
+			Write(next->sType);
+			Append(next, size, alignof(VkBaseInStructure));
+		}
+		else {
+			complete = false;
+		}
+	}
+	Write(VK_STRUCTURE_TYPE_MAX_ENUM);
+	return complete;
+}
+
+void CaptureWriter::Append(void const * t_data, size_t t_size, size_t t_alignment)
+{
+	auto position = m_block_position + m_block.size();
+	auto padding = static_cast<size_t>((t_alignment - position % t_alignment) % t_alignment);
+	m_block.resize(m_block.size() + padding + t_size);
+	std::memcpy(m_block.data() + m_block.size() - t_size, t_data, t_size);
+}
+
+void CaptureWriter::FlushBlock()
+{
+	if (m_block.empty()) {
+		return;
+	}
+
+	auto compressed = LzCodec::Compress(m_block.data(), m_block.size());
+	auto block = CaptureBlockHeader{ m_block.size(), compressed.size() };
+	auto stored = compressed.data();
+	if (compressed.size() >= m_block.size()) {
+		block.stored_size = block.size;
+		stored = m_block.data();
+	}
+
+	m_file.write(reinterpret_cast<char const *>(&block), sizeof(block));
+	m_file.write(reinterpret_cast<char const *>(stored), static_cast<std::streamsize>(block.stored_size));
+	m_file.flush();
+	if (!m_file) {
+		throw std::runtime_error("Capture writer - Could not write the capture");
+	}
+
+	m_block_position += m_block.size();
+	m_block.clear();
+}
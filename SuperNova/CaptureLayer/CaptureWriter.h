@@ -0,0 +1,80 @@
+#ifndef CAPTURE_WRITER
+#define CAPTURE_WRITER
+
+#include "CaptureFormat.h"
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Builds the call stream of a capture file, see CaptureFormat.h. Records
+// collect in a block that is compressed and written once it passes
+// CAPTURE_BLOCK_SIZE or a frame ends, so a capture cut short loses at most the
+// frame in flight. Not thread safe, the layer serialises its calls.
+class CaptureWriter
+{
+public:
+	explicit CaptureWriter() = default;
+	CaptureWriter(CaptureWriter const &) = delete;
+	CaptureWriter(CaptureWriter &&) noexcept = default;
+	CaptureWriter & operator = (CaptureWriter const &) = delete;
+	CaptureWriter & operator = (CaptureWriter &&) noexcept = default;
+	~CaptureWriter() noexcept = default;
+
+	void Create(std::string const &);
+	// Writes what is pending and the frame count
+	void Destroy();
+
+	[[nodiscard]] bool IsOpen() const noexcept;
+	[[nodiscard]] uint32_t GetFrameCount() const noexcept;
+
+	// Starts a record, the block is cut here once it is full
+	void Begin(CAPTURE_CALL);
+	// Between records only
+	void EndFrame();
+
+	template<typename T>
+	void Write(T const & t_value)
+	{
+		Append(&t_value, sizeof(T), alignof(T));
+	}
+
+	// Count first, a null array is written empty
+	template<typename T>
+	void WriteArray(T const * t_values, uint32_t t_count)
+	{
+		if (t_values == nullptr) {
+			t_count = 0;
+		}
+		Write(t_count);
+		if (t_count > 0) {
+			Append(t_values, sizeof(T) * t_count, alignof(T));
+		}
+	}
+
+	template<typename T>
+	void WriteOptional(T const * t_value)
+	{
+		Write(static_cast<VkBool32>(t_value != nullptr ? VK_TRUE : VK_FALSE));
+		if (t_value != nullptr) {
+			Write(*t_value);
+		}
+	}
+
+	void WriteBytes(void const *, uint64_t);
+	void WriteString(char const *);
+	// Returns false when the chain held structs it had to leave out
+	bool WriteNext(void const *);
+
+private:
+	void Append(void const *, size_t, size_t);
+	void FlushBlock();
+
+	std::ofstream m_file{};
+	std::vector<uint8_t> m_block{};
+	// Stream offset of the block's first byte, alignment counts from the stream start
+	uint64_t m_block_position{ 0 };
+	uint32_t m_frame_count{ 0 };
+};
+
+#endif // !CAPTURE_WRITER
@@ -3,24 +3,69 @@
 #include "date.h"
 #include "Module.h"
 #include "Renderer.h"
+#include "ShaderVariantCooker.h"
+#include "Telemetry.h"
+#include "TextureCooker.h"
+#include "World.h"
 
 std::stringstream Application::m_log{}; 
 std::ofstream Application::m_log_file{};
 
+// Cooking materials shares the renderer's compile cache
+constexpr char const * SHADER_CACHE_DIRECTORY = "Shaders/Cache";
+
+namespace
+{
+	SHADER_OPTIMIZATION ParseShaderOptimization(std::string const & t_recipe)
+	{
+		if (t_recipe == "none") {
+			return SO_NONE;
+		}
+		if (t_recipe == "performance") {
+			return SO_PERFORMANCE;
+		}
+		if (t_recipe == "size") {
+			return SO_SIZE;
+		}
+		throw std::invalid_argument(t_recipe);
+	}
+}
+
 Application::Application():
+	Application{ std::vector<std::string>{} }
+{}
+
+Application::Application(std::vector<std::string> const & t_arguments):
 	m_running{ true },
 	m_modules{},
 	m_observer{std::make_unique<Observer>()}
 {
-	constexpr auto num_modules = 1;
+	auto cooked = CookTextures(t_arguments);
+	cooked = CookMaterials(t_arguments) || cooked;
+	if (cooked) {
+		m_running = false;
+		m_headless = true;
+		return;
+	}
+
+	constexpr auto num_modules = 2;
 	m_modules.reserve(num_modules);
-	
-	m_modules.emplace_back(std::make_unique<Renderer>());
+
+	auto renderer_config = ParseRendererConfig(t_arguments);
+	m_headless = renderer_config.output == RO_HEADLESS;
+
+	// Game state is simulated before the renderer reads it
+	m_modules.emplace_back(std::make_unique<World>());
+	m_modules.back()->AddObserver(m_observer.get());
+
+	m_modules.emplace_back(std::make_unique<Renderer>(renderer_config));
 	m_modules.back()->AddObserver(m_observer.get());
 }
 
 Application::~Application() noexcept
 {
+	Telemetry::Close();
+
 	if (m_log_file.is_open()) {
 		m_log_file.close();
 	}
@@ -35,6 +80,9 @@ void Application::Start() noexcept
 
 void Application::Update() noexcept
 {
+	Telemetry::BeginFrame();
+	auto frame_timer = std::make_optional<ScopedCpuTimer>("Frame");
+
 	HandleEvents();
 
 	RemoveTerminatedModules();
@@ -50,6 +98,9 @@ void Application::Update() noexcept
 	for (auto it = m_modules.begin(); it != m_modules.end(); ++it) {
 		PostUpdateWithErrorHandling(it);
 	}
+
+	frame_timer.reset();
+	Telemetry::EndFrame();
 }
 
 void Application::CleanUp() noexcept
@@ -69,6 +120,11 @@ bool Application::IsRunning() const
 	return m_running;
 }
 
+bool Application::IsHeadless() const
+{
+	return m_headless;
+}
+
 void Application::LogError(std::string const & t_log_message) noexcept
 {
 	m_log << t_log_message;
@@ -90,6 +146,7 @@ void Application::HandleEvents()
 		switch (observer_event.GetType())
 		{
 		case E_CLOSE_WINDOW: m_running = false; break;
+		case E_QUIT: m_running = false; break;
 		default:
 			break;
 		}
@@ -98,6 +155,157 @@ void Application::HandleEvents()
 	}
 }
 
+bool Application::CookTextures(std::vector<std::string> const & t_arguments) noexcept
+{
+	auto settings = TextureCooker::Settings{};
+	auto jobs = std::vector<std::pair<std::string, std::string>>{};
+
+	for (size_t i = 0; i < t_arguments.size(); ++i) {
+		auto const & argument = t_arguments[i];
+
+		if (argument == "--cook-texture" && i + 2 < t_arguments.size()) {
+			jobs.emplace_back(t_arguments[i + 1], t_arguments[i + 2]);
+			i += 2;
+		}
+		else if (argument == "--cook-encoding" && i + 1 < t_arguments.size()) {
+			auto const & encoding = t_arguments[++i];
+			if (encoding == "bc1") { settings.encoding = TE_BC1; }
+			else if (encoding == "bc3") { settings.encoding = TE_BC3; }
+			else if (encoding == "bc5") { settings.encoding = TE_BC5; }
+			else if (encoding == "bc7") { settings.encoding = TE_BC7; }
+			else if (encoding == "rgba8") { settings.encoding = TE_RGBA8; }
+			else {
+				m_log << "Application - Ignoring unknown texture encoding " << encoding << '\n';
+				LogCurrentError();
+			}
+		}
+		else if (argument == "--cook-linear") {
+			settings.srgb = false;
+		}
+	}
+
+	// Each texture already spreads its blocks over every core
+	for (auto const & job : jobs) {
+		try {
+			TextureCooker::CookFile(job.first, job.second, settings);
+		}
+		catch (std::exception & error) {
+			LogError(std::string{ "Application - Could not cook " } + job.first + ": " + error.what());
+		}
+	}
+
+	return !jobs.empty();
+}
+
+bool Application::CookMaterials(std::vector<std::string> const & t_arguments) noexcept
+{
+	auto optimization = SO_PERFORMANCE;
+	auto jobs = std::vector<std::pair<std::string, std::string>>{};
+
+	for (size_t i = 0; i < t_arguments.size(); ++i) {
+		auto const & argument = t_arguments[i];
+
+		try {
+			if (argument == "--cook-materials" && i + 2 < t_arguments.size()) {
+				jobs.emplace_back(t_arguments[i + 1], t_arguments[i + 2]);
+				i += 2;
+			}
+			// Cooked variants are optimised the way the renderer would at start up
+			else if (argument == "--shader-optimization" && i + 1 < t_arguments.size()) {
+				optimization = ParseShaderOptimization(t_arguments[++i]);
+			}
+		}
+		catch (std::exception &) {
+			m_log << "Application - Ignoring invalid value for " << argument << '\n';
+			LogCurrentError();
+		}
+	}
+
+	for (auto const & job : jobs) {
+		try {
+			auto compiler = ShaderCompiler{};
+			compiler.Create(SHADER_CACHE_DIRECTORY, optimization);
+			auto report = ShaderVariantCooker::CookFile(job.first, job.second, compiler);
+			m_log << "Application - Cooked " << report.materials << " materials into " << report.variants << " shader variants and "
+				<< report.engine_shaders << " engine shaders, " << report.pruned << " unused variants pruned, " << report.compiled_bytes << " bytes of SPIR-V stored in " << report.stored_bytes << '\n';
+			LogCurrentError();
+		}
+		catch (std::exception & error) {
+			LogError(std::string{ "Application - Could not cook " } + job.first + ": " + error.what());
+		}
+	}
+
+	return !jobs.empty();
+}
+
+RendererConfig Application::ParseRendererConfig(std::vector<std::string> const & t_arguments)
+{
+	auto config = RendererConfig{};
+
+	for (size_t i = 0; i < t_arguments.size(); ++i) {
+		auto const & argument = t_arguments[i];
+		auto has_value = i + 1 < t_arguments.size();
+
+		try {
+			if (argument == "--headless") {
+				config.output = RO_HEADLESS;
+			}
+			else if (argument == "--frames" && has_value) {
+				config.frame_limit = std::stoull(t_arguments[++i]);
+			}
+			else if (argument == "--width" && has_value) {
+				config.width = static_cast<uint32_t>(std::stoul(t_arguments[++i]));
+			}
+			else if (argument == "--height" && has_value) {
+				config.height = static_cast<uint32_t>(std::stoul(t_arguments[++i]));
+			}
+			else if (argument == "--capture" && has_value) {
+				config.capture_path = t_arguments[++i];
+			}
+			else if (argument == "--depth-prepass") {
+				config.depth_pre_pass = true;
+			}
+			else if (argument == "--dynamic-resolution" && has_value) {
+				config.target_frame_milliseconds = std::stod(t_arguments[++i]);
+			}
+			else if (argument == "--texture-budget" && has_value) {
+				config.texture_budget_mib = std::stoull(t_arguments[++i]);
+			}
+			else if (argument == "--present" && has_value) {
+				auto const & policy = t_arguments[++i];
+				if (policy == "low-latency") {
+					config.present_policy = PP_LOW_LATENCY;
+				}
+				else if (policy == "power-saving") {
+					config.present_policy = PP_POWER_SAVING;
+				}
+				else if (policy == "vsync") {
+					config.present_policy = PP_STRICT_VSYNC;
+				}
+				else {
+					throw std::invalid_argument(policy);
+				}
+			}
+			else if (argument == "--shader-optimization" && has_value) {
+				config.shader_optimization = ParseShaderOptimization(t_arguments[++i]);
+			}
+			else if (argument == "--material" && has_value) {
+				config.material = static_cast<uint32_t>(std::stoul(t_arguments[++i]));
+			}
+			else {
+				m_log << "Application - Ignoring unknown argument " << argument << '\n';
+				LogCurrentError();
+			}
+		}
+		catch (std::exception &) {
+			m_log << "Application - Ignoring invalid value for " << argument << '\n';
+			LogCurrentError();
+		}
+	}
+
+	return config;
+}
+
 void Application::StartWithErrorHandling(std::vector<std::unique_ptr<Module>>::iterator& t_mod) noexcept
 {
 	try {
@@ -113,6 +321,7 @@ void Application::StartWithErrorHandling(std::vector<std::unique_ptr<Module>>::i
 void Application::PreUpdateWithErrorHandling(std::vector<std::unique_ptr<Module>>::iterator& t_mod) noexcept
 {
 	try {
+		auto timer = ScopedCpuTimer{ (*t_mod)->GetName() + " - PreUpdate" };
 		(*t_mod)->PreUpdate();
 	}
 	catch (std::exception & error) {
@@ -125,6 +334,7 @@ void Application::PreUpdateWithErrorHandling(std::vector<std::unique_ptr<Module>
 void Application::UpdateWithErrorHandling(std::vector<std::unique_ptr<Module>>::iterator& t_mod) noexcept
 {
 	try {
+		auto timer = ScopedCpuTimer{ (*t_mod)->GetName() + " - Update" };
 		(*t_mod)->Update();
 	}
 	catch (std::exception & error) {
@@ -137,6 +347,7 @@ void Application::UpdateWithErrorHandling(std::vector<std::unique_ptr<Module>>::
 void Application::PostUpdateWithErrorHandling(std::vector<std::unique_ptr<Module>>::iterator& t_mod) noexcept
 {
 	try {
+		auto timer = ScopedCpuTimer{ (*t_mod)->GetName() + " - PostUpdate" };
 		(*t_mod)->PostUpdate();
 	}
 	catch (std::exception & error) {
@@ -4,11 +4,13 @@
 class Module;
 class Window;
 class Observer;
+struct RendererConfig;
 
 class Application
 {
 public:
 	explicit Application();
+	explicit Application(std::vector<std::string> const &);
 	Application(Application const &) = delete;
 	Application(Application&&) noexcept = default;
 	Application & operator = (Application const &) = delete;
@@ -21,6 +23,7 @@ public:
 	void Quit() noexcept;
 
 	bool IsRunning() const;
+	bool IsHeadless() const;
 
 	static void LogError(std::string const &) noexcept;
 
@@ -28,6 +31,11 @@ private:
 	void RemoveTerminatedModules() noexcept;
 	void HandleEvents();
 
+	[[nodiscard]] static RendererConfig ParseRendererConfig(std::vector<std::string> const &);
+	// Returns whether the arguments asked for cooking instead of running the engine
+	[[nodiscard]] static bool CookTextures(std::vector<std::string> const &) noexcept;
+	[[nodiscard]] static bool CookMaterials(std::vector<std::string> const &) noexcept;
+
 	void StartWithErrorHandling(std::vector<std::unique_ptr<Module>>::iterator&) noexcept;
 	void PreUpdateWithErrorHandling(std::vector<std::unique_ptr<Module>>::iterator&) noexcept;
 	void UpdateWithErrorHandling(std::vector<std::unique_ptr<Module>>::iterator&) noexcept;
@@ -41,6 +49,7 @@ private:
 	static std::stringstream m_log;
 
 	bool m_running{ false };
+	bool m_headless{ false };
 	std::vector<std::unique_ptr<Module>> m_modules{};
 	std::unique_ptr<Observer> m_observer;
 };
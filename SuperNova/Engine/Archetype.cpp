@@ -0,0 +1,174 @@
+#include "PreCompiledHeader.hpp"
+#include "Archetype.h"
+
+std::array<ComponentInfo, MAX_COMPONENT_TYPES> ComponentRegistry::m_components{};
+std::atomic<uint32_t> ComponentRegistry::m_component_count{ 0 };
+
+namespace
+{
+	constexpr uint32_t AlignUp(uint32_t t_value, uint32_t t_alignment) noexcept
+	{
+		return (t_value + t_alignment - 1) & ~(t_alignment - 1);
+	}
+}
+
+ComponentInfo const & ComponentRegistry::GetInfo(ComponentId t_component) noexcept
+{
+	return m_components[t_component];
+}
+
+ComponentId ComponentRegistry::Register(ComponentInfo const & t_info)
+{
+	auto id = m_component_count.fetch_add(1);
+	if (id >= MAX_COMPONENT_TYPES) {
+		throw std::runtime_error("Component registry - More than " + std::to_string(MAX_COMPONENT_TYPES) + " component types");
+	}
+	m_components[id] = t_info;
+	return id;
+}
+
+Archetype::Archetype(ComponentMask t_mask):
+	m_mask{ t_mask }
+{
+	m_offsets.fill(ARCHETYPE_NONE);
+	m_add_edges.fill(ARCHETYPE_NONE);
+	m_remove_edges.fill(ARCHETYPE_NONE);
+
+	auto row_size = uint32_t{ sizeof(Entity) };
+	for (auto id = ComponentId{ 0 }; id < MAX_COMPONENT_TYPES; ++id) {
+		if ((t_mask & (ComponentMask{ 1 } << id)) != 0) {
+			m_components.push_back(id);
+			row_size += ComponentRegistry::GetInfo(id).size;
+		}
+	}
+
+	// Start from the capacity without padding and shrink until the padded
+	// arrays fit
+	m_capacity = ARCHETYPE_CHUNK_SIZE / row_size;
+	while (m_capacity > 0 && Layout(m_capacity) > ARCHETYPE_CHUNK_SIZE) {
+		--m_capacity;
+	}
+	if (m_capacity == 0) {
+		throw std::runtime_error("Archetype - Components do not fit in a chunk");
+	}
+}
+
+uint32_t Archetype::Add(Entity t_entity)
+{
+	if (m_count == m_chunks.size() * m_capacity) {
+		m_chunks.emplace_back(std::make_unique<Chunk>());
+	}
+
+	auto row = m_count++;
+	auto entities = reinterpret_cast<Entity *>(m_chunks[row / m_capacity]->data);
+	entities[row % m_capacity] = t_entity;
+	return row;
+}
+
+Entity Archetype::Remove(uint32_t t_row) noexcept
+{
+	auto last = --m_count;
+	if (t_row == last) {
+		return NULL_ENTITY;
+	}
+
+	for (auto id : m_components) {
+		std::memcpy(GetComponent(id, t_row), GetComponent(id, last), ComponentRegistry::GetInfo(id).size);
+	}
+	auto moved = GetEntity(last);
+	reinterpret_cast<Entity *>(m_chunks[t_row / m_capacity]->data)[t_row % m_capacity] = moved;
+	return moved;
+}
+
+void Archetype::CopyTo(uint32_t t_row, Archetype & t_target, uint32_t t_target_row) const noexcept
+{
+	for (auto id : m_components) {
+		if (t_target.HasComponent(id)) {
+			auto const & chunk = *m_chunks[t_row / m_capacity];
+			auto source = chunk.data + m_offsets[id] + (t_row % m_capacity) * ComponentRegistry::GetInfo(id).size;
+			std::memcpy(t_target.GetComponent(id, t_target_row), source, ComponentRegistry::GetInfo(id).size);
+		}
+	}
+}
+
+void Archetype::Clear() noexcept
+{
+	m_chunks.clear();
+	m_count = 0;
+}
+
+ComponentMask Archetype::GetMask() const noexcept
+{
+	return m_mask;
+}
+
+bool Archetype::HasComponent(ComponentId t_component) const noexcept
+{
+	return (m_mask & (ComponentMask{ 1 } << t_component)) != 0;
+}
+
+uint32_t Archetype::GetCount() const noexcept
+{
+	return m_count;
+}
+
+uint32_t Archetype::GetChunkCapacity() const noexcept
+{
+	return m_capacity;
+}
+
+uint32_t Archetype::GetChunkCount() const noexcept
+{
+	return (m_count + m_capacity - 1) / m_capacity;
+}
+
+uint32_t Archetype::GetChunkSize(uint32_t t_chunk) const noexcept
+{
+	return std::min(m_capacity, m_count - t_chunk * m_capacity);
+}
+
+Entity Archetype::GetEntity(uint32_t t_row) const noexcept
+{
+	return GetEntities(t_row / m_capacity)[t_row % m_capacity];
+}
+
+void * Archetype::GetComponent(ComponentId t_component, uint32_t t_row) noexcept
+{
+	return m_chunks[t_row / m_capacity]->data + m_offsets[t_component] + (t_row % m_capacity) * ComponentRegistry::GetInfo(t_component).size;
+}
+
+Entity const * Archetype::GetEntities(uint32_t t_chunk) const noexcept
+{
+	return reinterpret_cast<Entity const *>(m_chunks[t_chunk]->data);
+}
+
+uint32_t Archetype::GetAddEdge(ComponentId t_component) const noexcept
+{
+	return m_add_edges[t_component];
+}
+
+uint32_t Archetype::GetRemoveEdge(ComponentId t_component) const noexcept
+{
+	return m_remove_edges[t_component];
+}
+
+void Archetype::SetAddEdge(ComponentId t_component, uint32_t t_archetype) noexcept
+{
+	m_add_edges[t_component] = t_archetype;
+}
+
+void Archetype::SetRemoveEdge(ComponentId t_component, uint32_t t_archetype) noexcept
+{
+	m_remove_edges[t_component] = t_archetype;
+}
+
+uint32_t Archetype::Layout(uint32_t t_capacity) noexcept
+{
+	auto size = t_capacity * uint32_t{ sizeof(Entity) };
+	for (auto id : m_components) {
+		size = AlignUp(size, ARCHETYPE_CHUNK_ALIGNMENT);
+		m_offsets[id] = size;
+		size += t_capacity * ComponentRegistry::GetInfo(id).size;
+	}
+	return size;
+}
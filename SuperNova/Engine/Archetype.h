@@ -0,0 +1,157 @@
+#ifndef ARCHETYPE
+#define ARCHETYPE
+
+#include <array>
+#include <atomic>
+#include <type_traits>
+
+using ComponentId = uint32_t;
+// Bit n set for ComponentId n
+using ComponentMask = uint64_t;
+
+constexpr uint32_t MAX_COMPONENT_TYPES = 64;
+constexpr uint32_t ARCHETYPE_CHUNK_SIZE = 16 * 1024;
+// Every array in a chunk starts on a cache line
+constexpr uint32_t ARCHETYPE_CHUNK_ALIGNMENT = 64;
+constexpr uint32_t ARCHETYPE_NONE = ~0u;
+
+// The index names a slot in the world's entity table, the generation tells the
+// entity that holds the slot now from the ones that held it before. Generation
+// 0 is never handed out, so a default entity is null.
+struct Entity {
+	uint32_t index{ 0 };
+	uint32_t generation{ 0 };
+};
+
+constexpr Entity NULL_ENTITY{};
+
+[[nodiscard]] constexpr bool operator == (Entity const & t_lhs, Entity const & t_rhs) noexcept
+{
+	return t_lhs.index == t_rhs.index && t_lhs.generation == t_rhs.generation;
+}
+
+[[nodiscard]] constexpr bool operator != (Entity const & t_lhs, Entity const & t_rhs) noexcept
+{
+	return !(t_lhs == t_rhs);
+}
+
+struct ComponentInfo {
+	uint32_t size{ 0 };
+	uint32_t alignment{ 0 };
+};
+
+// Hands out an id per component type the first time the type is used. Ids
+// depend on the order types are first seen in, so they are only meaningful
+// inside one run. Components are plain data: archetypes copy them between rows
+// with memcpy and never run destructors. Const qualified types share the id of
+// the plain one.
+class ComponentRegistry
+{
+public:
+	ComponentRegistry() = delete;
+
+	template<typename T>
+	[[nodiscard]] static ComponentId GetId();
+	template<typename... Ts>
+	[[nodiscard]] static ComponentMask GetMask();
+	[[nodiscard]] static ComponentInfo const & GetInfo(ComponentId) noexcept;
+
+private:
+	[[nodiscard]] static ComponentId Register(ComponentInfo const &);
+
+	static std::array<ComponentInfo, MAX_COMPONENT_TYPES> m_components;
+	static std::atomic<uint32_t> m_component_count;
+};
+
+template<typename T>
+ComponentId ComponentRegistry::GetId()
+{
+	if constexpr (!std::is_same_v<T, std::remove_cv_t<T>>) {
+		return GetId<std::remove_cv_t<T>>();
+	}
+	else {
+		static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>, "Components must be plain data");
+		static_assert(alignof(T) <= ARCHETYPE_CHUNK_ALIGNMENT, "Component alignment exceeds the chunk alignment");
+
+		static auto const id = Register(ComponentInfo{ sizeof(T), alignof(T) });
+		return id;
+	}
+}
+
+template<typename... Ts>
+ComponentMask ComponentRegistry::GetMask()
+{
+	return (ComponentMask{ 0 } | ... | (ComponentMask{ 1 } << GetId<Ts>()));
+}
+
+// Storage for every entity with exactly one set of components. Rows live in
+// fixed size chunks; a chunk holds the entity handles as one array followed by
+// one array per component, so a loop over a component touches only that
+// component's memory, in address order. Rows are packed: all chunks but the last
+// are full, removing a row moves the last one into the hole. Emptied chunks are
+// kept for reuse, an archetype holds on to its peak size until cleared.
+//
+// The archetypes reached by adding or removing one component are cached as
+// edges, so structural changes find their target without hashing masks.
+class Archetype
+{
+public:
+	explicit Archetype(ComponentMask);
+	Archetype(Archetype const &) = delete;
+	Archetype(Archetype &&) noexcept = default;
+	Archetype & operator = (Archetype const &) = delete;
+	Archetype & operator = (Archetype &&) noexcept = default;
+	~Archetype() noexcept = default;
+
+	// The new row's components are left uninitialised, returns the row
+	[[nodiscard]] uint32_t Add(Entity);
+	// Returns the entity moved into the row, or NULL_ENTITY if the row was last
+	[[nodiscard]] Entity Remove(uint32_t) noexcept;
+	// Copies the components both archetypes have into the target's row
+	void CopyTo(uint32_t, Archetype &, uint32_t) const noexcept;
+	void Clear() noexcept;
+
+	[[nodiscard]] ComponentMask GetMask() const noexcept;
+	[[nodiscard]] bool HasComponent(ComponentId) const noexcept;
+	[[nodiscard]] uint32_t GetCount() const noexcept;
+	[[nodiscard]] uint32_t GetChunkCapacity() const noexcept;
+	[[nodiscard]] uint32_t GetChunkCount() const noexcept;
+	// Rows in use in the chunk
+	[[nodiscard]] uint32_t GetChunkSize(uint32_t) const noexcept;
+
+	[[nodiscard]] Entity GetEntity(uint32_t) const noexcept;
+	[[nodiscard]] void * GetComponent(ComponentId, uint32_t) noexcept;
+	[[nodiscard]] Entity const * GetEntities(uint32_t) const noexcept;
+	template<typename T>
+	[[nodiscard]] T * GetArray(uint32_t);
+
+	[[nodiscard]] uint32_t GetAddEdge(ComponentId) const noexcept;
+	[[nodiscard]] uint32_t GetRemoveEdge(ComponentId) const noexcept;
+	void SetAddEdge(ComponentId, uint32_t) noexcept;
+	void SetRemoveEdge(ComponentId, uint32_t) noexcept;
+
+private:
+	struct alignas(ARCHETYPE_CHUNK_ALIGNMENT) Chunk {
+		std::byte data[ARCHETYPE_CHUNK_SIZE];
+	};
+
+	// Assigns the array offsets for a capacity, returns the bytes it needs
+	uint32_t Layout(uint32_t) noexcept;
+
+	ComponentMask m_mask{ 0 };
+	std::vector<ComponentId> m_components{};
+	std::array<uint32_t, MAX_COMPONENT_TYPES> m_offsets{};
+	std::array<uint32_t, MAX_COMPONENT_TYPES> m_add_edges{};
+	std::array<uint32_t, MAX_COMPONENT_TYPES> m_remove_edges{};
+	std::vector<std::unique_ptr<Chunk>> m_chunks{};
+	uint32_t m_capacity{ 0 };
+	uint32_t m_count{ 0 };
+};
+
+template<typename T>
+T * Archetype::GetArray(uint32_t t_chunk)
+{
+	return reinterpret_cast<T *>(m_chunks[t_chunk]->data + m_offsets[ComponentRegistry::GetId<T>()]);
+}
+
+#endif // !ARCHETYPE
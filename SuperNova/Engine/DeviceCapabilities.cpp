@@ -0,0 +1,231 @@
+#include "PreCompiledHeader.hpp"
+#include "DeviceCapabilities.h"
+
+namespace
+{
+	// A share of the heap is left to the rest of the system when nothing reports
+	// what it uses
+	constexpr VkDeviceSize HEAP_SIZE_BUDGET_NUMERATOR = 3;
+	constexpr VkDeviceSize HEAP_SIZE_BUDGET_DENOMINATOR = 4;
+}
+
+void DeviceCapabilities::Query(VkPhysicalDevice const & t_device, uint32_t t_instance_version)
+{
+	m_features = Features{};
+	m_extensions.clear();
+
+	auto properties = VkPhysicalDeviceProperties{};
+	vkGetPhysicalDeviceProperties(t_device, &properties);
+	m_features.api_version = std::min(properties.apiVersion, t_instance_version);
+
+	auto extension_count = uint32_t{ 0 };
+	vkEnumerateDeviceExtensionProperties(t_device, nullptr, &extension_count, nullptr);
+	auto extensions = std::vector<VkExtensionProperties>(extension_count);
+	vkEnumerateDeviceExtensionProperties(t_device, nullptr, &extension_count, extensions.data());
+
+	auto has_extension = [&extensions](char const * t_name) {
+		return std::any_of(extensions.begin(), extensions.end(), [t_name](VkExtensionProperties const & t_extension) {
+			return std::strcmp(t_extension.extensionName, t_name) == 0;
+		});
+	};
+
+	m_enabled_features = VkPhysicalDeviceFeatures2{};
+	m_enabled_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	m_vulkan_12_features = VkPhysicalDeviceVulkan12Features{};
+	m_vulkan_12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	m_timeline_features = VkPhysicalDeviceTimelineSemaphoreFeatures{};
+	m_timeline_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+	auto core_features = VkPhysicalDeviceFeatures{};
+
+	if (m_features.api_version < VK_API_VERSION_1_1) {
+		vkGetPhysicalDeviceFeatures(t_device, &core_features);
+	}
+	else if (m_features.api_version < VK_API_VERSION_1_2) {
+		auto timeline = VkPhysicalDeviceTimelineSemaphoreFeatures{};
+		timeline.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+		// Extension structs may only be chained when the device has the extension
+		auto features = VkPhysicalDeviceFeatures2{};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		auto has_timeline = has_extension(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		if (has_timeline) {
+			timeline.pNext = features.pNext;
+			features.pNext = &timeline;
+		}
+
+		vkGetPhysicalDeviceFeatures2(t_device, &features);
+		core_features = features.features;
+
+		m_features.timeline_semaphores = has_timeline && timeline.timelineSemaphore == VK_TRUE;
+		m_features.draw_indirect_count = has_extension(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+	}
+	else {
+		auto vulkan_12 = VkPhysicalDeviceVulkan12Features{};
+		vulkan_12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		auto features = VkPhysicalDeviceFeatures2{};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &vulkan_12;
+
+		vkGetPhysicalDeviceFeatures2(t_device, &features);
+		core_features = features.features;
+
+		m_features.timeline_semaphores = vulkan_12.timelineSemaphore == VK_TRUE;
+		m_features.draw_indirect_count = vulkan_12.drawIndirectCount == VK_TRUE;
+	}
+
+	m_features.multi_draw_indirect = core_features.multiDrawIndirect == VK_TRUE;
+	m_features.draw_indirect_first_instance = core_features.drawIndirectFirstInstance == VK_TRUE;
+	// Budgets are read through the properties2 query, which needs Vulkan 1.1
+	m_features.memory_budget = m_features.api_version >= VK_API_VERSION_1_1 && has_extension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+	ChoosePaths();
+
+	// Only what a chosen path uses is enabled
+	m_enabled_features.features.multiDrawIndirect = core_features.multiDrawIndirect;
+	m_enabled_features.features.drawIndirectFirstInstance = core_features.drawIndirectFirstInstance;
+
+	auto core_12 = m_features.api_version >= VK_API_VERSION_1_2;
+
+	if (m_paths.sync == SP_TIMELINE_SEMAPHORES) {
+		m_vulkan_12_features.timelineSemaphore = VK_TRUE;
+		m_timeline_features.timelineSemaphore = VK_TRUE;
+		if (!core_12) {
+			m_extensions.emplace_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		}
+	}
+
+	if (m_paths.indirect_draws == IDP_DRAW_COUNT) {
+		m_vulkan_12_features.drawIndirectCount = VK_TRUE;
+		if (!core_12) {
+			m_extensions.emplace_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+		}
+	}
+
+	if (m_paths.memory_budget == MBP_BUDGET_EXTENSION) {
+		m_extensions.emplace_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+}
+
+DeviceCapabilities::Features const & DeviceCapabilities::GetFeatures() const noexcept
+{
+	return m_features;
+}
+
+DeviceCapabilities::Paths const & DeviceCapabilities::GetPaths() const noexcept
+{
+	return m_paths;
+}
+
+int DeviceCapabilities::GetScore() const noexcept
+{
+	auto score = 0;
+	score += m_paths.indirect_draws == IDP_DRAW_COUNT ? 300 : m_paths.indirect_draws == IDP_MULTI_DRAW ? 200 : 0;
+	score += m_paths.sync == SP_TIMELINE_SEMAPHORES ? 100 : 0;
+	score += m_paths.memory_budget == MBP_BUDGET_EXTENSION ? 50 : 0;
+	return score;
+}
+
+void DeviceCapabilities::AppendDeviceExtensions(std::vector<char const *> & t_extensions) const
+{
+	t_extensions.insert(t_extensions.end(), m_extensions.begin(), m_extensions.end());
+}
+
+void DeviceCapabilities::EnableFeatures(VkDeviceCreateInfo & t_create_info)
+{
+	// Without Vulkan 1.1 there is no features2 struct to chain anything to
+	if (m_features.api_version < VK_API_VERSION_1_1) {
+		t_create_info.pEnabledFeatures = &m_enabled_features.features;
+		return;
+	}
+
+	auto chain = [this](auto & t_features) {
+		t_features.pNext = m_enabled_features.pNext;
+		m_enabled_features.pNext = &t_features;
+	};
+
+	m_enabled_features.pNext = const_cast<void *>(t_create_info.pNext);
+	if (m_features.api_version >= VK_API_VERSION_1_2) {
+		chain(m_vulkan_12_features);
+	}
+	else if (m_paths.sync == SP_TIMELINE_SEMAPHORES) {
+		chain(m_timeline_features);
+	}
+
+	t_create_info.pEnabledFeatures = nullptr;
+	t_create_info.pNext = &m_enabled_features;
+}
+
+PFN_vkCmdDrawIndirectCount DeviceCapabilities::LoadDrawIndirectCount(VkDevice const & t_device) const
+{
+	if (m_paths.indirect_draws != IDP_DRAW_COUNT) {
+		return nullptr;
+	}
+
+	auto name = m_features.api_version >= VK_API_VERSION_1_2 ? "vkCmdDrawIndirectCount" : "vkCmdDrawIndirectCountKHR";
+	return reinterpret_cast<PFN_vkCmdDrawIndirectCount>(vkGetDeviceProcAddr(t_device, name));
+}
+
+VkDeviceSize DeviceCapabilities::GetDeviceLocalBudget(VkPhysicalDevice const & t_device) const
+{
+	auto budget = VkPhysicalDeviceMemoryBudgetPropertiesEXT{};
+	budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+	auto properties = VkPhysicalDeviceMemoryProperties{};
+	if (m_paths.memory_budget == MBP_BUDGET_EXTENSION) {
+		auto properties_2 = VkPhysicalDeviceMemoryProperties2{};
+		properties_2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+		properties_2.pNext = &budget;
+		vkGetPhysicalDeviceMemoryProperties2(t_device, &properties_2);
+		properties = properties_2.memoryProperties;
+	}
+	else {
+		vkGetPhysicalDeviceMemoryProperties(t_device, &properties);
+	}
+
+	auto total = VkDeviceSize{ 0 };
+	for (auto heap = uint32_t{ 0 }; heap < properties.memoryHeapCount; ++heap) {
+		if ((properties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) == 0) {
+			continue;
+		}
+
+		total += m_paths.memory_budget == MBP_BUDGET_EXTENSION ?
+			budget.heapBudget[heap] :
+			properties.memoryHeaps[heap].size / HEAP_SIZE_BUDGET_DENOMINATOR * HEAP_SIZE_BUDGET_NUMERATOR;
+	}
+
+	return total;
+}
+
+uint32_t DeviceCapabilities::GetInstanceApiVersion() noexcept
+{
+	// Vulkan 1.0 loaders do not export vkEnumerateInstanceVersion
+	auto enumerate_version = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+		vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion"));
+
+	auto version = uint32_t{ VK_API_VERSION_1_0 };
+	if (enumerate_version == nullptr || enumerate_version(&version) != VK_SUCCESS) {
+		return VK_API_VERSION_1_0;
+	}
+
+	return std::min(version, uint32_t{ VK_API_VERSION_1_2 });
+}
+
+void DeviceCapabilities::ChoosePaths() noexcept
+{
+	m_paths = Paths{};
+
+	m_paths.sync = m_features.timeline_semaphores ? SP_TIMELINE_SEMAPHORES : SP_FENCES;
+
+	// Every indirect draw selects its object through firstInstance
+	if (m_features.draw_indirect_first_instance) {
+		if (m_features.multi_draw_indirect) {
+			m_paths.indirect_draws = m_features.draw_indirect_count ? IDP_DRAW_COUNT : IDP_MULTI_DRAW;
+		}
+		else {
+			m_paths.indirect_draws = IDP_SINGLE_DRAWS;
+		}
+	}
+
+	m_paths.memory_budget = m_features.memory_budget ? MBP_BUDGET_EXTENSION : MBP_HEAP_SIZE;
+}
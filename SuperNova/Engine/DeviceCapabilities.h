@@ -0,0 +1,91 @@
+#ifndef DEVICE_CAPABILITIES
+#define DEVICE_CAPABILITIES
+
+#include "vulkan/vulkan.h"
+
+enum SYNC_PATH
+{
+	SP_TIMELINE_SEMAPHORES = 0,
+	SP_FENCES
+};
+
+enum INDIRECT_DRAW_PATH
+{
+	// The GPU writes the draw count, culled draws are never submitted
+	IDP_DRAW_COUNT = 0,
+	IDP_MULTI_DRAW,
+	IDP_SINGLE_DRAWS,
+	IDP_UNSUPPORTED
+};
+
+enum MEMORY_BUDGET_PATH
+{
+	MBP_BUDGET_EXTENSION = 0,
+	MBP_HEAP_SIZE
+};
+
+// What a physical device can do beyond the Vulkan 1.0 baseline, queried once at
+// device selection. Every subsystem with more than one implementation reads its
+// path from here, the fastest one the device supports, instead of each probing
+// features on its own. The same object enables exactly those features and
+// extensions on the logical device, so a chosen path is always usable.
+//
+// Vulkan 1.2 devices are queried through the core 1.2 feature struct, 1.1 devices
+// through the extension structs and 1.0 instances only get the core features.
+class DeviceCapabilities
+{
+public:
+	struct Features {
+		uint32_t api_version{ VK_API_VERSION_1_0 };
+		bool multi_draw_indirect{ false };
+		bool draw_indirect_first_instance{ false };
+		bool timeline_semaphores{ false };
+		bool draw_indirect_count{ false };
+		bool memory_budget{ false };
+	};
+
+	struct Paths {
+		SYNC_PATH sync{ SP_FENCES };
+		INDIRECT_DRAW_PATH indirect_draws{ IDP_UNSUPPORTED };
+		MEMORY_BUDGET_PATH memory_budget{ MBP_HEAP_SIZE };
+	};
+
+	explicit DeviceCapabilities() = default;
+	DeviceCapabilities(DeviceCapabilities const &) = delete;
+	DeviceCapabilities(DeviceCapabilities &&) noexcept = default;
+	DeviceCapabilities & operator = (DeviceCapabilities const &) = delete;
+	DeviceCapabilities & operator = (DeviceCapabilities &&) noexcept = default;
+	~DeviceCapabilities() noexcept = default;
+
+	// The version is the one the instance was created with
+	void Query(VkPhysicalDevice const &, uint32_t);
+
+	[[nodiscard]] Features const & GetFeatures() const noexcept;
+	[[nodiscard]] Paths const & GetPaths() const noexcept;
+	// Weight of the optional capabilities when rating devices against each other
+	[[nodiscard]] int GetScore() const noexcept;
+
+	void AppendDeviceExtensions(std::vector<char const *> &) const;
+	// The feature chain points into this object, which has to outlive device creation
+	void EnableFeatures(VkDeviceCreateInfo &);
+
+	// Null unless the indirect draw path is IDP_DRAW_COUNT
+	[[nodiscard]] PFN_vkCmdDrawIndirectCount LoadDrawIndirectCount(VkDevice const &) const;
+	// Device local bytes that can still be allocated without oversubscribing
+	[[nodiscard]] VkDeviceSize GetDeviceLocalBudget(VkPhysicalDevice const &) const;
+
+	// Highest version both the loader and the engine support
+	[[nodiscard]] static uint32_t GetInstanceApiVersion() noexcept;
+
+private:
+	void ChoosePaths() noexcept;
+
+	Features m_features{};
+	Paths m_paths{};
+	std::vector<char const *> m_extensions{};
+	VkPhysicalDeviceFeatures2 m_enabled_features{};
+	VkPhysicalDeviceVulkan12Features m_vulkan_12_features{};
+	VkPhysicalDeviceTimelineSemaphoreFeatures m_timeline_features{};
+};
+
+#endif // !DEVICE_CAPABILITIES
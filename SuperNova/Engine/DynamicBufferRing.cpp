@@ -0,0 +1,170 @@
+#include "PreCompiledHeader.hpp"
+#include "DynamicBufferRing.h"
+#include "VulkanUtils.h"
+
+// Largest single uniform allocation, 16KB is the smallest maxUniformBufferRange
+// the specification allows
+constexpr VkDeviceSize MAX_UNIFORM_RANGE = 16 * 1024;
+
+void DynamicBufferRing::Create(
+	VkDevice const & t_device,
+	VkPhysicalDevice const & t_physical_device,
+	uint32_t t_frame_count,
+	VkDeviceSize t_frame_size,
+	VkDescriptorSetLayout t_set_layout,
+	std::vector<VkDescriptorSetLayoutBinding> const & t_bindings)
+{
+	if (t_bindings.empty()) {
+		throw std::runtime_error("Dynamic buffer ring - The set layout has no bindings");
+	}
+	for (auto i = uint32_t{ 0 }; i < t_bindings.size(); ++i) {
+		auto expected = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		if (t_bindings[i].binding != i || t_bindings[i].descriptorType != expected || t_bindings[i].descriptorCount != 1) {
+			throw std::runtime_error("Dynamic buffer ring - Binding " + std::to_string(t_bindings[i].binding) + " of the set layout is not a single dynamic " + (i == 0 ? "uniform" : "storage") + " buffer");
+		}
+	}
+	auto storage_binding_count = static_cast<uint32_t>(t_bindings.size() - 1);
+
+	auto properties = VkPhysicalDeviceProperties{};
+	vkGetPhysicalDeviceProperties(t_physical_device, &properties);
+
+	auto const & limits = properties.limits;
+	if (storage_binding_count > limits.maxDescriptorSetStorageBuffersDynamic) {
+		throw std::runtime_error("Dynamic buffer ring - " + std::to_string(storage_binding_count) + " dynamic storage buffers exceed the device limit");
+	}
+
+	m_storage_binding_count = storage_binding_count;
+	m_descriptor_set_layout = t_set_layout;
+	m_alignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+	m_frame_size = (t_frame_size + m_alignment - 1) / m_alignment * m_alignment;
+	m_frame_count = t_frame_count;
+	m_uniform_range = std::min<VkDeviceSize>({ MAX_UNIFORM_RANGE, limits.maxUniformBufferRange, m_frame_size });
+	m_storage_range = std::min<VkDeviceSize>(limits.maxStorageBufferRange, m_frame_size);
+	m_frame_begin = 0;
+	m_head = 0;
+
+	// A descriptor's range has to fit the buffer at any dynamic offset, the tail
+	// padding lets the last allocation of the last region still be bound
+	auto size = m_frame_size * t_frame_count + std::max(m_uniform_range, m_storage_range);
+
+	// Device local and host visible memory, where there is some, saves the GPU from
+	// reading across the bus on every draw
+	vulkan_utils::CreateBuffer(t_device, t_physical_device, size,
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_buffer, m_memory);
+
+	void * mapped = nullptr;
+	auto result = vkMapMemory(t_device, m_memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("map dynamic buffer ring", result);
+	}
+	m_mapped = static_cast<uint8_t *>(mapped);
+
+	CreateDescriptors(t_device);
+}
+
+void DynamicBufferRing::Destroy(VkDevice const & t_device) noexcept
+{
+	if (m_mapped != nullptr) {
+		vkUnmapMemory(t_device, m_memory);
+		m_mapped = nullptr;
+	}
+
+	vkDestroyDescriptorPool(t_device, m_descriptor_pool, nullptr);
+	vkDestroyBuffer(t_device, m_buffer, nullptr);
+	vkFreeMemory(t_device, m_memory, nullptr);
+
+	m_descriptor_pool = VK_NULL_HANDLE;
+	m_descriptor_set_layout = VK_NULL_HANDLE;
+	m_descriptor_set = VK_NULL_HANDLE;
+	m_buffer = VK_NULL_HANDLE;
+	m_memory = VK_NULL_HANDLE;
+}
+
+void DynamicBufferRing::BeginFrame(uint32_t t_frame)
+{
+	m_frame_begin = m_frame_size * (t_frame % m_frame_count);
+	m_head = m_frame_begin;
+}
+
+DynamicBufferRing::Allocation DynamicBufferRing::Allocate(VkDeviceSize t_size)
+{
+	auto offset = (m_head + m_alignment - 1) / m_alignment * m_alignment;
+
+	if (offset + t_size > m_frame_begin + m_frame_size) {
+		throw std::runtime_error("Dynamic buffer ring - Frame region of " + std::to_string(m_frame_size) + " bytes exhausted");
+	}
+
+	m_head = offset + t_size;
+	return Allocation{ static_cast<uint32_t>(offset), m_mapped + offset };
+}
+
+VkDescriptorSetLayout DynamicBufferRing::GetDescriptorSetLayout() const noexcept
+{
+	return m_descriptor_set_layout;
+}
+
+VkDescriptorSet DynamicBufferRing::GetDescriptorSet() const noexcept
+{
+	return m_descriptor_set;
+}
+
+VkDeviceSize DynamicBufferRing::GetUniformRange() const noexcept
+{
+	return m_uniform_range;
+}
+
+VkDeviceSize DynamicBufferRing::GetFrameUsage() const noexcept
+{
+	return m_head - m_frame_begin;
+}
+
+void DynamicBufferRing::CreateDescriptors(VkDevice const & t_device)
+{
+	auto pool_sizes = std::vector<VkDescriptorPoolSize>{
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 }
+	};
+	if (m_storage_binding_count > 0) {
+		pool_sizes.emplace_back(VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, m_storage_binding_count });
+	}
+
+	auto pool_info = VkDescriptorPoolCreateInfo{};
+	pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_info.maxSets = 1;
+	pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+	pool_info.pPoolSizes = pool_sizes.data();
+
+	auto result = vkCreateDescriptorPool(t_device, &pool_info, nullptr, &m_descriptor_pool);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("create dynamic buffer descriptor pool", result);
+	}
+
+	auto alloc_info = VkDescriptorSetAllocateInfo{};
+	alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	alloc_info.descriptorPool = m_descriptor_pool;
+	alloc_info.descriptorSetCount = 1;
+	alloc_info.pSetLayouts = &m_descriptor_set_layout;
+
+	result = vkAllocateDescriptorSets(t_device, &alloc_info, &m_descriptor_set);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("allocate dynamic buffer descriptor set", result);
+	}
+
+	auto uniform_info = VkDescriptorBufferInfo{ m_buffer, 0, m_uniform_range };
+	auto storage_info = VkDescriptorBufferInfo{ m_buffer, 0, m_storage_range };
+
+	auto writes = std::vector<VkWriteDescriptorSet>(1 + static_cast<size_t>(m_storage_binding_count));
+	for (auto i = uint32_t{ 0 }; i < writes.size(); ++i) {
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = m_descriptor_set;
+		writes[i].dstBinding = i;
+		writes[i].dstArrayElement = 0;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		writes[i].pBufferInfo = i == 0 ? &uniform_info : &storage_info;
+	}
+
+	vkUpdateDescriptorSets(t_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
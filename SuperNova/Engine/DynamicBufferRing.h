@@ -0,0 +1,79 @@
+#ifndef DYNAMIC_BUFFER_RING
+#define DYNAMIC_BUFFER_RING
+
+#include "vulkan/vulkan.h"
+
+// One persistently mapped buffer split into a region per frame in flight. Per frame
+// data is bump allocated from the current region and addressed with dynamic
+// offsets, so a single descriptor set serves every frame and every object.
+// Binding 0 is a dynamic uniform buffer, the bindings after it dynamic storage
+// buffers, each bound at its own offset. The set layout comes from the caller,
+// reflected from the shaders reading the set, and has to have that shape.
+class DynamicBufferRing
+{
+public:
+	struct Allocation {
+		uint32_t offset{ 0 };
+		void * data{ nullptr };
+	};
+
+	explicit DynamicBufferRing() = default;
+	DynamicBufferRing(DynamicBufferRing const &) = delete;
+	DynamicBufferRing(DynamicBufferRing &&) noexcept = default;
+	DynamicBufferRing & operator = (DynamicBufferRing const &) = delete;
+	DynamicBufferRing & operator = (DynamicBufferRing &&) noexcept = default;
+	~DynamicBufferRing() noexcept = default;
+
+	// The layout stays owned by the caller
+	void Create(VkDevice const &, VkPhysicalDevice const &, uint32_t, VkDeviceSize, VkDescriptorSetLayout, std::vector<VkDescriptorSetLayoutBinding> const &);
+	void Destroy(VkDevice const &) noexcept;
+
+	// The frame's previous submission must have completed
+	void BeginFrame(uint32_t);
+	[[nodiscard]] Allocation Allocate(VkDeviceSize);
+
+	template<typename T>
+	[[nodiscard]] uint32_t Push(T const & t_value)
+	{
+		auto allocation = Allocate(sizeof(T));
+		std::memcpy(allocation.data, &t_value, sizeof(T));
+		return allocation.offset;
+	}
+
+	// Storage bindings need a valid offset even for an empty array, one element is
+	// always allocated
+	template<typename T>
+	[[nodiscard]] uint32_t PushArray(std::vector<T> const & t_values)
+	{
+		auto allocation = Allocate(sizeof(T) * std::max<size_t>(t_values.size(), 1));
+		if (!t_values.empty()) {
+			std::memcpy(allocation.data, t_values.data(), sizeof(T) * t_values.size());
+		}
+		return allocation.offset;
+	}
+
+	[[nodiscard]] VkDescriptorSetLayout GetDescriptorSetLayout() const noexcept;
+	[[nodiscard]] VkDescriptorSet GetDescriptorSet() const noexcept;
+	[[nodiscard]] VkDeviceSize GetUniformRange() const noexcept;
+	[[nodiscard]] VkDeviceSize GetFrameUsage() const noexcept;
+
+private:
+	void CreateDescriptors(VkDevice const &);
+
+	VkBuffer m_buffer{ VK_NULL_HANDLE };
+	VkDeviceMemory m_memory{ VK_NULL_HANDLE };
+	uint8_t * m_mapped{ nullptr };
+	VkDescriptorSetLayout m_descriptor_set_layout{ VK_NULL_HANDLE };
+	VkDescriptorPool m_descriptor_pool{ VK_NULL_HANDLE };
+	VkDescriptorSet m_descriptor_set{ VK_NULL_HANDLE };
+	VkDeviceSize m_frame_size{ 0 };
+	VkDeviceSize m_frame_begin{ 0 };
+	VkDeviceSize m_head{ 0 };
+	VkDeviceSize m_alignment{ 1 };
+	VkDeviceSize m_uniform_range{ 0 };
+	VkDeviceSize m_storage_range{ 0 };
+	uint32_t m_frame_count{ 0 };
+	uint32_t m_storage_binding_count{ 0 };
+};
+
+#endif // !DYNAMIC_BUFFER_RING
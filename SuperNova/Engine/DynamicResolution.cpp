@@ -0,0 +1,105 @@
+#include "PreCompiledHeader.hpp"
+#include "DynamicResolution.h"
+#include <cmath>
+
+// Render extents snap to multiples of this many pixels
+constexpr uint32_t EXTENT_GRANULARITY = 8;
+// Bounds the integral so a long stretch at a scale limit does not wind it up
+constexpr double MAX_INTEGRAL = 2.0;
+
+void DynamicResolution::Configure(Settings const & t_settings)
+{
+	if (t_settings.target_milliseconds <= 0.0) {
+		throw std::runtime_error("Dynamic resolution - Target frame time must be positive");
+	}
+	if (t_settings.min_scale <= 0.0f || t_settings.min_scale > t_settings.max_scale) {
+		throw std::runtime_error("Dynamic resolution - Invalid scale range");
+	}
+
+	m_settings = t_settings;
+	m_settings.interval = std::max(m_settings.interval, 1u);
+	Reset();
+}
+
+void DynamicResolution::Reset() noexcept
+{
+	m_accumulated = 0.0;
+	m_integral = 0.0;
+	m_previous_error = 0.0;
+	m_samples = 0;
+	m_settling = 0;
+	m_scale = m_settings.max_scale;
+}
+
+bool DynamicResolution::Update(double t_gpu_milliseconds)
+{
+	if (t_gpu_milliseconds <= 0.0) {
+		return false;
+	}
+
+	// Timed before the last change took effect, a spike there is already handled
+	if (m_settling > 0) {
+		--m_settling;
+		return false;
+	}
+
+	m_accumulated += t_gpu_milliseconds;
+	++m_samples;
+
+	auto spike = t_gpu_milliseconds > m_settings.target_milliseconds * (1.0 + m_settings.spike);
+	if (m_samples < m_settings.interval && !spike) {
+		return false;
+	}
+
+	// A spike is acted on by itself, averaging it in would blunt the response
+	auto milliseconds = spike ? t_gpu_milliseconds : m_accumulated / m_samples;
+	m_accumulated = 0.0;
+	m_samples = 0;
+
+	// Positive when there is headroom, relative so the gains hold for any target
+	auto error = (m_settings.target_milliseconds - milliseconds) / m_settings.target_milliseconds;
+	auto derivative = error - m_previous_error;
+	m_previous_error = error;
+
+	if (std::abs(error) < m_settings.dead_band) {
+		m_integral = 0.0;
+		return false;
+	}
+
+	m_integral = std::clamp(m_integral + error, -MAX_INTEGRAL, MAX_INTEGRAL);
+
+	auto output = m_settings.proportional * error + m_settings.integral * m_integral + m_settings.derivative * derivative;
+
+	// The controller steers the pixel count, the scale applies per axis
+	auto area = static_cast<double>(m_scale) * m_scale * std::max(1.0 + output, 0.1);
+	auto scale = std::clamp(static_cast<float>(std::sqrt(area)), m_settings.min_scale, m_settings.max_scale);
+
+	// Pinned against a limit the integral would only keep growing
+	if (scale == m_settings.min_scale || scale == m_settings.max_scale) {
+		m_integral -= error;
+	}
+
+	if (scale == m_scale) {
+		return false;
+	}
+
+	m_scale = scale;
+	m_settling = m_settings.latency;
+	return true;
+}
+
+float DynamicResolution::GetScale() const noexcept
+{
+	return m_scale;
+}
+
+VkExtent2D DynamicResolution::GetExtent(VkExtent2D const & t_full) const noexcept
+{
+	auto snap = [this](uint32_t t_size) {
+		auto scaled = static_cast<uint32_t>(static_cast<float>(t_size) * m_scale + 0.5f);
+		scaled = (scaled + EXTENT_GRANULARITY / 2) / EXTENT_GRANULARITY * EXTENT_GRANULARITY;
+		return std::clamp(scaled, std::min(EXTENT_GRANULARITY, t_size), t_size);
+	};
+
+	return VkExtent2D{ snap(t_full.width), snap(t_full.height) };
+}
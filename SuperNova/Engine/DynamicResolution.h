@@ -0,0 +1,61 @@
+#ifndef DYNAMIC_RESOLUTION
+#define DYNAMIC_RESOLUTION
+
+#include "vulkan/vulkan.h"
+
+// Holds a GPU frame time target by scaling the render resolution. A PID controller
+// works on the pixel count, which GPU time follows far more closely than the
+// per axis scale. It runs every few frames on the averaged time, stays still
+// while the error is inside a dead band and only drops the integral term there,
+// which keeps it from hunting around the target. A single frame far over the
+// target acts at once, so a spike costs resolution rather than frames. GPU times
+// arrive some frames late, so after any change the samples still timed at the old
+// scale are thrown away.
+class DynamicResolution
+{
+public:
+	struct Settings {
+		double target_milliseconds{ 1000.0 / 60.0 };
+		float min_scale{ 0.5f };
+		float max_scale{ 1.0f };
+		uint32_t interval{ 8 };
+		// Frames between rendering and its GPU time reaching Update
+		uint32_t latency{ 0 };
+		// Relative error the controller ignores
+		double dead_band{ 0.05 };
+		// Relative overshoot of a single frame that skips the interval
+		double spike{ 0.25 };
+		double proportional{ 0.5 };
+		double integral{ 0.1 };
+		double derivative{ 0.1 };
+	};
+
+	explicit DynamicResolution() = default;
+	DynamicResolution(DynamicResolution const &) = delete;
+	DynamicResolution(DynamicResolution &&) noexcept = default;
+	DynamicResolution & operator = (DynamicResolution const &) = delete;
+	DynamicResolution & operator = (DynamicResolution &&) noexcept = default;
+	~DynamicResolution() noexcept = default;
+
+	void Configure(Settings const &);
+	void Reset() noexcept;
+
+	// Returns true when the scale changed
+	bool Update(double);
+
+	[[nodiscard]] float GetScale() const noexcept;
+	// Rounded to whole blocks of pixels so small corrections do not churn the extent
+	[[nodiscard]] VkExtent2D GetExtent(VkExtent2D const &) const noexcept;
+
+private:
+	Settings m_settings{};
+	double m_accumulated{ 0.0 };
+	double m_integral{ 0.0 };
+	double m_previous_error{ 0.0 };
+	uint32_t m_samples{ 0 };
+	// Samples still to drop since the last scale change
+	uint32_t m_settling{ 0 };
+	float m_scale{ 1.0f };
+};
+
+#endif // !DYNAMIC_RESOLUTION
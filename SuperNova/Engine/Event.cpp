@@ -19,3 +19,7 @@ ModuleTerminationEvent::ModuleTerminationEvent(Module const & t_from): Event(E_M
 
 CloseWindowEvent::CloseWindowEvent(Module const & t_from) : Event(E_CLOSE_WINDOW, t_from)
 {}
+
+
+QuitEvent::QuitEvent(Module const & t_from) : Event(E_QUIT, t_from)
+{}
\ No newline at end of file
@@ -7,7 +7,8 @@ enum EVENT_TYPE
 {
 	E_NO_TYPE = 0,
 	E_MODULE_TERMINATION,
-	E_CLOSE_WINDOW
+	E_CLOSE_WINDOW,
+	E_QUIT
 };
 
 class Event
@@ -49,4 +50,14 @@ private:
 
 };
 
+class QuitEvent : public Event
+{
+public:
+	QuitEvent(Module const &);
+	~QuitEvent() noexcept = default;
+
+private:
+
+};
+
 #endif // !EVENTS
\ No newline at end of file
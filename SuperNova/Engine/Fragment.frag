@@ -1,9 +1,94 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+layout(set = 0, binding = 0) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    mat4 view_projection;
+    vec4 camera_position;
+    float time;
+    float delta_time;
+    vec4 ambient;
+    uvec4 cluster_count;
+    vec4 cluster_scale;
+} frame;
+
+struct PointLight {
+    vec4 position_radius;
+    vec4 color_intensity;
+};
+
+struct LightCluster {
+    uint offset;
+    uint count;
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer Lights {
+    PointLight entries[];
+} lights;
+
+layout(std430, set = 0, binding = 3) readonly buffer LightClusters {
+    LightCluster entries[];
+} clusters;
+
+layout(std430, set = 0, binding = 4) readonly buffer LightIndices {
+    uint entries[];
+} light_indices;
+
+layout(push_constant) uniform DrawPushConstants {
+    uint object_index;
+    float lod_fade;
+    vec4 tint;
+} draw;
+
+// Material features, see ShaderVariants. Specialization constants are set per
+// pipeline, MATERIAL_ defines pick the cooked variant
+layout(constant_id = 0) const bool LOD_FADE = true;
+
 layout(location = 0) out vec4 outColor;
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragPosition;
+layout(location = 2) in vec3 fragNormal;
+
+const float dither[16] = float[](
+    0.0 / 16.0, 8.0 / 16.0, 2.0 / 16.0, 10.0 / 16.0,
+    12.0 / 16.0, 4.0 / 16.0, 14.0 / 16.0, 6.0 / 16.0,
+    3.0 / 16.0, 11.0 / 16.0, 1.0 / 16.0, 9.0 / 16.0,
+    15.0 / 16.0, 7.0 / 16.0, 13.0 / 16.0, 5.0 / 16.0
+);
+
+// Must match LightClusterer, tiles in pixels and exponential slices in view depth
+uint ClusterIndex() {
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / frame.cluster_scale.xy), frame.cluster_count.xy - 1);
+    float depth = -(frame.view * vec4(fragPosition, 1.0)).z;
+    float slice = clamp(floor(log(depth) * frame.cluster_scale.z + frame.cluster_scale.w), 0.0, float(frame.cluster_count.z - 1));
+    return (uint(slice) * frame.cluster_count.y + tile.y) * frame.cluster_count.x + tile.x;
+}
 
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    // Two LOD levels cross-fading keep complementary halves of the pattern
+    if (LOD_FADE && draw.lod_fade != 0.0) {
+        ivec2 pixel = ivec2(gl_FragCoord.xy) & 3;
+        bool below = dither[pixel.y * 4 + pixel.x] < abs(draw.lod_fade);
+        if (below != (draw.lod_fade > 0.0)) {
+            discard;
+        }
+    }
+
+    vec3 normal = normalize(fragNormal);
+    vec3 lighting = frame.ambient.rgb;
+
+#ifdef MATERIAL_CLUSTERED_LIGHTING
+    LightCluster cluster = clusters.entries[ClusterIndex()];
+    for (uint i = 0; i < cluster.count; ++i) {
+        PointLight light = lights.entries[light_indices.entries[cluster.offset + i]];
+        vec3 to_light = light.position_radius.xyz - fragPosition;
+        float distance = length(to_light);
+        float falloff = clamp(1.0 - distance / light.position_radius.w, 0.0, 1.0);
+        float diffuse = max(dot(normal, to_light / max(distance, 1e-4)), 0.0);
+        lighting += light.color_intensity.rgb * light.color_intensity.w * falloff * falloff * diffuse;
+    }
+#endif
+
+    outColor = vec4(fragColor * lighting, 1.0);
 }
\ No newline at end of file
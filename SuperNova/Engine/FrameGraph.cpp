@@ -0,0 +1,934 @@
+#include "PreCompiledHeader.hpp"
+#include "FrameGraph.h"
+#include "VulkanUtils.h"
+#include "GpuProfiler.h"
+
+FrameGraph::ResourceHandle FrameGraph::CreateImage(std::string const & t_name, ImageDescription const & t_description)
+{
+	auto resource = Resource{};
+	resource.name = t_name;
+	resource.description = t_description;
+	m_resources.emplace_back(std::move(resource));
+	m_compiled = false;
+	return static_cast<ResourceHandle>(m_resources.size() - 1);
+}
+
+FrameGraph::ResourceHandle FrameGraph::ImportImage(
+	std::string const & t_name,
+	ImageDescription const & t_description,
+	VkImageLayout t_initial_layout,
+	VkImageLayout t_final_layout,
+	VkPipelineStageFlags t_initial_stage)
+{
+	auto resource = Resource{};
+	resource.name = t_name;
+	resource.description = t_description;
+	resource.imported = true;
+	resource.initial_state.layout = t_initial_layout;
+	resource.initial_state.stage = t_initial_stage;
+	resource.final_layout = t_final_layout;
+	m_resources.emplace_back(std::move(resource));
+	m_compiled = false;
+	return static_cast<ResourceHandle>(m_resources.size() - 1);
+}
+
+void FrameGraph::SetImportedImage(ResourceHandle t_resource, VkImage t_image, VkImageView t_view)
+{
+	auto & resource = m_resources.at(t_resource);
+	if (!resource.imported) {
+		throw std::runtime_error("Frame graph - Resource " + resource.name + " is transient and can not be set externally");
+	}
+	resource.image = t_image;
+	resource.view = t_view;
+}
+
+void FrameGraph::MarkOutput(ResourceHandle t_resource)
+{
+	m_resources.at(t_resource).output = true;
+	m_compiled = false;
+}
+
+FrameGraph::PassHandle FrameGraph::AddPass(std::string const & t_name, PASS_TYPE t_type, ExecuteCallback t_execute)
+{
+	auto pass = Pass{};
+	pass.name = t_name;
+	pass.type = t_type;
+	pass.execute = std::move(t_execute);
+	m_passes.emplace_back(std::move(pass));
+	m_compiled = false;
+	return static_cast<PassHandle>(m_passes.size() - 1);
+}
+
+void FrameGraph::Read(PassHandle t_pass, ResourceHandle t_resource, RESOURCE_USAGE t_usage)
+{
+	AddAccess(t_pass, t_resource, t_usage, false);
+}
+
+void FrameGraph::Write(PassHandle t_pass, ResourceHandle t_resource, RESOURCE_USAGE t_usage)
+{
+	AddAccess(t_pass, t_resource, t_usage, true);
+}
+
+void FrameGraph::SetSideEffects(PassHandle t_pass)
+{
+	m_passes.at(t_pass).side_effects = true;
+	m_compiled = false;
+}
+
+void FrameGraph::SetAsyncCompute(PassHandle t_pass)
+{
+	auto & pass = m_passes.at(t_pass);
+	if (pass.type != PT_COMPUTE) {
+		throw std::runtime_error("Frame graph - Pass " + pass.name + " is not a compute pass and can not run on the compute queue");
+	}
+	pass.async = true;
+	m_compiled = false;
+}
+
+void FrameGraph::DependOn(PassHandle t_pass, PassHandle t_producer, VkPipelineStageFlags t_stages)
+{
+	auto & pass = m_passes.at(t_pass);
+	if (t_producer >= t_pass) {
+		throw std::runtime_error("Frame graph - Pass " + pass.name + " can only depend on passes added before it");
+	}
+	pass.dependencies.emplace_back(PassDependency{ t_producer, t_stages });
+	m_compiled = false;
+}
+
+void FrameGraph::SetProfiler(GpuProfiler * t_profiler) noexcept
+{
+	m_profiler = t_profiler;
+}
+
+void FrameGraph::EnableAsyncCompute(uint32_t t_graphics_family, uint32_t t_compute_family) noexcept
+{
+	m_graphics_family = t_graphics_family;
+	m_compute_family = t_compute_family;
+	m_async_compute = t_graphics_family != t_compute_family;
+	m_compiled = false;
+}
+
+void FrameGraph::Compile(VkDevice const & t_device, VkPhysicalDevice const & t_physical_device)
+{
+	DestroyTransients(t_device);
+	DestroySemaphores(t_device);
+	m_statistics = Statistics{};
+
+	CullPasses();
+	AssignQueues();
+	ComputeLifetimes();
+	AllocateTransients(t_device, t_physical_device);
+	ComputeBarriers();
+	CreateSemaphores(t_device);
+
+	m_compiled = true;
+}
+
+void FrameGraph::Execute(VkCommandBuffer t_command_buffer)
+{
+	if (m_submissions.size() > 1) {
+		throw std::runtime_error("Frame graph - Passes run on several queues, every submission has to be recorded on its own");
+	}
+
+	RecordSubmission(0, t_command_buffer);
+}
+
+void FrameGraph::Reset(VkDevice const & t_device) noexcept
+{
+	DestroyTransients(t_device);
+	DestroySemaphores(t_device);
+	m_passes.clear();
+	m_resources.clear();
+	m_submissions.clear();
+	m_final_barriers = BarrierBatch{};
+	m_statistics = Statistics{};
+	m_compiled = false;
+}
+
+VkImage FrameGraph::GetImage(ResourceHandle t_resource) const
+{
+	return m_resources.at(t_resource).image;
+}
+
+VkImageView FrameGraph::GetImageView(ResourceHandle t_resource) const
+{
+	return m_resources.at(t_resource).view;
+}
+
+FrameGraph::ImageDescription const & FrameGraph::GetDescription(ResourceHandle t_resource) const
+{
+	return m_resources.at(t_resource).description;
+}
+
+bool FrameGraph::IsCulled(PassHandle t_pass) const
+{
+	return m_passes.at(t_pass).culled;
+}
+
+FrameGraph::Statistics const & FrameGraph::GetStatistics() const noexcept
+{
+	return m_statistics;
+}
+
+uint32_t FrameGraph::GetSubmissionCount() const noexcept
+{
+	return static_cast<uint32_t>(m_submissions.size());
+}
+
+QUEUE_TYPE FrameGraph::GetSubmissionQueue(uint32_t t_submission) const
+{
+	return m_submissions.at(t_submission).queue;
+}
+
+void FrameGraph::RecordSubmission(uint32_t t_submission, VkCommandBuffer t_command_buffer)
+{
+	if (!m_compiled) {
+		throw std::runtime_error("Frame graph - Executed without being compiled");
+	}
+
+	auto const & submission = m_submissions.at(t_submission);
+
+	// The profiler resets its queries on the graphics queue and nothing orders that
+	// against the compute queue, so only graphics passes are timed
+	auto profiler = submission.queue == QT_GRAPHICS ? m_profiler : nullptr;
+
+	for (auto pass_handle : submission.passes) {
+		auto const & pass = m_passes[pass_handle];
+		auto scope = profiler != nullptr ? profiler->BeginScope(t_command_buffer, pass.name) : GpuProfiler::ScopeHandle{};
+		RecordBarriers(t_command_buffer, pass.barriers);
+		pass.execute(t_command_buffer, *this);
+		if (profiler != nullptr) {
+			profiler->EndScope(t_command_buffer, scope);
+		}
+	}
+
+	RecordBarriers(t_command_buffer, submission.releases);
+
+	if (t_submission + 1 == m_submissions.size()) {
+		RecordBarriers(t_command_buffer, m_final_barriers);
+	}
+}
+
+void FrameGraph::AppendSubmissionSemaphores(
+	uint32_t t_submission,
+	std::vector<VkSemaphore> & t_wait_semaphores,
+	std::vector<VkPipelineStageFlags> & t_wait_stages,
+	std::vector<VkSemaphore> & t_signal_semaphores)
+{
+	auto const & submission = m_submissions.at(t_submission);
+
+	for (auto const & wait : submission.waits) {
+		t_wait_semaphores.emplace_back(wait.semaphore);
+		t_wait_stages.emplace_back(wait.stages);
+	}
+
+	if (submission.waits_previous_frame && m_frame_semaphore_signalled) {
+		t_wait_semaphores.emplace_back(m_frame_semaphore);
+		t_wait_stages.emplace_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+	}
+
+	t_signal_semaphores.insert(t_signal_semaphores.end(), submission.signals.begin(), submission.signals.end());
+
+	if (t_submission + 1 == m_submissions.size() && m_frame_semaphore != VK_NULL_HANDLE) {
+		t_signal_semaphores.emplace_back(m_frame_semaphore);
+		m_frame_semaphore_signalled = true;
+	}
+}
+
+void FrameGraph::AddAccess(PassHandle t_pass, ResourceHandle t_resource, RESOURCE_USAGE t_usage, bool t_write)
+{
+	auto & pass = m_passes.at(t_pass);
+	auto & resource = m_resources.at(t_resource);
+
+	auto already_declared = std::any_of(pass.accesses.begin(), pass.accesses.end(),
+		[&](auto const & access) { return access.resource == t_resource; });
+
+	if (already_declared) {
+		throw std::runtime_error("Frame graph - Pass " + pass.name + " declares resource " + resource.name + " more than once");
+	}
+
+	pass.accesses.emplace_back(ResourceAccess{ t_resource, t_usage, t_write });
+	m_compiled = false;
+}
+
+void FrameGraph::CullPasses()
+{
+	// Walking backwards, a pass survives if it has side effects or writes something
+	// a surviving pass (or the outside world) still needs.
+	auto needed = std::vector<bool>(m_resources.size(), false);
+	for (auto i = 0u; i < m_resources.size(); ++i) {
+		needed[i] = m_resources[i].output;
+	}
+
+	for (auto pass = m_passes.rbegin(); pass != m_passes.rend(); ++pass) {
+		auto contributes = pass->side_effects || std::any_of(pass->accesses.begin(), pass->accesses.end(),
+			[&](auto const & access) { return access.write && needed[access.resource]; });
+
+		pass->culled = !contributes;
+
+		if (pass->culled) {
+			++m_statistics.culled_passes;
+			continue;
+		}
+
+		for (auto const & access : pass->accesses) {
+			needed[access.resource] = true;
+		}
+	}
+}
+
+void FrameGraph::AssignQueues()
+{
+	m_submissions.clear();
+
+	for (auto & pass : m_passes) {
+		pass.queue = m_async_compute && pass.async ? QT_COMPUTE : QT_GRAPHICS;
+	}
+
+	// Imported contents enter the frame owned by the graphics queue. When the first
+	// pass to use one is on the compute queue, an empty graphics submission ahead of
+	// everything releases it.
+	auto seen = std::vector<bool>(m_resources.size(), false);
+	auto needs_prologue = false;
+	for (auto const & pass : m_passes) {
+		if (pass.culled) {
+			continue;
+		}
+		for (auto const & access : pass.accesses) {
+			auto const & resource = m_resources[access.resource];
+			if (!seen[access.resource] && resource.imported && resource.initial_state.layout != VK_IMAGE_LAYOUT_UNDEFINED) {
+				needs_prologue |= pass.queue == QT_COMPUTE;
+			}
+			seen[access.resource] = true;
+		}
+		if (pass.queue == QT_GRAPHICS) {
+			break;
+		}
+	}
+
+	if (needs_prologue) {
+		m_submissions.emplace_back(Submission{});
+		m_submissions.back().queue = QT_GRAPHICS;
+	}
+
+	for (auto p = PassHandle{ 0 }; p < m_passes.size(); ++p) {
+		auto & pass = m_passes[p];
+		if (pass.culled) {
+			continue;
+		}
+
+		if (m_submissions.empty() || m_submissions.back().queue != pass.queue) {
+			m_submissions.emplace_back(Submission{});
+			m_submissions.back().queue = pass.queue;
+		}
+
+		pass.submission = static_cast<uint32_t>(m_submissions.size() - 1);
+		m_submissions.back().passes.emplace_back(p);
+	}
+
+	// Presentation and the final transitions happen on the graphics queue
+	if (m_submissions.empty() || m_submissions.back().queue != QT_GRAPHICS) {
+		m_submissions.emplace_back(Submission{});
+		m_submissions.back().queue = QT_GRAPHICS;
+	}
+
+	m_statistics.submissions = static_cast<uint32_t>(m_submissions.size());
+}
+
+void FrameGraph::ComputeLifetimes()
+{
+	for (auto & resource : m_resources) {
+		resource.first_pass.reset();
+		resource.last_pass = 0;
+		resource.aliased_predecessor.reset();
+		resource.async_access = false;
+	}
+
+	for (auto i = PassHandle{ 0 }; i < m_passes.size(); ++i) {
+		if (m_passes[i].culled) {
+			continue;
+		}
+		for (auto const & access : m_passes[i].accesses) {
+			auto & resource = m_resources[access.resource];
+			if (!resource.first_pass.has_value()) {
+				resource.first_pass = i;
+			}
+			resource.last_pass = i;
+			resource.async_access |= m_passes[i].queue == QT_COMPUTE;
+		}
+	}
+}
+
+void FrameGraph::AllocateTransients(VkDevice const & t_device, VkPhysicalDevice const & t_physical_device)
+{
+	auto transients = std::vector<std::pair<ResourceHandle, VkMemoryRequirements>>{};
+
+	for (auto i = ResourceHandle{ 0 }; i < m_resources.size(); ++i) {
+		auto & resource = m_resources[i];
+		if (resource.imported || !resource.first_pass.has_value()) {
+			continue;
+		}
+
+		auto const & description = resource.description;
+
+		auto image_info = VkImageCreateInfo{};
+		image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		image_info.imageType = VK_IMAGE_TYPE_2D;
+		image_info.format = description.format;
+		image_info.extent = { description.extent.width, description.extent.height, 1 };
+		image_info.mipLevels = description.mip_levels;
+		image_info.arrayLayers = 1;
+		image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+		image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+		image_info.usage = description.usage;
+		image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		auto result = vkCreateImage(t_device, &image_info, nullptr, &resource.image);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("create frame graph image " + resource.name, result);
+		}
+
+		auto requirements = VkMemoryRequirements{};
+		vkGetImageMemoryRequirements(t_device, resource.image, &requirements);
+		transients.emplace_back(i, requirements);
+	}
+
+	std::sort(transients.begin(), transients.end(), [&](auto const & a, auto const & b) {
+		return m_resources[a.first].first_pass.value() < m_resources[b.first].first_pass.value();
+	});
+
+	// Greedy interval colouring: each image goes into the best fitting block whose
+	// previous occupant is already dead, otherwise it opens a new block. Images used
+	// on the compute queue get a block of their own, pass order says nothing about
+	// when the other queue is done with the memory.
+	for (auto const & [handle, requirements] : transients) {
+		auto & resource = m_resources[handle];
+		auto best_block = std::optional<size_t>{};
+
+		for (auto b = size_t{ 0 }; b < m_memory_blocks.size() && !resource.async_access; ++b) {
+			auto const & block = m_memory_blocks[b];
+			if (block.exclusive || block.last_pass >= resource.first_pass.value() || (block.memory_type_bits & requirements.memoryTypeBits) == 0) {
+				continue;
+			}
+
+			auto grow = block.size < requirements.size ? requirements.size - block.size : 0;
+			if (!best_block.has_value()) {
+				best_block = b;
+				continue;
+			}
+
+			auto const & best = m_memory_blocks[best_block.value()];
+			auto best_grow = best.size < requirements.size ? requirements.size - best.size : 0;
+			if (grow < best_grow || (grow == best_grow && block.size < best.size)) {
+				best_block = b;
+			}
+		}
+
+		if (!best_block.has_value()) {
+			m_memory_blocks.emplace_back(MemoryBlock{});
+			m_memory_blocks.back().memory_type_bits = requirements.memoryTypeBits;
+			m_memory_blocks.back().exclusive = resource.async_access;
+			best_block = m_memory_blocks.size() - 1;
+		}
+		else {
+			resource.aliased_predecessor = m_memory_blocks[best_block.value()].last_occupant;
+		}
+
+		auto & block = m_memory_blocks[best_block.value()];
+		block.size = std::max(block.size, requirements.size);
+		block.memory_type_bits &= requirements.memoryTypeBits;
+		block.last_pass = resource.last_pass;
+		block.last_occupant = handle;
+		block.occupants.emplace_back(handle, requirements);
+		resource.memory_block = best_block.value();
+
+		m_statistics.aliased_memory_saved += requirements.size;
+	}
+
+	for (auto & block : m_memory_blocks) {
+		auto allocate_info = VkMemoryAllocateInfo{};
+		allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocate_info.allocationSize = block.size;
+		allocate_info.memoryTypeIndex = vulkan_utils::FindMemoryType(t_physical_device, block.memory_type_bits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		auto result = vkAllocateMemory(t_device, &allocate_info, nullptr, &block.memory);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("allocate frame graph memory", result);
+		}
+
+		m_statistics.transient_memory += block.size;
+
+		for (auto const & occupant : block.occupants) {
+			auto & resource = m_resources[occupant.first];
+			vkBindImageMemory(t_device, resource.image, block.memory, 0);
+
+			auto view_info = VkImageViewCreateInfo{};
+			view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			view_info.image = resource.image;
+			view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			view_info.format = resource.description.format;
+			view_info.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+			view_info.subresourceRange.aspectMask = resource.description.aspect;
+			view_info.subresourceRange.baseMipLevel = 0;
+			view_info.subresourceRange.levelCount = resource.description.mip_levels;
+			view_info.subresourceRange.baseArrayLayer = 0;
+			view_info.subresourceRange.layerCount = 1;
+
+			result = vkCreateImageView(t_device, &view_info, nullptr, &resource.view);
+			if (result != VK_SUCCESS) {
+				vulkan_utils::ThrowError("create frame graph image view " + resource.name, result);
+			}
+		}
+	}
+
+	m_statistics.aliased_memory_saved -= m_statistics.transient_memory;
+}
+
+void FrameGraph::ComputeBarriers()
+{
+	// The first run only finds the state every resource is left in at the end of a
+	// frame, the second one starts from it so that the first use of a transient also
+	// waits for the previous frame's last use of the same memory.
+	auto end_states = SimulateStates(std::vector<TrackedState>(m_resources.size()), false);
+
+	for (auto & submission : m_submissions) {
+		submission.waits.clear();
+		submission.signals.clear();
+		submission.releases = BarrierBatch{};
+		submission.waits_previous_frame = false;
+	}
+
+	auto initial_states = std::vector<TrackedState>(m_resources.size());
+	for (auto i = ResourceHandle{ 0 }; i < m_resources.size(); ++i) {
+		auto const & resource = m_resources[i];
+		auto & state = initial_states[i];
+
+		if (resource.imported) {
+			state.layout = resource.initial_state.layout;
+			state.write_stages = resource.initial_state.stage;
+
+			// Discarded contents are taken over by whichever queue uses the image
+			// first, after the previous frame's last use on the other queue
+			auto discarded = resource.initial_state.layout == VK_IMAGE_LAYOUT_UNDEFINED;
+			if (discarded && resource.first_pass.has_value() && end_states[i].queue != m_passes[resource.first_pass.value()].queue) {
+				state.write_stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			}
+		}
+		else if (resource.first_pass.has_value() && !resource.aliased_predecessor.has_value()) {
+			auto const & previous_frame = end_states[m_memory_blocks[resource.memory_block].last_occupant];
+			state.write_stages = previous_frame.write_stages | previous_frame.read_stages;
+			state.write_access = previous_frame.write_access;
+
+			// Last used on the other queue, whose work is only joined into this one
+			// at the end of the frame
+			if (previous_frame.queue != m_passes[resource.first_pass.value()].queue) {
+				state.write_stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+				state.write_access = 0;
+			}
+		}
+	}
+
+	auto states = SimulateStates(std::move(initial_states), true);
+
+	for (auto const & pass : m_passes) {
+		if (pass.culled) {
+			continue;
+		}
+		for (auto const & dependency : pass.dependencies) {
+			auto const & producer = m_passes[dependency.producer];
+			if (!producer.culled && producer.queue != pass.queue) {
+				AddSubmissionWait(producer.submission, pass.submission, dependency.stages);
+			}
+		}
+	}
+
+	auto last_submission = static_cast<uint32_t>(m_submissions.size() - 1);
+	ComputeFinalBarriers(states, last_submission);
+
+	// The last compute submission's signal covers everything submitted before it on
+	// that queue. Joining it into the final graphics submission means a finished
+	// frame has no compute work left in flight, and the next frame's first compute
+	// submission waits for that before reusing the memory.
+	auto first_compute = std::optional<uint32_t>{};
+	auto last_compute = std::optional<uint32_t>{};
+
+	for (auto s = uint32_t{ 0 }; s < m_submissions.size(); ++s) {
+		if (m_submissions[s].queue != QT_COMPUTE) {
+			continue;
+		}
+		if (!first_compute.has_value()) {
+			first_compute = s;
+		}
+		last_compute = s;
+	}
+
+	if (last_compute.has_value()) {
+		auto joined = false;
+		for (auto s = last_compute.value() + 1; s < m_submissions.size(); ++s) {
+			auto const & waits = m_submissions[s].waits;
+			joined |= std::any_of(waits.begin(), waits.end(), [&](auto const & wait) { return wait.producer == last_compute.value(); });
+		}
+
+		if (!joined) {
+			AddSubmissionWait(last_compute.value(), last_submission, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+		}
+
+		m_submissions[first_compute.value()].waits_previous_frame = true;
+	}
+
+	if (!m_final_barriers.transitions.empty()) {
+		++m_statistics.barrier_batches;
+		m_statistics.image_barriers += static_cast<uint32_t>(m_final_barriers.transitions.size());
+	}
+
+	for (auto const & submission : m_submissions) {
+		if (!submission.releases.transitions.empty()) {
+			++m_statistics.barrier_batches;
+			m_statistics.image_barriers += static_cast<uint32_t>(submission.releases.transitions.size());
+		}
+	}
+}
+
+void FrameGraph::ComputeFinalBarriers(std::vector<TrackedState> const & t_states, uint32_t t_last_submission)
+{
+	m_final_barriers = BarrierBatch{};
+	for (auto i = ResourceHandle{ 0 }; i < m_resources.size(); ++i) {
+		auto const & resource = m_resources[i];
+		auto const & state = t_states[i];
+
+		if (!resource.imported) {
+			continue;
+		}
+
+		// Contents leaving the frame are handed back to the graphics queue, which
+		// also presents and starts the next frame
+		auto keeps_contents = resource.final_layout != VK_IMAGE_LAYOUT_UNDEFINED || resource.initial_state.layout != VK_IMAGE_LAYOUT_UNDEFINED;
+		auto ownership_transfer = keeps_contents && state.queue != QT_GRAPHICS;
+		auto final_layout = resource.final_layout != VK_IMAGE_LAYOUT_UNDEFINED ? resource.final_layout : state.layout;
+
+		if (!ownership_transfer && final_layout == state.layout) {
+			continue;
+		}
+
+		auto transition = Transition{};
+		transition.resource = i;
+		transition.old_layout = state.layout;
+		transition.new_layout = final_layout;
+		transition.source_access = state.write_access;
+		transition.destination_access = 0;
+
+		auto source_stages = state.write_stages | state.read_stages;
+		if (source_stages == 0) {
+			source_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		}
+
+		if (ownership_transfer) {
+			transition.ownership_transfer = true;
+			transition.source_queue = state.queue;
+			transition.destination_queue = QT_GRAPHICS;
+
+			auto & producer = m_submissions[state.submission];
+			producer.releases.source_stages |= source_stages;
+			producer.releases.destination_stages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+			producer.releases.transitions.emplace_back(transition);
+
+			transition.source_access = 0;
+			m_final_barriers.source_stages |= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			AddSubmissionWait(state.submission, t_last_submission, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+			++m_statistics.queue_ownership_transfers;
+		}
+		else {
+			m_final_barriers.source_stages |= source_stages;
+		}
+
+		m_final_barriers.destination_stages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		m_final_barriers.transitions.emplace_back(transition);
+	}
+}
+
+std::vector<FrameGraph::TrackedState> FrameGraph::SimulateStates(std::vector<TrackedState> t_states, bool t_record)
+{
+	for (auto p = PassHandle{ 0 }; p < m_passes.size(); ++p) {
+		auto & pass = m_passes[p];
+		if (t_record) {
+			pass.barriers = BarrierBatch{};
+		}
+
+		if (pass.culled) {
+			continue;
+		}
+
+		for (auto const & access : pass.accesses) {
+			auto const & resource = m_resources[access.resource];
+			auto & state = t_states[access.resource];
+			auto required = GetUsageState(access.usage, pass.type, access.write);
+
+			// A transient placed in memory someone else used this frame must wait for
+			// that work before its contents are discarded by the UNDEFINED transition.
+			// Imported contents carried into the frame are kept.
+			auto discarded = !resource.imported || resource.initial_state.layout == VK_IMAGE_LAYOUT_UNDEFINED;
+			if (resource.first_pass == p && discarded) {
+				state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+				state.queue = pass.queue;
+				if (resource.aliased_predecessor.has_value()) {
+					auto const & predecessor = t_states[resource.aliased_predecessor.value()];
+					state.write_stages = predecessor.write_stages | predecessor.read_stages;
+					state.write_access = predecessor.write_access;
+				}
+			}
+
+			auto needs_barrier = false;
+			auto source_stages = state.write_stages | state.read_stages;
+			auto layout_change = state.layout != required.layout;
+			auto ownership_transfer = state.queue != pass.queue;
+
+			if (layout_change || ownership_transfer) {
+				needs_barrier = true;
+			}
+			else if (access.write) {
+				needs_barrier = source_stages != 0;
+			}
+			else {
+				needs_barrier = state.write_access != 0 && (required.stage & ~state.visible_stages) != 0;
+			}
+
+			if (needs_barrier && t_record) {
+				auto transition = Transition{};
+				transition.resource = access.resource;
+				transition.old_layout = state.layout;
+				transition.new_layout = required.layout;
+				transition.source_access = state.write_access;
+				transition.destination_access = required.access;
+
+				if (ownership_transfer) {
+					// The producing queue releases with the very same layout transition,
+					// the semaphore orders it before the acquire below
+					transition.ownership_transfer = true;
+					transition.source_queue = state.queue;
+					transition.destination_queue = pass.queue;
+
+					auto release = transition;
+					release.destination_access = 0;
+
+					auto & producer = m_submissions[state.submission];
+					producer.releases.source_stages |= source_stages != 0 ? source_stages : VkPipelineStageFlags{ VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT };
+					producer.releases.destination_stages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+					producer.releases.transitions.emplace_back(release);
+
+					transition.source_access = 0;
+					pass.barriers.source_stages |= required.stage;
+					AddSubmissionWait(state.submission, pass.submission, required.stage);
+					++m_statistics.queue_ownership_transfers;
+				}
+				else {
+					pass.barriers.source_stages |= source_stages != 0 ? source_stages : VkPipelineStageFlags{ VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT };
+				}
+
+				pass.barriers.destination_stages |= required.stage;
+				pass.barriers.transitions.emplace_back(transition);
+			}
+
+			// After an acquire the work on this queue that waited on the semaphore
+			// stands in for the producer
+			if (ownership_transfer) {
+				state.write_stages = required.stage;
+				state.read_stages = 0;
+				state.visible_stages = 0;
+			}
+
+			state.queue = pass.queue;
+			state.submission = pass.submission;
+			state.layout = required.layout;
+			if (access.write) {
+				state.write_stages = required.stage;
+				state.write_access = GetWriteAccess(required.access);
+				state.read_stages = 0;
+				state.visible_stages = 0;
+			}
+			else {
+				state.visible_stages = layout_change ? required.stage : state.visible_stages | (needs_barrier ? required.stage : 0);
+				state.read_stages |= required.stage;
+			}
+		}
+
+		if (t_record && !pass.barriers.transitions.empty()) {
+			++m_statistics.barrier_batches;
+			m_statistics.image_barriers += static_cast<uint32_t>(pass.barriers.transitions.size());
+		}
+	}
+
+	return t_states;
+}
+
+void FrameGraph::AddSubmissionWait(uint32_t t_producer, uint32_t t_consumer, VkPipelineStageFlags t_stages)
+{
+	auto & waits = m_submissions[t_consumer].waits;
+	auto existing = std::find_if(waits.begin(), waits.end(), [&](auto const & wait) { return wait.producer == t_producer; });
+
+	if (existing != waits.end()) {
+		existing->stages |= t_stages;
+	}
+	else {
+		waits.emplace_back(SubmissionWait{ t_producer, t_stages, VK_NULL_HANDLE });
+	}
+}
+
+void FrameGraph::CreateSemaphores(VkDevice const & t_device)
+{
+	auto semaphore_info = VkSemaphoreCreateInfo{};
+	semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	auto MakeSemaphore = [&](VkSemaphore & t_semaphore) {
+		auto result = vkCreateSemaphore(t_device, &semaphore_info, nullptr, &t_semaphore);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("create frame graph semaphore", result);
+		}
+		++m_statistics.cross_queue_semaphores;
+	};
+
+	for (auto & submission : m_submissions) {
+		for (auto & wait : submission.waits) {
+			MakeSemaphore(wait.semaphore);
+			m_submissions[wait.producer].signals.emplace_back(wait.semaphore);
+		}
+	}
+
+	auto uses_compute = std::any_of(m_submissions.begin(), m_submissions.end(),
+		[](auto const & submission) { return submission.queue == QT_COMPUTE; });
+
+	if (uses_compute) {
+		MakeSemaphore(m_frame_semaphore);
+	}
+	m_frame_semaphore_signalled = false;
+}
+
+void FrameGraph::RecordBarriers(VkCommandBuffer t_command_buffer, BarrierBatch const & t_batch)
+{
+	if (t_batch.transitions.empty()) {
+		return;
+	}
+
+	m_barrier_scratch.clear();
+
+	for (auto const & transition : t_batch.transitions) {
+		auto const & resource = m_resources[transition.resource];
+
+		if (resource.image == VK_NULL_HANDLE) {
+			throw std::runtime_error("Frame graph - Imported resource " + resource.name + " has no image bound");
+		}
+
+		auto barrier = VkImageMemoryBarrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = transition.source_access;
+		barrier.dstAccessMask = transition.destination_access;
+		barrier.oldLayout = transition.old_layout;
+		barrier.newLayout = transition.new_layout;
+		barrier.srcQueueFamilyIndex = transition.ownership_transfer ? GetQueueFamily(transition.source_queue) : VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = transition.ownership_transfer ? GetQueueFamily(transition.destination_queue) : VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = resource.image;
+		barrier.subresourceRange.aspectMask = resource.description.aspect;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = resource.description.mip_levels;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		m_barrier_scratch.emplace_back(barrier);
+	}
+
+	vkCmdPipelineBarrier(
+		t_command_buffer,
+		t_batch.source_stages,
+		t_batch.destination_stages,
+		0,
+		0, nullptr,
+		0, nullptr,
+		static_cast<uint32_t>(m_barrier_scratch.size()), m_barrier_scratch.data());
+}
+
+void FrameGraph::DestroyTransients(VkDevice const & t_device) noexcept
+{
+	for (auto & resource : m_resources) {
+		if (resource.imported) {
+			continue;
+		}
+		if (resource.view != VK_NULL_HANDLE) {
+			vkDestroyImageView(t_device, resource.view, nullptr);
+			resource.view = VK_NULL_HANDLE;
+		}
+		if (resource.image != VK_NULL_HANDLE) {
+			vkDestroyImage(t_device, resource.image, nullptr);
+			resource.image = VK_NULL_HANDLE;
+		}
+	}
+
+	for (auto & block : m_memory_blocks) {
+		vkFreeMemory(t_device, block.memory, nullptr);
+	}
+	m_memory_blocks.clear();
+}
+
+void FrameGraph::DestroySemaphores(VkDevice const & t_device) noexcept
+{
+	for (auto & submission : m_submissions) {
+		for (auto & wait : submission.waits) {
+			vkDestroySemaphore(t_device, wait.semaphore, nullptr);
+			wait.semaphore = VK_NULL_HANDLE;
+		}
+		submission.signals.clear();
+	}
+
+	if (m_frame_semaphore != VK_NULL_HANDLE) {
+		vkDestroySemaphore(t_device, m_frame_semaphore, nullptr);
+		m_frame_semaphore = VK_NULL_HANDLE;
+	}
+	m_frame_semaphore_signalled = false;
+}
+
+uint32_t FrameGraph::GetQueueFamily(QUEUE_TYPE t_queue) const noexcept
+{
+	return t_queue == QT_COMPUTE ? m_compute_family : m_graphics_family;
+}
+
+FrameGraph::ImageState FrameGraph::GetUsageState(RESOURCE_USAGE t_usage, PASS_TYPE t_pass_type, bool t_write)
+{
+	auto shader_stages = VkPipelineStageFlags{ VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT };
+	if (t_pass_type == PT_COMPUTE) {
+		shader_stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	}
+
+	auto depth_stages = VkPipelineStageFlags{ VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT };
+
+	auto WriteOnly = [t_write](VkAccessFlags t_access) { return t_write ? t_access : VkAccessFlags{ 0 }; };
+
+	switch (t_usage)
+	{
+	case RU_COLOR_ATTACHMENT:
+		return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | WriteOnly(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT) };
+	case RU_DEPTH_ATTACHMENT:
+		return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, depth_stages,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | WriteOnly(VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT) };
+	case RU_DEPTH_READ:
+		return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, depth_stages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT };
+	case RU_SAMPLED:
+		return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, shader_stages, VK_ACCESS_SHADER_READ_BIT };
+	case RU_STORAGE:
+		return { VK_IMAGE_LAYOUT_GENERAL, shader_stages, VK_ACCESS_SHADER_READ_BIT | WriteOnly(VK_ACCESS_SHADER_WRITE_BIT) };
+	case RU_TRANSFER_SOURCE:
+		return { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT };
+	case RU_TRANSFER_DESTINATION:
+		return { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT };
+	default:
+		throw std::runtime_error("Frame graph - Unknown resource usage");
+	}
+}
+
+VkAccessFlags FrameGraph::GetWriteAccess(VkAccessFlags t_access)
+{
+	return t_access & (VK_ACCESS_SHADER_WRITE_BIT |
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_TRANSFER_WRITE_BIT |
+		VK_ACCESS_HOST_WRITE_BIT |
+		VK_ACCESS_MEMORY_WRITE_BIT);
+}
@@ -0,0 +1,244 @@
+#ifndef FRAME_GRAPH
+#define FRAME_GRAPH
+
+#include "vulkan/vulkan.h"
+
+class GpuProfiler;
+
+enum PASS_TYPE
+{
+	PT_GRAPHICS = 0,
+	PT_COMPUTE,
+	PT_TRANSFER
+};
+
+enum QUEUE_TYPE
+{
+	QT_GRAPHICS = 0,
+	QT_COMPUTE
+};
+
+enum RESOURCE_USAGE
+{
+	RU_COLOR_ATTACHMENT = 0,
+	RU_DEPTH_ATTACHMENT,
+	RU_DEPTH_READ,
+	RU_SAMPLED,
+	RU_STORAGE,
+	RU_TRANSFER_SOURCE,
+	RU_TRANSFER_DESTINATION
+};
+
+// Passes declare what they read and write, Compile() culls the passes that do not
+// contribute to an output, places transient images in shared memory when their
+// lifetimes do not overlap and precomputes one batched barrier per pass.
+//
+// Compute passes marked async run on the compute queue when one is enabled. The
+// passes are split into submissions at every queue change, images crossing queues
+// get matching release and acquire barriers and the consuming submission waits on
+// a semaphore signalled by the producing one. Imported images cross queues like
+// transient ones; contents carried into or out of the frame are handed over on
+// the graphics queue. Buffers are not tracked, passes sharing them across queues
+// declare the dependency.
+class FrameGraph
+{
+public:
+	using ResourceHandle = uint32_t;
+	using PassHandle = uint32_t;
+	using ExecuteCallback = std::function<void(VkCommandBuffer, FrameGraph const &)>;
+
+	struct ImageDescription {
+		VkFormat format{ VK_FORMAT_UNDEFINED };
+		VkExtent2D extent{};
+		VkImageUsageFlags usage{ 0 };
+		VkImageAspectFlags aspect{ VK_IMAGE_ASPECT_COLOR_BIT };
+		uint32_t mip_levels{ 1 };
+	};
+
+	struct Statistics {
+		uint32_t culled_passes{ 0 };
+		uint32_t barrier_batches{ 0 };
+		uint32_t image_barriers{ 0 };
+		VkDeviceSize transient_memory{ 0 };
+		VkDeviceSize aliased_memory_saved{ 0 };
+		uint32_t submissions{ 0 };
+		uint32_t queue_ownership_transfers{ 0 };
+		uint32_t cross_queue_semaphores{ 0 };
+	};
+
+	explicit FrameGraph() = default;
+	FrameGraph(FrameGraph const &) = delete;
+	FrameGraph(FrameGraph &&) noexcept = default;
+	FrameGraph & operator = (FrameGraph const &) = delete;
+	FrameGraph & operator = (FrameGraph &&) noexcept = default;
+	~FrameGraph() noexcept = default;
+
+	[[nodiscard]] ResourceHandle CreateImage(std::string const &, ImageDescription const &);
+	[[nodiscard]] ResourceHandle ImportImage(std::string const &, ImageDescription const &, VkImageLayout, VkImageLayout, VkPipelineStageFlags);
+	void SetImportedImage(ResourceHandle, VkImage, VkImageView);
+	void MarkOutput(ResourceHandle);
+
+	[[nodiscard]] PassHandle AddPass(std::string const &, PASS_TYPE, ExecuteCallback);
+	void Read(PassHandle, ResourceHandle, RESOURCE_USAGE);
+	void Write(PassHandle, ResourceHandle, RESOURCE_USAGE);
+	void SetSideEffects(PassHandle);
+	void SetAsyncCompute(PassHandle);
+	// The first pass consumes, at the given stages, buffer results of the second,
+	// earlier one. Only orders the passes across queues, barriers on one queue stay
+	// with the passes.
+	void DependOn(PassHandle, PassHandle, VkPipelineStageFlags);
+	void SetProfiler(GpuProfiler *) noexcept;
+	void EnableAsyncCompute(uint32_t, uint32_t) noexcept;
+
+	void Compile(VkDevice const &, VkPhysicalDevice const &);
+	void Execute(VkCommandBuffer);
+	void Reset(VkDevice const &) noexcept;
+
+	// Submissions have to be recorded and submitted in order, the last one is always
+	// on the graphics queue
+	[[nodiscard]] uint32_t GetSubmissionCount() const noexcept;
+	[[nodiscard]] QUEUE_TYPE GetSubmissionQueue(uint32_t) const;
+	void RecordSubmission(uint32_t, VkCommandBuffer);
+	void AppendSubmissionSemaphores(uint32_t, std::vector<VkSemaphore> &, std::vector<VkPipelineStageFlags> &, std::vector<VkSemaphore> &);
+
+	[[nodiscard]] VkImage GetImage(ResourceHandle) const;
+	[[nodiscard]] VkImageView GetImageView(ResourceHandle) const;
+	[[nodiscard]] ImageDescription const & GetDescription(ResourceHandle) const;
+	[[nodiscard]] bool IsCulled(PassHandle) const;
+	[[nodiscard]] Statistics const & GetStatistics() const noexcept;
+
+private:
+	struct ImageState {
+		VkImageLayout layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		VkPipelineStageFlags stage{ 0 };
+		VkAccessFlags access{ 0 };
+	};
+
+	struct TrackedState {
+		VkImageLayout layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		VkPipelineStageFlags write_stages{ 0 };
+		VkAccessFlags write_access{ 0 };
+		VkPipelineStageFlags read_stages{ 0 };
+		VkPipelineStageFlags visible_stages{ 0 };
+		QUEUE_TYPE queue{ QT_GRAPHICS };
+		uint32_t submission{ 0 };
+	};
+
+	struct ResourceAccess {
+		ResourceHandle resource{};
+		RESOURCE_USAGE usage{};
+		bool write{ false };
+	};
+
+	struct Transition {
+		ResourceHandle resource{};
+		VkImageLayout old_layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		VkImageLayout new_layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		VkAccessFlags source_access{ 0 };
+		VkAccessFlags destination_access{ 0 };
+		bool ownership_transfer{ false };
+		QUEUE_TYPE source_queue{ QT_GRAPHICS };
+		QUEUE_TYPE destination_queue{ QT_GRAPHICS };
+	};
+
+	struct BarrierBatch {
+		VkPipelineStageFlags source_stages{ 0 };
+		VkPipelineStageFlags destination_stages{ 0 };
+		std::vector<Transition> transitions{};
+	};
+
+	struct PassDependency {
+		PassHandle producer{ 0 };
+		VkPipelineStageFlags stages{ 0 };
+	};
+
+	struct Pass {
+		std::string name{};
+		PASS_TYPE type{ PT_GRAPHICS };
+		ExecuteCallback execute{};
+		std::vector<ResourceAccess> accesses{};
+		std::vector<PassDependency> dependencies{};
+		bool side_effects{ false };
+		bool async{ false };
+		bool culled{ false };
+		QUEUE_TYPE queue{ QT_GRAPHICS };
+		uint32_t submission{ 0 };
+		BarrierBatch barriers{};
+	};
+
+	struct SubmissionWait {
+		uint32_t producer{ 0 };
+		VkPipelineStageFlags stages{ 0 };
+		VkSemaphore semaphore{ VK_NULL_HANDLE };
+	};
+
+	struct Submission {
+		QUEUE_TYPE queue{ QT_GRAPHICS };
+		std::vector<PassHandle> passes{};
+		std::vector<SubmissionWait> waits{};
+		std::vector<VkSemaphore> signals{};
+		BarrierBatch releases{};
+		bool waits_previous_frame{ false };
+	};
+
+	struct Resource {
+		std::string name{};
+		ImageDescription description{};
+		bool imported{ false };
+		bool output{ false };
+		ImageState initial_state{};
+		VkImageLayout final_layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		VkImage image{ VK_NULL_HANDLE };
+		VkImageView view{ VK_NULL_HANDLE };
+		std::optional<PassHandle> first_pass{};
+		PassHandle last_pass{ 0 };
+		std::optional<ResourceHandle> aliased_predecessor{};
+		size_t memory_block{ 0 };
+		bool async_access{ false };
+	};
+
+	struct MemoryBlock {
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+		VkDeviceSize size{ 0 };
+		uint32_t memory_type_bits{ 0 };
+		PassHandle last_pass{ 0 };
+		ResourceHandle last_occupant{ 0 };
+		bool exclusive{ false };
+		std::vector<std::pair<ResourceHandle, VkMemoryRequirements>> occupants{};
+	};
+
+	void AddAccess(PassHandle, ResourceHandle, RESOURCE_USAGE, bool);
+	void CullPasses();
+	void AssignQueues();
+	void ComputeLifetimes();
+	void AllocateTransients(VkDevice const &, VkPhysicalDevice const &);
+	void ComputeBarriers();
+	void ComputeFinalBarriers(std::vector<TrackedState> const &, uint32_t);
+	[[nodiscard]] std::vector<TrackedState> SimulateStates(std::vector<TrackedState>, bool);
+	void AddSubmissionWait(uint32_t, uint32_t, VkPipelineStageFlags);
+	void CreateSemaphores(VkDevice const &);
+	void RecordBarriers(VkCommandBuffer, BarrierBatch const &);
+	void DestroyTransients(VkDevice const &) noexcept;
+	void DestroySemaphores(VkDevice const &) noexcept;
+	[[nodiscard]] uint32_t GetQueueFamily(QUEUE_TYPE) const noexcept;
+
+	[[nodiscard]] static ImageState GetUsageState(RESOURCE_USAGE, PASS_TYPE, bool);
+	[[nodiscard]] static VkAccessFlags GetWriteAccess(VkAccessFlags);
+
+	std::vector<Pass> m_passes{};
+	std::vector<Resource> m_resources{};
+	std::vector<MemoryBlock> m_memory_blocks{};
+	std::vector<Submission> m_submissions{};
+	BarrierBatch m_final_barriers{};
+	std::vector<VkImageMemoryBarrier> m_barrier_scratch{};
+	Statistics m_statistics{};
+	GpuProfiler * m_profiler{ nullptr };
+	VkSemaphore m_frame_semaphore{ VK_NULL_HANDLE };
+	uint32_t m_graphics_family{ 0 };
+	uint32_t m_compute_family{ 0 };
+	bool m_async_compute{ false };
+	bool m_frame_semaphore_signalled{ false };
+	bool m_compiled{ false };
+};
+
+#endif // !FRAME_GRAPH
@@ -0,0 +1,314 @@
+#include "PreCompiledHeader.hpp"
+#include "FrustumCuller.h"
+#include "Telemetry.h"
+
+#if GLM_ARCH & GLM_ARCH_X86_BIT
+#	include <immintrin.h>
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#		define AVX_TARGET
+#	else
+#		include <cpuid.h>
+#		define AVX_TARGET __attribute__((target("avx")))
+#	endif
+#	define FRUSTUM_CULLER_X86
+#endif
+
+// Arrays are padded to a whole AVX register, padding objects have a negative
+// infinite radius and never pass a plane
+constexpr uint32_t SIMD_WIDTH = 8;
+// Smallest chunk worth handing to another thread
+constexpr uint32_t MIN_CULL_CHUNK_SIZE = 16 * 1024;
+
+namespace
+{
+	void AppendMask(uint32_t t_mask, uint32_t t_first, std::vector<FrustumCuller::ObjectIndex> & t_visible)
+	{
+		while (t_mask != 0) {
+			auto bit = uint32_t{ 0 };
+			while ((t_mask & (1u << bit)) == 0) {
+				++bit;
+			}
+			t_visible.emplace_back(t_first + bit);
+			t_mask &= t_mask - 1;
+		}
+	}
+
+	void CullScalar(
+		FrustumCuller::Frustum const & t_frustum,
+		float const * t_x, float const * t_y, float const * t_z, float const * t_radius,
+		uint32_t t_begin, uint32_t t_end,
+		std::vector<FrustumCuller::ObjectIndex> & t_visible)
+	{
+		for (auto i = t_begin; i < t_end; ++i) {
+			auto visible = true;
+			for (auto const & plane : t_frustum.planes) {
+				if (plane.x * t_x[i] + plane.y * t_y[i] + plane.z * t_z[i] + plane.w <= -t_radius[i]) {
+					visible = false;
+					break;
+				}
+			}
+			if (visible) {
+				t_visible.emplace_back(i);
+			}
+		}
+	}
+
+#ifdef FRUSTUM_CULLER_X86
+	void CullSse(
+		FrustumCuller::Frustum const & t_frustum,
+		float const * t_x, float const * t_y, float const * t_z, float const * t_radius,
+		uint32_t t_begin, uint32_t t_end,
+		std::vector<FrustumCuller::ObjectIndex> & t_visible)
+	{
+		__m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+		for (auto p = 0; p < 6; ++p) {
+			plane_x[p] = _mm_set1_ps(t_frustum.planes[p].x);
+			plane_y[p] = _mm_set1_ps(t_frustum.planes[p].y);
+			plane_z[p] = _mm_set1_ps(t_frustum.planes[p].z);
+			plane_w[p] = _mm_set1_ps(t_frustum.planes[p].w);
+		}
+
+		auto const sign = _mm_set1_ps(-0.0f);
+
+		for (auto i = t_begin; i < t_end; i += 4) {
+			auto x = _mm_loadu_ps(t_x + i);
+			auto y = _mm_loadu_ps(t_y + i);
+			auto z = _mm_loadu_ps(t_z + i);
+			auto negative_radius = _mm_xor_ps(_mm_loadu_ps(t_radius + i), sign);
+
+			auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (auto p = 0; p < 6; ++p) {
+				auto distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(plane_x[p], x), _mm_mul_ps(plane_y[p], y)),
+					_mm_add_ps(_mm_mul_ps(plane_z[p], z), plane_w[p]));
+				inside = _mm_and_ps(inside, _mm_cmpgt_ps(distance, negative_radius));
+			}
+
+			AppendMask(static_cast<uint32_t>(_mm_movemask_ps(inside)), i, t_visible);
+		}
+	}
+
+	AVX_TARGET void CullAvx(
+		FrustumCuller::Frustum const & t_frustum,
+		float const * t_x, float const * t_y, float const * t_z, float const * t_radius,
+		uint32_t t_begin, uint32_t t_end,
+		std::vector<FrustumCuller::ObjectIndex> & t_visible)
+	{
+		__m256 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+		for (auto p = 0; p < 6; ++p) {
+			plane_x[p] = _mm256_set1_ps(t_frustum.planes[p].x);
+			plane_y[p] = _mm256_set1_ps(t_frustum.planes[p].y);
+			plane_z[p] = _mm256_set1_ps(t_frustum.planes[p].z);
+			plane_w[p] = _mm256_set1_ps(t_frustum.planes[p].w);
+		}
+
+		auto const sign = _mm256_set1_ps(-0.0f);
+
+		for (auto i = t_begin; i < t_end; i += 8) {
+			auto x = _mm256_loadu_ps(t_x + i);
+			auto y = _mm256_loadu_ps(t_y + i);
+			auto z = _mm256_loadu_ps(t_z + i);
+			auto negative_radius = _mm256_xor_ps(_mm256_loadu_ps(t_radius + i), sign);
+
+			auto inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (auto p = 0; p < 6; ++p) {
+				auto distance = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(plane_x[p], x), _mm256_mul_ps(plane_y[p], y)),
+					_mm256_add_ps(_mm256_mul_ps(plane_z[p], z), plane_w[p]));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negative_radius, _CMP_GT_OQ));
+			}
+
+			AppendMask(static_cast<uint32_t>(_mm256_movemask_ps(inside)), i, t_visible);
+		}
+	}
+#endif
+}
+
+FrustumCuller::FrustumCuller() :
+	m_center_x{},
+	m_center_y{},
+	m_center_z{},
+	m_radius{},
+	m_chunk_results{},
+	m_object_count{ 0 },
+	m_simd_level{ DetectSimdLevel() }
+{}
+
+FrustumCuller::ObjectIndex FrustumCuller::Add(glm::vec3 const & t_center, float t_radius)
+{
+	auto index = m_object_count++;
+
+	if (m_radius.size() < m_object_count) {
+		auto padded = static_cast<size_t>(m_object_count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+		m_center_x.resize(padded, 0.0f);
+		m_center_y.resize(padded, 0.0f);
+		m_center_z.resize(padded, 0.0f);
+		m_radius.resize(padded, -std::numeric_limits<float>::infinity());
+	}
+
+	Update(index, t_center, t_radius);
+	return index;
+}
+
+void FrustumCuller::Update(ObjectIndex t_index, glm::vec3 const & t_center, float t_radius)
+{
+	m_center_x.at(t_index) = t_center.x;
+	m_center_y[t_index] = t_center.y;
+	m_center_z[t_index] = t_center.z;
+	m_radius[t_index] = t_radius;
+}
+
+void FrustumCuller::Clear() noexcept
+{
+	m_center_x.clear();
+	m_center_y.clear();
+	m_center_z.clear();
+	m_radius.clear();
+	m_object_count = 0;
+}
+
+void FrustumCuller::Cull(glm::mat4 const & t_view_projection, std::vector<ObjectIndex> & t_visible)
+{
+	Cull(ExtractFrustum(t_view_projection), t_visible);
+}
+
+void FrustumCuller::Cull(Frustum const & t_frustum, std::vector<ObjectIndex> & t_visible)
+{
+	auto timer = ScopedCpuTimer{ "Frustum Culling" };
+
+	t_visible.clear();
+	auto padded_count = static_cast<uint32_t>(m_radius.size());
+	auto chunk_count = std::min(
+		(padded_count + MIN_CULL_CHUNK_SIZE - 1) / MIN_CULL_CHUNK_SIZE,
+		std::max(std::thread::hardware_concurrency(), 1u));
+
+	if (chunk_count <= 1) {
+		CullRange(t_frustum, 0, padded_count, t_visible);
+		return;
+	}
+
+	if (m_chunk_results.size() < chunk_count) {
+		m_chunk_results.resize(chunk_count);
+	}
+
+	// Rounded up so the chunks cover every object, trailing chunks may be empty
+	auto chunk_size = (padded_count + chunk_count * SIMD_WIDTH - 1) / (chunk_count * SIMD_WIDTH) * SIMD_WIDTH;
+
+	// The calling thread culls chunks too instead of waiting idle
+	if (m_workers == nullptr) {
+		m_workers = std::make_unique<WorkerPool>(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+	}
+	m_workers->Run(chunk_count, [this, &t_frustum, chunk_size, padded_count](uint32_t t_chunk) {
+		auto begin = std::min(t_chunk * chunk_size, padded_count);
+		auto end = std::min(begin + chunk_size, padded_count);
+		CullRange(t_frustum, begin, end, m_chunk_results[t_chunk]);
+	});
+
+	auto total = size_t{ 0 };
+	for (auto chunk = uint32_t{ 0 }; chunk < chunk_count; ++chunk) {
+		total += m_chunk_results[chunk].size();
+	}
+
+	t_visible.reserve(total);
+	for (auto chunk = uint32_t{ 0 }; chunk < chunk_count; ++chunk) {
+		t_visible.insert(t_visible.end(), m_chunk_results[chunk].begin(), m_chunk_results[chunk].end());
+	}
+}
+
+uint32_t FrustumCuller::GetObjectCount() const noexcept
+{
+	return m_object_count;
+}
+
+glm::vec4 FrustumCuller::GetSphere(ObjectIndex t_index) const
+{
+	return glm::vec4{ m_center_x.at(t_index), m_center_y[t_index], m_center_z[t_index], m_radius[t_index] };
+}
+
+SIMD_LEVEL FrustumCuller::GetSimdLevel() const noexcept
+{
+	return m_simd_level;
+}
+
+void FrustumCuller::SetSimdLevel(SIMD_LEVEL t_level) noexcept
+{
+	m_simd_level = std::min(t_level, DetectSimdLevel());
+}
+
+FrustumCuller::Frustum FrustumCuller::ExtractFrustum(glm::mat4 const & t_view_projection)
+{
+	auto Row = [&t_view_projection](int t_row) {
+		return glm::vec4{ t_view_projection[0][t_row], t_view_projection[1][t_row], t_view_projection[2][t_row], t_view_projection[3][t_row] };
+	};
+
+	auto frustum = Frustum{};
+	frustum.planes[0] = Row(3) + Row(0);
+	frustum.planes[1] = Row(3) - Row(0);
+	frustum.planes[2] = Row(3) + Row(1);
+	frustum.planes[3] = Row(3) - Row(1);
+	frustum.planes[4] = Row(2);
+	frustum.planes[5] = Row(3) - Row(2);
+
+	for (auto & plane : frustum.planes) {
+		plane /= std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+	}
+
+	return frustum;
+}
+
+SIMD_LEVEL FrustumCuller::DetectSimdLevel() noexcept
+{
+#ifdef FRUSTUM_CULLER_X86
+	auto ecx = uint32_t{ 0 };
+#	if defined(_MSC_VER)
+	int registers[4]{};
+	__cpuid(registers, 1);
+	ecx = static_cast<uint32_t>(registers[2]);
+#	else
+	unsigned int eax = 0, ebx = 0, edx = 0;
+	__get_cpuid(1, &eax, &ebx, &ecx, &edx);
+#	endif
+
+	// AVX needs the CPU flag and the OS saving the upper register halves (OSXSAVE
+	// and the XMM and YMM bits of XCR0)
+	auto const avx_bit = 1u << 28;
+	auto const osxsave_bit = 1u << 27;
+	if ((ecx & avx_bit) && (ecx & osxsave_bit)) {
+#	if defined(_MSC_VER)
+		auto xcr0 = _xgetbv(0);
+#	else
+		unsigned int xcr0_low = 0, xcr0_high = 0;
+		__asm__("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+		auto xcr0 = (static_cast<uint64_t>(xcr0_high) << 32) | xcr0_low;
+#	endif
+		if ((xcr0 & 0x6) == 0x6) {
+			return SL_AVX;
+		}
+	}
+
+	// SSE2 is part of every x64 CPU
+	return SL_SSE;
+#else
+	return SL_SCALAR;
+#endif
+}
+
+void FrustumCuller::CullRange(Frustum const & t_frustum, uint32_t t_begin, uint32_t t_end, std::vector<ObjectIndex> & t_visible) const
+{
+	t_visible.clear();
+
+	auto x = m_center_x.data();
+	auto y = m_center_y.data();
+	auto z = m_center_z.data();
+	auto radius = m_radius.data();
+
+	switch (m_simd_level)
+	{
+#ifdef FRUSTUM_CULLER_X86
+	case SL_AVX: CullAvx(t_frustum, x, y, z, radius, t_begin, t_end, t_visible); break;
+	case SL_SSE: CullSse(t_frustum, x, y, z, radius, t_begin, t_end, t_visible); break;
+#endif
+	default: CullScalar(t_frustum, x, y, z, radius, t_begin, t_end, t_visible); break;
+	}
+}
@@ -0,0 +1,68 @@
+#ifndef FRUSTUM_CULLER
+#define FRUSTUM_CULLER
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm/vec3.hpp"
+#include "glm/glm/vec4.hpp"
+#include "glm/glm/mat4x4.hpp"
+#include "WorkerPool.h"
+
+enum SIMD_LEVEL
+{
+	SL_SCALAR = 0,
+	SL_SSE,
+	SL_AVX
+};
+
+// Bounding spheres kept as one array per component, so 4 (SSE) or 8 (AVX)
+// consecutive objects load straight into a register each and are tested against
+// all six planes at once. The widest path the CPU supports is picked at runtime.
+// Large sets are split into chunks culled in parallel on a pool started with the
+// first such set, the visible indices come out compacted and in ascending order.
+class FrustumCuller
+{
+public:
+	using ObjectIndex = uint32_t;
+
+	struct Frustum {
+		glm::vec4 planes[6]{};
+	};
+
+	explicit FrustumCuller();
+	FrustumCuller(FrustumCuller const &) = delete;
+	FrustumCuller(FrustumCuller &&) noexcept = default;
+	FrustumCuller & operator = (FrustumCuller const &) = delete;
+	FrustumCuller & operator = (FrustumCuller &&) noexcept = default;
+	~FrustumCuller() noexcept = default;
+
+	[[nodiscard]] ObjectIndex Add(glm::vec3 const &, float);
+	void Update(ObjectIndex, glm::vec3 const &, float);
+	void Clear() noexcept;
+
+	void Cull(glm::mat4 const &, std::vector<ObjectIndex> &);
+	void Cull(Frustum const &, std::vector<ObjectIndex> &);
+
+	[[nodiscard]] uint32_t GetObjectCount() const noexcept;
+	[[nodiscard]] glm::vec4 GetSphere(ObjectIndex) const;
+	[[nodiscard]] SIMD_LEVEL GetSimdLevel() const noexcept;
+	void SetSimdLevel(SIMD_LEVEL) noexcept;
+
+	// Planes point inwards and are normalized, depth is expected in [0, 1]
+	[[nodiscard]] static Frustum ExtractFrustum(glm::mat4 const &);
+	[[nodiscard]] static SIMD_LEVEL DetectSimdLevel() noexcept;
+
+private:
+	void CullRange(Frustum const &, uint32_t, uint32_t, std::vector<ObjectIndex> &) const;
+
+	std::vector<float> m_center_x{};
+	std::vector<float> m_center_y{};
+	std::vector<float> m_center_z{};
+	std::vector<float> m_radius{};
+	std::vector<std::vector<ObjectIndex>> m_chunk_results{};
+	std::unique_ptr<WorkerPool> m_workers{};
+	uint32_t m_object_count{ 0 };
+	SIMD_LEVEL m_simd_level{ SL_SCALAR };
+};
+
+#endif // !FRUSTUM_CULLER
@@ -0,0 +1,163 @@
+#include "PreCompiledHeader.hpp"
+#include "GpuProfiler.h"
+#include "Telemetry.h"
+#include "VulkanUtils.h"
+
+constexpr auto INVALID_SCOPE = std::numeric_limits<GpuProfiler::ScopeHandle>::max();
+
+void GpuProfiler::Create(
+	VkDevice const & t_device,
+	VkPhysicalDevice const & t_physical_device,
+	uint32_t t_queue_family,
+	uint32_t t_slot_count,
+	uint32_t t_max_scopes)
+{
+	auto properties = VkPhysicalDeviceProperties{};
+	vkGetPhysicalDeviceProperties(t_physical_device, &properties);
+
+	uint32_t queue_family_count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(t_physical_device, &queue_family_count, nullptr);
+	auto queue_families = std::vector<VkQueueFamilyProperties>(queue_family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(t_physical_device, &queue_family_count, queue_families.data());
+
+	auto valid_bits = queue_families.at(t_queue_family).timestampValidBits;
+	m_supported = valid_bits != 0 && properties.limits.timestampPeriod > 0.0f;
+
+	if (!m_supported) {
+		return;
+	}
+
+	m_valid_bits_mask = valid_bits >= 64 ? std::numeric_limits<uint64_t>::max() : (uint64_t{ 1 } << valid_bits) - 1;
+	m_timestamp_period = static_cast<double>(properties.limits.timestampPeriod);
+	m_queries_per_slot = t_max_scopes * 2;
+	m_slots.resize(t_slot_count);
+	m_results.resize(static_cast<size_t>(m_queries_per_slot) * 2);
+	m_current_slot = 0;
+
+	auto pool_info = VkQueryPoolCreateInfo{};
+	pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	pool_info.queryCount = m_queries_per_slot * t_slot_count;
+
+	auto result = vkCreateQueryPool(t_device, &pool_info, nullptr, &m_query_pool);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("create timestamp query pool", result);
+	}
+}
+
+void GpuProfiler::Destroy(VkDevice const & t_device) noexcept
+{
+	if (m_query_pool != VK_NULL_HANDLE) {
+		vkDestroyQueryPool(t_device, m_query_pool, nullptr);
+		m_query_pool = VK_NULL_HANDLE;
+	}
+	m_slots.clear();
+	m_supported = false;
+}
+
+void GpuProfiler::BeginFrame(VkDevice const & t_device, VkCommandBuffer t_command_buffer)
+{
+	if (!m_supported) {
+		return;
+	}
+
+	m_current_slot = (m_current_slot + 1) % static_cast<uint32_t>(m_slots.size());
+	auto & slot = m_slots[m_current_slot];
+
+	if (slot.used_queries > 0) {
+		ReadBack(t_device, slot);
+	}
+
+	vkCmdResetQueryPool(t_command_buffer, m_query_pool, m_current_slot * m_queries_per_slot, m_queries_per_slot);
+
+	slot.scopes.clear();
+	slot.used_queries = 0;
+	slot.telemetry_frame = Telemetry::GetFrame();
+}
+
+GpuProfiler::ScopeHandle GpuProfiler::BeginScope(VkCommandBuffer t_command_buffer, std::string const & t_name)
+{
+	if (!m_supported) {
+		return INVALID_SCOPE;
+	}
+
+	auto & slot = m_slots[m_current_slot];
+	if (slot.used_queries + 2 > m_queries_per_slot) {
+		return INVALID_SCOPE;
+	}
+
+	auto scope = Scope{};
+	scope.name = t_name;
+	scope.begin_query = slot.used_queries;
+	slot.used_queries += 2;
+
+	vkCmdWriteTimestamp(t_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_query_pool, m_current_slot * m_queries_per_slot + scope.begin_query);
+
+	slot.scopes.emplace_back(std::move(scope));
+	return static_cast<ScopeHandle>(slot.scopes.size() - 1);
+}
+
+void GpuProfiler::EndScope(VkCommandBuffer t_command_buffer, ScopeHandle t_scope)
+{
+	if (!m_supported || t_scope == INVALID_SCOPE) {
+		return;
+	}
+
+	auto & scope = m_slots[m_current_slot].scopes.at(t_scope);
+	vkCmdWriteTimestamp(t_command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_query_pool, m_current_slot * m_queries_per_slot + scope.begin_query + 1);
+	scope.ended = true;
+}
+
+bool GpuProfiler::IsSupported() const noexcept
+{
+	return m_supported;
+}
+
+double GpuProfiler::GetLastFrameMilliseconds() const noexcept
+{
+	return m_last_frame_milliseconds;
+}
+
+void GpuProfiler::ReadBack(VkDevice const & t_device, FrameSlot & t_slot)
+{
+	// Every query is followed by its availability word, nothing here waits on the GPU
+	auto stride = VkDeviceSize{ sizeof(uint64_t) * 2 };
+	auto result = vkGetQueryPoolResults(
+		t_device,
+		m_query_pool,
+		m_current_slot * m_queries_per_slot,
+		t_slot.used_queries,
+		static_cast<size_t>(stride) * t_slot.used_queries,
+		m_results.data(),
+		stride,
+		VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+	if (result != VK_SUCCESS && result != VK_NOT_READY) {
+		vulkan_utils::ThrowError("read back timestamp queries", result);
+	}
+
+	auto frame_begin = std::numeric_limits<uint64_t>::max();
+	auto frame_end = uint64_t{ 0 };
+
+	for (auto const & scope : t_slot.scopes) {
+		auto begin_index = static_cast<size_t>(scope.begin_query) * 2;
+		auto end_index = begin_index + 2;
+
+		if (!scope.ended || m_results[begin_index + 1] == 0 || m_results[end_index + 1] == 0) {
+			continue;
+		}
+
+		auto begin = m_results[begin_index] & m_valid_bits_mask;
+		auto end = m_results[end_index] & m_valid_bits_mask;
+		auto ticks = (end - begin) & m_valid_bits_mask;
+
+		Telemetry::Record(TS_GPU, scope.name, static_cast<double>(ticks) * m_timestamp_period / 1e6, t_slot.telemetry_frame);
+
+		frame_begin = std::min(frame_begin, begin);
+		frame_end = std::max(frame_end, end);
+	}
+
+	if (frame_end > frame_begin) {
+		m_last_frame_milliseconds = static_cast<double>(frame_end - frame_begin) * m_timestamp_period / 1e6;
+	}
+}
@@ -0,0 +1,57 @@
+#ifndef GPU_PROFILER
+#define GPU_PROFILER
+
+#include "vulkan/vulkan.h"
+
+// Timestamp queries around named scopes. Every frame uses its own slice of the
+// query pool and a slice is only read back, without waiting, when it comes round
+// again, by which time the GPU has long finished with it.
+class GpuProfiler
+{
+public:
+	using ScopeHandle = uint32_t;
+
+	explicit GpuProfiler() = default;
+	GpuProfiler(GpuProfiler const &) = delete;
+	GpuProfiler(GpuProfiler &&) noexcept = default;
+	GpuProfiler & operator = (GpuProfiler const &) = delete;
+	GpuProfiler & operator = (GpuProfiler &&) noexcept = default;
+	~GpuProfiler() noexcept = default;
+
+	void Create(VkDevice const &, VkPhysicalDevice const &, uint32_t, uint32_t, uint32_t);
+	void Destroy(VkDevice const &) noexcept;
+
+	void BeginFrame(VkDevice const &, VkCommandBuffer);
+	[[nodiscard]] ScopeHandle BeginScope(VkCommandBuffer, std::string const &);
+	void EndScope(VkCommandBuffer, ScopeHandle);
+
+	[[nodiscard]] bool IsSupported() const noexcept;
+	[[nodiscard]] double GetLastFrameMilliseconds() const noexcept;
+
+private:
+	struct Scope {
+		std::string name{};
+		uint32_t begin_query{ 0 };
+		bool ended{ false };
+	};
+
+	struct FrameSlot {
+		std::vector<Scope> scopes{};
+		uint32_t used_queries{ 0 };
+		uint64_t telemetry_frame{ 0 };
+	};
+
+	void ReadBack(VkDevice const &, FrameSlot &);
+
+	VkQueryPool m_query_pool{ VK_NULL_HANDLE };
+	std::vector<FrameSlot> m_slots{};
+	std::vector<uint64_t> m_results{};
+	uint32_t m_current_slot{ 0 };
+	uint32_t m_queries_per_slot{ 0 };
+	uint64_t m_valid_bits_mask{ 0 };
+	double m_timestamp_period{ 0.0 };
+	double m_last_frame_milliseconds{ 0.0 };
+	bool m_supported{ false };
+};
+
+#endif // !GPU_PROFILER
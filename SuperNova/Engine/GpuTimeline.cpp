@@ -0,0 +1,223 @@
+#include "PreCompiledHeader.hpp"
+#include "GpuTimeline.h"
+#include "VulkanUtils.h"
+
+void GpuTimeline::Create(VkDevice const & t_device, DeviceCapabilities const & t_capabilities)
+{
+	m_queues.assign(GQ_COUNT, Queue{});
+	m_timeline_semaphores = t_capabilities.GetPaths().sync == SP_TIMELINE_SEMAPHORES;
+
+	if (m_timeline_semaphores) {
+		auto core = t_capabilities.GetFeatures().api_version >= VK_API_VERSION_1_2;
+		m_wait_semaphores = reinterpret_cast<PFN_vkWaitSemaphores>(
+			vkGetDeviceProcAddr(t_device, core ? "vkWaitSemaphores" : "vkWaitSemaphoresKHR"));
+		m_get_counter_value = reinterpret_cast<PFN_vkGetSemaphoreCounterValue>(
+			vkGetDeviceProcAddr(t_device, core ? "vkGetSemaphoreCounterValue" : "vkGetSemaphoreCounterValueKHR"));
+		m_timeline_semaphores = m_wait_semaphores != nullptr && m_get_counter_value != nullptr;
+	}
+
+	if (!m_timeline_semaphores) {
+		return;
+	}
+
+	auto type_info = VkSemaphoreTypeCreateInfo{};
+	type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	type_info.initialValue = 0;
+
+	auto semaphore_info = VkSemaphoreCreateInfo{};
+	semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphore_info.pNext = &type_info;
+
+	for (auto & queue : m_queues) {
+		auto result = vkCreateSemaphore(t_device, &semaphore_info, nullptr, &queue.semaphore);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("create timeline semaphore", result);
+		}
+	}
+}
+
+void GpuTimeline::Destroy(VkDevice const & t_device) noexcept
+{
+	for (auto & retirement : m_retirements) {
+		retirement.release(t_device);
+	}
+	m_retirements.clear();
+
+	for (auto & queue : m_queues) {
+		vkDestroySemaphore(t_device, queue.semaphore, nullptr);
+		for (auto const & pending : queue.pending_fences) {
+			vkDestroyFence(t_device, pending.fence, nullptr);
+		}
+	}
+	m_queues.clear();
+
+	for (auto fence : m_free_fences) {
+		vkDestroyFence(t_device, fence, nullptr);
+	}
+	m_free_fences.clear();
+}
+
+GpuTimeline::Point GpuTimeline::Submit(VkDevice const & t_device, GPU_QUEUE t_queue, VkQueue t_vulkan_queue, VkSubmitInfo const & t_submit_info)
+{
+	auto & queue = m_queues.at(t_queue);
+	auto point = Point{ t_queue, queue.next_value };
+	auto submit_info = t_submit_info;
+
+	if (m_timeline_semaphores) {
+		// Values line up with the semaphore arrays, binary semaphores ignore theirs
+		m_signal_semaphores.assign(t_submit_info.pSignalSemaphores, t_submit_info.pSignalSemaphores + t_submit_info.signalSemaphoreCount);
+		m_signal_semaphores.emplace_back(queue.semaphore);
+		m_signal_values.assign(t_submit_info.signalSemaphoreCount, 0);
+		m_signal_values.emplace_back(point.value);
+		m_wait_values.assign(t_submit_info.waitSemaphoreCount, 0);
+
+		auto timeline_info = VkTimelineSemaphoreSubmitInfo{};
+		timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timeline_info.pNext = t_submit_info.pNext;
+		timeline_info.waitSemaphoreValueCount = static_cast<uint32_t>(m_wait_values.size());
+		timeline_info.pWaitSemaphoreValues = m_wait_values.data();
+		timeline_info.signalSemaphoreValueCount = static_cast<uint32_t>(m_signal_values.size());
+		timeline_info.pSignalSemaphoreValues = m_signal_values.data();
+
+		submit_info.pNext = &timeline_info;
+		submit_info.signalSemaphoreCount = static_cast<uint32_t>(m_signal_semaphores.size());
+		submit_info.pSignalSemaphores = m_signal_semaphores.data();
+
+		auto result = vkQueueSubmit(t_vulkan_queue, 1, &submit_info, VK_NULL_HANDLE);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("submit to the GPU timeline", result);
+		}
+	}
+	else {
+		auto fence = AcquireFence(t_device);
+		auto result = vkQueueSubmit(t_vulkan_queue, 1, &submit_info, fence);
+		if (result != VK_SUCCESS) {
+			m_free_fences.emplace_back(fence);
+			vulkan_utils::ThrowError("submit to the GPU timeline", result);
+		}
+		queue.pending_fences.emplace_back(PendingFence{ point.value, fence });
+	}
+
+	++queue.next_value;
+	return point;
+}
+
+GpuTimeline::Point GpuTimeline::GetNextPoint(GPU_QUEUE t_queue) const noexcept
+{
+	return Point{ t_queue, m_queues[t_queue].next_value };
+}
+
+bool GpuTimeline::HasReached(VkDevice const & t_device, Point const & t_point)
+{
+	auto & queue = m_queues.at(t_point.queue);
+	if (t_point.value <= queue.completed_value) {
+		return true;
+	}
+	return t_point.value <= UpdateCompleted(t_device, queue);
+}
+
+void GpuTimeline::Wait(VkDevice const & t_device, Point const & t_point)
+{
+	auto & queue = m_queues.at(t_point.queue);
+	if (t_point.value <= queue.completed_value) {
+		return;
+	}
+	if (t_point.value >= queue.next_value) {
+		throw std::runtime_error("GPU timeline - Waiting on a value that has not been submitted");
+	}
+
+	if (m_timeline_semaphores) {
+		auto wait_info = VkSemaphoreWaitInfo{};
+		wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		wait_info.semaphoreCount = 1;
+		wait_info.pSemaphores = &queue.semaphore;
+		wait_info.pValues = &t_point.value;
+
+		auto result = m_wait_semaphores(t_device, &wait_info, UINT64_MAX);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("wait on the GPU timeline", result);
+		}
+		queue.completed_value = std::max(queue.completed_value, t_point.value);
+		return;
+	}
+
+	// Fences are in submission order, the first at or past the value covers it
+	auto pending = std::find_if(queue.pending_fences.begin(), queue.pending_fences.end(),
+		[&t_point](PendingFence const & t_pending) { return t_pending.value >= t_point.value; });
+
+	auto result = vkWaitForFences(t_device, 1, &pending->fence, VK_TRUE, UINT64_MAX);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("wait on the GPU timeline", result);
+	}
+	(void)UpdateCompleted(t_device, queue);
+}
+
+void GpuTimeline::Retire(Point const & t_point, Release t_release)
+{
+	m_retirements.emplace_back(Retirement{ t_point, std::move(t_release) });
+}
+
+void GpuTimeline::CollectRetired(VkDevice const & t_device)
+{
+	auto retired = std::stable_partition(m_retirements.begin(), m_retirements.end(),
+		[this, &t_device](Retirement const & t_retirement) { return !HasReached(t_device, t_retirement.point); });
+
+	for (auto retirement = retired; retirement != m_retirements.end(); ++retirement) {
+		retirement->release(t_device);
+	}
+	m_retirements.erase(retired, m_retirements.end());
+}
+
+bool GpuTimeline::UsesTimelineSemaphores() const noexcept
+{
+	return m_timeline_semaphores;
+}
+
+uint64_t GpuTimeline::UpdateCompleted(VkDevice const & t_device, Queue & t_queue)
+{
+	if (m_timeline_semaphores) {
+		auto value = uint64_t{ 0 };
+		auto result = m_get_counter_value(t_device, t_queue.semaphore, &value);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("read the GPU timeline", result);
+		}
+		t_queue.completed_value = std::max(t_queue.completed_value, value);
+		return t_queue.completed_value;
+	}
+
+	auto signalled = t_queue.pending_fences.begin();
+	while (signalled != t_queue.pending_fences.end() && vkGetFenceStatus(t_device, signalled->fence) == VK_SUCCESS) {
+		t_queue.completed_value = signalled->value;
+		m_free_fences.emplace_back(signalled->fence);
+		++signalled;
+	}
+	t_queue.pending_fences.erase(t_queue.pending_fences.begin(), signalled);
+
+	return t_queue.completed_value;
+}
+
+VkFence GpuTimeline::AcquireFence(VkDevice const & t_device)
+{
+	auto fence = VkFence{ VK_NULL_HANDLE };
+
+	if (!m_free_fences.empty()) {
+		fence = m_free_fences.back();
+		m_free_fences.pop_back();
+
+		auto result = vkResetFences(t_device, 1, &fence);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("reset timeline fence", result);
+		}
+		return fence;
+	}
+
+	auto fence_info = VkFenceCreateInfo{};
+	fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	auto result = vkCreateFence(t_device, &fence_info, nullptr, &fence);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("create timeline fence", result);
+	}
+	return fence;
+}
@@ -0,0 +1,91 @@
+#ifndef GPU_TIMELINE
+#define GPU_TIMELINE
+
+#include "vulkan/vulkan.h"
+#include "DeviceCapabilities.h"
+
+enum GPU_QUEUE
+{
+	GQ_GRAPHICS = 0,
+	GQ_COMPUTE,
+	GQ_TRANSFER,
+	GQ_COUNT
+};
+
+// CPU/GPU synchronisation as one increasing value per queue. Every submission
+// signals its queue's next value, and waiting on work or checking whether a
+// resource can be reused is asking whether the GPU has reached a point. With
+// timeline semaphores that is a counter read, otherwise each submission gets a
+// recycled fence and the completed value advances as fences signal in order.
+//
+// Binary semaphores still order work between queues and with the swap chain,
+// they pass through Submit untouched.
+class GpuTimeline
+{
+public:
+	struct Point {
+		GPU_QUEUE queue{ GQ_GRAPHICS };
+		uint64_t value{ 0 };
+	};
+
+	using Release = std::function<void(VkDevice const &)>;
+
+	explicit GpuTimeline() = default;
+	GpuTimeline(GpuTimeline const &) = delete;
+	GpuTimeline(GpuTimeline &&) noexcept = default;
+	GpuTimeline & operator = (GpuTimeline const &) = delete;
+	GpuTimeline & operator = (GpuTimeline &&) noexcept = default;
+	~GpuTimeline() noexcept = default;
+
+	void Create(VkDevice const &, DeviceCapabilities const &);
+	// Runs every pending release, the device must be idle
+	void Destroy(VkDevice const &) noexcept;
+
+	// The submit info must not signal a fence of its own
+	Point Submit(VkDevice const &, GPU_QUEUE, VkQueue, VkSubmitInfo const &);
+	// The point the next submission to the queue will signal
+	[[nodiscard]] Point GetNextPoint(GPU_QUEUE) const noexcept;
+
+	[[nodiscard]] bool HasReached(VkDevice const &, Point const &);
+	void Wait(VkDevice const &, Point const &);
+
+	// Deferred destruction, the release runs from CollectRetired once the GPU is
+	// past the point
+	void Retire(Point const &, Release);
+	void CollectRetired(VkDevice const &);
+
+	[[nodiscard]] bool UsesTimelineSemaphores() const noexcept;
+
+private:
+	struct PendingFence {
+		uint64_t value{ 0 };
+		VkFence fence{ VK_NULL_HANDLE };
+	};
+
+	struct Queue {
+		VkSemaphore semaphore{ VK_NULL_HANDLE };
+		uint64_t next_value{ 1 };
+		uint64_t completed_value{ 0 };
+		std::vector<PendingFence> pending_fences{};
+	};
+
+	struct Retirement {
+		Point point{};
+		Release release{};
+	};
+
+	[[nodiscard]] uint64_t UpdateCompleted(VkDevice const &, Queue &);
+	[[nodiscard]] VkFence AcquireFence(VkDevice const &);
+
+	std::vector<Queue> m_queues{};
+	std::vector<VkFence> m_free_fences{};
+	std::vector<Retirement> m_retirements{};
+	std::vector<VkSemaphore> m_signal_semaphores{};
+	std::vector<uint64_t> m_signal_values{};
+	std::vector<uint64_t> m_wait_values{};
+	PFN_vkWaitSemaphores m_wait_semaphores{ nullptr };
+	PFN_vkGetSemaphoreCounterValue m_get_counter_value{ nullptr };
+	bool m_timeline_semaphores{ false };
+};
+
+#endif // !GPU_TIMELINE
@@ -0,0 +1,247 @@
+#include "PreCompiledHeader.hpp"
+#include "LightClusterer.h"
+#include "Telemetry.h"
+
+// Fewest lights worth handing to another thread
+constexpr uint32_t MIN_LIGHTS_PER_CHUNK = 64;
+
+void LightClusterer::SetDimensions(glm::uvec3 const & t_dimensions)
+{
+	if (t_dimensions.x == 0 || t_dimensions.y == 0 || t_dimensions.z == 0) {
+		throw std::runtime_error("Light clusterer - Every dimension needs at least one cluster");
+	}
+	m_dimensions = t_dimensions;
+}
+
+LightClusterer::LightIndex LightClusterer::Add(PointLight const & t_light)
+{
+	m_lights.emplace_back(t_light);
+	return static_cast<LightIndex>(m_lights.size() - 1);
+}
+
+void LightClusterer::Update(LightIndex t_index, PointLight const & t_light)
+{
+	m_lights.at(t_index) = t_light;
+}
+
+void LightClusterer::Clear() noexcept
+{
+	m_lights.clear();
+}
+
+void LightClusterer::Build(
+	glm::mat4 const & t_view,
+	glm::mat4 const & t_projection,
+	float t_near,
+	float t_far,
+	glm::vec2 const & t_viewport)
+{
+	auto timer = ScopedCpuTimer{ "Light Clustering" };
+
+	auto cluster_total = m_dimensions.x * m_dimensions.y * m_dimensions.z;
+	m_clusters.assign(cluster_total, LightCluster{});
+	m_light_indices.clear();
+
+	// Tile edges are evenly spaced in NDC, which is linear in the view space slope
+	m_slopes_x.resize(m_dimensions.x + 1);
+	for (auto x = uint32_t{ 0 }; x <= m_dimensions.x; ++x) {
+		m_slopes_x[x] = (-1.0f + 2.0f * static_cast<float>(x) / static_cast<float>(m_dimensions.x)) / t_projection[0][0];
+	}
+	m_slopes_y.resize(m_dimensions.y + 1);
+	for (auto y = uint32_t{ 0 }; y <= m_dimensions.y; ++y) {
+		m_slopes_y[y] = (-1.0f + 2.0f * static_cast<float>(y) / static_cast<float>(m_dimensions.y)) / t_projection[1][1];
+	}
+
+	// Exponential slices keep clusters roughly cubic at every depth
+	auto depth_ratio = std::log(t_far / t_near);
+	m_slice_depths.resize(m_dimensions.z + 1);
+	for (auto z = uint32_t{ 0 }; z <= m_dimensions.z; ++z) {
+		m_slice_depths[z] = t_near * std::exp(depth_ratio * static_cast<float>(z) / static_cast<float>(m_dimensions.z));
+	}
+
+	m_scale = glm::vec4{
+		t_viewport.x / static_cast<float>(m_dimensions.x),
+		t_viewport.y / static_cast<float>(m_dimensions.y),
+		static_cast<float>(m_dimensions.z) / depth_ratio,
+		-static_cast<float>(m_dimensions.z) * std::log(t_near) / depth_ratio };
+
+	ComputeLightBounds(t_view, t_projection, t_near, t_far);
+
+	auto light_count = static_cast<uint32_t>(m_lights.size());
+	auto chunk_count = std::min({
+		(light_count + MIN_LIGHTS_PER_CHUNK - 1) / MIN_LIGHTS_PER_CHUNK,
+		std::max(std::thread::hardware_concurrency(), 1u),
+		m_dimensions.z });
+	chunk_count = std::max(chunk_count, 1u);
+
+	if (m_chunk_results.size() < chunk_count) {
+		m_chunk_results.resize(chunk_count);
+	}
+
+	auto slices_per_chunk = (m_dimensions.z + chunk_count - 1) / chunk_count;
+
+	// The calling thread bins chunks too instead of waiting idle
+	if (m_workers == nullptr) {
+		m_workers = std::make_unique<WorkerPool>(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+	}
+	m_workers->Run(chunk_count, [this, slices_per_chunk](uint32_t t_chunk) {
+		auto begin = std::min(t_chunk * slices_per_chunk, m_dimensions.z);
+		auto end = std::min(begin + slices_per_chunk, m_dimensions.z);
+		BinSlices(begin, end, m_chunk_results[t_chunk]);
+	});
+
+	// Chunks wrote offsets into their own index lists, rebase them onto the shared one
+	auto clusters_per_slice = m_dimensions.x * m_dimensions.y;
+	for (auto chunk = uint32_t{ 0 }; chunk < chunk_count; ++chunk) {
+		auto base = static_cast<uint32_t>(m_light_indices.size());
+		auto begin = std::min(chunk * slices_per_chunk, m_dimensions.z) * clusters_per_slice;
+		auto end = std::min(chunk * slices_per_chunk + slices_per_chunk, m_dimensions.z) * clusters_per_slice;
+
+		for (auto cluster = begin; cluster < end; ++cluster) {
+			m_clusters[cluster].offset += base;
+		}
+		m_light_indices.insert(m_light_indices.end(), m_chunk_results[chunk].indices.begin(), m_chunk_results[chunk].indices.end());
+	}
+
+	Telemetry::Record(TS_COUNTER, "Light Cluster Indices", static_cast<double>(m_light_indices.size()));
+}
+
+std::vector<PointLight> const & LightClusterer::GetLights() const noexcept
+{
+	return m_lights;
+}
+
+std::vector<LightCluster> const & LightClusterer::GetClusters() const noexcept
+{
+	return m_clusters;
+}
+
+std::vector<uint32_t> const & LightClusterer::GetLightIndices() const noexcept
+{
+	return m_light_indices;
+}
+
+glm::uvec4 LightClusterer::GetClusterCount() const noexcept
+{
+	return glm::uvec4{ m_dimensions, static_cast<uint32_t>(m_lights.size()) };
+}
+
+glm::vec4 LightClusterer::GetClusterScale() const noexcept
+{
+	return m_scale;
+}
+
+void LightClusterer::ComputeLightBounds(glm::mat4 const & t_view, glm::mat4 const & t_projection, float t_near, float t_far)
+{
+	m_light_bounds.resize(m_lights.size());
+
+	auto to_tile = [](float t_ndc, uint32_t t_count) {
+		auto tile = std::floor((t_ndc + 1.0f) * 0.5f * static_cast<float>(t_count));
+		return static_cast<uint32_t>(std::clamp(tile, 0.0f, static_cast<float>(t_count - 1)));
+	};
+
+	auto to_slice = [this](float t_depth) {
+		auto slice = std::floor(std::log(t_depth) * m_scale.z + m_scale.w);
+		return static_cast<uint32_t>(std::clamp(slice, 0.0f, static_cast<float>(m_dimensions.z - 1)));
+	};
+
+	for (auto i = size_t{ 0 }; i < m_lights.size(); ++i) {
+		auto & bounds = m_light_bounds[i];
+		auto view_position = t_view * glm::vec4{ glm::vec3{ m_lights[i].position_radius }, 1.0f };
+
+		bounds.center = glm::vec3{ view_position.x, view_position.y, -view_position.z };
+		bounds.radius = m_lights[i].position_radius.w;
+		bounds.visible = bounds.radius > 0.0f &&
+			bounds.center.z + bounds.radius > t_near &&
+			bounds.center.z - bounds.radius < t_far;
+
+		if (!bounds.visible) {
+			continue;
+		}
+
+		auto nearest = std::max(bounds.center.z - bounds.radius, t_near);
+		auto farthest = std::min(bounds.center.z + bounds.radius, t_far);
+
+		// x / depth over the sphere's box peaks at one of its corners, so the four
+		// corner slopes bound the tiles it covers
+		auto tile_range = [&](float t_center, float t_scale, uint32_t t_count, uint32_t & t_min, uint32_t & t_max) {
+			auto low = t_center - bounds.radius;
+			auto high = t_center + bounds.radius;
+			auto a = low / nearest * t_scale;
+			auto b = low / farthest * t_scale;
+			auto c = high / nearest * t_scale;
+			auto d = high / farthest * t_scale;
+			t_min = to_tile(std::min({ a, b, c, d }), t_count);
+			t_max = to_tile(std::max({ a, b, c, d }), t_count);
+		};
+
+		tile_range(bounds.center.x, t_projection[0][0], m_dimensions.x, bounds.min.x, bounds.max.x);
+		tile_range(bounds.center.y, t_projection[1][1], m_dimensions.y, bounds.min.y, bounds.max.y);
+		bounds.min.z = to_slice(nearest);
+		bounds.max.z = to_slice(farthest);
+	}
+}
+
+void LightClusterer::BinSlices(uint32_t t_begin, uint32_t t_end, ChunkResult & t_result)
+{
+	t_result.pairs.clear();
+	t_result.indices.clear();
+
+	auto clusters_per_slice = m_dimensions.x * m_dimensions.y;
+	auto first_cluster = t_begin * clusters_per_slice;
+
+	for (auto light = uint32_t{ 0 }; light < m_light_bounds.size(); ++light) {
+		auto const & bounds = m_light_bounds[light];
+		if (!bounds.visible || bounds.max.z < t_begin || bounds.min.z >= t_end) {
+			continue;
+		}
+
+		for (auto z = std::max(bounds.min.z, t_begin); z <= std::min(bounds.max.z, t_end - 1); ++z) {
+			for (auto y = bounds.min.y; y <= bounds.max.y; ++y) {
+				for (auto x = bounds.min.x; x <= bounds.max.x; ++x) {
+					if (Intersects(bounds, x, y, z)) {
+						t_result.pairs.emplace_back(ClusterLight{ (z * m_dimensions.y + y) * m_dimensions.x + x - first_cluster, light });
+					}
+				}
+			}
+		}
+	}
+
+	// Counting sort into per cluster lists, lights stay in ascending order
+	auto clusters = m_clusters.data() + first_cluster;
+	for (auto const & pair : t_result.pairs) {
+		++clusters[pair.cluster].count;
+	}
+
+	auto offset = uint32_t{ 0 };
+	for (auto cluster = uint32_t{ 0 }; cluster < (t_end - t_begin) * clusters_per_slice; ++cluster) {
+		clusters[cluster].offset = offset;
+		offset += clusters[cluster].count;
+		clusters[cluster].count = 0;
+	}
+
+	t_result.indices.resize(t_result.pairs.size());
+	for (auto const & pair : t_result.pairs) {
+		auto & cluster = clusters[pair.cluster];
+		t_result.indices[cluster.offset + cluster.count++] = pair.light;
+	}
+}
+
+bool LightClusterer::Intersects(LightBounds const & t_bounds, uint32_t t_x, uint32_t t_y, uint32_t t_z) const noexcept
+{
+	auto near_depth = m_slice_depths[t_z];
+	auto far_depth = m_slice_depths[t_z + 1];
+
+	// The cluster's view space box, depth positive
+	auto axis_distance = [&](float t_center, float t_slope_a, float t_slope_b) {
+		auto low = std::min({ t_slope_a * near_depth, t_slope_a * far_depth, t_slope_b * near_depth, t_slope_b * far_depth });
+		auto high = std::max({ t_slope_a * near_depth, t_slope_a * far_depth, t_slope_b * near_depth, t_slope_b * far_depth });
+		return std::max({ low - t_center, 0.0f, t_center - high });
+	};
+
+	auto dx = axis_distance(t_bounds.center.x, m_slopes_x[t_x], m_slopes_x[t_x + 1]);
+	auto dy = axis_distance(t_bounds.center.y, m_slopes_y[t_y], m_slopes_y[t_y + 1]);
+	auto dz = std::max({ near_depth - t_bounds.center.z, 0.0f, t_bounds.center.z - far_depth });
+
+	return dx * dx + dy * dy + dz * dz <= t_bounds.radius * t_bounds.radius;
+}
@@ -0,0 +1,80 @@
+#ifndef LIGHT_CLUSTERER
+#define LIGHT_CLUSTERER
+
+#include "ShaderInterface.h"
+#include "WorkerPool.h"
+#include "glm/glm/vec2.hpp"
+#include "glm/glm/vec3.hpp"
+
+// Clustered forward light assignment. The view frustum is cut into a grid of
+// screen tiles by exponential depth slices and every light is binned into the
+// clusters its sphere touches. Fragments look up their cluster and loop only over
+// its compact light list, so shading cost follows the lights nearby rather than
+// the total. Slices are binned in parallel on a pool started with the first
+// build, each worker owns whole slices so no list is shared.
+class LightClusterer
+{
+public:
+	using LightIndex = uint32_t;
+
+	explicit LightClusterer() = default;
+	LightClusterer(LightClusterer const &) = delete;
+	LightClusterer(LightClusterer &&) noexcept = default;
+	LightClusterer & operator = (LightClusterer const &) = delete;
+	LightClusterer & operator = (LightClusterer &&) noexcept = default;
+	~LightClusterer() noexcept = default;
+
+	void SetDimensions(glm::uvec3 const &);
+
+	[[nodiscard]] LightIndex Add(PointLight const &);
+	void Update(LightIndex, PointLight const &);
+	void Clear() noexcept;
+
+	// The projection must be a symmetric perspective one, the viewport is in pixels
+	void Build(glm::mat4 const &, glm::mat4 const &, float, float, glm::vec2 const &);
+
+	[[nodiscard]] std::vector<PointLight> const & GetLights() const noexcept;
+	[[nodiscard]] std::vector<LightCluster> const & GetClusters() const noexcept;
+	[[nodiscard]] std::vector<uint32_t> const & GetLightIndices() const noexcept;
+	[[nodiscard]] glm::uvec4 GetClusterCount() const noexcept;
+	[[nodiscard]] glm::vec4 GetClusterScale() const noexcept;
+
+private:
+	// Inclusive cluster ranges a light's sphere may reach, depth is positive
+	struct LightBounds {
+		glm::vec3 center{ 0.0f };
+		float radius{ 0.0f };
+		glm::uvec3 min{ 0 };
+		glm::uvec3 max{ 0 };
+		bool visible{ false };
+	};
+
+	struct ClusterLight {
+		uint32_t cluster{ 0 };
+		uint32_t light{ 0 };
+	};
+
+	struct ChunkResult {
+		std::vector<ClusterLight> pairs{};
+		std::vector<uint32_t> indices{};
+	};
+
+	void ComputeLightBounds(glm::mat4 const &, glm::mat4 const &, float, float);
+	void BinSlices(uint32_t, uint32_t, ChunkResult &);
+	[[nodiscard]] bool Intersects(LightBounds const &, uint32_t, uint32_t, uint32_t) const noexcept;
+
+	std::vector<PointLight> m_lights{};
+	std::vector<LightBounds> m_light_bounds{};
+	std::vector<LightCluster> m_clusters{};
+	std::vector<uint32_t> m_light_indices{};
+	std::vector<ChunkResult> m_chunk_results{};
+	std::unique_ptr<WorkerPool> m_workers{};
+	// Cluster boundaries, x and y as view space slopes, z as view depths
+	std::vector<float> m_slopes_x{};
+	std::vector<float> m_slopes_y{};
+	std::vector<float> m_slice_depths{};
+	glm::uvec3 m_dimensions{ 16, 9, 24 };
+	glm::vec4 m_scale{ 0.0f };
+};
+
+#endif // !LIGHT_CLUSTERER
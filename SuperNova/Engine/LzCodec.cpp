@@ -0,0 +1,162 @@
+#include "PreCompiledHeader.hpp"
+#include "LzCodec.h"
+
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_OFFSET = 0xFFFF;
+constexpr uint32_t HASH_BITS = 16;
+constexpr uint32_t NO_POSITION = std::numeric_limits<uint32_t>::max();
+constexpr uint32_t NIBBLE_MAX = 15;
+
+namespace
+{
+	uint32_t Read32(uint8_t const * t_data)
+	{
+		auto value = uint32_t{ 0 };
+		std::memcpy(&value, t_data, sizeof(value));
+		return value;
+	}
+
+	uint32_t Hash(uint32_t t_sequence)
+	{
+		return (t_sequence * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	void WriteLength(std::vector<uint8_t> & t_output, size_t t_length)
+	{
+		for (; t_length >= 255; t_length -= 255) {
+			t_output.emplace_back(uint8_t{ 255 });
+		}
+		t_output.emplace_back(static_cast<uint8_t>(t_length));
+	}
+
+	size_t ReadLength(uint8_t const *& t_input, uint8_t const * t_end)
+	{
+		auto length = size_t{ 0 };
+		auto byte = uint8_t{ 255 };
+		while (byte == 255) {
+			if (t_input == t_end) {
+				throw std::runtime_error("Lz codec - Truncated length");
+			}
+			byte = *t_input++;
+			length += byte;
+		}
+		return length;
+	}
+
+	void WriteSequence(std::vector<uint8_t> & t_output, uint8_t const * t_literals, size_t t_literal_count, size_t t_offset, size_t t_match_length)
+	{
+		auto literal_nibble = static_cast<uint32_t>(std::min<size_t>(t_literal_count, NIBBLE_MAX));
+		auto match_nibble = t_match_length == 0 ? 0 : static_cast<uint32_t>(std::min<size_t>(t_match_length - MIN_MATCH, NIBBLE_MAX));
+		t_output.emplace_back(static_cast<uint8_t>(literal_nibble << 4 | match_nibble));
+		if (literal_nibble == NIBBLE_MAX) {
+			WriteLength(t_output, t_literal_count - NIBBLE_MAX);
+		}
+		t_output.insert(t_output.end(), t_literals, t_literals + t_literal_count);
+
+		if (t_match_length == 0) {
+			return;
+		}
+		t_output.emplace_back(static_cast<uint8_t>(t_offset));
+		t_output.emplace_back(static_cast<uint8_t>(t_offset >> 8));
+		if (match_nibble == NIBBLE_MAX) {
+			WriteLength(t_output, t_match_length - MIN_MATCH - NIBBLE_MAX);
+		}
+	}
+}
+
+std::vector<uint8_t> LzCodec::Compress(uint8_t const * t_data, size_t t_size)
+{
+	auto output = std::vector<uint8_t>{};
+	output.reserve(t_size / 2 + 16);
+
+	auto table = std::vector<uint32_t>(size_t{ 1 } << HASH_BITS, NO_POSITION);
+	auto anchor = size_t{ 0 };
+	auto position = size_t{ 0 };
+
+	while (position + MIN_MATCH <= t_size) {
+		auto sequence = Read32(t_data + position);
+		auto & slot = table[Hash(sequence)];
+		auto candidate = slot;
+		slot = static_cast<uint32_t>(position);
+
+		if (candidate == NO_POSITION || position - candidate > MAX_OFFSET || Read32(t_data + candidate) != sequence) {
+			++position;
+			continue;
+		}
+
+		auto length = MIN_MATCH;
+		while (position + length < t_size && t_data[candidate + length] == t_data[position + length]) {
+			++length;
+		}
+
+		WriteSequence(output, t_data + anchor, position - anchor, position - candidate, length);
+
+		// Positions inside the match are hashed too, later matches can start there
+		for (auto inside = position + 1; inside < position + length && inside + MIN_MATCH <= t_size; ++inside) {
+			table[Hash(Read32(t_data + inside))] = static_cast<uint32_t>(inside);
+		}
+		position += length;
+		anchor = position;
+	}
+
+	WriteSequence(output, t_data + anchor, t_size - anchor, 0, 0);
+	return output;
+}
+
+void LzCodec::Decompress(uint8_t const * t_input, size_t t_input_size, uint8_t * t_output, size_t t_output_size)
+{
+	auto input_end = t_input + t_input_size;
+	auto output = t_output;
+	auto output_end = t_output + t_output_size;
+
+	while (true) {
+		if (t_input == input_end) {
+			throw std::runtime_error("Lz codec - Truncated stream");
+		}
+		auto token = *t_input++;
+
+		auto literal_count = static_cast<size_t>(token >> 4u);
+		if (literal_count == NIBBLE_MAX) {
+			literal_count += ReadLength(t_input, input_end);
+		}
+		if (literal_count > static_cast<size_t>(input_end - t_input) || literal_count > static_cast<size_t>(output_end - output)) {
+			throw std::runtime_error("Lz codec - Literals run past the end");
+		}
+		std::copy_n(t_input, literal_count, output);
+		t_input += literal_count;
+		output += literal_count;
+
+		if (t_input == input_end) {
+			break;
+		}
+
+		if (input_end - t_input < 2) {
+			throw std::runtime_error("Lz codec - Truncated offset");
+		}
+		auto offset = size_t{ t_input[0] } | size_t{ t_input[1] } << 8;
+		t_input += 2;
+		auto length = size_t{ token & 0xFu } + MIN_MATCH;
+		if ((token & 0xFu) == NIBBLE_MAX) {
+			length += ReadLength(t_input, input_end);
+		}
+		if (offset == 0 || offset > static_cast<size_t>(output - t_output) || length > static_cast<size_t>(output_end - output)) {
+			throw std::runtime_error("Lz codec - Match outside the output");
+		}
+
+		// Overlapping matches repeat their start, they copy forward a byte at a time
+		auto match = output - offset;
+		if (offset >= length) {
+			std::memcpy(output, match, length);
+			output += length;
+		}
+		else {
+			for (auto end = output + length; output != end;) {
+				*output++ = *match++;
+			}
+		}
+	}
+
+	if (output != output_end) {
+		throw std::runtime_error("Lz codec - Stream is shorter than expected");
+	}
+}
@@ -0,0 +1,24 @@
+#ifndef LZ_CODEC
+#define LZ_CODEC
+
+// Byte oriented LZ77 in the manner of LZ4, picked for decoding speed over
+// ratio. A stream is a run of sequences, each a token byte (literal count in
+// the high nibble, match length minus 4 in the low one, 15 meaning more length
+// bytes follow, added until one is below 255), the literals, a little endian
+// 16 bit offset back into the output and the extra match length bytes. The
+// last sequence has literals only.
+//
+// Compression looks every position up in a hash of four byte prefixes and
+// takes the first candidate that matches, it is meant for cook time. Decoding
+// is bounds checked against both buffers, a damaged stream throws.
+class LzCodec
+{
+public:
+	LzCodec() = delete;
+
+	[[nodiscard]] static std::vector<uint8_t> Compress(uint8_t const *, size_t);
+	// The output size has to be known, the stream does not record it
+	static void Decompress(uint8_t const *, size_t, uint8_t *, size_t);
+};
+
+#endif // !LZ_CODEC
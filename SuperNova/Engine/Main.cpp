@@ -18,9 +18,9 @@ public:
 
 
 
-int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv)
+int main(int argc, char** argv)
 {
-	auto app = Application{};
+	auto app = Application{ std::vector<std::string>(argv + 1, argv + argc) };
 
 	app.Start();
 
@@ -30,6 +30,8 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv)
 
 	app.CleanUp();
 
-	system("pause");
+	if (!app.IsHeadless()) {
+		system("pause");
+	}
 	return EXIT_SUCCESS;
 }
\ No newline at end of file
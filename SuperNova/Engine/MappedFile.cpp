@@ -0,0 +1,100 @@
+#include "PreCompiledHeader.hpp"
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void MappedFile::Create(std::string const & t_path)
+{
+	Destroy();
+
+#ifdef _WIN32
+	auto file = CreateFileA(t_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Mapped file - Could not open " + t_path);
+	}
+	m_file = file;
+
+	auto size = LARGE_INTEGER{};
+	if (!GetFileSizeEx(file, &size)) {
+		Destroy();
+		throw std::runtime_error("Mapped file - Could not size " + t_path);
+	}
+	m_size = static_cast<uint64_t>(size.QuadPart);
+	if (m_size == 0) {
+		Destroy();
+		throw std::runtime_error("Mapped file - " + t_path + " is empty");
+	}
+
+	m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping == nullptr) {
+		Destroy();
+		throw std::runtime_error("Mapped file - Could not map " + t_path);
+	}
+
+	m_data = static_cast<uint8_t const *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_data == nullptr) {
+		Destroy();
+		throw std::runtime_error("Mapped file - Could not view " + t_path);
+	}
+#else
+	auto file = open(t_path.c_str(), O_RDONLY);
+	if (file < 0) {
+		throw std::runtime_error("Mapped file - Could not open " + t_path);
+	}
+
+	// The mapping keeps its own reference to the file
+	struct stat status {};
+	auto sized = fstat(file, &status) == 0 && status.st_size > 0;
+	auto data = sized ? mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+	close(file);
+	if (data == MAP_FAILED) {
+		throw std::runtime_error("Mapped file - Could not map " + t_path);
+	}
+
+	m_data = static_cast<uint8_t const *>(data);
+	m_size = static_cast<uint64_t>(status.st_size);
+#endif
+}
+
+void MappedFile::Destroy() noexcept
+{
+#ifdef _WIN32
+	if (m_data != nullptr) {
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping != nullptr) {
+		CloseHandle(m_mapping);
+	}
+	if (m_file != nullptr) {
+		CloseHandle(m_file);
+	}
+#else
+	if (m_data != nullptr) {
+		munmap(const_cast<uint8_t *>(m_data), static_cast<size_t>(m_size));
+	}
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+	m_file = nullptr;
+	m_mapping = nullptr;
+}
+
+uint8_t const * MappedFile::GetData() const noexcept
+{
+	return m_data;
+}
+
+uint64_t MappedFile::GetSize() const noexcept
+{
+	return m_size;
+}
@@ -0,0 +1,31 @@
+#ifndef MAPPED_FILE
+#define MAPPED_FILE
+
+// A whole file mapped read only. Opening costs no reads, the OS pages the file
+// in as it is touched and shares the pages with its own file cache, so nothing
+// is copied into the process. The mapping starts page aligned.
+class MappedFile
+{
+public:
+	explicit MappedFile() = default;
+	MappedFile(MappedFile const &) = delete;
+	MappedFile(MappedFile &&) noexcept = default;
+	MappedFile & operator = (MappedFile const &) = delete;
+	MappedFile & operator = (MappedFile &&) noexcept = default;
+	~MappedFile() noexcept = default;
+
+	void Create(std::string const &);
+	void Destroy() noexcept;
+
+	[[nodiscard]] uint8_t const * GetData() const noexcept;
+	[[nodiscard]] uint64_t GetSize() const noexcept;
+
+private:
+	uint8_t const * m_data{ nullptr };
+	uint64_t m_size{ 0 };
+	// Platform handles, unused where unmapping needs only the view
+	void * m_file{ nullptr };
+	void * m_mapping{ nullptr };
+};
+
+#endif // !MAPPED_FILE
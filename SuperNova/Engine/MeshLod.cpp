@@ -0,0 +1,409 @@
+#include "PreCompiledHeader.hpp"
+#include "MeshLod.h"
+
+// Borders weigh this much more than faces, so open edges only move as a last resort
+constexpr double BORDER_WEIGHT = 10.0;
+// A level that removes less than this share of its parent is not worth keeping
+constexpr float MIN_LEVEL_REDUCTION = 0.05f;
+// Closer than this the camera is taken to be inside the object
+constexpr float MIN_LOD_DISTANCE = 1e-4f;
+
+namespace
+{
+	// Symmetric 4x4 matrix of the summed squared plane distances, weight is the
+	// face area it was built from
+	struct Quadric {
+		double a00{ 0.0 }, a01{ 0.0 }, a02{ 0.0 }, a03{ 0.0 };
+		double a11{ 0.0 }, a12{ 0.0 }, a13{ 0.0 };
+		double a22{ 0.0 }, a23{ 0.0 };
+		double a33{ 0.0 };
+		double weight{ 0.0 };
+	};
+
+	Quadric MakePlaneQuadric(glm::dvec3 const & t_normal, double t_distance, double t_weight)
+	{
+		auto quadric = Quadric{};
+		quadric.a00 = t_weight * t_normal.x * t_normal.x;
+		quadric.a01 = t_weight * t_normal.x * t_normal.y;
+		quadric.a02 = t_weight * t_normal.x * t_normal.z;
+		quadric.a03 = t_weight * t_normal.x * t_distance;
+		quadric.a11 = t_weight * t_normal.y * t_normal.y;
+		quadric.a12 = t_weight * t_normal.y * t_normal.z;
+		quadric.a13 = t_weight * t_normal.y * t_distance;
+		quadric.a22 = t_weight * t_normal.z * t_normal.z;
+		quadric.a23 = t_weight * t_normal.z * t_distance;
+		quadric.a33 = t_weight * t_distance * t_distance;
+		return quadric;
+	}
+
+	void Accumulate(Quadric & t_destination, Quadric const & t_source)
+	{
+		t_destination.a00 += t_source.a00;
+		t_destination.a01 += t_source.a01;
+		t_destination.a02 += t_source.a02;
+		t_destination.a03 += t_source.a03;
+		t_destination.a11 += t_source.a11;
+		t_destination.a12 += t_source.a12;
+		t_destination.a13 += t_source.a13;
+		t_destination.a22 += t_source.a22;
+		t_destination.a23 += t_source.a23;
+		t_destination.a33 += t_source.a33;
+		t_destination.weight += t_source.weight;
+	}
+
+	double Evaluate(Quadric const & t_quadric, glm::dvec3 const & t_point)
+	{
+		auto x = t_point.x;
+		auto y = t_point.y;
+		auto z = t_point.z;
+		return t_quadric.a00 * x * x + 2.0 * t_quadric.a01 * x * y + 2.0 * t_quadric.a02 * x * z + 2.0 * t_quadric.a03 * x
+			+ t_quadric.a11 * y * y + 2.0 * t_quadric.a12 * y * z + 2.0 * t_quadric.a13 * y
+			+ t_quadric.a22 * z * z + 2.0 * t_quadric.a23 * z
+			+ t_quadric.a33;
+	}
+
+	uint64_t EdgeKey(uint32_t t_a, uint32_t t_b)
+	{
+		return t_a < t_b ? (uint64_t{ t_a } << 32) | t_b : (uint64_t{ t_b } << 32) | t_a;
+	}
+
+	// Versions are bumped whenever a vertex changes, so queued collapses that saw
+	// an older state can be recognised and dropped when popped
+	struct Collapse {
+		float error{ 0.0f };
+		uint32_t from{ 0 };
+		uint32_t to{ 0 };
+		uint32_t from_version{ 0 };
+		uint32_t to_version{ 0 };
+
+		bool operator > (Collapse const & t_other) const noexcept
+		{
+			return error > t_other.error;
+		}
+	};
+
+	class CollapseQueue
+	{
+	public:
+		CollapseQueue(std::vector<glm::dvec3> const & t_positions, std::vector<Quadric> const & t_quadrics, std::vector<uint32_t> const & t_versions) :
+			m_positions{ t_positions },
+			m_quadrics{ t_quadrics },
+			m_versions{ t_versions },
+			m_queue{}
+		{}
+
+		// Only the cheaper of the two directions is queued
+		void Push(uint32_t t_a, uint32_t t_b)
+		{
+			auto a_to_b = GetError(t_a, t_b);
+			auto b_to_a = GetError(t_b, t_a);
+
+			if (a_to_b <= b_to_a) {
+				m_queue.push(Collapse{ a_to_b, t_a, t_b, m_versions[t_a], m_versions[t_b] });
+			}
+			else {
+				m_queue.push(Collapse{ b_to_a, t_b, t_a, m_versions[t_b], m_versions[t_a] });
+			}
+		}
+
+		[[nodiscard]] bool Pop(Collapse & t_collapse)
+		{
+			while (!m_queue.empty()) {
+				t_collapse = m_queue.top();
+				m_queue.pop();
+
+				if (t_collapse.from_version == m_versions[t_collapse.from] && t_collapse.to_version == m_versions[t_collapse.to]) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+	private:
+		// Root mean square distance, over the merged area, to the planes both vertices came from
+		[[nodiscard]] float GetError(uint32_t t_from, uint32_t t_to) const
+		{
+			auto quadric = m_quadrics[t_from];
+			Accumulate(quadric, m_quadrics[t_to]);
+
+			auto squared = std::max(Evaluate(quadric, m_positions[t_to]), 0.0);
+			return static_cast<float>(std::sqrt(squared / std::max(quadric.weight, std::numeric_limits<double>::min())));
+		}
+
+		std::vector<glm::dvec3> const & m_positions;
+		std::vector<Quadric> const & m_quadrics;
+		std::vector<uint32_t> const & m_versions;
+		std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> m_queue;
+	};
+}
+
+MeshLodChain MeshSimplifier::BuildLodChain(std::vector<glm::vec3> const & t_positions, std::vector<uint32_t> const & t_indices, Settings const & t_settings)
+{
+	auto chain = MeshLodChain{};
+	chain.positions = t_positions;
+	chain.indices = t_indices;
+	chain.levels.emplace_back(MeshLevel{ 0, static_cast<uint32_t>(t_indices.size()), 0.0f });
+
+	auto current = t_indices;
+	auto error = 0.0f;
+	auto min_index_count = static_cast<size_t>(t_settings.min_triangles) * 3;
+
+	while (chain.levels.size() < t_settings.max_levels && current.size() > min_index_count) {
+		auto target = static_cast<size_t>(static_cast<float>(current.size()) * t_settings.reduction);
+		target = std::max(target - target % 3, min_index_count);
+
+		auto level_error = 0.0f;
+		auto simplified = Simplify(t_positions, current, static_cast<uint32_t>(target), t_settings.max_error - error, level_error);
+
+		// Borders, flips or the error limit stopped the collapses early
+		if (simplified.size() > static_cast<size_t>(static_cast<float>(current.size()) * (1.0f - MIN_LEVEL_REDUCTION))) {
+			break;
+		}
+
+		error += level_error;
+		chain.levels.emplace_back(MeshLevel{ static_cast<uint32_t>(chain.indices.size()), static_cast<uint32_t>(simplified.size()), error });
+		chain.indices.insert(chain.indices.end(), simplified.begin(), simplified.end());
+		current = std::move(simplified);
+	}
+
+	return chain;
+}
+
+std::vector<uint32_t> MeshSimplifier::Simplify(
+	std::vector<glm::vec3> const & t_positions,
+	std::vector<uint32_t> const & t_indices,
+	uint32_t t_target_index_count,
+	float t_max_error,
+	float & t_error)
+{
+	if (t_indices.size() % 3 != 0) {
+		throw std::runtime_error("Mesh simplifier - Index count must be a multiple of 3");
+	}
+
+	for (auto index : t_indices) {
+		if (index >= t_positions.size()) {
+			throw std::runtime_error("Mesh simplifier - Index " + std::to_string(index) + " is out of range");
+		}
+	}
+
+	t_error = 0.0f;
+	if (t_indices.size() <= t_target_index_count) {
+		return t_indices;
+	}
+
+	auto vertex_count = t_positions.size();
+	auto triangle_count = t_indices.size() / 3;
+
+	auto positions = std::vector<glm::dvec3>(t_positions.begin(), t_positions.end());
+	auto quadrics = std::vector<Quadric>(vertex_count);
+	auto versions = std::vector<uint32_t>(vertex_count, 0);
+	auto vertex_triangles = std::vector<std::vector<uint32_t>>(vertex_count);
+
+	auto edges = std::vector<uint64_t>{};
+	edges.reserve(t_indices.size());
+
+	for (auto t = size_t{ 0 }; t < triangle_count; ++t) {
+		for (auto corner = size_t{ 0 }; corner < 3; ++corner) {
+			vertex_triangles[t_indices[t * 3 + corner]].emplace_back(static_cast<uint32_t>(t));
+			edges.emplace_back(EdgeKey(t_indices[t * 3 + corner], t_indices[t * 3 + (corner + 1) % 3]));
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+
+	for (auto t = size_t{ 0 }; t < triangle_count; ++t) {
+		auto const & p0 = positions[t_indices[t * 3]];
+		auto const & p1 = positions[t_indices[t * 3 + 1]];
+		auto const & p2 = positions[t_indices[t * 3 + 2]];
+
+		auto normal = glm::cross(p1 - p0, p2 - p0);
+		auto double_area = glm::length(normal);
+		if (double_area <= 0.0) {
+			continue;
+		}
+		normal /= double_area;
+
+		auto face = MakePlaneQuadric(normal, -glm::dot(normal, p0), double_area * 0.5);
+		face.weight = double_area * 0.5;
+		for (auto corner = size_t{ 0 }; corner < 3; ++corner) {
+			Accumulate(quadrics[t_indices[t * 3 + corner]], face);
+		}
+
+		// An edge only one triangle uses is a border, a plane perpendicular to the
+		// face through it keeps its vertices from sliding off it
+		for (auto corner = size_t{ 0 }; corner < 3; ++corner) {
+			auto a = t_indices[t * 3 + corner];
+			auto b = t_indices[t * 3 + (corner + 1) % 3];
+			auto range = std::equal_range(edges.begin(), edges.end(), EdgeKey(a, b));
+			if (range.second - range.first != 1) {
+				continue;
+			}
+
+			auto edge = positions[b] - positions[a];
+			auto border_normal = glm::cross(edge, normal);
+			auto border_length = glm::length(border_normal);
+			if (border_length <= 0.0) {
+				continue;
+			}
+			border_normal /= border_length;
+
+			// Constraint planes add error without adding area
+			auto border = MakePlaneQuadric(border_normal, -glm::dot(border_normal, positions[a]), BORDER_WEIGHT * glm::dot(edge, edge));
+			Accumulate(quadrics[a], border);
+			Accumulate(quadrics[b], border);
+		}
+	}
+
+	auto queue = CollapseQueue{ positions, quadrics, versions };
+
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+	for (auto key : edges) {
+		queue.Push(static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key & 0xFFFFFFFF));
+	}
+
+	auto indices = t_indices;
+	auto alive = std::vector<bool>(triangle_count, true);
+	auto index_count = indices.size();
+	auto collapse = Collapse{};
+
+	while (index_count > t_target_index_count && queue.Pop(collapse)) {
+		if (collapse.error > t_max_error) {
+			break;
+		}
+
+		auto from = collapse.from;
+		auto to = collapse.to;
+
+		// Moving the vertex must not turn any of the triangles that survive the collapse over
+		auto flips = false;
+		for (auto t : vertex_triangles[from]) {
+			if (!alive[t]) {
+				continue;
+			}
+
+			auto const * triangle = &indices[static_cast<size_t>(t) * 3];
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+				continue;
+			}
+
+			glm::dvec3 corners[3]{};
+			for (auto corner = 0; corner < 3; ++corner) {
+				corners[corner] = positions[triangle[corner]];
+			}
+			auto before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+			for (auto corner = 0; corner < 3; ++corner) {
+				if (triangle[corner] == from) {
+					corners[corner] = positions[to];
+				}
+			}
+			auto after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+			if (glm::dot(before, after) <= 0.0) {
+				flips = true;
+				break;
+			}
+		}
+
+		if (flips) {
+			continue;
+		}
+
+		for (auto t : vertex_triangles[from]) {
+			if (!alive[t]) {
+				continue;
+			}
+
+			auto * triangle = &indices[static_cast<size_t>(t) * 3];
+			for (auto corner = 0; corner < 3; ++corner) {
+				if (triangle[corner] == from) {
+					triangle[corner] = to;
+				}
+			}
+
+			if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2]) {
+				alive[t] = false;
+				index_count -= 3;
+			}
+			else {
+				vertex_triangles[to].emplace_back(t);
+			}
+		}
+		vertex_triangles[from].clear();
+
+		Accumulate(quadrics[to], quadrics[from]);
+		++versions[from];
+		++versions[to];
+		t_error = std::max(t_error, collapse.error);
+
+		// Every edge around the surviving vertex has a new cost
+		auto & triangles = vertex_triangles[to];
+		triangles.erase(std::remove_if(triangles.begin(), triangles.end(), [&alive](uint32_t t) { return !alive[t]; }), triangles.end());
+		for (auto t : triangles) {
+			for (auto corner = 0; corner < 3; ++corner) {
+				auto other = indices[static_cast<size_t>(t) * 3 + corner];
+				if (other != to) {
+					queue.Push(to, other);
+				}
+			}
+		}
+	}
+
+	auto simplified = std::vector<uint32_t>{};
+	simplified.reserve(index_count);
+	for (auto t = size_t{ 0 }; t < triangle_count; ++t) {
+		if (alive[t]) {
+			simplified.insert(simplified.end(), indices.begin() + t * 3, indices.begin() + t * 3 + 3);
+		}
+	}
+
+	return simplified;
+}
+
+void LodSelector::SetProjection(glm::mat4 const & t_projection, float t_viewport_height) noexcept
+{
+	// [1][1] is cot(fov / 2), it may carry the Vulkan y flip
+	m_pixels_per_unit = std::abs(t_projection[1][1]) * 0.5f * t_viewport_height;
+}
+
+void LodSelector::SetThreshold(float t_pixels) noexcept
+{
+	m_threshold = t_pixels;
+}
+
+void LodSelector::SetFadeBand(float t_band) noexcept
+{
+	m_fade_band = std::max(t_band, 0.0f);
+}
+
+LodSelection LodSelector::Select(std::vector<MeshLevel> const & t_levels, float t_distance) const noexcept
+{
+	auto selection = LodSelection{};
+	if (t_levels.empty()) {
+		return selection;
+	}
+
+	auto level = uint32_t{ 0 };
+	while (level + 1 < t_levels.size() && GetScreenError(t_levels[level + 1].error, t_distance) <= m_threshold) {
+		++level;
+	}
+
+	selection.level = level;
+	selection.next_level = level;
+
+	if (m_fade_band > 0.0f && level + 1 < t_levels.size()) {
+		auto next_error = GetScreenError(t_levels[level + 1].error, t_distance);
+		auto fade_start = m_threshold * (1.0f + m_fade_band);
+
+		if (next_error < fade_start) {
+			selection.next_level = level + 1;
+			selection.fade = (fade_start - next_error) / (fade_start - m_threshold);
+		}
+	}
+
+	return selection;
+}
+
+float LodSelector::GetScreenError(float t_error, float t_distance) const noexcept
+{
+	return t_error * m_pixels_per_unit / std::max(t_distance, MIN_LOD_DISTANCE);
+}
@@ -0,0 +1,89 @@
+#ifndef MESH_LOD
+#define MESH_LOD
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm/vec3.hpp"
+#include "glm/glm/mat4x4.hpp"
+
+// One level of a LOD chain, a range of the chain's shared index buffer. The error
+// estimates, in object space units, how far the level's surface strays from the
+// source mesh. It is accumulated level over level, so it errs on the large side.
+struct MeshLevel {
+	uint32_t first_index{ 0 };
+	uint32_t index_count{ 0 };
+	float error{ 0.0f };
+};
+
+// Every level indexes the same vertices, so a mesh needs a single vertex buffer
+// and switching levels only changes the index range drawn. Level 0 is the source
+// mesh, errors grow monotonically with the level.
+struct MeshLodChain {
+	std::vector<glm::vec3> positions{};
+	std::vector<uint32_t> indices{};
+	std::vector<MeshLevel> levels{};
+};
+
+// Import time simplification with quadric error metrics (Garland & Heckbert).
+// Edges are collapsed onto one of their endpoints, never onto a new position, which
+// is what lets all levels share the source vertices. Open borders are held in
+// place by extra constraint planes and collapses that would flip a triangle are
+// rejected.
+class MeshSimplifier
+{
+public:
+	struct Settings {
+		// Index count of every level relative to the previous one
+		float reduction{ 0.5f };
+		uint32_t max_levels{ 8 };
+		uint32_t min_triangles{ 32 };
+		// Levels stop once a collapse would exceed this, in object space units
+		float max_error{ std::numeric_limits<float>::max() };
+	};
+
+	[[nodiscard]] static MeshLodChain BuildLodChain(std::vector<glm::vec3> const &, std::vector<uint32_t> const &, Settings const &);
+
+	// Returns the simplified indices, the error reached is written to the last parameter
+	[[nodiscard]] static std::vector<uint32_t> Simplify(std::vector<glm::vec3> const &, std::vector<uint32_t> const &, uint32_t, float, float &);
+};
+
+// The level to draw and, when cross-fading, the level fading in on top of it.
+// Both are drawn with the fade pushed as DrawPushConstants::lod_fade, +fade for
+// the next level and -fade for the current one, so each keeps the complementary
+// part of a screen space dither pattern. A fade of 0 draws the level as usual.
+// Fading draws must skip the depth pre-pass, it has no fragment stage to dither.
+struct LodSelection {
+	uint32_t level{ 0 };
+	uint32_t next_level{ 0 };
+	float fade{ 0.0f };
+};
+
+// Picks the coarsest level whose error, projected to the screen, stays under a
+// pixel threshold. With a fade band the next coarser level starts fading in while
+// its projected error is still under (1 + band) times the threshold, and is fully
+// faded in by the time it is selected.
+class LodSelector
+{
+public:
+	explicit LodSelector() = default;
+	LodSelector(LodSelector const &) = delete;
+	LodSelector(LodSelector &&) noexcept = default;
+	LodSelector & operator = (LodSelector const &) = delete;
+	LodSelector & operator = (LodSelector &&) noexcept = default;
+	~LodSelector() noexcept = default;
+
+	void SetProjection(glm::mat4 const &, float) noexcept;
+	void SetThreshold(float) noexcept;
+	void SetFadeBand(float) noexcept;
+
+	// Distance from the camera to the closest point of the object's bounds
+	[[nodiscard]] LodSelection Select(std::vector<MeshLevel> const &, float) const noexcept;
+	[[nodiscard]] float GetScreenError(float, float) const noexcept;
+
+private:
+	float m_pixels_per_unit{ 1.0f };
+	float m_threshold{ 1.0f };
+	float m_fade_band{ 0.0f };
+};
+
+#endif // !MESH_LOD
@@ -0,0 +1,609 @@
+#include "PreCompiledHeader.hpp"
+#include "OcclusionCuller.h"
+#include "Telemetry.h"
+#include "VulkanUtils.h"
+
+constexpr uint32_t DOWNSAMPLE_GROUP_SIZE = 8;
+constexpr uint32_t CULL_GROUP_SIZE = 64;
+// constant_id of COMPACT_DRAWS in OcclusionCull.comp
+constexpr uint32_t COMPACT_DRAWS_CONSTANT = 0;
+
+struct DownsampleConstants {
+	int32_t source_size[2]{};
+	int32_t destination_size[2]{};
+	uint32_t level{ 0 };
+};
+
+struct CullConstants {
+	uint32_t phase{ 0 };
+	uint32_t vertex_count{ 0 };
+};
+
+namespace
+{
+	void ComputeBarrier(VkCommandBuffer t_command_buffer,
+		VkPipelineStageFlags t_source_stages, VkAccessFlags t_source_access,
+		VkPipelineStageFlags t_destination_stages, VkAccessFlags t_destination_access)
+	{
+		auto barrier = VkMemoryBarrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = t_source_access;
+		barrier.dstAccessMask = t_destination_access;
+		vkCmdPipelineBarrier(t_command_buffer, t_source_stages, t_destination_stages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+}
+
+void OcclusionCuller::Create(
+	VkDevice const & t_device,
+	VkPhysicalDevice const & t_physical_device,
+	VkImageView t_depth_view,
+	VkExtent2D t_extent,
+	uint32_t t_frame_count,
+	uint32_t t_capacity,
+	uint32_t t_vertex_count,
+	INDIRECT_DRAW_PATH t_draw_path,
+	PFN_vkCmdDrawIndirectCount t_draw_indirect_count,
+	PipelineLayoutCache & t_layout_cache,
+	VkShaderModule t_downsample_shader,
+	ReflectedShader const & t_downsample_reflection,
+	VkShaderModule t_cull_shader,
+	ReflectedShader const & t_cull_reflection,
+	std::vector<uint32_t> const & t_queue_families)
+{
+	m_capacity = (t_capacity + 31) / 32 * 32;
+	m_vertex_count = t_vertex_count;
+	if (t_draw_path == IDP_UNSUPPORTED) {
+		throw std::runtime_error("Occlusion culler - Indirect draws with firstInstance are required");
+	}
+	m_draw_path = t_draw_path == IDP_DRAW_COUNT && t_draw_indirect_count == nullptr ? IDP_MULTI_DRAW : t_draw_path;
+	m_draw_indirect_count = t_draw_indirect_count;
+	m_pyramid_extent = t_extent;
+	m_slots.assign(t_frame_count, FrameSlot{});
+	m_current_slot = 0;
+	m_visibility_cleared = false;
+
+	CreateBuffers(t_device, t_physical_device, t_queue_families);
+	CreatePyramid(t_device, t_physical_device);
+	CreateLayouts(t_device, t_layout_cache, t_downsample_reflection, t_cull_reflection);
+	CreateDescriptors(t_device, t_depth_view);
+	CreatePipelines(t_device, t_downsample_shader, t_cull_shader, t_cull_reflection);
+}
+
+void OcclusionCuller::Destroy(VkDevice const & t_device) noexcept
+{
+	vkDestroyPipeline(t_device, m_cull_pipeline, nullptr);
+	vkDestroyPipeline(t_device, m_downsample_pipeline, nullptr);
+	vkDestroyDescriptorPool(t_device, m_descriptor_pool, nullptr);
+	vkDestroySampler(t_device, m_sampler, nullptr);
+
+	for (auto view : m_pyramid_level_views) {
+		vkDestroyImageView(t_device, view, nullptr);
+	}
+	vkDestroyImageView(t_device, m_pyramid_view, nullptr);
+	vkDestroyImage(t_device, m_pyramid, nullptr);
+	vkFreeMemory(t_device, m_pyramid_memory, nullptr);
+
+	for (auto buffer : { m_input_buffer, m_visibility_buffer, m_early_draw_buffer, m_late_draw_buffer, m_counter_buffer, m_readback_buffer }) {
+		vkDestroyBuffer(t_device, buffer, nullptr);
+	}
+	for (auto memory : m_device_memory) {
+		vkFreeMemory(t_device, memory, nullptr);
+	}
+	vkFreeMemory(t_device, m_input_memory, nullptr);
+	vkFreeMemory(t_device, m_readback_memory, nullptr);
+
+	*this = OcclusionCuller{};
+}
+
+void OcclusionCuller::BeginFrame(uint32_t t_frame, glm::mat4 const & t_view_projection, glm::vec2 const & t_rendered_area, std::vector<CullCandidate> const & t_candidates)
+{
+	if (t_candidates.size() > m_capacity) {
+		throw std::runtime_error("Occlusion culler - " + std::to_string(t_candidates.size()) + " candidates exceed the capacity of " + std::to_string(m_capacity));
+	}
+
+	for (auto const & candidate : t_candidates) {
+		if (candidate.object >= m_capacity) {
+			throw std::runtime_error("Occlusion culler - Object " + std::to_string(candidate.object) + " is outside the visibility buffer");
+		}
+	}
+
+	m_current_slot = t_frame % static_cast<uint32_t>(m_slots.size());
+	auto & slot = m_slots[m_current_slot];
+
+	if (slot.pending) {
+		ReadStatistics(slot);
+	}
+
+	auto header = CullInputHeader{};
+	header.view_projection = t_view_projection;
+	header.pyramid_size = glm::vec2{ static_cast<float>(m_pyramid_extent.width), static_cast<float>(m_pyramid_extent.height) };
+	header.pyramid_levels = static_cast<uint32_t>(m_pyramid_level_views.size());
+	header.uv_scale = t_rendered_area;
+	header.candidate_count = static_cast<uint32_t>(t_candidates.size());
+
+	auto destination = m_input_mapped + m_input_slot_size * m_current_slot;
+	std::memcpy(destination, &header, sizeof(header));
+	if (!t_candidates.empty()) {
+		std::memcpy(destination + sizeof(header), t_candidates.data(), sizeof(CullCandidate) * t_candidates.size());
+	}
+
+	slot.candidate_count = header.candidate_count;
+	slot.telemetry_frame = Telemetry::GetFrame();
+	slot.pending = true;
+}
+
+void OcclusionCuller::RecordEarlyCull(VkCommandBuffer t_command_buffer)
+{
+	// Last frame's indirect reads, late culling and counter copy all have to be done
+	// before anything here is overwritten
+	ComputeBarrier(t_command_buffer,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+	if (!m_visibility_cleared) {
+		vkCmdFillBuffer(t_command_buffer, m_visibility_buffer, 0, VK_WHOLE_SIZE, 0);
+		m_visibility_cleared = true;
+	}
+	vkCmdFillBuffer(t_command_buffer, m_counter_buffer, 0, VK_WHOLE_SIZE, 0);
+
+	ComputeBarrier(t_command_buffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+	auto const & slot = m_slots[m_current_slot];
+	auto constants = CullConstants{ 0, m_vertex_count };
+
+	vkCmdBindPipeline(t_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cull_pipeline);
+	vkCmdBindDescriptorSets(t_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cull_layout, 0, 1, &slot.cull_set, 0, nullptr);
+	vkCmdPushConstants(t_command_buffer, m_cull_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+	vkCmdDispatch(t_command_buffer, std::max((slot.candidate_count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1u), 1, 1);
+
+	ComputeBarrier(t_command_buffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+}
+
+void OcclusionCuller::RecordBuildPyramid(VkCommandBuffer t_command_buffer) const
+{
+	vkCmdBindPipeline(t_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_downsample_pipeline);
+
+	auto source_size = m_pyramid_extent;
+
+	for (auto level = uint32_t{ 0 }; level < m_pyramid_level_views.size(); ++level) {
+		auto destination_size = level == 0 ? source_size :
+			VkExtent2D{ std::max(source_size.width / 2, 1u), std::max(source_size.height / 2, 1u) };
+
+		auto constants = DownsampleConstants{};
+		constants.source_size[0] = static_cast<int32_t>(source_size.width);
+		constants.source_size[1] = static_cast<int32_t>(source_size.height);
+		constants.destination_size[0] = static_cast<int32_t>(destination_size.width);
+		constants.destination_size[1] = static_cast<int32_t>(destination_size.height);
+		constants.level = level;
+
+		vkCmdBindDescriptorSets(t_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_downsample_layout, 0, 1, &m_downsample_sets[level], 0, nullptr);
+		vkCmdPushConstants(t_command_buffer, m_downsample_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+		vkCmdDispatch(t_command_buffer,
+			(destination_size.width + DOWNSAMPLE_GROUP_SIZE - 1) / DOWNSAMPLE_GROUP_SIZE,
+			(destination_size.height + DOWNSAMPLE_GROUP_SIZE - 1) / DOWNSAMPLE_GROUP_SIZE,
+			1);
+
+		// Every level reads the one written just before
+		if (level + 1 < m_pyramid_level_views.size()) {
+			ComputeBarrier(t_command_buffer,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+		}
+
+		source_size = destination_size;
+	}
+}
+
+void OcclusionCuller::RecordLateCull(VkCommandBuffer t_command_buffer) const
+{
+	// Visibility and counters were last touched by the early phase
+	ComputeBarrier(t_command_buffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+	auto const & slot = m_slots[m_current_slot];
+	auto constants = CullConstants{ 1, m_vertex_count };
+
+	vkCmdBindPipeline(t_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cull_pipeline);
+	vkCmdBindDescriptorSets(t_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cull_layout, 0, 1, &slot.cull_set, 0, nullptr);
+	vkCmdPushConstants(t_command_buffer, m_cull_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+	vkCmdDispatch(t_command_buffer, std::max((slot.candidate_count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1u), 1, 1);
+
+	ComputeBarrier(t_command_buffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT);
+
+	auto copy = VkBufferCopy{ 0, sizeof(CullCounters) * m_current_slot, sizeof(CullCounters) };
+	vkCmdCopyBuffer(t_command_buffer, m_counter_buffer, m_readback_buffer, 1, &copy);
+
+	ComputeBarrier(t_command_buffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+}
+
+void OcclusionCuller::RecordEarlyDraws(VkCommandBuffer t_command_buffer) const
+{
+	RecordDraws(t_command_buffer, m_early_draw_buffer, offsetof(CullCounters, early_drawn));
+}
+
+void OcclusionCuller::RecordLateDraws(VkCommandBuffer t_command_buffer) const
+{
+	RecordDraws(t_command_buffer, m_late_draw_buffer, offsetof(CullCounters, late_drawn));
+}
+
+VkImage OcclusionCuller::GetPyramidImage() const noexcept
+{
+	return m_pyramid;
+}
+
+VkImageView OcclusionCuller::GetPyramidView() const noexcept
+{
+	return m_pyramid_view;
+}
+
+VkExtent2D OcclusionCuller::GetPyramidExtent() const noexcept
+{
+	return m_pyramid_extent;
+}
+
+uint32_t OcclusionCuller::GetPyramidLevels() const noexcept
+{
+	return static_cast<uint32_t>(m_pyramid_level_views.size());
+}
+
+OcclusionCuller::Statistics const & OcclusionCuller::GetStatistics() const noexcept
+{
+	return m_statistics;
+}
+
+void OcclusionCuller::CreateBuffers(VkDevice const & t_device, VkPhysicalDevice const & t_physical_device, std::vector<uint32_t> const & t_queue_families)
+{
+	auto properties = VkPhysicalDeviceProperties{};
+	vkGetPhysicalDeviceProperties(t_physical_device, &properties);
+	auto alignment = properties.limits.minStorageBufferOffsetAlignment;
+
+	// One input region per frame in flight so the CPU never writes what the GPU reads
+	auto input_size = sizeof(CullInputHeader) + sizeof(CullCandidate) * m_capacity;
+	m_input_slot_size = (input_size + alignment - 1) / alignment * alignment;
+
+	vulkan_utils::CreateBuffer(t_device, t_physical_device, m_input_slot_size * m_slots.size(),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_input_buffer, m_input_memory);
+
+	void * mapped = nullptr;
+	auto result = vkMapMemory(t_device, m_input_memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("map occlusion culling input", result);
+	}
+	m_input_mapped = static_cast<uint8_t *>(mapped);
+
+	auto const draw_buffer_size = VkDeviceSize{ sizeof(VkDrawIndirectCommand) } * m_capacity;
+	auto const device_buffers = std::vector<std::pair<VkBuffer *, std::pair<VkDeviceSize, VkBufferUsageFlags>>>{
+		{ &m_visibility_buffer, { m_capacity / 32 * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT } },
+		{ &m_early_draw_buffer, { draw_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT } },
+		{ &m_late_draw_buffer, { draw_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT } },
+		{ &m_counter_buffer, { sizeof(CullCounters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT } }
+	};
+
+	// Written by the cull passes and read by the draws, which may run on different
+	// queues, so they are shared instead of handed over every frame
+	for (auto const & [buffer, description] : device_buffers) {
+		m_device_memory.emplace_back(VkDeviceMemory{ VK_NULL_HANDLE });
+		vulkan_utils::CreateBuffer(t_device, t_physical_device, description.first, description.second,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, t_queue_families, *buffer, m_device_memory.back());
+	}
+
+	vulkan_utils::CreateBuffer(t_device, t_physical_device, sizeof(CullCounters) * m_slots.size(),
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+		m_readback_buffer, m_readback_memory);
+
+	result = vkMapMemory(t_device, m_readback_memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("map occlusion culling readback", result);
+	}
+	m_readback_mapped = static_cast<CullCounters const *>(mapped);
+}
+
+void OcclusionCuller::CreatePyramid(VkDevice const & t_device, VkPhysicalDevice const & t_physical_device)
+{
+	auto levels = uint32_t{ 1 };
+	for (auto size = std::max(m_pyramid_extent.width, m_pyramid_extent.height); size > 1; size /= 2) {
+		++levels;
+	}
+
+	auto image_info = VkImageCreateInfo{};
+	image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_info.imageType = VK_IMAGE_TYPE_2D;
+	image_info.format = VK_FORMAT_R32_SFLOAT;
+	image_info.extent = { m_pyramid_extent.width, m_pyramid_extent.height, 1 };
+	image_info.mipLevels = levels;
+	image_info.arrayLayers = 1;
+	image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_info.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	auto result = vkCreateImage(t_device, &image_info, nullptr, &m_pyramid);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("create Hi-Z pyramid", result);
+	}
+
+	auto requirements = VkMemoryRequirements{};
+	vkGetImageMemoryRequirements(t_device, m_pyramid, &requirements);
+
+	auto allocate_info = VkMemoryAllocateInfo{};
+	allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocate_info.allocationSize = requirements.size;
+	allocate_info.memoryTypeIndex = vulkan_utils::FindMemoryType(t_physical_device, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	result = vkAllocateMemory(t_device, &allocate_info, nullptr, &m_pyramid_memory);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("allocate Hi-Z pyramid memory", result);
+	}
+
+	vkBindImageMemory(t_device, m_pyramid, m_pyramid_memory, 0);
+
+	auto view_info = VkImageViewCreateInfo{};
+	view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	view_info.image = m_pyramid;
+	view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	view_info.format = VK_FORMAT_R32_SFLOAT;
+	view_info.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levels, 0, 1 };
+
+	result = vkCreateImageView(t_device, &view_info, nullptr, &m_pyramid_view);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("create Hi-Z pyramid view", result);
+	}
+
+	m_pyramid_level_views.resize(levels, VK_NULL_HANDLE);
+	for (auto level = uint32_t{ 0 }; level < levels; ++level) {
+		view_info.subresourceRange.baseMipLevel = level;
+		view_info.subresourceRange.levelCount = 1;
+
+		result = vkCreateImageView(t_device, &view_info, nullptr, &m_pyramid_level_views[level]);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("create Hi-Z pyramid level view", result);
+		}
+	}
+
+	// Reductions are done in the shaders with texel fetches, the sampler only has to
+	// exist
+	auto sampler_info = VkSamplerCreateInfo{};
+	sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	sampler_info.magFilter = VK_FILTER_NEAREST;
+	sampler_info.minFilter = VK_FILTER_NEAREST;
+	sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.maxLod = static_cast<float>(levels);
+
+	result = vkCreateSampler(t_device, &sampler_info, nullptr, &m_sampler);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("create Hi-Z sampler", result);
+	}
+}
+
+void OcclusionCuller::CreateLayouts(
+	VkDevice const & t_device,
+	PipelineLayoutCache & t_layout_cache,
+	ReflectedShader const & t_downsample_reflection,
+	ReflectedShader const & t_cull_reflection)
+{
+	auto const & downsample_layout = t_layout_cache.GetPipelineLayout(t_device, { &t_downsample_reflection });
+	auto const & cull_layout = t_layout_cache.GetPipelineLayout(t_device, { &t_cull_reflection });
+
+	// Descriptor writes below assume the bindings the shaders were written with
+	auto ExpectBindings = [&t_layout_cache](PipelineLayoutCache::PipelineLayout const & t_layout, std::vector<VkDescriptorType> const & t_types) {
+		if (t_layout.set_layouts.size() != 1) {
+			throw std::runtime_error("Occlusion culler - Shaders must use exactly descriptor set 0");
+		}
+		auto const & bindings = t_layout_cache.GetSetBindings(t_layout.set_layouts[0]);
+		auto matches = bindings.size() == t_types.size();
+		for (auto i = size_t{ 0 }; matches && i < bindings.size(); ++i) {
+			matches = bindings[i].binding == i && bindings[i].descriptorType == t_types[i] && bindings[i].descriptorCount == 1;
+		}
+		if (!matches) {
+			throw std::runtime_error("Occlusion culler - Shader bindings do not match the descriptors written for them");
+		}
+	};
+
+	ExpectBindings(downsample_layout, {
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+		VK_DESCRIPTOR_TYPE_STORAGE_IMAGE });
+
+	ExpectBindings(cull_layout, {
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER });
+
+	m_downsample_set_layout = downsample_layout.set_layouts[0];
+	m_downsample_layout = downsample_layout.layout;
+	m_cull_set_layout = cull_layout.set_layouts[0];
+	m_cull_layout = cull_layout.layout;
+}
+
+void OcclusionCuller::CreateDescriptors(VkDevice const & t_device, VkImageView t_depth_view)
+{
+	auto level_count = static_cast<uint32_t>(m_pyramid_level_views.size());
+	auto slot_count = static_cast<uint32_t>(m_slots.size());
+
+	auto pool_sizes = std::vector<VkDescriptorPoolSize>{
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, level_count + slot_count },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, level_count * 2 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, slot_count * 5 }
+	};
+
+	auto pool_info = VkDescriptorPoolCreateInfo{};
+	pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_info.maxSets = level_count + slot_count;
+	pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+	pool_info.pPoolSizes = pool_sizes.data();
+
+	auto result = vkCreateDescriptorPool(t_device, &pool_info, nullptr, &m_descriptor_pool);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("create occlusion culling descriptor pool", result);
+	}
+
+	auto layouts = std::vector<VkDescriptorSetLayout>(level_count, m_downsample_set_layout);
+	layouts.insert(layouts.end(), slot_count, m_cull_set_layout);
+	auto sets = std::vector<VkDescriptorSet>(layouts.size(), VK_NULL_HANDLE);
+
+	auto alloc_info = VkDescriptorSetAllocateInfo{};
+	alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	alloc_info.descriptorPool = m_descriptor_pool;
+	alloc_info.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+	alloc_info.pSetLayouts = layouts.data();
+
+	result = vkAllocateDescriptorSets(t_device, &alloc_info, sets.data());
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("allocate occlusion culling descriptor sets", result);
+	}
+
+	m_downsample_sets.assign(sets.begin(), sets.begin() + level_count);
+	for (auto slot = uint32_t{ 0 }; slot < slot_count; ++slot) {
+		m_slots[slot].cull_set = sets[level_count + slot];
+	}
+
+	// Infos are kept alive until the single update at the end
+	auto image_infos = std::vector<VkDescriptorImageInfo>{};
+	auto buffer_infos = std::vector<VkDescriptorBufferInfo>{};
+	image_infos.reserve(static_cast<size_t>(level_count) * 3 + slot_count);
+	buffer_infos.reserve(static_cast<size_t>(slot_count) * 5);
+	auto writes = std::vector<VkWriteDescriptorSet>{};
+
+	auto AddWrite = [&writes](VkDescriptorSet t_set, uint32_t t_binding, VkDescriptorType t_type,
+		VkDescriptorImageInfo const * t_image, VkDescriptorBufferInfo const * t_buffer) {
+		auto write = VkWriteDescriptorSet{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = t_set;
+		write.dstBinding = t_binding;
+		write.descriptorCount = 1;
+		write.descriptorType = t_type;
+		write.pImageInfo = t_image;
+		write.pBufferInfo = t_buffer;
+		writes.emplace_back(write);
+	};
+
+	for (auto level = uint32_t{ 0 }; level < level_count; ++level) {
+		// Level 0 reads the depth buffer, its source binding only has to be valid
+		auto source_level = level == 0 ? 0 : level - 1;
+		image_infos.emplace_back(VkDescriptorImageInfo{ m_sampler, t_depth_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+		AddWrite(m_downsample_sets[level], 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &image_infos.back(), nullptr);
+		image_infos.emplace_back(VkDescriptorImageInfo{ VK_NULL_HANDLE, m_pyramid_level_views[source_level], VK_IMAGE_LAYOUT_GENERAL });
+		AddWrite(m_downsample_sets[level], 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &image_infos.back(), nullptr);
+		image_infos.emplace_back(VkDescriptorImageInfo{ VK_NULL_HANDLE, m_pyramid_level_views[level], VK_IMAGE_LAYOUT_GENERAL });
+		AddWrite(m_downsample_sets[level], 2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &image_infos.back(), nullptr);
+	}
+
+	for (auto slot = uint32_t{ 0 }; slot < slot_count; ++slot) {
+		auto set = m_slots[slot].cull_set;
+		buffer_infos.emplace_back(VkDescriptorBufferInfo{ m_input_buffer, m_input_slot_size * slot, m_input_slot_size });
+		AddWrite(set, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &buffer_infos.back());
+
+		auto binding = uint32_t{ 1 };
+		for (auto buffer : { m_visibility_buffer, m_early_draw_buffer, m_late_draw_buffer, m_counter_buffer }) {
+			buffer_infos.emplace_back(VkDescriptorBufferInfo{ buffer, 0, VK_WHOLE_SIZE });
+			AddWrite(set, binding++, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &buffer_infos.back());
+		}
+
+		image_infos.emplace_back(VkDescriptorImageInfo{ m_sampler, m_pyramid_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+		AddWrite(set, 5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &image_infos.back(), nullptr);
+	}
+
+	vkUpdateDescriptorSets(t_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void OcclusionCuller::CreatePipelines(VkDevice const & t_device, VkShaderModule t_downsample_shader, VkShaderModule t_cull_shader, ReflectedShader const & t_cull_reflection)
+{
+	// The cull shader packs its draws when the count comes from the GPU. Constants
+	// the optimiser removed are left out of the map
+	VkBool32 const compact_draws = m_draw_path == IDP_DRAW_COUNT ? VK_TRUE : VK_FALSE;
+	auto cull_entries = ShaderReflection::GetSpecializationMap(t_cull_reflection);
+	auto cull_data = std::vector<uint8_t>(cull_entries.empty() ? 0 : cull_entries.back().offset + cull_entries.back().size);
+	for (auto const & entry : cull_entries) {
+		if (entry.constantID == COMPACT_DRAWS_CONSTANT && entry.size == sizeof(compact_draws)) {
+			std::memcpy(cull_data.data() + entry.offset, &compact_draws, sizeof(compact_draws));
+		}
+	}
+	auto cull_specialization = VkSpecializationInfo{ static_cast<uint32_t>(cull_entries.size()), cull_entries.data(), cull_data.size(), cull_data.data() };
+
+	auto MakeInfo = [](VkShaderModule t_module, VkPipelineLayout t_layout, VkSpecializationInfo const * t_specialization) {
+		auto pipeline_info = VkComputePipelineCreateInfo{};
+		pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipeline_info.stage.module = t_module;
+		pipeline_info.stage.pName = "main";
+		pipeline_info.stage.pSpecializationInfo = t_specialization;
+		pipeline_info.layout = t_layout;
+		pipeline_info.basePipelineIndex = -1;
+		return pipeline_info;
+	};
+
+	auto pipeline_infos = std::vector<VkComputePipelineCreateInfo>{
+		MakeInfo(t_downsample_shader, m_downsample_layout, nullptr),
+		MakeInfo(t_cull_shader, m_cull_layout, &cull_specialization)
+	};
+	auto pipelines = std::vector<VkPipeline>(pipeline_infos.size(), VK_NULL_HANDLE);
+
+	auto result = vkCreateComputePipelines(t_device, VK_NULL_HANDLE, static_cast<uint32_t>(pipeline_infos.size()), pipeline_infos.data(), nullptr, pipelines.data());
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("create occlusion culling pipelines", result);
+	}
+
+	m_downsample_pipeline = pipelines[0];
+	m_cull_pipeline = pipelines[1];
+}
+
+void OcclusionCuller::RecordDraws(VkCommandBuffer t_command_buffer, VkBuffer t_draws, VkDeviceSize t_count_offset) const
+{
+	auto draw_count = m_slots[m_current_slot].candidate_count;
+	auto stride = static_cast<uint32_t>(sizeof(VkDrawIndirectCommand));
+
+	// The phase's drawn counter doubles as the draw count of the packed commands
+	if (m_draw_path == IDP_DRAW_COUNT) {
+		m_draw_indirect_count(t_command_buffer, t_draws, 0, m_counter_buffer, t_count_offset, draw_count, stride);
+		return;
+	}
+
+	// Culled candidates are draws with no instances, the GPU skips them
+	if (m_draw_path == IDP_MULTI_DRAW) {
+		vkCmdDrawIndirect(t_command_buffer, t_draws, 0, draw_count, stride);
+		return;
+	}
+
+	for (auto draw = uint32_t{ 0 }; draw < draw_count; ++draw) {
+		vkCmdDrawIndirect(t_command_buffer, t_draws, VkDeviceSize{ stride } * draw, 1, stride);
+	}
+}
+
+void OcclusionCuller::ReadStatistics(FrameSlot const & t_slot)
+{
+	auto const & counters = m_readback_mapped[m_current_slot];
+
+	m_statistics.candidates = t_slot.candidate_count;
+	m_statistics.early_drawn = counters.early_drawn;
+	m_statistics.late_drawn = counters.late_drawn;
+	m_statistics.occluded = counters.occluded;
+
+	Telemetry::Record(TS_COUNTER, "Occlusion Candidates", m_statistics.candidates, t_slot.telemetry_frame);
+	Telemetry::Record(TS_COUNTER, "Occlusion Early Drawn", m_statistics.early_drawn, t_slot.telemetry_frame);
+	Telemetry::Record(TS_COUNTER, "Occlusion Late Drawn", m_statistics.late_drawn, t_slot.telemetry_frame);
+	Telemetry::Record(TS_COUNTER, "Occlusion Culled", m_statistics.occluded, t_slot.telemetry_frame);
+}
@@ -0,0 +1,128 @@
+#ifndef OCCLUSION_CULLER
+#define OCCLUSION_CULLER
+
+#include "vulkan/vulkan.h"
+#include "DeviceCapabilities.h"
+#include "PipelineLayoutCache.h"
+#include "ShaderInterface.h"
+
+// Two phase Hi-Z occlusion culling on the GPU. The early phase draws the
+// candidates that were visible last frame, the pyramid is then built from that
+// depth with a compute downsample and the late phase tests every candidate
+// against it. Candidates that turn out visible but were not drawn early are drawn
+// in a second pass, so nothing disoccluded since last frame is lost. Visibility is
+// one bit per object. With a GPU written draw count both phases pack the draws
+// they keep, otherwise they write one per candidate and culled ones draw nothing.
+//
+// Culled counts are copied into a readback slot per frame in flight and reported
+// once the frame's slot comes round again.
+class OcclusionCuller
+{
+public:
+	struct Statistics {
+		uint32_t candidates{ 0 };
+		uint32_t early_drawn{ 0 };
+		uint32_t late_drawn{ 0 };
+		uint32_t occluded{ 0 };
+	};
+
+	explicit OcclusionCuller() = default;
+	OcclusionCuller(OcclusionCuller const &) = delete;
+	OcclusionCuller(OcclusionCuller &&) noexcept = default;
+	OcclusionCuller & operator = (OcclusionCuller const &) = delete;
+	OcclusionCuller & operator = (OcclusionCuller &&) noexcept = default;
+	~OcclusionCuller() noexcept = default;
+
+	// Shader modules are only used during creation and stay owned by the caller,
+	// layouts come from the cache and are owned by it. The draw buffers are shared
+	// by the queue families given, so culling may run on another queue than the draws
+	void Create(
+		VkDevice const &,
+		VkPhysicalDevice const &,
+		VkImageView,
+		VkExtent2D,
+		uint32_t,
+		uint32_t,
+		uint32_t,
+		INDIRECT_DRAW_PATH,
+		PFN_vkCmdDrawIndirectCount,
+		PipelineLayoutCache &,
+		VkShaderModule,
+		ReflectedShader const &,
+		VkShaderModule,
+		ReflectedShader const &,
+		std::vector<uint32_t> const &);
+	void Destroy(VkDevice const &) noexcept;
+
+	// The frame's previous submission must have completed. Candidate object ids have
+	// to be below the capacity and the draw of candidate i uses firstInstance i
+	void BeginFrame(uint32_t, glm::mat4 const &, glm::vec2 const &, std::vector<CullCandidate> const &);
+
+	void RecordEarlyCull(VkCommandBuffer);
+	void RecordBuildPyramid(VkCommandBuffer) const;
+	void RecordLateCull(VkCommandBuffer) const;
+	void RecordEarlyDraws(VkCommandBuffer) const;
+	void RecordLateDraws(VkCommandBuffer) const;
+
+	[[nodiscard]] VkImage GetPyramidImage() const noexcept;
+	[[nodiscard]] VkImageView GetPyramidView() const noexcept;
+	[[nodiscard]] VkExtent2D GetPyramidExtent() const noexcept;
+	[[nodiscard]] uint32_t GetPyramidLevels() const noexcept;
+	[[nodiscard]] Statistics const & GetStatistics() const noexcept;
+
+private:
+	struct FrameSlot {
+		VkDescriptorSet cull_set{ VK_NULL_HANDLE };
+		uint32_t candidate_count{ 0 };
+		uint64_t telemetry_frame{ 0 };
+		bool pending{ false };
+	};
+
+	void CreateBuffers(VkDevice const &, VkPhysicalDevice const &, std::vector<uint32_t> const &);
+	void CreatePyramid(VkDevice const &, VkPhysicalDevice const &);
+	void CreateDescriptors(VkDevice const &, VkImageView);
+	void CreateLayouts(VkDevice const &, PipelineLayoutCache &, ReflectedShader const &, ReflectedShader const &);
+	void CreatePipelines(VkDevice const &, VkShaderModule, VkShaderModule, ReflectedShader const &);
+	void RecordDraws(VkCommandBuffer, VkBuffer, VkDeviceSize) const;
+	void ReadStatistics(FrameSlot const &);
+
+	VkBuffer m_input_buffer{ VK_NULL_HANDLE };
+	VkDeviceMemory m_input_memory{ VK_NULL_HANDLE };
+	uint8_t * m_input_mapped{ nullptr };
+	VkDeviceSize m_input_slot_size{ 0 };
+	VkBuffer m_visibility_buffer{ VK_NULL_HANDLE };
+	VkBuffer m_early_draw_buffer{ VK_NULL_HANDLE };
+	VkBuffer m_late_draw_buffer{ VK_NULL_HANDLE };
+	VkBuffer m_counter_buffer{ VK_NULL_HANDLE };
+	std::vector<VkDeviceMemory> m_device_memory{};
+	VkBuffer m_readback_buffer{ VK_NULL_HANDLE };
+	VkDeviceMemory m_readback_memory{ VK_NULL_HANDLE };
+	CullCounters const * m_readback_mapped{ nullptr };
+
+	VkImage m_pyramid{ VK_NULL_HANDLE };
+	VkDeviceMemory m_pyramid_memory{ VK_NULL_HANDLE };
+	VkImageView m_pyramid_view{ VK_NULL_HANDLE };
+	std::vector<VkImageView> m_pyramid_level_views{};
+	VkExtent2D m_pyramid_extent{};
+	VkSampler m_sampler{ VK_NULL_HANDLE };
+
+	VkDescriptorSetLayout m_downsample_set_layout{ VK_NULL_HANDLE };
+	VkDescriptorSetLayout m_cull_set_layout{ VK_NULL_HANDLE };
+	VkDescriptorPool m_descriptor_pool{ VK_NULL_HANDLE };
+	std::vector<VkDescriptorSet> m_downsample_sets{};
+	VkPipelineLayout m_downsample_layout{ VK_NULL_HANDLE };
+	VkPipelineLayout m_cull_layout{ VK_NULL_HANDLE };
+	VkPipeline m_downsample_pipeline{ VK_NULL_HANDLE };
+	VkPipeline m_cull_pipeline{ VK_NULL_HANDLE };
+
+	std::vector<FrameSlot> m_slots{};
+	uint32_t m_current_slot{ 0 };
+	uint32_t m_capacity{ 0 };
+	uint32_t m_vertex_count{ 0 };
+	Statistics m_statistics{};
+	INDIRECT_DRAW_PATH m_draw_path{ IDP_SINGLE_DRAWS };
+	PFN_vkCmdDrawIndirectCount m_draw_indirect_count{ nullptr };
+	bool m_visibility_cleared{ false };
+};
+
+#endif // !OCCLUSION_CULLER
@@ -0,0 +1,163 @@
+#include "PreCompiledHeader.hpp"
+#include "PipelineLayoutCache.h"
+#include "VulkanUtils.h"
+
+namespace
+{
+	VkDescriptorType MakeDynamic(VkDescriptorType t_type)
+	{
+		switch (t_type) {
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER: return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		default: return t_type;
+		}
+	}
+
+	// Handles go into keys as integers, they are pointers on 64 bit targets and
+	// integers on 32 bit ones
+	template<typename T>
+	uint64_t ToKey(T t_handle)
+	{
+		if constexpr (std::is_pointer_v<T>) {
+			return static_cast<uint64_t>(reinterpret_cast<std::uintptr_t>(t_handle));
+		}
+		else {
+			return static_cast<uint64_t>(t_handle);
+		}
+	}
+}
+
+void PipelineLayoutCache::Destroy(VkDevice const & t_device) noexcept
+{
+	for (auto const & entry : m_pipeline_layouts) {
+		vkDestroyPipelineLayout(t_device, entry.second.layout, nullptr);
+	}
+	for (auto const & entry : m_set_layouts) {
+		vkDestroyDescriptorSetLayout(t_device, entry.second, nullptr);
+	}
+
+	m_pipeline_layouts.clear();
+	m_set_bindings.clear();
+	m_set_layouts.clear();
+}
+
+PipelineLayoutCache::PipelineLayout const & PipelineLayoutCache::GetPipelineLayout(
+	VkDevice const & t_device,
+	std::vector<ReflectedShader const *> const & t_stages,
+	uint32_t t_dynamic_sets)
+{
+	auto sets = std::vector<std::vector<VkDescriptorSetLayoutBinding>>{};
+	auto push_constant_ranges = std::vector<VkPushConstantRange>{};
+
+	for (auto stage : t_stages) {
+		for (auto const & reflected : stage->bindings) {
+			if (sets.size() <= reflected.set) {
+				sets.resize(static_cast<size_t>(reflected.set) + 1);
+			}
+
+			auto type = reflected.set < 32 && (t_dynamic_sets & (1u << reflected.set)) != 0 ? MakeDynamic(reflected.type) : reflected.type;
+			auto & bindings = sets[reflected.set];
+			auto existing = std::find_if(bindings.begin(), bindings.end(), [&reflected](auto const & t_binding) {
+				return t_binding.binding == reflected.binding;
+			});
+
+			if (existing == bindings.end()) {
+				bindings.emplace_back(VkDescriptorSetLayoutBinding{ reflected.binding, type, reflected.count, static_cast<VkShaderStageFlags>(stage->stage), nullptr });
+			}
+			else if (existing->descriptorType == type && existing->descriptorCount == reflected.count) {
+				existing->stageFlags |= stage->stage;
+			}
+			else {
+				throw std::runtime_error("Pipeline layout cache - Set " + std::to_string(reflected.set) + " binding " + std::to_string(reflected.binding) + " is declared differently by two stages");
+			}
+		}
+
+		for (auto const & range : stage->push_constant_ranges) {
+			auto same = std::find_if(push_constant_ranges.begin(), push_constant_ranges.end(), [&range](auto const & t_range) {
+				return t_range.offset == range.offset && t_range.size == range.size;
+			});
+			if (same != push_constant_ranges.end()) {
+				same->stageFlags |= range.stageFlags;
+			}
+			else {
+				push_constant_ranges.emplace_back(range);
+			}
+		}
+	}
+
+	auto set_layouts = std::vector<VkDescriptorSetLayout>{};
+	set_layouts.reserve(sets.size());
+	for (auto & bindings : sets) {
+		std::sort(bindings.begin(), bindings.end(), [](auto const & t_a, auto const & t_b) {
+			return t_a.binding < t_b.binding;
+		});
+		set_layouts.emplace_back(GetSetLayout(t_device, bindings));
+	}
+
+	// Set layouts are already unique, their handles stand for their contents
+	auto key = std::vector<uint64_t>{};
+	for (auto set_layout : set_layouts) {
+		key.emplace_back(ToKey(set_layout));
+	}
+	for (auto const & range : push_constant_ranges) {
+		key.insert(key.end(), { range.stageFlags, range.offset, range.size });
+	}
+
+	auto cached = m_pipeline_layouts.find(key);
+	if (cached != m_pipeline_layouts.end()) {
+		return cached->second;
+	}
+
+	auto layout_info = VkPipelineLayoutCreateInfo{};
+	layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layout_info.setLayoutCount = static_cast<uint32_t>(set_layouts.size());
+	layout_info.pSetLayouts = set_layouts.data();
+	layout_info.pushConstantRangeCount = static_cast<uint32_t>(push_constant_ranges.size());
+	layout_info.pPushConstantRanges = push_constant_ranges.data();
+
+	auto layout = VkPipelineLayout{ VK_NULL_HANDLE };
+	auto result = vkCreatePipelineLayout(t_device, &layout_info, nullptr, &layout);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("create pipeline layout", result);
+	}
+
+	return m_pipeline_layouts.emplace(std::move(key), PipelineLayout{ layout, std::move(set_layouts), std::move(push_constant_ranges) }).first->second;
+}
+
+VkDescriptorSetLayout PipelineLayoutCache::GetSetLayout(VkDevice const & t_device, std::vector<VkDescriptorSetLayoutBinding> const & t_bindings)
+{
+	// Immutable samplers are not supported, the key would have to hold them
+	auto key = std::vector<uint64_t>{};
+	for (auto const & binding : t_bindings) {
+		key.insert(key.end(), { binding.binding, static_cast<uint64_t>(binding.descriptorType), binding.descriptorCount, binding.stageFlags });
+	}
+
+	auto cached = m_set_layouts.find(key);
+	if (cached != m_set_layouts.end()) {
+		return cached->second;
+	}
+
+	auto layout_info = VkDescriptorSetLayoutCreateInfo{};
+	layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_info.bindingCount = static_cast<uint32_t>(t_bindings.size());
+	layout_info.pBindings = t_bindings.data();
+
+	auto layout = VkDescriptorSetLayout{ VK_NULL_HANDLE };
+	auto result = vkCreateDescriptorSetLayout(t_device, &layout_info, nullptr, &layout);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("create descriptor set layout", result);
+	}
+
+	m_set_layouts.emplace(std::move(key), layout);
+	m_set_bindings.emplace(layout, t_bindings);
+	return layout;
+}
+
+std::vector<VkDescriptorSetLayoutBinding> const & PipelineLayoutCache::GetSetBindings(VkDescriptorSetLayout t_layout) const
+{
+	auto bindings = m_set_bindings.find(t_layout);
+	if (bindings == m_set_bindings.end()) {
+		throw std::runtime_error("Pipeline layout cache - Set layout was not created by this cache");
+	}
+	return bindings->second;
+}
@@ -0,0 +1,46 @@
+#ifndef PIPELINE_LAYOUT_CACHE
+#define PIPELINE_LAYOUT_CACHE
+
+#include "vulkan/vulkan.h"
+#include "ShaderReflection.h"
+
+// Descriptor set and pipeline layouts built from shader reflection, one Vulkan
+// object per distinct layout. Pipelines whose shaders declare the same interface
+// get the same handles, so a set bound for one stays bound across a switch to the
+// other, and sets allocated from a layout here fit every pipeline using it.
+//
+// A pipeline's stages are merged by set and binding, each binding visible to the
+// stages declaring it. Push constant ranges declared identically by several
+// stages become one range. Sets below the highest one used get an empty layout.
+// The cache owns every handle it returns until Destroy.
+class PipelineLayoutCache
+{
+public:
+	struct PipelineLayout {
+		VkPipelineLayout layout{ VK_NULL_HANDLE };
+		std::vector<VkDescriptorSetLayout> set_layouts{};
+		std::vector<VkPushConstantRange> push_constant_ranges{};
+	};
+
+	explicit PipelineLayoutCache() = default;
+	PipelineLayoutCache(PipelineLayoutCache const &) = delete;
+	PipelineLayoutCache(PipelineLayoutCache &&) noexcept = default;
+	PipelineLayoutCache & operator = (PipelineLayoutCache const &) = delete;
+	PipelineLayoutCache & operator = (PipelineLayoutCache &&) noexcept = default;
+	~PipelineLayoutCache() noexcept = default;
+
+	void Destroy(VkDevice const &) noexcept;
+
+	// Uniform and storage buffers in the sets flagged in the mask, bit n for set n,
+	// are made dynamic. A binding two stages declare differently throws
+	[[nodiscard]] PipelineLayout const & GetPipelineLayout(VkDevice const &, std::vector<ReflectedShader const *> const &, uint32_t = 0);
+	[[nodiscard]] VkDescriptorSetLayout GetSetLayout(VkDevice const &, std::vector<VkDescriptorSetLayoutBinding> const &);
+	[[nodiscard]] std::vector<VkDescriptorSetLayoutBinding> const & GetSetBindings(VkDescriptorSetLayout) const;
+
+private:
+	std::map<std::vector<uint64_t>, VkDescriptorSetLayout> m_set_layouts{};
+	std::map<VkDescriptorSetLayout, std::vector<VkDescriptorSetLayoutBinding>> m_set_bindings{};
+	std::map<std::vector<uint64_t>, PipelineLayout> m_pipeline_layouts{};
+};
+
+#endif // !PIPELINE_LAYOUT_CACHE
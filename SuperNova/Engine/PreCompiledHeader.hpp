@@ -14,9 +14,13 @@
 #include <queue>
 #include <cstdlib>
 #include <functional>
+#include <limits>
 #include <map>
 #include <optional>
 #include <set>
+#include <cstring>
+#include <future>
+#include <thread>
 
 
 #endif // !PRE_COMPILED_HEADER
@@ -0,0 +1,146 @@
+#include "PreCompiledHeader.hpp"
+#include "ReadbackRing.h"
+#include "VulkanUtils.h"
+
+void ReadbackRing::Create(
+	VkDevice const & t_device,
+	VkPhysicalDevice const & t_physical_device,
+	uint32_t t_slot_count,
+	VkExtent2D t_extent,
+	uint32_t t_bytes_per_pixel)
+{
+	m_extent = t_extent;
+	m_bytes_per_pixel = t_bytes_per_pixel;
+	m_slot_size = VkDeviceSize{ t_extent.width } * t_extent.height * t_bytes_per_pixel;
+	m_slots.resize(t_slot_count);
+	m_current_slot = 0;
+
+	for (auto & slot : m_slots) {
+		// Cached memory keeps the CPU side reads of the copied image fast
+		vulkan_utils::CreateBuffer(t_device, t_physical_device, m_slot_size,
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+			VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+			slot.buffer, slot.memory);
+
+		void * mapped = nullptr;
+		auto result = vkMapMemory(t_device, slot.memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("map readback buffer", result);
+		}
+		slot.mapped = static_cast<uint8_t *>(mapped);
+	}
+}
+
+void ReadbackRing::Destroy(VkDevice const & t_device) noexcept
+{
+	for (auto & slot : m_slots) {
+		if (slot.mapped != nullptr) {
+			vkUnmapMemory(t_device, slot.memory);
+		}
+		vkDestroyBuffer(t_device, slot.buffer, nullptr);
+		vkFreeMemory(t_device, slot.memory, nullptr);
+	}
+	m_slots.clear();
+}
+
+void ReadbackRing::SetConsumer(Consumer t_consumer)
+{
+	m_consumer = std::move(t_consumer);
+}
+
+void ReadbackRing::BeginFrame(VkDevice const & t_device, uint64_t t_frame)
+{
+	if (m_slots.empty()) {
+		return;
+	}
+
+	m_current_slot = (m_current_slot + 1) % static_cast<uint32_t>(m_slots.size());
+	auto & slot = m_slots[m_current_slot];
+
+	if (slot.pending) {
+		Consume(t_device, slot);
+	}
+
+	slot.frame = t_frame;
+}
+
+void ReadbackRing::RecordCopy(VkCommandBuffer t_command_buffer, VkImage t_image)
+{
+	if (m_slots.empty()) {
+		return;
+	}
+
+	auto & slot = m_slots[m_current_slot];
+
+	auto region = VkBufferImageCopy{};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { m_extent.width, m_extent.height, 1 };
+
+	vkCmdCopyImageToBuffer(t_command_buffer, t_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1, &region);
+
+	// Makes the copy available to the host once the submission's fence signals
+	auto barrier = VkBufferMemoryBarrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = slot.buffer;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(t_command_buffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+		0, nullptr, 1, &barrier, 0, nullptr);
+
+	slot.pending = true;
+}
+
+void ReadbackRing::Flush(VkDevice const & t_device)
+{
+	// Oldest first, the slot after the current one is the one written longest ago
+	for (size_t i = 1; i <= m_slots.size(); ++i) {
+		auto & slot = m_slots[(m_current_slot + i) % m_slots.size()];
+		if (slot.pending) {
+			Consume(t_device, slot);
+		}
+	}
+}
+
+void ReadbackRing::Consume(VkDevice const & t_device, Slot & t_slot)
+{
+	t_slot.pending = false;
+
+	if (!m_consumer) {
+		return;
+	}
+
+	// Needed when the chosen memory type is cached but not coherent, harmless otherwise
+	auto range = VkMappedMemoryRange{};
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.memory = t_slot.memory;
+	range.offset = 0;
+	range.size = VK_WHOLE_SIZE;
+
+	auto result = vkInvalidateMappedMemoryRanges(t_device, 1, &range);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("invalidate readback buffer", result);
+	}
+
+	auto frame = Frame{};
+	frame.frame = t_slot.frame;
+	frame.extent = m_extent;
+	frame.bytes_per_pixel = m_bytes_per_pixel;
+	frame.data = t_slot.mapped;
+	frame.size = static_cast<size_t>(m_slot_size);
+
+	m_consumer(frame);
+}
@@ -0,0 +1,57 @@
+#ifndef READBACK_RING
+#define READBACK_RING
+
+#include "vulkan/vulkan.h"
+
+// Copies a rendered image into one of several persistently mapped host buffers.
+// A slot is only handed to the consumer when the ring comes back round to it, by
+// which time the frame that filled it has been waited on, so the CPU never stalls
+// on a copy that is still in flight.
+class ReadbackRing
+{
+public:
+	struct Frame {
+		uint64_t frame{ 0 };
+		VkExtent2D extent{};
+		uint32_t bytes_per_pixel{ 0 };
+		uint8_t const * data{ nullptr };
+		size_t size{ 0 };
+	};
+
+	using Consumer = std::function<void(Frame const &)>;
+
+	explicit ReadbackRing() = default;
+	ReadbackRing(ReadbackRing const &) = delete;
+	ReadbackRing(ReadbackRing &&) noexcept = default;
+	ReadbackRing & operator = (ReadbackRing const &) = delete;
+	ReadbackRing & operator = (ReadbackRing &&) noexcept = default;
+	~ReadbackRing() noexcept = default;
+
+	void Create(VkDevice const &, VkPhysicalDevice const &, uint32_t, VkExtent2D, uint32_t);
+	void Destroy(VkDevice const &) noexcept;
+	void SetConsumer(Consumer);
+
+	void BeginFrame(VkDevice const &, uint64_t);
+	void RecordCopy(VkCommandBuffer, VkImage);
+	void Flush(VkDevice const &);
+
+private:
+	struct Slot {
+		VkBuffer buffer{ VK_NULL_HANDLE };
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+		uint8_t * mapped{ nullptr };
+		uint64_t frame{ 0 };
+		bool pending{ false };
+	};
+
+	void Consume(VkDevice const &, Slot &);
+
+	std::vector<Slot> m_slots{};
+	Consumer m_consumer{};
+	VkExtent2D m_extent{};
+	VkDeviceSize m_slot_size{ 0 };
+	uint32_t m_bytes_per_pixel{ 0 };
+	uint32_t m_current_slot{ 0 };
+};
+
+#endif // !READBACK_RING
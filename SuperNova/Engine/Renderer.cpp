@@ -2,55 +2,185 @@
 #include "Renderer.h"
 #include "glfw3.h"
 #include "Application.hpp"
+#include "VulkanUtils.h"
+#include "Telemetry.h"
+#include "glm/glm/gtc/matrix_transform.hpp"
 
 const std::vector<const char*> validation_layers = {
 	"VK_LAYER_KHRONOS_validation"
 };
 
-const std::vector<const char*> device_extensions = {
+const std::vector<const char*> presentation_device_extensions = {
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
 constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+constexpr uint32_t GPU_PROFILER_LATENCY = MAX_FRAMES_IN_FLIGHT + 1;
+constexpr uint32_t GPU_PROFILER_MAX_SCOPES = 64;
+constexpr uint32_t READBACK_LATENCY = MAX_FRAMES_IN_FLIGHT + 1;
+constexpr uint32_t UPLOAD_BATCHES = MAX_FRAMES_IN_FLIGHT + 1;
+constexpr VkDeviceSize UPLOAD_STAGING_SIZE = 8 * 1024 * 1024;
+constexpr VkDeviceSize FRAME_DATA_SIZE = 4 * 1024 * 1024;
+// Without a configured budget textures get this fraction of device local memory
+constexpr VkDeviceSize TEXTURE_BUDGET_DIVISOR = 4;
+// Object transforms, lights, light clusters and light indices
+constexpr uint32_t FRAME_DATA_STORAGE_BINDINGS = 4;
+// Set 0 of the forward shaders is the frame data ring, bound at dynamic offsets
+constexpr uint32_t FRAME_DATA_DYNAMIC_SETS = 1u << 0;
+// Their transforms fill a quarter of the ring, the rest is left to lighting
+constexpr uint32_t OCCLUSION_CAPACITY = static_cast<uint32_t>(FRAME_DATA_SIZE / 4 / sizeof(ObjectTransform));
+// Shader sources are compiled at start up, relative to the working directory
+constexpr char const * SHADER_CACHE_DIRECTORY = "Shaders/Cache";
+// Cooked with --cook-materials, without it the forward shaders are built with every feature
+constexpr char const * MATERIAL_VARIANT_DATABASE = "Shaders/Materials.svdb";
+constexpr float CAMERA_NEAR = 0.1f;
+constexpr float CAMERA_FAR = 100.0f;
+// Screen space error a LOD level may show, in render pixels
+constexpr float LOD_PIXEL_THRESHOLD = 1.0f;
+// The next level fades in while its error is under (1 + band) times the threshold
+constexpr float LOD_FADE_BAND = 0.5f;
+// Headless frames advance time by a fixed step so captures are reproducible
+constexpr float HEADLESS_FRAME_TIME = 1.0f / 60.0f;
+constexpr VkFormat OFFSCREEN_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+constexpr uint32_t OFFSCREEN_BYTES_PER_PIXEL = 4;
 
 Renderer::Renderer():
+	Renderer{ RendererConfig{} }
+{}
+
+Renderer::Renderer(RendererConfig const & t_config):
+	Module{ "Renderer" },
+	m_config{ t_config },
 	m_window{ nullptr },
-	m_window_width{ 800 },
-	m_window_height{ 600 },
+	m_window_width{ t_config.width },
+	m_window_height{ t_config.height },
 	m_instance{},
 	m_debug_messenger{},
 	m_physical_device{ VK_NULL_HANDLE },
+	m_device_capabilities{},
 	m_logical_device{},
 	m_graphics_queue{},
+	m_compute_queue{},
+	m_transfer_queue{},
 	m_swap_chain{},
 	m_swap_chain_images{},
 	m_swap_chain_image_format{},
 	m_swap_chain_extent{},
-	m_swap_chain_image_views{},
+	m_frame_latency{ GetFrameLatency(t_config.present_policy) },
+	m_input_sample_time{},
 	m_render_pass{},
 	m_pipeline_layout{},
 	m_graphics_pipeline{},
-	m_swap_chain_framebuffers{},
+	m_scene_framebuffer{ VK_NULL_HANDLE },
+	m_scene_color_image{ VK_NULL_HANDLE },
+	m_scene_color_memory{ VK_NULL_HANDLE },
+	m_scene_color_view{ VK_NULL_HANDLE },
+	m_render_extent{},
+	m_dynamic_resolution{},
+	m_dynamic_resolution_enabled{ false },
+	m_upscale_blit{ false },
+	m_depth_format{ VK_FORMAT_UNDEFINED },
+	m_depth_image{ VK_NULL_HANDLE },
+	m_depth_memory{ VK_NULL_HANDLE },
+	m_depth_image_view{ VK_NULL_HANDLE },
+	m_depth_sampled_view{ VK_NULL_HANDLE },
+	m_late_render_pass{ VK_NULL_HANDLE },
+	m_depth_pre_pass_render_pass{ VK_NULL_HANDLE },
+	m_depth_equal_render_pass{ VK_NULL_HANDLE },
+	m_depth_pre_pass_pipeline{ VK_NULL_HANDLE },
+	m_depth_equal_pipeline{ VK_NULL_HANDLE },
+	m_depth_framebuffer{ VK_NULL_HANDLE },
+	m_depth_pre_pass{ t_config.depth_pre_pass },
+	m_depth_pre_pass_key_down{ false },
+	m_offscreen_memory{ VK_NULL_HANDLE },
+	m_readback_ring{},
+	m_captured_frame{},
+	m_frame_count{ 0 },
+	m_frame_graph{},
+	m_back_buffer{},
+	m_scene_color{},
+	m_depth_buffer{},
+	m_hiz_pyramid{},
+	m_gpu_profiler{},
+	m_upload_queue{},
+	m_shader_compiler{},
+	m_compiled_shaders{},
+	m_shader_code{},
+	m_shader_reflections{},
+	m_shader_variants{},
+	m_material_features{ MATERIAL_ALL_FEATURES },
+	m_forward_reflections{},
+	m_layout_cache{},
+	m_texture_streamer{},
+	m_object_textures{},
+	m_frame_data_ring{},
+	m_frame_uniforms_offset{ 0 },
+	m_object_transforms_offset{ 0 },
+	m_frame_data_binding_count{ 0 },
+	m_start_time{ std::chrono::steady_clock::now() },
+	m_last_frame_time{ 0.0f },
+	m_frustum_culler{},
+	m_object_transforms{},
+	m_visible_objects{},
+	m_lod_selector{},
+	m_object_levels{},
+	m_lod_selections{},
+	m_light_clusterer{},
+	m_lights_offset{ 0 },
+	m_light_clusters_offset{ 0 },
+	m_light_indices_offset{ 0 },
+	m_occlusion_culler{},
+	m_cull_candidates{},
+	m_occlusion_culling{ false },
+	m_image_index{ 0 },
 	m_command_pool{},
+	m_compute_command_pool{ VK_NULL_HANDLE },
 	m_command_buffers{},
 	m_image_available_semaphores{ MAX_FRAMES_IN_FLIGHT },
 	m_render_finished_semaphores{ MAX_FRAMES_IN_FLIGHT },
-	m_in_flight_fences{ MAX_FRAMES_IN_FLIGHT },
+	m_gpu_timeline{},
+	m_frame_submissions{ MAX_FRAMES_IN_FLIGHT },
 	m_current_frame{}
 {}
 
 void Renderer::Start()
 {	
-	InitWindow();
+	if (!IsHeadless()) {
+		InitWindow();
+	}
 	InitVulkan();
+
+	m_lod_selector.SetThreshold(LOD_PIXEL_THRESHOLD);
+	// Without the lod-fade feature the shader ignores the fade, both levels would
+	// draw whole
+	auto lod_fade = (m_material_features & (1u << MF_LOD_FADE)) != 0;
+	m_lod_selector.SetFadeBand(lod_fade ? LOD_FADE_BAND : 0.0f);
+
+	// Until there is a scene the triangle is the only object, bounded by a sphere
+	// around its three corners
+	m_object_transforms.emplace_back(ObjectTransform{});
+	(void)m_frustum_culler.Add(glm::vec3{ 0.0f }, 0.71f);
 }
 
 void Renderer::PreUpdate()
 {
+	if (IsHeadless()) {
+		return;
+	}
+
+	ThrottleFrameStart();
+
 	glfwPollEvents();
+	m_input_sample_time = std::chrono::steady_clock::now();
 	if (glfwWindowShouldClose(m_window)) {
 		m_subject.BroadcastEvent(CloseWindowEvent{*this});
 	}
+
+	auto key_down = glfwGetKey(m_window, GLFW_KEY_P) == GLFW_PRESS;
+	if (key_down && !m_depth_pre_pass_key_down) {
+		SetDepthPrePass(!m_depth_pre_pass);
+	}
+	m_depth_pre_pass_key_down = key_down;
 }
 
 void Renderer::Update()
@@ -59,14 +189,81 @@ void Renderer::Update()
 
 void Renderer::PostUpdate()
 {
-	DrawFrame();
+	if (IsHeadless()) {
+		DrawOffscreenFrame();
+	}
+	else {
+		DrawFrame();
+	}
+
+	++m_frame_count;
+	if (m_config.frame_limit != 0 && m_frame_count == m_config.frame_limit) {
+		m_subject.BroadcastEvent(QuitEvent{ *this });
+	}
 }
 
 void Renderer::CleanUp() noexcept
 {
 	vkDeviceWaitIdle(m_logical_device);
+
+	try {
+		m_readback_ring.Flush(m_logical_device);
+		WriteCapture();
+	}
+	catch (std::exception & error) {
+		Application::LogError(std::string{ "Renderer - Could not write capture: " } + error.what());
+	}
+
 	CleanUpVulkan();
-	CleanUpWindow();
+	if (!IsHeadless()) {
+		CleanUpWindow();
+	}
+}
+
+void Renderer::SetDepthPrePass(bool t_enabled) noexcept
+{
+	m_depth_pre_pass = t_enabled;
+}
+
+bool Renderer::IsDepthPrePassEnabled() const noexcept
+{
+	return m_depth_pre_pass;
+}
+
+LightClusterer::LightIndex Renderer::AddPointLight(PointLight const & t_light)
+{
+	return m_light_clusterer.Add(t_light);
+}
+
+void Renderer::UpdatePointLight(LightClusterer::LightIndex t_index, PointLight const & t_light)
+{
+	m_light_clusterer.Update(t_index, t_light);
+}
+
+void Renderer::ClearPointLights() noexcept
+{
+	m_light_clusterer.Clear();
+}
+
+TextureStreamer::TextureHandle Renderer::LoadTexture(std::string const & t_path)
+{
+	return m_texture_streamer.Load(m_logical_device, t_path);
+}
+
+void Renderer::SetObjectTexture(FrustumCuller::ObjectIndex t_object, TextureStreamer::TextureHandle t_texture)
+{
+	if (m_object_textures.size() <= t_object) {
+		m_object_textures.resize(t_object + 1);
+	}
+	m_object_textures[t_object] = t_texture;
+}
+
+void Renderer::SetObjectLevels(FrustumCuller::ObjectIndex t_object, std::vector<MeshLevel> const & t_levels)
+{
+	if (m_object_levels.size() <= t_object) {
+		m_object_levels.resize(t_object + 1);
+	}
+	m_object_levels[t_object] = t_levels;
 }
 
 void Renderer::InitWindow()
@@ -83,17 +280,35 @@ void Renderer::InitVulkan()
 #ifdef _DEBUG
 	SetUpDebugMessenger();
 #endif
-	CreateSurface();
+	if (!IsHeadless()) {
+		CreateSurface();
+	}
 	PickPhysicalDevice();
 	CreateLogicalDevice();
-	CreateSwapChain();
-	CreateImageViews();
+	if (IsHeadless()) {
+		CreateOffscreenTarget();
+	}
+	else {
+		CreateSwapChain();
+	}
+	CreateSceneTarget();
+	CreateDepthResources();
 	CreateRenderPass();
+	CompileShaders();
+	CreateFrameDataRing();
 	CreateGraphicsPipeline();
+	CreateOcclusionCuller();
 	CreateFrameBuffers();
+	BuildFrameGraph();
 	CreateCommandPool();
 	CreateCommandBuffers();
 	CreateSyncObjects();
+	CreateGpuProfiler();
+	CreateUploadQueue();
+	CreateTextureStreamer();
+	if (IsHeadless()) {
+		CreateReadbackRing();
+	}
 }
 
 void Renderer::CleanUpVulkan()
@@ -101,24 +316,55 @@ void Renderer::CleanUpVulkan()
 	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
 		vkDestroySemaphore(m_logical_device, m_render_finished_semaphores[i], nullptr);
 		vkDestroySemaphore(m_logical_device, m_image_available_semaphores[i], nullptr);
-		vkDestroyFence(m_logical_device, m_in_flight_fences[i], nullptr);
 	}
+	m_texture_streamer.Destroy(m_logical_device);
+	m_gpu_timeline.Destroy(m_logical_device);
+	m_shader_compiler.Destroy();
+	m_shader_code.clear();
+	m_compiled_shaders.clear();
+	m_shader_variants.Destroy();
+
+	m_readback_ring.Destroy(m_logical_device);
+	m_upload_queue.Destroy(m_logical_device);
+	m_gpu_profiler.Destroy(m_logical_device);
+	m_frame_data_ring.Destroy(m_logical_device);
+	m_occlusion_culler.Destroy(m_logical_device);
 
 	vkDestroyCommandPool(m_logical_device, m_command_pool, nullptr);
+	vkDestroyCommandPool(m_logical_device, m_compute_command_pool, nullptr);
 
-	for (auto framebuffer : m_swap_chain_framebuffers) {
-		vkDestroyFramebuffer(m_logical_device, framebuffer, nullptr);
-	}
+	m_frame_graph.Reset(m_logical_device);
+
+	vkDestroyFramebuffer(m_logical_device, m_scene_framebuffer, nullptr);
+	vkDestroyFramebuffer(m_logical_device, m_depth_framebuffer, nullptr);
 
 	vkDestroyPipeline(m_logical_device, m_graphics_pipeline, nullptr);
-	vkDestroyPipelineLayout(m_logical_device, m_pipeline_layout, nullptr);
+	vkDestroyPipeline(m_logical_device, m_depth_equal_pipeline, nullptr);
+	vkDestroyPipeline(m_logical_device, m_depth_pre_pass_pipeline, nullptr);
+	m_layout_cache.Destroy(m_logical_device);
 	vkDestroyRenderPass(m_logical_device, m_render_pass, nullptr);
-
-	for (auto image_view : m_swap_chain_image_views) {
-		vkDestroyImageView(m_logical_device, image_view, nullptr);
+	vkDestroyRenderPass(m_logical_device, m_depth_equal_render_pass, nullptr);
+	vkDestroyRenderPass(m_logical_device, m_depth_pre_pass_render_pass, nullptr);
+	vkDestroyRenderPass(m_logical_device, m_late_render_pass, nullptr);
+
+	vkDestroyImageView(m_logical_device, m_scene_color_view, nullptr);
+	vkDestroyImage(m_logical_device, m_scene_color_image, nullptr);
+	vkFreeMemory(m_logical_device, m_scene_color_memory, nullptr);
+
+	vkDestroyImageView(m_logical_device, m_depth_image_view, nullptr);
+	vkDestroyImageView(m_logical_device, m_depth_sampled_view, nullptr);
+	vkDestroyImage(m_logical_device, m_depth_image, nullptr);
+	vkFreeMemory(m_logical_device, m_depth_memory, nullptr);
+
+	if (IsHeadless()) {
+		for (auto image : m_swap_chain_images) {
+			vkDestroyImage(m_logical_device, image, nullptr);
+		}
+		vkFreeMemory(m_logical_device, m_offscreen_memory, nullptr);
+	}
+	else {
+		vkDestroySwapchainKHR(m_logical_device, m_swap_chain, nullptr);
 	}
-
-	vkDestroySwapchainKHR(m_logical_device, m_swap_chain, nullptr);
 	vkDestroyDevice(m_logical_device, nullptr);
 	vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
 #ifdef _DEBUG
@@ -211,6 +457,8 @@ void Renderer::PickPhysicalDevice()
 	else {
 		throw std::runtime_error("Failed to find a suitable GPU!");
 	}
+
+	m_device_capabilities.Query(m_physical_device, DeviceCapabilities::GetInstanceApiVersion());
 }
 
 void Renderer::CreateLogicalDevice()
@@ -218,19 +466,26 @@ void Renderer::CreateLogicalDevice()
 	auto indices = FindQueueFamilies(m_physical_device, m_surface);
 
 	auto queue_create_infos = std::vector<VkDeviceQueueCreateInfo>{};
-	auto unique_queue_families = std::set<uint32_t> { indices.graphics_family.value(), indices.presentation_family.value() };
+	auto unique_queue_families = std::set<uint32_t> { indices.graphics_family.value() };
+	for (auto const & family : { indices.presentation_family, indices.compute_family, indices.transfer_family }) {
+		if (family.has_value()) {
+			unique_queue_families.insert(family.value());
+		}
+	}
 
 	for (uint32_t queueFamily : unique_queue_families) {
 		queue_create_infos.push_back(GetDeviceQueueConfig(queueFamily));
 	}
 
-	VkPhysicalDeviceFeatures deviceFeatures = {}; //empty for now
+	// Features and extensions are those of the paths picked for this device
+	auto device_extensions = GetRequiredDeviceExtensions();
+	m_device_capabilities.AppendDeviceExtensions(device_extensions);
 
 	auto create_info = VkDeviceCreateInfo {};
 	create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
 	create_info.pQueueCreateInfos = queue_create_infos.data();
-	create_info.pEnabledFeatures = &deviceFeatures;
+	m_device_capabilities.EnableFeatures(create_info);
 	create_info.enabledExtensionCount = static_cast<uint32_t>(device_extensions.size());
 	create_info.ppEnabledExtensionNames = device_extensions.data();
 #ifdef _DEBUG
@@ -247,7 +502,19 @@ void Renderer::CreateLogicalDevice()
 	}
 
 	vkGetDeviceQueue(m_logical_device, indices.graphics_family.value(), 0, &m_graphics_queue);
-	vkGetDeviceQueue(m_logical_device, indices.presentation_family.value(), 0, &m_presentation_queue);
+	if (indices.SupportsPresentationFamily()) {
+		vkGetDeviceQueue(m_logical_device, indices.presentation_family.value(), 0, &m_presentation_queue);
+	}
+
+	m_compute_queue = m_graphics_queue;
+	if (indices.compute_family.has_value()) {
+		vkGetDeviceQueue(m_logical_device, indices.compute_family.value(), 0, &m_compute_queue);
+	}
+
+	m_transfer_queue = m_graphics_queue;
+	if (indices.transfer_family.has_value()) {
+		vkGetDeviceQueue(m_logical_device, indices.transfer_family.value(), 0, &m_transfer_queue);
+	}
 }
 
 void Renderer::CreateSwapChain()
@@ -255,15 +522,9 @@ void Renderer::CreateSwapChain()
 	auto swap_chain_support = QuerySwapChainSupport(m_physical_device);
 
 	auto surface_format = GetSwapSurfaceFormat(swap_chain_support.formats);
-	auto presentation_mode = GetSwapPresentationMode(swap_chain_support.presentModes);
+	auto presentation_mode = GetSwapPresentationMode(swap_chain_support.presentModes, m_config.present_policy);
 	auto extent = GetSwapExtent(swap_chain_support.capabilities);
-
-	uint32_t const extra_images = 1;
-	auto image_count = swap_chain_support.capabilities.minImageCount + extra_images;
-
-	if (swap_chain_support.capabilities.maxImageCount > 0 && image_count > swap_chain_support.capabilities.maxImageCount) {
-		image_count = swap_chain_support.capabilities.maxImageCount;
-	}
+	auto image_count = GetSwapImageCount(swap_chain_support.capabilities, presentation_mode, m_config.present_policy);
 
 	auto create_info = VkSwapchainCreateInfoKHR{};
 	create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -274,7 +535,11 @@ void Renderer::CreateSwapChain()
 	create_info.imageColorSpace = surface_format.colorSpace;
 	create_info.imageExtent = extent;
 	create_info.imageArrayLayers = 1;
-	create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	// The scene is rendered elsewhere and upscaled into the swap chain image
+	if ((swap_chain_support.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) == 0) {
+		throw std::runtime_error("Renderer - Swap chain images can not be transfer destinations");
+	}
+	create_info.imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
 	auto indices = FindQueueFamilies(m_physical_device, m_surface);
 	uint32_t queue_family_indices[] = { indices.graphics_family.value(), indices.presentation_family.value() };
@@ -310,77 +575,402 @@ void Renderer::CreateSwapChain()
 	m_swap_chain_extent = extent;
 }
 
-void Renderer::CreateImageViews()
+void Renderer::CreateOffscreenTarget()
 {
-	m_swap_chain_image_views.resize(m_swap_chain_images.size());
+	// Stands in for the swap chain, everything downstream renders into image 0
+	m_swap_chain_image_format = OFFSCREEN_FORMAT;
+	m_swap_chain_extent = VkExtent2D{ m_window_width, m_window_height };
 
-	for (auto i = 0; i < m_swap_chain_images.size(); ++i) {
-		auto create_info = VkImageViewCreateInfo{};
-		create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-		create_info.image = m_swap_chain_images[i];
-		create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		create_info.format = m_swap_chain_image_format;
-		create_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-		create_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-		create_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-		create_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-		create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		create_info.subresourceRange.baseMipLevel = 0;
-		create_info.subresourceRange.levelCount = 1;
-		create_info.subresourceRange.baseArrayLayer = 0;
-		create_info.subresourceRange.layerCount = 1;
+	auto image_info = VkImageCreateInfo{};
+	image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_info.imageType = VK_IMAGE_TYPE_2D;
+	image_info.format = m_swap_chain_image_format;
+	image_info.extent = { m_swap_chain_extent.width, m_swap_chain_extent.height, 1 };
+	image_info.mipLevels = 1;
+	image_info.arrayLayers = 1;
+	image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
-		auto result = vkCreateImageView(m_logical_device, &create_info, nullptr, &m_swap_chain_image_views[i]);
-		if (result != VK_SUCCESS) {
-			CreateRenderPassErrorHandling(result);
+	m_swap_chain_images.resize(1);
+
+	auto result = vkCreateImage(m_logical_device, &image_info, nullptr, &m_swap_chain_images[0]);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("create offscreen image", result);
+	}
+
+	auto requirements = VkMemoryRequirements{};
+	vkGetImageMemoryRequirements(m_logical_device, m_swap_chain_images[0], &requirements);
+
+	auto allocate_info = VkMemoryAllocateInfo{};
+	allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocate_info.allocationSize = requirements.size;
+	allocate_info.memoryTypeIndex = vulkan_utils::FindMemoryType(m_physical_device, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	result = vkAllocateMemory(m_logical_device, &allocate_info, nullptr, &m_offscreen_memory);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("allocate offscreen image memory", result);
+	}
+
+	vkBindImageMemory(m_logical_device, m_swap_chain_images[0], m_offscreen_memory, 0);
+}
+
+void Renderer::CreateSceneTarget()
+{
+	// Sized for full resolution, lower resolutions only render into its top left
+	// corner so changing the scale never reallocates anything
+	m_render_extent = m_swap_chain_extent;
+
+	auto format_properties = VkFormatProperties{};
+	vkGetPhysicalDeviceFormatProperties(m_physical_device, m_swap_chain_image_format, &format_properties);
+	auto blit_features = VkFormatFeatureFlags{ VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT };
+	m_upscale_blit = (format_properties.optimalTilingFeatures & blit_features) == blit_features;
+
+	if (m_config.target_frame_milliseconds > 0.0) {
+		if (m_upscale_blit) {
+			auto settings = DynamicResolution::Settings{};
+			settings.target_milliseconds = m_config.target_frame_milliseconds;
+			settings.latency = GPU_PROFILER_LATENCY;
+			m_dynamic_resolution.Configure(settings);
+			m_dynamic_resolution_enabled = true;
 		}
+		else {
+			Application::LogError("Renderer - The back buffer format can not be blit with filtering, dynamic resolution disabled");
+		}
+	}
+
+	auto image_info = VkImageCreateInfo{};
+	image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_info.imageType = VK_IMAGE_TYPE_2D;
+	image_info.format = m_swap_chain_image_format;
+	image_info.extent = { m_swap_chain_extent.width, m_swap_chain_extent.height, 1 };
+	image_info.mipLevels = 1;
+	image_info.arrayLayers = 1;
+	image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	auto result = vkCreateImage(m_logical_device, &image_info, nullptr, &m_scene_color_image);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("create scene color image", result);
+	}
+
+	auto requirements = VkMemoryRequirements{};
+	vkGetImageMemoryRequirements(m_logical_device, m_scene_color_image, &requirements);
+
+	auto allocate_info = VkMemoryAllocateInfo{};
+	allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocate_info.allocationSize = requirements.size;
+	allocate_info.memoryTypeIndex = vulkan_utils::FindMemoryType(m_physical_device, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	result = vkAllocateMemory(m_logical_device, &allocate_info, nullptr, &m_scene_color_memory);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("allocate scene color memory", result);
+	}
+
+	vkBindImageMemory(m_logical_device, m_scene_color_image, m_scene_color_memory, 0);
+
+	auto view_info = VkImageViewCreateInfo{};
+	view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	view_info.image = m_scene_color_image;
+	view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	view_info.format = m_swap_chain_image_format;
+	view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	view_info.subresourceRange.baseMipLevel = 0;
+	view_info.subresourceRange.levelCount = 1;
+	view_info.subresourceRange.baseArrayLayer = 0;
+	view_info.subresourceRange.layerCount = 1;
+
+	result = vkCreateImageView(m_logical_device, &view_info, nullptr, &m_scene_color_view);
+	if (result != VK_SUCCESS) {
+		CreateImageViewsErrorHandling(result);
+	}
+}
+
+void Renderer::CreateDepthResources()
+{
+	m_depth_format = FindDepthFormat(m_physical_device);
+
+	auto aspect = VkImageAspectFlags{ VK_IMAGE_ASPECT_DEPTH_BIT };
+	if (HasStencilComponent(m_depth_format)) {
+		aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+	}
+
+	auto image_info = VkImageCreateInfo{};
+	image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_info.imageType = VK_IMAGE_TYPE_2D;
+	image_info.format = m_depth_format;
+	image_info.extent = { m_swap_chain_extent.width, m_swap_chain_extent.height, 1 };
+	image_info.mipLevels = 1;
+	image_info.arrayLayers = 1;
+	image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	auto result = vkCreateImage(m_logical_device, &image_info, nullptr, &m_depth_image);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("create depth image", result);
+	}
+
+	auto requirements = VkMemoryRequirements{};
+	vkGetImageMemoryRequirements(m_logical_device, m_depth_image, &requirements);
+
+	auto allocate_info = VkMemoryAllocateInfo{};
+	allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocate_info.allocationSize = requirements.size;
+	allocate_info.memoryTypeIndex = vulkan_utils::FindMemoryType(m_physical_device, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	result = vkAllocateMemory(m_logical_device, &allocate_info, nullptr, &m_depth_memory);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("allocate depth image memory", result);
+	}
+
+	vkBindImageMemory(m_logical_device, m_depth_image, m_depth_memory, 0);
+
+	auto view_info = VkImageViewCreateInfo{};
+	view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	view_info.image = m_depth_image;
+	view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	view_info.format = m_depth_format;
+	view_info.subresourceRange.aspectMask = aspect;
+	view_info.subresourceRange.baseMipLevel = 0;
+	view_info.subresourceRange.levelCount = 1;
+	view_info.subresourceRange.baseArrayLayer = 0;
+	view_info.subresourceRange.layerCount = 1;
+
+	result = vkCreateImageView(m_logical_device, &view_info, nullptr, &m_depth_image_view);
+	if (result != VK_SUCCESS) {
+		CreateImageViewsErrorHandling(result);
+	}
+
+	// Shaders can only sample a single aspect
+	view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+	result = vkCreateImageView(m_logical_device, &view_info, nullptr, &m_depth_sampled_view);
+	if (result != VK_SUCCESS) {
+		CreateImageViewsErrorHandling(result);
 	}
 }
 
 void Renderer::CreateRenderPass()
 {
-	auto color_attachment = GetColorAttachmentConfig(m_swap_chain_image_format);
 	auto color_attachment_ref = GetColorAttachmentReferenceConfig();
+	auto depth_attachment_ref = GetDepthAttachmentReferenceConfig(1);
 
 	std::vector<VkAttachmentReference> color_attachment_refs{
 	color_attachment_ref
 	};
 
-	auto subpass = GetSubpassConfig(color_attachment_refs);
+	auto subpass = GetSubpassConfig(color_attachment_refs, &depth_attachment_ref);
+
+	// The main pass either clears depth itself or, after a pre-pass, loads it. Both
+	// variants only differ in load operations and share pipelines and framebuffers
+	auto attachments = std::vector<VkAttachmentDescription>{
+		GetColorAttachmentConfig(m_swap_chain_image_format),
+		GetDepthAttachmentConfig(m_depth_format, VK_ATTACHMENT_LOAD_OP_CLEAR)
+	};
 
 	auto render_pass_info = VkRenderPassCreateInfo{};
 	render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	render_pass_info.attachmentCount = 1;
-	render_pass_info.pAttachments = &color_attachment;
+	render_pass_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+	render_pass_info.pAttachments = attachments.data();
 	render_pass_info.subpassCount = 1;
 	render_pass_info.pSubpasses = &subpass;
-
-	auto dependency = GetSubpassDependencyConfig();
-	render_pass_info.dependencyCount = 1;
-	render_pass_info.pDependencies = &dependency;
+	render_pass_info.dependencyCount = 0;
+	render_pass_info.pDependencies = nullptr;
 
 	auto result = vkCreateRenderPass(m_logical_device, &render_pass_info, nullptr, &m_render_pass);
 	if (result != VK_SUCCESS) {
 		CreateRenderPassErrorHandling(result);
 	}
+
+	attachments[1] = GetDepthAttachmentConfig(m_depth_format, VK_ATTACHMENT_LOAD_OP_LOAD);
+
+	result = vkCreateRenderPass(m_logical_device, &render_pass_info, nullptr, &m_depth_equal_render_pass);
+	if (result != VK_SUCCESS) {
+		CreateRenderPassErrorHandling(result);
+	}
+
+	// Objects found visible by late occlusion culling are drawn over the early ones
+	attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+
+	result = vkCreateRenderPass(m_logical_device, &render_pass_info, nullptr, &m_late_render_pass);
+	if (result != VK_SUCCESS) {
+		CreateRenderPassErrorHandling(result);
+	}
+
+	auto depth_only_attachment = GetDepthAttachmentConfig(m_depth_format, VK_ATTACHMENT_LOAD_OP_CLEAR);
+	auto depth_only_ref = GetDepthAttachmentReferenceConfig(0);
+	auto no_color_attachment_refs = std::vector<VkAttachmentReference>{};
+	auto depth_only_subpass = GetSubpassConfig(no_color_attachment_refs, &depth_only_ref);
+
+	render_pass_info.attachmentCount = 1;
+	render_pass_info.pAttachments = &depth_only_attachment;
+	render_pass_info.pSubpasses = &depth_only_subpass;
+
+	result = vkCreateRenderPass(m_logical_device, &render_pass_info, nullptr, &m_depth_pre_pass_render_pass);
+	if (result != VK_SUCCESS) {
+		CreateRenderPassErrorHandling(result);
+	}
+}
+
+void Renderer::CreateFrameDataRing()
+{
+	// The ring's set is whatever the forward variants declare as set 0. Variants
+	// without lighting drop the light bindings, when none uses lighting the set
+	// ends after the transforms and the draws bind fewer offsets
+	auto const & layout = GetForwardPipelineLayout();
+	auto const & bindings = m_layout_cache.GetSetBindings(layout.set_layouts.at(0));
+	if (bindings.empty() || bindings.size() > 1 + FRAME_DATA_STORAGE_BINDINGS) {
+		throw std::runtime_error("Renderer - Forward shaders declare " + std::to_string(bindings.size()) + " frame data bindings, at most " + std::to_string(1 + FRAME_DATA_STORAGE_BINDINGS) + " are bound");
+	}
+
+	m_frame_data_ring.Create(m_logical_device, m_physical_device, MAX_FRAMES_IN_FLIGHT, FRAME_DATA_SIZE, layout.set_layouts[0], bindings);
+	m_frame_data_binding_count = static_cast<uint32_t>(bindings.size());
+}
+
+void Renderer::CompileShaders()
+{
+	// A cooked pack holds every shader, sources are only compiled without one
+	auto cooked = LoadMaterialVariants();
+	if (!cooked) {
+		m_shader_compiler.Create(SHADER_CACHE_DIRECTORY, m_config.shader_optimization);
+		m_material_features = MATERIAL_ALL_FEATURES;
+
+		// In RENDERER_SHADER order
+		auto sources = std::vector<ShaderSource>{
+			ShaderVariants::GetSource(m_material_features, MS_VERTEX),
+			ShaderVariants::GetSource(m_material_features, MS_FRAGMENT),
+			ShaderVariants::GetEngineSource(ES_HIZ_DOWNSAMPLE),
+			ShaderVariants::GetEngineSource(ES_OCCLUSION_CULL)
+		};
+		m_compiled_shaders = m_shader_compiler.Compile(sources);
+		m_shader_code.assign(m_compiled_shaders.begin(), m_compiled_shaders.end());
+	}
+
+	m_shader_reflections.clear();
+	for (auto code : m_shader_code) {
+		m_shader_reflections.emplace_back(ShaderReflection::Reflect(code));
+	}
+
+	m_forward_reflections.clear();
+	if (cooked) {
+		for (auto const & variant : m_shader_variants.GetVariants()) {
+			m_forward_reflections.emplace_back(ShaderReflection::Reflect(variant.spirv));
+		}
+	}
+	else {
+		m_forward_reflections.emplace_back(m_shader_reflections[RS_VERTEX]);
+		m_forward_reflections.emplace_back(m_shader_reflections[RS_FRAGMENT]);
+	}
+}
+
+bool Renderer::LoadMaterialVariants()
+{
+	// Release builds ship the pack, compiling in its place would hide a broken
+	// build behind a slow start
+	if (!std::filesystem::exists(MATERIAL_VARIANT_DATABASE)) {
+#ifdef _DEBUG
+		return false;
+#else
+		throw std::runtime_error(std::string{ "Renderer - Missing the cooked shader pack " } + MATERIAL_VARIANT_DATABASE);
+#endif
+	}
+
+	try {
+		m_shader_variants.Create(MATERIAL_VARIANT_DATABASE);
+		m_material_features = m_shader_variants.GetMaterialFeatures(m_config.material);
+
+		auto vertex = m_shader_variants.Find(m_material_features, MS_VERTEX);
+		auto fragment = m_shader_variants.Find(m_material_features, MS_FRAGMENT);
+		if (vertex == nullptr || fragment == nullptr) {
+			throw std::runtime_error("Renderer - Material " + std::to_string(m_config.material) + " has no cooked variant");
+		}
+
+		m_shader_code.resize(RS_COUNT);
+		m_shader_code[RS_VERTEX] = vertex->spirv;
+		m_shader_code[RS_FRAGMENT] = fragment->spirv;
+		m_shader_code[RS_HIZ_DOWNSAMPLE] = m_shader_variants.GetEngineShader(ES_HIZ_DOWNSAMPLE);
+		m_shader_code[RS_OCCLUSION_CULL] = m_shader_variants.GetEngineShader(ES_OCCLUSION_CULL);
+		return true;
+	}
+	catch (std::exception & error) {
+		m_shader_variants.Destroy();
+#ifdef _DEBUG
+		Application::LogError(std::string{ "Renderer - Compiling the shaders from source: " } + error.what());
+		return false;
+#else
+		throw;
+#endif
+	}
+}
+
+void Renderer::CreateOcclusionCuller()
+{
+	// Occlusion culling selects objects through firstInstance and is switched off
+	// without it
+	auto draw_path = m_device_capabilities.GetPaths().indirect_draws;
+	if (draw_path == IDP_UNSUPPORTED) {
+		Application::LogError("Renderer - drawIndirectFirstInstance is not supported, occlusion culling disabled");
+		return;
+	}
+
+	auto downsample_shader = VkShaderModule{ VK_NULL_HANDLE };
+	auto cull_shader = VkShaderModule{ VK_NULL_HANDLE };
+
+	try {
+		downsample_shader = CreateShaderModule(m_shader_code[RS_HIZ_DOWNSAMPLE]);
+		cull_shader = CreateShaderModule(m_shader_code[RS_OCCLUSION_CULL]);
+
+		auto indices = FindQueueFamilies(m_physical_device, m_surface);
+		auto queue_families = std::vector<uint32_t>{ indices.graphics_family.value() };
+		if (indices.compute_family.has_value()) {
+			queue_families.push_back(indices.compute_family.value());
+		}
+
+		m_occlusion_culler.Create(m_logical_device, m_physical_device, m_depth_sampled_view, m_swap_chain_extent,
+			MAX_FRAMES_IN_FLIGHT, OCCLUSION_CAPACITY, 3, draw_path, m_device_capabilities.LoadDrawIndirectCount(m_logical_device), m_layout_cache,
+			downsample_shader, m_shader_reflections[RS_HIZ_DOWNSAMPLE], cull_shader, m_shader_reflections[RS_OCCLUSION_CULL], queue_families);
+		m_occlusion_culling = true;
+	}
+	catch (std::exception & error) {
+		m_occlusion_culler.Destroy(m_logical_device);
+		Application::LogError(std::string{ "Renderer - Occlusion culling disabled: " } + error.what());
+	}
+
+	vkDestroyShaderModule(m_logical_device, cull_shader, nullptr);
+	vkDestroyShaderModule(m_logical_device, downsample_shader, nullptr);
 }
 
 void Renderer::CreateGraphicsPipeline()
 {
-	auto vertex_shader_module = CreateShaderModule("Shaders/vert.spv");
-	auto fragment_shader_module = CreateShaderModule("Shaders/frag.spv");
+	auto vertex_shader_module = CreateShaderModule(m_shader_code[RS_VERTEX]);
+	auto fragment_shader_module = CreateShaderModule(m_shader_code[RS_FRAGMENT]);
 	
 	auto vertex_shader_stage_info = GetVertexShaderPipelineStageConfig(vertex_shader_module);
 	auto fragment_shader_stage_info = GetFragmentShaderPipelineStageConfig(fragment_shader_module);
 
+	// Constant features are folded here, the variant already holds the preprocessed ones
+	auto vertex_specialization = MaterialSpecialization{ m_material_features, MS_VERTEX };
+	auto fragment_specialization = MaterialSpecialization{ m_material_features, MS_FRAGMENT };
+	vertex_shader_stage_info.pSpecializationInfo = vertex_specialization.GetInfo();
+	fragment_shader_stage_info.pSpecializationInfo = fragment_specialization.GetInfo();
+
 	auto shader_stages = std::vector<VkPipelineShaderStageCreateInfo>{
 		vertex_shader_stage_info,
 		fragment_shader_stage_info
 	};
 
-	auto vertex_input_info = GetPipelineVertexInputConfig();
+	auto const & vertex_reflection = m_shader_reflections[RS_VERTEX];
+	auto vertex_input_info = GetPipelineVertexInputConfig(vertex_reflection.vertex_bindings, vertex_reflection.vertex_attributes);
 	auto input_assembly_info = GetPipelineInputAssemblyConfig();
-	auto viewport = GetViewportConfig(static_cast<float>(m_window_width), static_cast<float>(m_window_height));
+	auto viewport = GetViewportConfig(static_cast<float>(m_swap_chain_extent.width), static_cast<float>(m_swap_chain_extent.height));
 	auto scissor = GetScissorConfig(m_swap_chain_extent);
 	auto viewport_state = GetViewportStateConfig(viewport, scissor);
 	auto rasterizer = GetRasterizerConfig();
@@ -388,18 +978,28 @@ void Renderer::CreateGraphicsPipeline()
 	auto color_blend_attachment = GetColorBlendAttachmentConfig();
 	auto color_blending = GetColorBlendConfig(color_blend_attachment);
 
+	// Dynamic resolution changes the rendered area without rebuilding pipelines
 	auto dynamic_states = std::vector<VkDynamicState>{
 	VK_DYNAMIC_STATE_VIEWPORT,
-	VK_DYNAMIC_STATE_LINE_WIDTH
+	VK_DYNAMIC_STATE_SCISSOR
 	};
 
 	auto dynamic_state = GetDynamicStateCongif(dynamic_states);
-	auto pipeline_layout_info = GetPipelineLayoutConfig();
 
-	auto create_pipeline_layout_result = vkCreatePipelineLayout(m_logical_device, &pipeline_layout_info, nullptr, &m_pipeline_layout);
-	if (create_pipeline_layout_result != VK_SUCCESS) {
-		CreatePipelineLayoutErrorHandling(create_pipeline_layout_result);
-	}
+	// The same layout the frame data ring's set was made for, and the one the
+	// pre-pass uses even though it runs the vertex stage alone
+	m_pipeline_layout = GetForwardPipelineLayout().layout;
+
+	// Without a pre-pass the main pass tests and writes depth itself. After one it
+	// only shades the fragments whose depth matches exactly, which holds because
+	// Vertex.vert declares gl_Position invariant. Running the same shader in two
+	// pipelines alone does not promise identical results
+	auto depth_test = GetDepthStencilConfig(VK_COMPARE_OP_LESS, true);
+	auto depth_equal = GetDepthStencilConfig(VK_COMPARE_OP_EQUAL, false);
+
+	auto depth_only_blending = color_blending;
+	depth_only_blending.attachmentCount = 0;
+	depth_only_blending.pAttachments = nullptr;
 
 	auto pipeline_info = VkGraphicsPipelineCreateInfo{};
 	pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -410,32 +1010,194 @@ void Renderer::CreateGraphicsPipeline()
 	pipeline_info.pViewportState = &viewport_state;
 	pipeline_info.pRasterizationState = &rasterizer;
 	pipeline_info.pMultisampleState = &multisampling;
-	pipeline_info.pDepthStencilState = nullptr;
+	pipeline_info.pDepthStencilState = &depth_test;
 	pipeline_info.pColorBlendState = &color_blending;
-	pipeline_info.pDynamicState = nullptr;
+	pipeline_info.pDynamicState = &dynamic_state;
 	pipeline_info.layout = m_pipeline_layout;
 	pipeline_info.renderPass = m_render_pass;
 	pipeline_info.subpass = 0;
 	pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
 	pipeline_info.basePipelineIndex = -1;
 
-	auto create_pipeline_result = vkCreateGraphicsPipelines(m_logical_device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &m_graphics_pipeline);
+	auto equal_pipeline_info = pipeline_info;
+	equal_pipeline_info.pDepthStencilState = &depth_equal;
+
+	// Depth only, no fragment stage and no color attachment
+	auto pre_pass_pipeline_info = pipeline_info;
+	pre_pass_pipeline_info.stageCount = 1;
+	pre_pass_pipeline_info.pColorBlendState = &depth_only_blending;
+	pre_pass_pipeline_info.renderPass = m_depth_pre_pass_render_pass;
+
+	auto pipeline_infos = std::vector<VkGraphicsPipelineCreateInfo>{ pipeline_info, equal_pipeline_info, pre_pass_pipeline_info };
+	auto pipelines = std::vector<VkPipeline>(pipeline_infos.size(), VK_NULL_HANDLE);
+
+	auto create_pipeline_result = vkCreateGraphicsPipelines(m_logical_device, VK_NULL_HANDLE,
+		static_cast<uint32_t>(pipeline_infos.size()), pipeline_infos.data(), nullptr, pipelines.data());
 	if (create_pipeline_result != VK_SUCCESS) {
 		CreatePipelineErrorHandling(create_pipeline_result);
 	}
 
+	m_graphics_pipeline = pipelines[0];
+	m_depth_equal_pipeline = pipelines[1];
+	m_depth_pre_pass_pipeline = pipelines[2];
+
 	vkDestroyShaderModule(m_logical_device, fragment_shader_module, nullptr);
 	vkDestroyShaderModule(m_logical_device, vertex_shader_module, nullptr);
 }
 
 void Renderer::CreateFrameBuffers()
 {
-	m_swap_chain_framebuffers.reserve(m_swap_chain_image_views.size());
-	for (VkImageView image_view : m_swap_chain_image_views) {
-		CreateFrameBuffer(image_view);
+	CreateFrameBuffer(m_scene_color_view);
+
+	auto framebuffer_info = VkFramebufferCreateInfo{};
+	framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebuffer_info.renderPass = m_depth_pre_pass_render_pass;
+	framebuffer_info.attachmentCount = 1;
+	framebuffer_info.pAttachments = &m_depth_image_view;
+	framebuffer_info.width = m_swap_chain_extent.width;
+	framebuffer_info.height = m_swap_chain_extent.height;
+	framebuffer_info.layers = 1;
+
+	auto result = vkCreateFramebuffer(m_logical_device, &framebuffer_info, nullptr, &m_depth_framebuffer);
+	if (result != VK_SUCCESS) {
+		CreateFrameBufferErrorHandling(result);
 	}
 }
 
+void Renderer::BuildFrameGraph()
+{
+	auto back_buffer_description = FrameGraph::ImageDescription{};
+	back_buffer_description.format = m_swap_chain_image_format;
+	back_buffer_description.extent = m_swap_chain_extent;
+	back_buffer_description.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+	if (IsHeadless()) {
+		// The previous frame's copy is the last thing to touch the offscreen image,
+		// the readback pass is the graph's output in place of a present
+		back_buffer_description.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		m_back_buffer = m_frame_graph.ImportImage("Back Buffer", back_buffer_description,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_PIPELINE_STAGE_TRANSFER_BIT);
+	}
+	else {
+		// The acquire semaphore is waited on at the transfer stage, the first
+		// transition of the back buffer has to be ordered after it
+		m_back_buffer = m_frame_graph.ImportImage("Back Buffer", back_buffer_description,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			VK_PIPELINE_STAGE_TRANSFER_BIT);
+		m_frame_graph.MarkOutput(m_back_buffer);
+	}
+	m_frame_graph.SetProfiler(&m_gpu_profiler);
+
+	// Rendered at the current render extent and upscaled into the back buffer,
+	// the previous frame's upscale is the last thing to read it
+	auto scene_color_description = FrameGraph::ImageDescription{};
+	scene_color_description.format = m_swap_chain_image_format;
+	scene_color_description.extent = m_swap_chain_extent;
+	scene_color_description.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	m_scene_color = m_frame_graph.ImportImage("Scene Color", scene_color_description,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+	// Nothing of the previous frame's depth is kept, its last tests still have to
+	// finish before the image is cleared again
+	auto depth_description = FrameGraph::ImageDescription{};
+	depth_description.format = m_depth_format;
+	depth_description.extent = m_swap_chain_extent;
+	depth_description.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	depth_description.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+	if (HasStencilComponent(m_depth_format)) {
+		depth_description.aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+	}
+	m_depth_buffer = m_frame_graph.ImportImage("Depth Buffer", depth_description,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT);
+
+	// Passes marked async only leave the graphics queue when a separate compute
+	// family exists
+	auto indices = FindQueueFamilies(m_physical_device, m_surface);
+	if (indices.compute_family.has_value()) {
+		m_frame_graph.EnableAsyncCompute(indices.graphics_family.value(), indices.compute_family.value());
+	}
+
+	// Buffers are not tracked by the graph, the culler places its own barriers
+	// between the cull dispatches and the indirect draws that consume them. The
+	// culling passes run on the compute queue when there is one, the draws depend
+	// on them so the graph orders the queues.
+	auto early_cull = FrameGraph::PassHandle{ 0 };
+	if (m_occlusion_culling) {
+		early_cull = m_frame_graph.AddPass("Occlusion Cull Early", PT_COMPUTE,
+			[this](VkCommandBuffer t_command_buffer, FrameGraph const &) { m_occlusion_culler.RecordEarlyCull(t_command_buffer); });
+		m_frame_graph.SetSideEffects(early_cull);
+		m_frame_graph.SetAsyncCompute(early_cull);
+	}
+
+	// Always part of the graph so toggling it needs no recompile, disabled it records
+	// nothing and the main pass clears depth itself
+	auto depth_pre_pass = m_frame_graph.AddPass("Depth Pre-Pass", PT_GRAPHICS,
+		[this](VkCommandBuffer t_command_buffer, FrameGraph const &) { RecordDepthPrePass(t_command_buffer); });
+	m_frame_graph.Write(depth_pre_pass, m_depth_buffer, RU_DEPTH_ATTACHMENT);
+
+	auto main_pass = m_frame_graph.AddPass("Main Pass", PT_GRAPHICS,
+		[this](VkCommandBuffer t_command_buffer, FrameGraph const &) { RecordMainPass(t_command_buffer); });
+	m_frame_graph.Write(main_pass, m_scene_color, RU_COLOR_ATTACHMENT);
+	m_frame_graph.Write(main_pass, m_depth_buffer, RU_DEPTH_ATTACHMENT);
+
+	if (m_occlusion_culling) {
+		m_frame_graph.DependOn(depth_pre_pass, early_cull, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+		m_frame_graph.DependOn(main_pass, early_cull, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+	}
+
+	if (m_occlusion_culling) {
+		// Rebuilt from this frame's early depth every frame, nothing carries over
+		auto pyramid_description = FrameGraph::ImageDescription{};
+		pyramid_description.format = VK_FORMAT_R32_SFLOAT;
+		pyramid_description.extent = m_occlusion_culler.GetPyramidExtent();
+		pyramid_description.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		pyramid_description.mip_levels = m_occlusion_culler.GetPyramidLevels();
+		m_hiz_pyramid = m_frame_graph.ImportImage("Hi-Z Pyramid", pyramid_description,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+		auto build_pyramid = m_frame_graph.AddPass("Hi-Z Build", PT_COMPUTE,
+			[this](VkCommandBuffer t_command_buffer, FrameGraph const &) { m_occlusion_culler.RecordBuildPyramid(t_command_buffer); });
+		m_frame_graph.Read(build_pyramid, m_depth_buffer, RU_SAMPLED);
+		m_frame_graph.Write(build_pyramid, m_hiz_pyramid, RU_STORAGE);
+		m_frame_graph.SetAsyncCompute(build_pyramid);
+
+		auto late_cull = m_frame_graph.AddPass("Occlusion Cull Late", PT_COMPUTE,
+			[this](VkCommandBuffer t_command_buffer, FrameGraph const &) { m_occlusion_culler.RecordLateCull(t_command_buffer); });
+		m_frame_graph.Read(late_cull, m_hiz_pyramid, RU_SAMPLED);
+		m_frame_graph.SetSideEffects(late_cull);
+		m_frame_graph.SetAsyncCompute(late_cull);
+
+		auto late_main_pass = m_frame_graph.AddPass("Late Main Pass", PT_GRAPHICS,
+			[this](VkCommandBuffer t_command_buffer, FrameGraph const &) { RecordLateMainPass(t_command_buffer); });
+		m_frame_graph.Write(late_main_pass, m_scene_color, RU_COLOR_ATTACHMENT);
+		m_frame_graph.Write(late_main_pass, m_depth_buffer, RU_DEPTH_ATTACHMENT);
+		m_frame_graph.DependOn(late_main_pass, late_cull, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+	}
+
+	auto upscale_pass = m_frame_graph.AddPass("Upscale", PT_TRANSFER,
+		[this](VkCommandBuffer t_command_buffer, FrameGraph const & t_graph) { RecordUpscale(t_command_buffer, t_graph); });
+	m_frame_graph.Read(upscale_pass, m_scene_color, RU_TRANSFER_SOURCE);
+	m_frame_graph.Write(upscale_pass, m_back_buffer, RU_TRANSFER_DESTINATION);
+
+	if (IsHeadless()) {
+		auto readback_pass = m_frame_graph.AddPass("Readback", PT_TRANSFER,
+			[this](VkCommandBuffer t_command_buffer, FrameGraph const & t_graph) { m_readback_ring.RecordCopy(t_command_buffer, t_graph.GetImage(m_back_buffer)); });
+		m_frame_graph.Read(readback_pass, m_back_buffer, RU_TRANSFER_SOURCE);
+		m_frame_graph.SetSideEffects(readback_pass);
+	}
+
+	m_frame_graph.Compile(m_logical_device, m_physical_device);
+}
+
 void Renderer::CreateCommandPool()
 {
 	auto queue_family_indices = FindQueueFamilies(m_physical_device, m_surface);
@@ -443,59 +1205,42 @@ void Renderer::CreateCommandPool()
 	auto pool_info = VkCommandPoolCreateInfo{};
 	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 	pool_info.queueFamilyIndex = queue_family_indices.graphics_family.value();
-	pool_info.flags = 0;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
 	auto result = vkCreateCommandPool(m_logical_device, &pool_info, nullptr, &m_command_pool);		
 	if ( result != VK_SUCCESS) {
 		CreateCommandPoolErrorHandling(result);
 	}
-}
-
-void Renderer::CreateCommandBuffers()
-{
-	m_command_buffers.resize(m_swap_chain_framebuffers.size());
-
-	auto alloc_info = VkCommandBufferAllocateInfo{};
-	alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	alloc_info.commandPool = m_command_pool;
-	alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	alloc_info.commandBufferCount = static_cast<uint32_t>(m_command_buffers.size());
 
-	auto result = vkAllocateCommandBuffers(m_logical_device, &alloc_info, m_command_buffers.data());
-	if (result != VK_SUCCESS) {
-		CreateCommandBuffersErrorHandling(result);
-	}
+	if (queue_family_indices.compute_family.has_value()) {
+		pool_info.queueFamilyIndex = queue_family_indices.compute_family.value();
 
-	for (auto i = 0; i < m_command_buffers.size(); ++i ) {
-		auto begin_info = VkCommandBufferBeginInfo{};
-		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		begin_info.flags = 0; 
-		begin_info.pInheritanceInfo = nullptr;
-
-		if (vkBeginCommandBuffer(m_command_buffers[i], &begin_info) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to begin recording command buffer!");
+		result = vkCreateCommandPool(m_logical_device, &pool_info, nullptr, &m_compute_command_pool);
+		if (result != VK_SUCCESS) {
+			CreateCommandPoolErrorHandling(result);
 		}
+	}
+}
 
-		auto render_pass_info = VkRenderPassBeginInfo{};
-		render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		render_pass_info.renderPass = m_render_pass;
-		render_pass_info.framebuffer = m_swap_chain_framebuffers[i];
-		render_pass_info.renderArea.offset = { 0, 0 };
-		render_pass_info.renderArea.extent = m_swap_chain_extent;
-		auto clear_color = VkClearValue { 0.0f, 0.0f, 0.0f, 1.0f };
-		render_pass_info.clearValueCount = 1;
-		render_pass_info.pClearValues = &clear_color;
-
-		vkCmdBeginRenderPass(m_command_buffers[i], &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
-
-		vkCmdBindPipeline(m_command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphics_pipeline);
+void Renderer::CreateCommandBuffers()
+{
+	// One command buffer per frame graph submission and frame in flight, each taken
+	// from the pool of the queue the submission runs on
+	auto submission_count = m_frame_graph.GetSubmissionCount();
+	m_command_buffers.resize(static_cast<size_t>(submission_count) * MAX_FRAMES_IN_FLIGHT);
 
-		vkCmdDraw(m_command_buffers[i], 3, 1, 0, 0);
+	for (auto i = size_t{ 0 }; i < m_command_buffers.size(); ++i) {
+		auto queue = m_frame_graph.GetSubmissionQueue(static_cast<uint32_t>(i % submission_count));
 
-		vkCmdEndRenderPass(m_command_buffers[i]);
+		auto alloc_info = VkCommandBufferAllocateInfo{};
+		alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		alloc_info.commandPool = queue == QT_COMPUTE ? m_compute_command_pool : m_command_pool;
+		alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		alloc_info.commandBufferCount = 1;
 
-		if (vkEndCommandBuffer(m_command_buffers[i]) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to record command buffer!");
+		auto result = vkAllocateCommandBuffers(m_logical_device, &alloc_info, &m_command_buffers[i]);
+		if (result != VK_SUCCESS) {
+			CreateCommandBuffersErrorHandling(result);
 		}
 	}
 }
@@ -505,13 +1250,11 @@ void Renderer::CreateSyncObjects()
 	auto sempahore_info = VkSemaphoreCreateInfo{};
 	sempahore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	auto fence_info = VkFenceCreateInfo{};
-	fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	m_gpu_timeline.Create(m_logical_device, m_device_capabilities);
 
 	for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i){
 		auto image_available_sempahore_result = vkCreateSemaphore(m_logical_device, &sempahore_info, nullptr, &m_image_available_semaphores[i]);
 		auto render_finised_semaphore_result = vkCreateSemaphore(m_logical_device, &sempahore_info, nullptr, &m_render_finished_semaphores[i]);
-		auto fence_result = vkCreateFence(m_logical_device, &fence_info, nullptr, &m_in_flight_fences[i]);
 
 		if (image_available_sempahore_result != VK_SUCCESS) {
 			CreateSemaphoreErrorHandling(image_available_sempahore_result);
@@ -519,37 +1262,77 @@ void Renderer::CreateSyncObjects()
 		if (render_finised_semaphore_result != VK_SUCCESS) {
 			CreateSemaphoreErrorHandling(render_finised_semaphore_result);
 		}
-		if (fence_result != VK_SUCCESS) {
-			CreateFenceErrorHandling(fence_result);
-		}
 	}
 }
 
-void Renderer::DrawFrame()
+void Renderer::CreateGpuProfiler()
 {
-	auto image_index = uint32_t{};
-	vkAcquireNextImageKHR(m_logical_device, m_swap_chain, UINT64_MAX, m_image_available_semaphores[m_current_frame], VK_NULL_HANDLE, &image_index	);
+	auto indices = FindQueueFamilies(m_physical_device, m_surface);
+	m_gpu_profiler.Create(m_logical_device, m_physical_device, indices.graphics_family.value(), GPU_PROFILER_LATENCY, GPU_PROFILER_MAX_SCOPES);
+
+	if (!m_gpu_profiler.IsSupported()) {
+		Application::LogError("Renderer - Graphics queue does not support timestamps, GPU timings disabled");
+	}
+}
 
-	auto submit_info = VkSubmitInfo{};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+void Renderer::CreateUploadQueue()
+{
+	auto indices = FindQueueFamilies(m_physical_device, m_surface);
+	auto graphics_family = indices.graphics_family.value();
+	auto transfer_family = indices.transfer_family.value_or(graphics_family);
 
-	auto wait_semaphores = std::vector<VkSemaphore>{ m_image_available_semaphores[m_current_frame] };
-	auto wait_stages = std::vector<VkPipelineStageFlags>{ VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	m_upload_queue.Create(m_logical_device, m_physical_device, m_gpu_timeline, m_transfer_queue, transfer_family, graphics_family, UPLOAD_BATCHES, UPLOAD_STAGING_SIZE);
+}
 
-	submit_info.waitSemaphoreCount = static_cast<uint32_t>(wait_semaphores.size());
-	submit_info.pWaitSemaphores = wait_semaphores.data();
-	submit_info.pWaitDstStageMask = wait_stages.data();
+void Renderer::CreateTextureStreamer()
+{
+	auto budget = static_cast<VkDeviceSize>(m_config.texture_budget_mib) * 1024 * 1024;
+	if (budget == 0) {
+		budget = m_device_capabilities.GetDeviceLocalBudget(m_physical_device) / TEXTURE_BUDGET_DIVISOR;
+	}
 
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &m_command_buffers[image_index];
+	m_texture_streamer.Create(m_physical_device, m_upload_queue, m_gpu_timeline, budget);
+}
 
-	auto signal_semaphores = std::vector<VkSemaphore>{ m_render_finished_semaphores[m_current_frame] };
-	submit_info.signalSemaphoreCount = static_cast<uint32_t>(signal_semaphores.size());
-	submit_info.pSignalSemaphores = signal_semaphores.data();
+void Renderer::CreateReadbackRing()
+{
+	m_readback_ring.Create(m_logical_device, m_physical_device, READBACK_LATENCY, m_swap_chain_extent, OFFSCREEN_BYTES_PER_PIXEL);
 
-	if (vkQueueSubmit(m_graphics_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to submit draw command buffer!");
+	if (!m_config.capture_path.empty()) {
+		m_readback_ring.SetConsumer([this](ReadbackRing::Frame const & t_frame) {
+			m_captured_frame.assign(t_frame.data, t_frame.data + t_frame.size);
+		});
 	}
+}
+
+void Renderer::ThrottleFrameStart()
+{
+	auto timer = ScopedCpuTimer{ "Frame Throttle" };
+
+	// Blocking before input is sampled rather than after keeps the CPU from
+	// queueing frames built on input the GPU will not get to for a while
+	WaitForFrame((m_current_frame + MAX_FRAMES_IN_FLIGHT - m_frame_latency) % MAX_FRAMES_IN_FLIGHT);
+}
+
+void Renderer::WaitForFrame(size_t t_slot)
+{
+	for (auto const & submission : m_frame_submissions[t_slot]) {
+		m_gpu_timeline.Wait(m_logical_device, submission);
+	}
+}
+
+void Renderer::DrawFrame()
+{
+	// Command buffers are per frame in flight, every queue the frame used has to be
+	// done with them
+	WaitForFrame(m_current_frame);
+
+	auto image_index = uint32_t{};
+	vkAcquireNextImageKHR(m_logical_device, m_swap_chain, UINT64_MAX, m_image_available_semaphores[m_current_frame], VK_NULL_HANDLE, &image_index	);
+
+	RecordAndSubmitFrame(image_index, m_image_available_semaphores[m_current_frame], m_render_finished_semaphores[m_current_frame]);
+
+	auto signal_semaphores = std::vector<VkSemaphore>{ m_render_finished_semaphores[m_current_frame] };
 
 	auto present_info = VkPresentInfoKHR{};
 	present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -565,14 +1348,442 @@ void Renderer::DrawFrame()
 
 	vkQueuePresentKHR(m_presentation_queue, &present_info);
 
-	vkQueueWaitIdle(m_presentation_queue);
+	auto input_latency = std::chrono::duration<double, std::milli>{ std::chrono::steady_clock::now() - m_input_sample_time };
+	Telemetry::Record(TS_CPU, "Input To Present", input_latency.count());
 
 	m_current_frame = (m_current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
 }
 
+void Renderer::DrawOffscreenFrame()
+{
+	// Waiting on the frame that last used this command buffer also guarantees the
+	// readback slot about to be reused has landed
+	WaitForFrame(m_current_frame);
+
+	m_readback_ring.BeginFrame(m_logical_device, m_frame_count);
+
+	RecordAndSubmitFrame(0, VK_NULL_HANDLE, VK_NULL_HANDLE);
+
+	m_current_frame = (m_current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+}
+
+void Renderer::RecordAndSubmitFrame(uint32_t t_image_index, VkSemaphore t_image_available, VkSemaphore t_render_finished)
+{
+	m_image_index = t_image_index;
+	// Only ever a blit destination, transfer usage allows no view of it
+	m_frame_graph.SetImportedImage(m_back_buffer, m_swap_chain_images[t_image_index], VK_NULL_HANDLE);
+	m_frame_graph.SetImportedImage(m_scene_color, m_scene_color_image, m_scene_color_view);
+	m_frame_graph.SetImportedImage(m_depth_buffer, m_depth_image, m_depth_image_view);
+	if (m_occlusion_culling) {
+		m_frame_graph.SetImportedImage(m_hiz_pyramid, m_occlusion_culler.GetPyramidImage(), m_occlusion_culler.GetPyramidView());
+	}
+
+	m_gpu_timeline.CollectRetired(m_logical_device);
+	m_texture_streamer.Update(m_logical_device, m_frame_count);
+	m_upload_queue.Submit(m_logical_device);
+	UpdateRenderExtent();
+	WriteFrameData();
+
+	auto submission_count = m_frame_graph.GetSubmissionCount();
+	auto first_graphics_submission = uint32_t{ 0 };
+	while (m_frame_graph.GetSubmissionQueue(first_graphics_submission) != QT_GRAPHICS) {
+		++first_graphics_submission;
+	}
+
+	auto frame_scope = GpuProfiler::ScopeHandle{};
+	auto & frame_submissions = m_frame_submissions[m_current_frame];
+	frame_submissions.clear();
+
+	for (auto submission = uint32_t{ 0 }; submission < submission_count; ++submission) {
+		auto command_buffer = m_command_buffers[m_current_frame * submission_count + submission];
+		auto is_first_graphics = submission == first_graphics_submission;
+		auto is_last = submission + 1 == submission_count;
+
+		auto begin_info = VkCommandBufferBeginInfo{};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		begin_info.pInheritanceInfo = nullptr;
+
+		if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to begin recording command buffer!");
+		}
+
+		if (is_first_graphics) {
+			m_gpu_profiler.BeginFrame(m_logical_device, command_buffer);
+			frame_scope = m_gpu_profiler.BeginScope(command_buffer, "Frame");
+			m_upload_queue.RecordAcquires(command_buffer);
+		}
+
+		m_frame_graph.RecordSubmission(submission, command_buffer);
+
+		if (is_last) {
+			m_gpu_profiler.EndScope(command_buffer, frame_scope);
+		}
+
+		if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to record command buffer!");
+		}
+
+		auto wait_semaphores = std::vector<VkSemaphore>{};
+		auto wait_stages = std::vector<VkPipelineStageFlags>{};
+		auto signal_semaphores = std::vector<VkSemaphore>{};
+		m_frame_graph.AppendSubmissionSemaphores(submission, wait_semaphores, wait_stages, signal_semaphores);
+
+		if (is_first_graphics) {
+			if (t_image_available != VK_NULL_HANDLE) {
+				wait_semaphores.emplace_back(t_image_available);
+				wait_stages.emplace_back(VK_PIPELINE_STAGE_TRANSFER_BIT);
+			}
+			m_upload_queue.AppendWaitSemaphores(wait_semaphores, wait_stages);
+		}
+
+		if (is_last && t_render_finished != VK_NULL_HANDLE) {
+			signal_semaphores.emplace_back(t_render_finished);
+		}
+
+		auto submit_info = VkSubmitInfo{};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.waitSemaphoreCount = static_cast<uint32_t>(wait_semaphores.size());
+		submit_info.pWaitSemaphores = wait_semaphores.data();
+		submit_info.pWaitDstStageMask = wait_stages.data();
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &command_buffer;
+		submit_info.signalSemaphoreCount = static_cast<uint32_t>(signal_semaphores.size());
+		submit_info.pSignalSemaphores = signal_semaphores.data();
+
+		auto is_compute = m_frame_graph.GetSubmissionQueue(submission) == QT_COMPUTE;
+		frame_submissions.emplace_back(m_gpu_timeline.Submit(m_logical_device,
+			is_compute ? GQ_COMPUTE : GQ_GRAPHICS,
+			is_compute ? m_compute_queue : m_graphics_queue,
+			submit_info));
+	}
+}
+
+void Renderer::WriteFrameData()
+{
+	// The frame's submissions have been waited on, so its region of the ring is free again
+	m_frame_data_ring.BeginFrame(static_cast<uint32_t>(m_current_frame));
+
+	auto time = IsHeadless() ?
+		static_cast<float>(m_frame_count) * HEADLESS_FRAME_TIME :
+		std::chrono::duration<float>{ std::chrono::steady_clock::now() - m_start_time }.count();
+
+	auto aspect = static_cast<float>(m_swap_chain_extent.width) / static_cast<float>(m_swap_chain_extent.height);
+	auto camera_position = glm::vec3{ 0.0f, 0.0f, 2.0f };
+
+	auto frame = FrameUniforms{};
+	frame.view = glm::lookAt(camera_position, glm::vec3{ 0.0f }, glm::vec3{ 0.0f, 1.0f, 0.0f });
+	frame.projection = glm::perspective(glm::radians(45.0f), aspect, CAMERA_NEAR, CAMERA_FAR);
+	// Vulkan clip space has y pointing down
+	frame.projection[1][1] *= -1.0f;
+	frame.view_projection = frame.projection * frame.view;
+	frame.camera_position = glm::vec4{ camera_position, 1.0f };
+	frame.time = time;
+	frame.delta_time = m_frame_count == 0 ? 0.0f : time - m_last_frame_time;
+	m_last_frame_time = time;
+
+	// Clusters tile the rendered area, which is what gl_FragCoord spans
+	auto viewport = glm::vec2{ static_cast<float>(m_render_extent.width), static_cast<float>(m_render_extent.height) };
+	m_light_clusterer.Build(frame.view, frame.projection, CAMERA_NEAR, CAMERA_FAR, viewport);
+	frame.cluster_count = m_light_clusterer.GetClusterCount();
+	frame.cluster_scale = m_light_clusterer.GetClusterScale();
+
+	m_frame_uniforms_offset = m_frame_data_ring.Push(frame);
+	m_lights_offset = m_frame_data_ring.PushArray(m_light_clusterer.GetLights());
+	m_light_clusters_offset = m_frame_data_ring.PushArray(m_light_clusterer.GetClusters());
+	m_light_indices_offset = m_frame_data_ring.PushArray(m_light_clusterer.GetLightIndices());
+
+	// Only visible objects get a transform, packed in the order they are drawn.
+	// The binding needs a valid offset even when nothing is visible
+	m_frustum_culler.Cull(frame.view_projection, m_visible_objects);
+
+	auto transform_count = std::max<size_t>(m_visible_objects.size(), 1);
+	auto transforms = m_frame_data_ring.Allocate(sizeof(ObjectTransform) * transform_count);
+	auto destination = static_cast<ObjectTransform *>(transforms.data);
+	for (auto object : m_visible_objects) {
+		*destination++ = m_object_transforms[object];
+	}
+	m_object_transforms_offset = transforms.offset;
+
+	Telemetry::Record(TS_COUNTER, "Frustum Culled", m_frustum_culler.GetObjectCount() - m_visible_objects.size());
+
+	SelectLevels(frame);
+
+	ReportTextureCoverage(frame);
+
+	if (m_occlusion_culling) {
+		m_cull_candidates.resize(m_visible_objects.size());
+		for (auto i = size_t{ 0 }; i < m_visible_objects.size(); ++i) {
+			m_cull_candidates[i].sphere = m_frustum_culler.GetSphere(m_visible_objects[i]);
+			m_cull_candidates[i].object = m_visible_objects[i];
+		}
+		auto rendered_area = viewport / glm::vec2{ static_cast<float>(m_swap_chain_extent.width), static_cast<float>(m_swap_chain_extent.height) };
+		m_occlusion_culler.BeginFrame(static_cast<uint32_t>(m_current_frame), frame.view_projection, rendered_area, m_cull_candidates);
+	}
+}
+
+void Renderer::ReportTextureCoverage(FrameUniforms const & t_frame)
+{
+	// A sphere of radius r at distance d spans about r * projection[1][1] / d of
+	// the viewport's half height, so that many render pixels across
+	auto focal_pixels = std::abs(t_frame.projection[1][1]) * static_cast<float>(m_render_extent.height);
+	auto camera_position = glm::vec3{ t_frame.camera_position };
+
+	for (auto object : m_visible_objects) {
+		if (object >= m_object_textures.size() || !m_object_textures[object].has_value()) {
+			continue;
+		}
+
+		auto sphere = m_frustum_culler.GetSphere(object);
+		auto distance = std::max(glm::length(glm::vec3{ sphere } - camera_position), CAMERA_NEAR);
+		m_texture_streamer.ReportCoverage(m_object_textures[object].value(), sphere.w * focal_pixels / distance);
+	}
+}
+
+void Renderer::SelectLevels(FrameUniforms const & t_frame)
+{
+	m_lod_selections.assign(m_visible_objects.size(), LodSelection{});
+
+	// Occlusion culled objects are drawn indirectly from the GPU's lists, always
+	// at their first level
+	if (m_occlusion_culling) {
+		return;
+	}
+
+	m_lod_selector.SetProjection(t_frame.projection, static_cast<float>(m_render_extent.height));
+	auto camera_position = glm::vec3{ t_frame.camera_position };
+
+	for (auto i = size_t{ 0 }; i < m_visible_objects.size(); ++i) {
+		auto object = m_visible_objects[i];
+		if (object >= m_object_levels.size()) {
+			continue;
+		}
+
+		auto sphere = m_frustum_culler.GetSphere(object);
+		auto distance = std::max(glm::length(glm::vec3{ sphere } - camera_position) - sphere.w, 0.0f);
+		m_lod_selections[i] = m_lod_selector.Select(m_object_levels[object], distance);
+	}
+}
+
+void Renderer::RecordDepthPrePass(VkCommandBuffer t_command_buffer) const
+{
+	if (!m_depth_pre_pass) {
+		return;
+	}
+
+	auto clear_depth = VkClearValue{};
+	clear_depth.depthStencil = { 1.0f, 0 };
+
+	auto render_pass_info = VkRenderPassBeginInfo{};
+	render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	render_pass_info.renderPass = m_depth_pre_pass_render_pass;
+	render_pass_info.framebuffer = m_depth_framebuffer;
+	render_pass_info.renderArea.offset = { 0, 0 };
+	render_pass_info.renderArea.extent = m_render_extent;
+	render_pass_info.clearValueCount = 1;
+	render_pass_info.pClearValues = &clear_depth;
+
+	vkCmdBeginRenderPass(t_command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBindPipeline(t_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_depth_pre_pass_pipeline);
+	RecordDraws(t_command_buffer, false);
+	vkCmdEndRenderPass(t_command_buffer);
+}
+
+void Renderer::RecordMainPass(VkCommandBuffer t_command_buffer) const
+{
+	auto clear_values = std::vector<VkClearValue>(2);
+	clear_values[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+	clear_values[1].depthStencil = { 1.0f, 0 };
+
+	auto render_pass_info = VkRenderPassBeginInfo{};
+	render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	render_pass_info.renderPass = m_depth_pre_pass ? m_depth_equal_render_pass : m_render_pass;
+	render_pass_info.framebuffer = m_scene_framebuffer;
+	render_pass_info.renderArea.offset = { 0, 0 };
+	render_pass_info.renderArea.extent = m_render_extent;
+	render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
+	render_pass_info.pClearValues = clear_values.data();
+
+	vkCmdBeginRenderPass(t_command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBindPipeline(t_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_depth_pre_pass ? m_depth_equal_pipeline : m_graphics_pipeline);
+	RecordDraws(t_command_buffer, false);
+	if (m_depth_pre_pass) {
+		RecordFadingDraws(t_command_buffer);
+	}
+	vkCmdEndRenderPass(t_command_buffer);
+}
+
+void Renderer::RecordLateMainPass(VkCommandBuffer t_command_buffer) const
+{
+	auto render_pass_info = VkRenderPassBeginInfo{};
+	render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	render_pass_info.renderPass = m_late_render_pass;
+	render_pass_info.framebuffer = m_scene_framebuffer;
+	render_pass_info.renderArea.offset = { 0, 0 };
+	render_pass_info.renderArea.extent = m_render_extent;
+
+	// Late objects were not in the pre-pass, they test and write depth themselves
+	vkCmdBeginRenderPass(t_command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBindPipeline(t_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphics_pipeline);
+	RecordDraws(t_command_buffer, true);
+	vkCmdEndRenderPass(t_command_buffer);
+}
+
+void Renderer::RecordUpscale(VkCommandBuffer t_command_buffer, FrameGraph const & t_graph) const
+{
+	auto subresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+
+	// Without filtered blits the scene is always rendered at full resolution
+	if (!m_upscale_blit) {
+		auto region = VkImageCopy{};
+		region.srcSubresource = subresource;
+		region.dstSubresource = subresource;
+		region.extent = { m_swap_chain_extent.width, m_swap_chain_extent.height, 1 };
+
+		vkCmdCopyImage(t_command_buffer,
+			t_graph.GetImage(m_scene_color), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			t_graph.GetImage(m_back_buffer), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &region);
+		return;
+	}
+
+	auto region = VkImageBlit{};
+	region.srcSubresource = subresource;
+	region.srcOffsets[1] = { static_cast<int32_t>(m_render_extent.width), static_cast<int32_t>(m_render_extent.height), 1 };
+	region.dstSubresource = subresource;
+	region.dstOffsets[1] = { static_cast<int32_t>(m_swap_chain_extent.width), static_cast<int32_t>(m_swap_chain_extent.height), 1 };
+
+	vkCmdBlitImage(t_command_buffer,
+		t_graph.GetImage(m_scene_color), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		t_graph.GetImage(m_back_buffer), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		1, &region, VK_FILTER_LINEAR);
+}
+
+void Renderer::UpdateRenderExtent()
+{
+	if (!m_dynamic_resolution_enabled) {
+		return;
+	}
+
+	// Timings arrive a few frames late, the controller skips those from before its last change
+	if (m_dynamic_resolution.Update(m_gpu_profiler.GetLastFrameMilliseconds())) {
+		m_render_extent = m_dynamic_resolution.GetExtent(m_swap_chain_extent);
+	}
+
+	Telemetry::Record(TS_COUNTER, "Render Scale", m_dynamic_resolution.GetScale());
+}
+
+void Renderer::RecordDraws(VkCommandBuffer t_command_buffer, bool t_late) const
+{
+	auto viewport = GetViewportConfig(static_cast<float>(m_render_extent.width), static_cast<float>(m_render_extent.height));
+	auto scissor = GetScissorConfig(m_render_extent);
+	vkCmdSetViewport(t_command_buffer, 0, 1, &viewport);
+	vkCmdSetScissor(t_command_buffer, 0, 1, &scissor);
+
+	// Dynamic offsets follow binding order, frame uniforms then object transforms,
+	// as many as the forward variants in use declare
+	auto descriptor_set = m_frame_data_ring.GetDescriptorSet();
+	uint32_t const dynamic_offsets[] = {
+		m_frame_uniforms_offset,
+		m_object_transforms_offset,
+		m_lights_offset,
+		m_light_clusters_offset,
+		m_light_indices_offset };
+	vkCmdBindDescriptorSets(t_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 0, 1, &descriptor_set, m_frame_data_binding_count, dynamic_offsets);
+
+	auto push_constants = DrawPushConstants{};
+
+	if (m_occlusion_culling) {
+		vkCmdPushConstants(t_command_buffer, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push_constants), &push_constants);
+		if (t_late) {
+			m_occlusion_culler.RecordLateDraws(t_command_buffer);
+		}
+		else {
+			m_occlusion_culler.RecordEarlyDraws(t_command_buffer);
+		}
+		return;
+	}
+
+	// The pre-pass has no fragment stage to dither with, so cross-fading objects
+	// are left out of it and of the depth EQUAL test that relies on it
+	for (auto i = uint32_t{ 0 }; i < m_visible_objects.size(); ++i) {
+		if (m_depth_pre_pass && m_lod_selections[i].fade > 0.0f) {
+			continue;
+		}
+		RecordObjectDraws(t_command_buffer, i);
+	}
+}
+
+void Renderer::RecordFadingDraws(VkCommandBuffer t_command_buffer) const
+{
+	// Drawn after the pre-pass objects, testing and writing depth themselves
+	auto bound = false;
+	for (auto i = uint32_t{ 0 }; i < m_lod_selections.size(); ++i) {
+		if (m_lod_selections[i].fade <= 0.0f) {
+			continue;
+		}
+		if (!bound) {
+			vkCmdBindPipeline(t_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphics_pipeline);
+			bound = true;
+		}
+		RecordObjectDraws(t_command_buffer, i);
+	}
+}
+
+void Renderer::RecordObjectDraws(VkCommandBuffer t_command_buffer, uint32_t t_draw) const
+{
+	// Until meshes are loaded every level is the triangle, a level only changes
+	// the index range drawn
+	auto const & selection = m_lod_selections[t_draw];
+
+	auto push_constants = DrawPushConstants{};
+	push_constants.object_index = t_draw;
+	push_constants.lod_fade = selection.fade > 0.0f ? -selection.fade : 0.0f;
+	vkCmdPushConstants(t_command_buffer, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push_constants), &push_constants);
+	vkCmdDraw(t_command_buffer, 3, 1, 0, 0);
+
+	// The next level on top, keeping the pixels the current one dithered away
+	if (selection.fade > 0.0f) {
+		push_constants.lod_fade = selection.fade;
+		vkCmdPushConstants(t_command_buffer, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push_constants), &push_constants);
+		vkCmdDraw(t_command_buffer, 3, 1, 0, 0);
+	}
+}
+
+void Renderer::WriteCapture() const
+{
+	if (m_config.capture_path.empty() || m_captured_frame.empty()) {
+		return;
+	}
+
+	// Binary PPM, alpha is dropped
+	std::ofstream file(m_config.capture_path, std::ios::binary);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open " + m_config.capture_path);
+	}
+
+	file << "P6\n" << m_swap_chain_extent.width << ' ' << m_swap_chain_extent.height << "\n255\n";
+
+	auto row = std::vector<char>(static_cast<size_t>(m_swap_chain_extent.width) * 3);
+	for (uint32_t y = 0; y < m_swap_chain_extent.height; ++y) {
+		auto source = m_captured_frame.data() + static_cast<size_t>(y) * m_swap_chain_extent.width * OFFSCREEN_BYTES_PER_PIXEL;
+		for (uint32_t x = 0; x < m_swap_chain_extent.width; ++x) {
+			row[x * 3 + 0] = static_cast<char>(source[x * OFFSCREEN_BYTES_PER_PIXEL + 0]);
+			row[x * 3 + 1] = static_cast<char>(source[x * OFFSCREEN_BYTES_PER_PIXEL + 1]);
+			row[x * 3 + 2] = static_cast<char>(source[x * OFFSCREEN_BYTES_PER_PIXEL + 2]);
+		}
+		file.write(row.data(), static_cast<std::streamsize>(row.size()));
+	}
+}
+
+bool Renderer::IsHeadless() const noexcept
+{
+	return m_config.output == RO_HEADLESS;
+}
+
 void Renderer::CreateFrameBuffer(VkImageView const & t_image_view)
 {
-	auto attachments = std::vector<VkImageView>{ t_image_view };
+	auto attachments = std::vector<VkImageView>{ t_image_view, m_depth_image_view };
 
 	auto framebuffer_info = VkFramebufferCreateInfo {};
 	framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -583,9 +1794,7 @@ void Renderer::CreateFrameBuffer(VkImageView const & t_image_view)
 	framebuffer_info.height = m_swap_chain_extent.height;
 	framebuffer_info.layers = 1;
 
-	m_swap_chain_framebuffers.emplace_back(VkFramebuffer{});
-
-	auto result = vkCreateFramebuffer(m_logical_device, &framebuffer_info, nullptr, &m_swap_chain_framebuffers.back());
+	auto result = vkCreateFramebuffer(m_logical_device, &framebuffer_info, nullptr, &m_scene_framebuffer);
 
 	if (result != VK_SUCCESS) {
 		CreateFrameBufferErrorHandling(result);
@@ -685,19 +1894,6 @@ void Renderer::CreateRenderPassErrorHandling(VkResult const & t_error)
 	throw std::runtime_error(std::move(error_message));
 }
 
-void Renderer::CreatePipelineLayoutErrorHandling(VkResult const & t_error)
-{
-	auto error_message = std::string{ "Vulkan - Failed to create pipeline layout - " };
-
-	switch (t_error)
-	{
-	case VK_ERROR_OUT_OF_HOST_MEMORY: error_message += "Out of host memory"; break;
-	case VK_ERROR_OUT_OF_DEVICE_MEMORY: error_message += "Out of device memory"; break;
-	default: error_message += "Unidentified error"; break;
-	}
-	throw std::runtime_error(std::move(error_message));
-}
-
 void Renderer::CreatePipelineErrorHandling(VkResult const & t_error)
 {
 	auto error_message = std::string{ "Vulkan - Failed to create graphics pipeline - " };
@@ -764,19 +1960,6 @@ void Renderer::CreateSemaphoreErrorHandling(VkResult const & t_error)
 	throw std::runtime_error(std::move(error_message));
 }
 
-void Renderer::CreateFenceErrorHandling(VkResult const & t_error)
-{
-	auto error_message = std::string{ "Vulkan - Failed to create fence - " };
-
-	switch (t_error)
-	{
-	case VK_ERROR_OUT_OF_HOST_MEMORY: error_message += "Out of host memory"; break;
-	case VK_ERROR_OUT_OF_DEVICE_MEMORY: error_message += "Out of device memory"; break;
-	default: error_message += "Unidentified error"; break;
-	}
-	throw std::runtime_error(std::move(error_message));
-}
-
 void Renderer::CheckValidationLayerSupport()
 {
 	uint32_t layer_count;
@@ -820,11 +2003,11 @@ VkApplicationInfo const Renderer::GetVulkanAppInfoConfig()
 	app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 	app_info.pEngineName = "Supernova Engine";
 	app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	app_info.apiVersion = VK_API_VERSION_1_0;
+	app_info.apiVersion = DeviceCapabilities::GetInstanceApiVersion();
 	return app_info;
 }
 
-std::vector<char const*> const Renderer::GetRequiredInstanceExtensions()
+std::vector<char const*> const Renderer::GetRequiredInstanceExtensions() const
 {
 	auto supported_extensions = std::vector<VkExtensionProperties>{};
 	uint32_t extension_count = 0;
@@ -832,10 +2015,14 @@ std::vector<char const*> const Renderer::GetRequiredInstanceExtensions()
 	supported_extensions.resize(extension_count);
 	vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, supported_extensions.data());
 
-	auto required_extension_count = uint32_t{ 0 };
-	auto required_extensions_ptr = glfwGetRequiredInstanceExtensions(&required_extension_count);
+	auto required_extencions = std::vector<char const*>{};
 
-	auto required_extencions = std::vector(required_extensions_ptr, required_extensions_ptr + required_extension_count);
+	// Without a surface nothing has to be asked of the window system
+	if (!IsHeadless()) {
+		auto required_extension_count = uint32_t{ 0 };
+		auto required_extensions_ptr = glfwGetRequiredInstanceExtensions(&required_extension_count);
+		required_extencions.assign(required_extensions_ptr, required_extensions_ptr + required_extension_count);
+	}
 
 	CheckRequiredInstanceExtensionsSupport(required_extencions, supported_extensions);
 
@@ -892,51 +2079,64 @@ int Renderer::RatePhysicalDevice(VkPhysicalDevice const & t_device) const
 	auto score = 0;
 
 	auto device_properties = VkPhysicalDeviceProperties{};
-	auto device_features = VkPhysicalDeviceFeatures{};
 
 	vkGetPhysicalDeviceProperties(t_device, &device_properties);
-	vkGetPhysicalDeviceFeatures(t_device, &device_features);
 
-	if (!CheckRequiredPhysicalDeviceExtensionSupport(t_device)){
+	if (!CheckRequiredPhysicalDeviceExtensionSupport(t_device, GetRequiredDeviceExtensions())){
 		return 0;
 	}
 
 	auto supported_queue_families = FindQueueFamilies(t_device, m_surface);
-	if (!supported_queue_families.SupportsAllRequiredFamilies()) {
+	if (!supported_queue_families.SupportsGraphicsFamily()) {
 		return 0;
 	}
 
-	auto swap_chain_support = QuerySwapChainSupport(t_device);
-	if (swap_chain_support.formats.empty() || swap_chain_support.presentModes.empty()) {
-		return 0;
-	}
-	else
-	{
-		// TODO should rate each color format and color space
+	// Headless runs never present, software implementations without a surface qualify
+	if (!IsHeadless()) {
+		if (!supported_queue_families.SupportsPresentationFamily()) {
+			return 0;
+		}
 
-		if (swap_chain_support.presentModes.end() !=
-			std::find(swap_chain_support.presentModes.begin(),
-				swap_chain_support.presentModes.end(),
-				VK_PRESENT_MODE_MAILBOX_KHR)) {
-			score += 1000;
+		auto swap_chain_support = QuerySwapChainSupport(t_device);
+		if (swap_chain_support.formats.empty() || swap_chain_support.presentModes.empty()) {
+			return 0;
 		}
+		else
+		{
+			// TODO should rate each color format and color space
 
-	}
+			if (swap_chain_support.presentModes.end() !=
+				std::find(swap_chain_support.presentModes.begin(),
+					swap_chain_support.presentModes.end(),
+					VK_PRESENT_MODE_MAILBOX_KHR)) {
+				score += 1000;
+			}
 
-	if (!device_features.geometryShader) {
-		return 0;
+		}
 	}
 
 	if (device_properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
 		score += 1000;
 	}
 
+	auto capabilities = DeviceCapabilities{};
+	capabilities.Query(t_device, DeviceCapabilities::GetInstanceApiVersion());
+	score += capabilities.GetScore();
+
 	score += device_properties.limits.maxImageDimension2D;
 
 	return score;
 }
 
-bool Renderer::CheckRequiredPhysicalDeviceExtensionSupport(VkPhysicalDevice const & t_device)
+std::vector<char const*> Renderer::GetRequiredDeviceExtensions() const
+{
+	if (IsHeadless()) {
+		return {};
+	}
+	return presentation_device_extensions;
+}
+
+bool Renderer::CheckRequiredPhysicalDeviceExtensionSupport(VkPhysicalDevice const & t_device, std::vector<char const*> const & t_device_extensions)
 {
 	uint32_t extension_count;
 	vkEnumerateDeviceExtensionProperties(t_device, nullptr, &extension_count, nullptr);
@@ -944,7 +2144,7 @@ bool Renderer::CheckRequiredPhysicalDeviceExtensionSupport(VkPhysicalDevice cons
 	std::vector<VkExtensionProperties> available_extensions(extension_count);
 	vkEnumerateDeviceExtensionProperties(t_device, nullptr, &extension_count, available_extensions.data());
 
-	std::set<std::string> required_extensions(device_extensions.begin(), device_extensions.end());
+	std::set<std::string> required_extensions(t_device_extensions.begin(), t_device_extensions.end());
 
 	for (const auto& extension : available_extensions) {
 		required_extensions.erase(extension.extensionName);
@@ -963,21 +2163,35 @@ Renderer::QueueFamilyIndices Renderer::FindQueueFamilies(VkPhysicalDevice const
 	auto queue_families = std::vector<VkQueueFamilyProperties> (queue_family_count);
 	vkGetPhysicalDeviceQueueFamilyProperties(t_physical_device, &queue_family_count, queue_families.data());
 
-	int i = 0;
+	uint32_t i = 0;
 	for (const auto& queue_family : queue_families) {
-		if (queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+		auto const graphics = (queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+		auto const compute = (queue_family.queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+		auto const transfer = (queue_family.queueFlags & VK_QUEUE_TRANSFER_BIT) != 0;
+
+		if (graphics && !indices.SupportsGraphicsFamily()) {
 			indices.graphics_family = i;
 		}
 
-		VkBool32 presentation_support = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(t_physical_device, i, t_surface, &presentation_support);
+		// Headless rendering has no surface to present to
+		if (t_surface != VK_NULL_HANDLE) {
+			VkBool32 presentation_support = false;
+			vkGetPhysicalDeviceSurfaceSupportKHR(t_physical_device, i, t_surface, &presentation_support);
 
-		if (presentation_support) {
-			indices.presentation_family = i;
+			// Presenting from the graphics family saves a queue ownership transfer
+			if (presentation_support && (!indices.SupportsPresentationFamily() || indices.graphics_family == i)) {
+				indices.presentation_family = i;
+			}
 		}
 
-		if (indices.SupportsAllRequiredFamilies()) {
-			break;
+		// Dedicated families are the ones that run alongside the graphics queue,
+		// a transfer only family is usually a DMA engine
+		if (compute && !graphics && !indices.compute_family.has_value()) {
+			indices.compute_family = i;
+		}
+
+		if (transfer && !graphics && !compute && !indices.transfer_family.has_value()) {
+			indices.transfer_family = i;
 		}
 
 		i++;
@@ -992,7 +2206,8 @@ VkDeviceQueueCreateInfo Renderer::GetDeviceQueueConfig(uint32_t t_queue_family)
 	queue_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 	queue_create_info.queueFamilyIndex = t_queue_family;
 	queue_create_info.queueCount = 1;
-	auto queue_priority = 1.0f;
+	// Read by vkCreateDevice after this returns
+	static auto const queue_priority = 1.0f;
 	queue_create_info.pQueuePriorities = &queue_priority;
 	return queue_create_info;
 }
@@ -1034,17 +2249,50 @@ VkSurfaceFormatKHR Renderer::GetSwapSurfaceFormat(std::vector<VkSurfaceFormatKHR
 	return t_available_formats[0];
 }
 
-VkPresentModeKHR Renderer::GetSwapPresentationMode(const std::vector<VkPresentModeKHR>& t_available_present_modes)
+VkPresentModeKHR Renderer::GetSwapPresentationMode(const std::vector<VkPresentModeKHR>& t_available_present_modes, PRESENT_POLICY t_policy)
 {
-	for (const auto& available_present_mode : t_available_present_modes) {
-		if (available_present_mode == VK_PRESENT_MODE_MAILBOX_KHR) {
-			return available_present_mode;
+	// FIFO is the only mode every implementation has to support
+	auto preferred = std::vector<VkPresentModeKHR>{};
+	switch (t_policy) {
+	case PP_LOW_LATENCY:
+		preferred = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+		break;
+	case PP_POWER_SAVING:
+	case PP_STRICT_VSYNC:
+		break;
+	}
+
+	for (auto const & mode : preferred) {
+		if (std::find(t_available_present_modes.begin(), t_available_present_modes.end(), mode) != t_available_present_modes.end()) {
+			return mode;
 		}
 	}
 
 	return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+uint32_t Renderer::GetSwapImageCount(VkSurfaceCapabilitiesKHR const & t_capabilities, VkPresentModeKHR t_mode, PRESENT_POLICY t_policy)
+{
+	// Mailbox needs a spare image to replace queued frames with, strict vsync
+	// wants one so a frame can be rendered while another waits for the blank
+	auto extra_images = uint32_t{ 0 };
+	if (t_mode == VK_PRESENT_MODE_MAILBOX_KHR || t_policy == PP_STRICT_VSYNC) {
+		extra_images = 1;
+	}
+
+	auto image_count = t_capabilities.minImageCount + extra_images;
+	if (t_capabilities.maxImageCount > 0 && image_count > t_capabilities.maxImageCount) {
+		image_count = t_capabilities.maxImageCount;
+	}
+
+	return image_count;
+}
+
+uint32_t Renderer::GetFrameLatency(PRESENT_POLICY t_policy) noexcept
+{
+	return t_policy == PP_STRICT_VSYNC ? MAX_FRAMES_IN_FLIGHT : 1;
+}
+
 VkExtent2D Renderer::GetSwapExtent(VkSurfaceCapabilitiesKHR const & t_capabilities) const
 {
 	if (t_capabilities.currentExtent.width != UINT32_MAX) {
@@ -1069,8 +2317,9 @@ VkAttachmentDescription Renderer::GetColorAttachmentConfig(VkFormat const & t_fo
 	color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	// Layout transitions in and out of the pass are issued by the frame graph
+	color_attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	color_attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 	return color_attachment;
 }
 
@@ -1082,35 +2331,72 @@ VkAttachmentReference Renderer::GetColorAttachmentReferenceConfig()
 	return color_attachment_ref;
 }
 
-VkSubpassDescription Renderer::GetSubpassConfig(std::vector<VkAttachmentReference> const & t_color_attachment_refs)
+VkAttachmentDescription Renderer::GetDepthAttachmentConfig(VkFormat const & t_format, VkAttachmentLoadOp t_load_op)
+{
+	auto depth_attachment = VkAttachmentDescription{};
+	depth_attachment.format = t_format;
+	depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	depth_attachment.loadOp = t_load_op;
+	depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	// Layout transitions in and out of the pass are issued by the frame graph
+	depth_attachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	return depth_attachment;
+}
+
+VkAttachmentReference Renderer::GetDepthAttachmentReferenceConfig(uint32_t t_attachment)
+{
+	auto depth_attachment_ref = VkAttachmentReference{};
+	depth_attachment_ref.attachment = t_attachment;
+	depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	return depth_attachment_ref;
+}
+
+VkSubpassDescription Renderer::GetSubpassConfig(std::vector<VkAttachmentReference> const & t_color_attachment_refs, VkAttachmentReference const * t_depth_attachment_ref)
 {
 	auto subpass = VkSubpassDescription{};
 	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 	subpass.colorAttachmentCount = static_cast<uint32_t>(t_color_attachment_refs.size());
 	subpass.pColorAttachments = t_color_attachment_refs.data();
+	subpass.pDepthStencilAttachment = t_depth_attachment_ref;
 	return subpass;
 }
 
-VkSubpassDependency Renderer::GetSubpassDependencyConfig()
+VkFormat Renderer::FindDepthFormat(VkPhysicalDevice const & t_physical_device)
 {
-	auto dependency = VkSubpassDependency{};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	return dependency;
+	// Pure depth formats first, nothing uses stencil yet
+	auto const candidates = std::vector<VkFormat>{
+		VK_FORMAT_D32_SFLOAT,
+		VK_FORMAT_D32_SFLOAT_S8_UINT,
+		VK_FORMAT_D24_UNORM_S8_UINT,
+		VK_FORMAT_D16_UNORM
+	};
+
+	for (auto format : candidates) {
+		auto properties = VkFormatProperties{};
+		vkGetPhysicalDeviceFormatProperties(t_physical_device, format, &properties);
+
+		if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+			return format;
+		}
+	}
+
+	throw std::runtime_error("Vulkan - Failed to find a supported depth format!");
 }
 
-VkShaderModule Renderer::CreateShaderModule(std::string const & file) const
+bool Renderer::HasStencilComponent(VkFormat t_format) noexcept
 {
-	std::vector<char> code = ReadShaderFile(file);
+	return t_format == VK_FORMAT_D32_SFLOAT_S8_UINT || t_format == VK_FORMAT_D24_UNORM_S8_UINT;
+}
 
+VkShaderModule Renderer::CreateShaderModule(SpirvView t_code) const
+{
 	auto create_info = VkShaderModuleCreateInfo{};
 	create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	create_info.codeSize = code.size();
-	create_info.pCode = reinterpret_cast<const uint32_t*>(code.data());
+	create_info.codeSize = t_code.size() * sizeof(uint32_t);
+	create_info.pCode = t_code.data();
 
 	VkShaderModule shader_module;
 	auto result = vkCreateShaderModule(m_logical_device, &create_info, nullptr, &shader_module);
@@ -1142,14 +2428,26 @@ VkPipelineShaderStageCreateInfo Renderer::GetFragmentShaderPipelineStageConfig(V
 	return fragment_shader_stage_info;
 }
 
-VkPipelineVertexInputStateCreateInfo Renderer::GetPipelineVertexInputConfig()
+PipelineLayoutCache::PipelineLayout const & Renderer::GetForwardPipelineLayout()
+{
+	// One layout for every material, so switching variants never rebinds set 0
+	auto stages = std::vector<ReflectedShader const *>{};
+	for (auto const & reflection : m_forward_reflections) {
+		stages.emplace_back(&reflection);
+	}
+	return m_layout_cache.GetPipelineLayout(m_logical_device, stages, FRAME_DATA_DYNAMIC_SETS);
+}
+
+VkPipelineVertexInputStateCreateInfo Renderer::GetPipelineVertexInputConfig(
+	std::vector<VkVertexInputBindingDescription> const & t_bindings,
+	std::vector<VkVertexInputAttributeDescription> const & t_attributes)
 {
 	auto vertex_input_info = VkPipelineVertexInputStateCreateInfo{};
 	vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertex_input_info.vertexBindingDescriptionCount = 0;
-	vertex_input_info.pVertexBindingDescriptions = nullptr;
-	vertex_input_info.vertexAttributeDescriptionCount = 0;
-	vertex_input_info.pVertexAttributeDescriptions = nullptr;
+	vertex_input_info.vertexBindingDescriptionCount = static_cast<uint32_t>(t_bindings.size());
+	vertex_input_info.pVertexBindingDescriptions = t_bindings.data();
+	vertex_input_info.vertexAttributeDescriptionCount = static_cast<uint32_t>(t_attributes.size());
+	vertex_input_info.pVertexAttributeDescriptions = t_attributes.data();
 	return vertex_input_info;
 }
 
@@ -1237,6 +2535,18 @@ VkPipelineColorBlendAttachmentState Renderer::GetColorBlendAttachmentConfig()
 	return color_blend_attachment;
 }
 
+VkPipelineDepthStencilStateCreateInfo Renderer::GetDepthStencilConfig(VkCompareOp t_compare_op, bool t_write)
+{
+	auto depth_stencil = VkPipelineDepthStencilStateCreateInfo{};
+	depth_stencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depth_stencil.depthTestEnable = VK_TRUE;
+	depth_stencil.depthWriteEnable = t_write ? VK_TRUE : VK_FALSE;
+	depth_stencil.depthCompareOp = t_compare_op;
+	depth_stencil.depthBoundsTestEnable = VK_FALSE;
+	depth_stencil.stencilTestEnable = VK_FALSE;
+	return depth_stencil;
+}
+
 VkPipelineColorBlendStateCreateInfo Renderer::GetColorBlendConfig(VkPipelineColorBlendAttachmentState const & t_color_blend_attachment)
 {
 	auto color_blending = VkPipelineColorBlendStateCreateInfo{};
@@ -1261,17 +2571,6 @@ VkPipelineDynamicStateCreateInfo Renderer::GetDynamicStateCongif(std::vector<VkD
 	return dynamic_state;
 }
 
-VkPipelineLayoutCreateInfo Renderer::GetPipelineLayoutConfig()
-{
-	auto pipeline_layout_info = VkPipelineLayoutCreateInfo{};
-	pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipeline_layout_info.setLayoutCount = 0;
-	pipeline_layout_info.pSetLayouts = nullptr;
-	pipeline_layout_info.pushConstantRangeCount = 0;
-	pipeline_layout_info.pPushConstantRanges = nullptr;
-	return pipeline_layout_info;
-}
-
 VKAPI_ATTR VkBool32 VKAPI_CALL Renderer::debugCallback(
 	VkDebugUtilsMessageSeverityFlagBitsEXT t_message_severity,
 	VkDebugUtilsMessageTypeFlagsEXT t_message_type,
@@ -1330,22 +2629,3 @@ void Renderer::DestroyDebugUtilsMessengerEXT(
 		func(t_instance, t_debug_messenger, allocator);
 	}
 }
-
-std::vector<char> Renderer::ReadShaderFile(std::string const & filename)
-{
-	std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-	if (!file.is_open()) {
-		throw std::runtime_error("Failed to open file!");
-	}
-
-	size_t file_size = static_cast<size_t>(file.tellg());
-	std::vector<char> buffer(file_size);
-
-	file.seekg(0);
-	file.read(buffer.data(), file_size);
-
-	file.close();
-
-	return buffer;
-}
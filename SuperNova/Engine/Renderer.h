@@ -2,14 +2,80 @@
 #define RENDERER
 
 #include "Module.h"
+#include "FrameGraph.h"
+#include "GpuProfiler.h"
+#include "GpuTimeline.h"
+#include "ReadbackRing.h"
+#include "DeviceCapabilities.h"
+#include "DynamicBufferRing.h"
+#include "DynamicResolution.h"
+#include "FrustumCuller.h"
+#include "LightClusterer.h"
+#include "MeshLod.h"
+#include "OcclusionCuller.h"
+#include "PipelineLayoutCache.h"
+#include "ShaderCompiler.h"
+#include "ShaderInterface.h"
+#include "ShaderReflection.h"
+#include "ShaderVariantDatabase.h"
+#include "TextureStreamer.h"
+#include "UploadQueue.h"
 #include "vulkan/vulkan.hpp"
 
 struct GLFWwindow;
 
+enum RENDER_OUTPUT
+{
+	RO_WINDOW = 0,
+	RO_HEADLESS
+};
+
+// Low latency presents as soon as a frame is done, tearing if it has to. Power
+// saving double buffers on vsync so the CPU and GPU idle between frames. Strict
+// vsync triple buffers and keeps every frame in flight for the steadiest pacing.
+enum PRESENT_POLICY
+{
+	PP_LOW_LATENCY = 0,
+	PP_POWER_SAVING,
+	PP_STRICT_VSYNC
+};
+
+// Index of each of the renderer's shaders in its compiled shader code
+enum RENDERER_SHADER
+{
+	RS_VERTEX = 0,
+	RS_FRAGMENT,
+	RS_HIZ_DOWNSAMPLE,
+	RS_OCCLUSION_CULL,
+	RS_COUNT
+};
+
+// Headless renders into an offscreen image with no window or surface, so it also
+// runs on software implementations such as lavapipe. A frame limit of 0 runs until
+// the window is closed.
+struct RendererConfig {
+	RENDER_OUTPUT output{ RO_WINDOW };
+	uint32_t width{ 800 };
+	uint32_t height{ 600 };
+	uint64_t frame_limit{ 0 };
+	std::string capture_path{};
+	bool depth_pre_pass{ false };
+	// GPU frame time dynamic resolution holds, 0 renders at full resolution
+	double target_frame_milliseconds{ 0.0 };
+	PRESENT_POLICY present_policy{ PP_STRICT_VSYNC };
+	// Device memory streamed textures may use, 0 takes a share of the device's budget
+	uint64_t texture_budget_mib{ 0 };
+	// Pass recipe run over freshly compiled SPIR-V
+	SHADER_OPTIMIZATION shader_optimization{ SO_PERFORMANCE };
+	// Index into the cooked material list, ignored without a variant database
+	uint32_t material{ 0 };
+};
+
 class Renderer : public Module
 {
 public:
 	explicit Renderer();
+	explicit Renderer(RendererConfig const &);
 	Renderer(Renderer const &) = delete;
 	Renderer(Renderer &&) noexcept = default;
 	Renderer & operator = (Renderer const &) = delete;
@@ -22,6 +88,23 @@ public:
 	void PostUpdate() final;
 	void CleanUp() noexcept final;
 
+	// Takes effect from the next recorded frame, no pipelines are rebuilt
+	void SetDepthPrePass(bool) noexcept;
+	[[nodiscard]] bool IsDepthPrePassEnabled() const noexcept;
+
+	[[nodiscard]] LightClusterer::LightIndex AddPointLight(PointLight const &);
+	void UpdatePointLight(LightClusterer::LightIndex, PointLight const &);
+	void ClearPointLights() noexcept;
+
+	// Only the texture's mip tail is resident until objects using it cover enough
+	// of the screen
+	[[nodiscard]] TextureStreamer::TextureHandle LoadTexture(std::string const &);
+	void SetObjectTexture(FrustumCuller::ObjectIndex, TextureStreamer::TextureHandle);
+
+	// Levels of the object's LOD chain, as MeshSimplifier builds them. Objects
+	// without a chain draw at their only level and never cross-fade
+	void SetObjectLevels(FrustumCuller::ObjectIndex, std::vector<MeshLevel> const &);
+
 private:
 	struct QueueFamilyIndices;
 	struct SwapChainSupportDetails;
@@ -37,15 +120,43 @@ private:
 	void PickPhysicalDevice();
 	void CreateLogicalDevice();
 	void CreateSwapChain();
-	void CreateImageViews();
+	void CreateOffscreenTarget();
+	void CreateSceneTarget();
+	void CreateDepthResources();
 	void CreateRenderPass();
+	void CompileShaders();
+	[[nodiscard]] bool LoadMaterialVariants();
+	void CreateFrameDataRing();
+	void CreateOcclusionCuller();
 	void CreateGraphicsPipeline();
 	void CreateFrameBuffers();
+	void BuildFrameGraph();
 	void CreateCommandPool();
 	void CreateCommandBuffers();
 	void CreateSyncObjects();
+	void CreateGpuProfiler();
+	void CreateReadbackRing();
+	void CreateUploadQueue();
+	void CreateTextureStreamer();
 
+	void ThrottleFrameStart();
+	void WaitForFrame(size_t);
 	void DrawFrame();
+	void DrawOffscreenFrame();
+	void RecordAndSubmitFrame(uint32_t, VkSemaphore, VkSemaphore);
+	void WriteFrameData();
+	void ReportTextureCoverage(FrameUniforms const &);
+	void SelectLevels(FrameUniforms const &);
+	void RecordDepthPrePass(VkCommandBuffer) const;
+	void RecordMainPass(VkCommandBuffer) const;
+	void RecordLateMainPass(VkCommandBuffer) const;
+	void RecordUpscale(VkCommandBuffer, FrameGraph const &) const;
+	void UpdateRenderExtent();
+	void RecordDraws(VkCommandBuffer, bool) const;
+	void RecordFadingDraws(VkCommandBuffer) const;
+	void RecordObjectDraws(VkCommandBuffer, uint32_t) const;
+	void WriteCapture() const;
+	[[nodiscard]] bool IsHeadless() const noexcept;
 
 	[[noreturn]] static void CreateInstanceErrorHandling(VkResult const &);
 	[[noreturn]] static void CreateLogicalDeviceErrorHandling(VkResult const &);
@@ -53,18 +164,16 @@ private:
 	[[noreturn]] static void CreateImageViewsErrorHandling(VkResult const &);
 	[[noreturn]] static void CreateShaderModuleErrorHandling(VkResult const &);
 	[[noreturn]] static void CreateRenderPassErrorHandling(VkResult const &);
-	[[noreturn]] static void CreatePipelineLayoutErrorHandling(VkResult const &);
 	[[noreturn]] static void CreatePipelineErrorHandling(VkResult const &);
 	[[noreturn]] static void CreateFrameBufferErrorHandling(VkResult const &);
 	[[noreturn]] static void CreateCommandPoolErrorHandling(VkResult const &);
 	[[noreturn]] static void CreateCommandBuffersErrorHandling(VkResult const &);
 	[[noreturn]] static void CreateSemaphoreErrorHandling(VkResult const &);
-	[[noreturn]] static void CreateFenceErrorHandling(VkResult const &);
 
 	// Instance
 	static void CheckValidationLayerSupport();
 	[[nodiscard]] static VkApplicationInfo const GetVulkanAppInfoConfig();
-	[[nodiscard]] static std::vector<char const*> const GetRequiredInstanceExtensions();
+	[[nodiscard]] std::vector<char const*> const GetRequiredInstanceExtensions() const;
 	static void CheckRequiredInstanceExtensionsSupport(std::vector<char const*> const &, std::vector<VkExtensionProperties> const &);
 
 	// Debug Messenger
@@ -72,7 +181,8 @@ private:
 
 	// Physical Device
 	[[nodiscard]] int RatePhysicalDevice(VkPhysicalDevice const &) const;
-	[[nodiscard]] static bool CheckRequiredPhysicalDeviceExtensionSupport(VkPhysicalDevice const &);
+	[[nodiscard]] std::vector<char const*> GetRequiredDeviceExtensions() const;
+	[[nodiscard]] static bool CheckRequiredPhysicalDeviceExtensionSupport(VkPhysicalDevice const &, std::vector<char const*> const &);
 
 	// Logical Device
 	[[nodiscard]] static QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice const &, VkSurfaceKHR const &);
@@ -81,20 +191,28 @@ private:
 	// Swap Chain
 	[[nodiscard]] SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice const &) const;
 	[[nodiscard]] static VkSurfaceFormatKHR GetSwapSurfaceFormat(std::vector<VkSurfaceFormatKHR> const &);
-	[[nodiscard]] static VkPresentModeKHR GetSwapPresentationMode(std::vector<VkPresentModeKHR> const &);
+	[[nodiscard]] static VkPresentModeKHR GetSwapPresentationMode(std::vector<VkPresentModeKHR> const &, PRESENT_POLICY);
+	[[nodiscard]] static uint32_t GetSwapImageCount(VkSurfaceCapabilitiesKHR const &, VkPresentModeKHR, PRESENT_POLICY);
+	[[nodiscard]] static uint32_t GetFrameLatency(PRESENT_POLICY) noexcept;
 	[[nodiscard]] VkExtent2D GetSwapExtent(VkSurfaceCapabilitiesKHR const &) const;
 
 	// Render Pass
 	[[nodiscard]] static VkAttachmentDescription GetColorAttachmentConfig(VkFormat const &);
 	[[nodiscard]] static VkAttachmentReference GetColorAttachmentReferenceConfig();
-	[[nodiscard]] static VkSubpassDescription GetSubpassConfig(std::vector<VkAttachmentReference> const &);
-	[[nodiscard]] static VkSubpassDependency GetSubpassDependencyConfig();
+	[[nodiscard]] static VkAttachmentDescription GetDepthAttachmentConfig(VkFormat const &, VkAttachmentLoadOp);
+	[[nodiscard]] static VkAttachmentReference GetDepthAttachmentReferenceConfig(uint32_t);
+	[[nodiscard]] static VkSubpassDescription GetSubpassConfig(std::vector<VkAttachmentReference> const &, VkAttachmentReference const *);
+
+	// Depth
+	[[nodiscard]] static VkFormat FindDepthFormat(VkPhysicalDevice const &);
+	[[nodiscard]] static bool HasStencilComponent(VkFormat) noexcept;
 
 	// Graphics Pipeline
-	[[nodiscard]] VkShaderModule CreateShaderModule(std::string const &) const;
+	[[nodiscard]] VkShaderModule CreateShaderModule(SpirvView) const;
 	[[nodiscard]] static VkPipelineShaderStageCreateInfo GetVertexShaderPipelineStageConfig(VkShaderModule const &);
 	[[nodiscard]] static VkPipelineShaderStageCreateInfo GetFragmentShaderPipelineStageConfig(VkShaderModule const &);
-	[[nodiscard]] static VkPipelineVertexInputStateCreateInfo GetPipelineVertexInputConfig();
+	[[nodiscard]] PipelineLayoutCache::PipelineLayout const & GetForwardPipelineLayout();
+	[[nodiscard]] static VkPipelineVertexInputStateCreateInfo GetPipelineVertexInputConfig(std::vector<VkVertexInputBindingDescription> const &, std::vector<VkVertexInputAttributeDescription> const &);
 	[[nodiscard]] static VkPipelineInputAssemblyStateCreateInfo GetPipelineInputAssemblyConfig();
 	[[nodiscard]] static VkViewport GetViewportConfig(float, float);
 	[[nodiscard]] static VkRect2D GetScissorConfig(VkExtent2D const &);
@@ -103,8 +221,8 @@ private:
 	[[nodiscard]] static VkPipelineMultisampleStateCreateInfo GetMultisamplingConfig();
 	[[nodiscard]] static VkPipelineColorBlendAttachmentState GetColorBlendAttachmentConfig();
 	[[nodiscard]] static VkPipelineColorBlendStateCreateInfo GetColorBlendConfig(VkPipelineColorBlendAttachmentState const &);
+	[[nodiscard]] static VkPipelineDepthStencilStateCreateInfo GetDepthStencilConfig(VkCompareOp, bool);
 	[[nodiscard]] static VkPipelineDynamicStateCreateInfo GetDynamicStateCongif(std::vector<VkDynamicState> const &);
-	[[nodiscard]] static VkPipelineLayoutCreateInfo GetPipelineLayoutConfig();
 
 	// Frame buffers
 	void CreateFrameBuffer(VkImageView const &);
@@ -126,9 +244,8 @@ private:
 		VkDebugUtilsMessengerEXT,
 		const VkAllocationCallbacks*);
 
-	static std::vector<char> ReadShaderFile(std::string const & filename);
-
 private:
+	RendererConfig m_config{};
 	GLFWwindow* m_window{ nullptr };
 	uint32_t const m_window_width{};
 	uint32_t const m_window_height{};
@@ -136,29 +253,109 @@ private:
 	VkSurfaceKHR m_surface{};
 	VkDebugUtilsMessengerEXT m_debug_messenger{};
 	VkPhysicalDevice m_physical_device = VK_NULL_HANDLE;
+	DeviceCapabilities m_device_capabilities{};
 	VkDevice m_logical_device{};
 	VkQueue m_graphics_queue{};
 	VkQueue m_presentation_queue{};
+	VkQueue m_compute_queue{};
+	VkQueue m_transfer_queue{};
 	VkSwapchainKHR m_swap_chain{};
 	std::vector<VkImage> m_swap_chain_images{};
 	VkFormat m_swap_chain_image_format{};
 	VkExtent2D m_swap_chain_extent{};
-	std::vector<VkImageView> m_swap_chain_image_views{};
+	// Frames the CPU may have submitted and not yet seen finish when a new one starts
+	uint32_t m_frame_latency{ 1 };
+	std::chrono::steady_clock::time_point m_input_sample_time{};
 	VkRenderPass m_render_pass{};
+	// Owned by m_layout_cache
 	VkPipelineLayout m_pipeline_layout{};
 	VkPipeline m_graphics_pipeline{};
-	std::vector<VkFramebuffer> m_swap_chain_framebuffers{};
+	VkFramebuffer m_scene_framebuffer{ VK_NULL_HANDLE };
+	VkImage m_scene_color_image{ VK_NULL_HANDLE };
+	VkDeviceMemory m_scene_color_memory{ VK_NULL_HANDLE };
+	VkImageView m_scene_color_view{ VK_NULL_HANDLE };
+	VkExtent2D m_render_extent{};
+	DynamicResolution m_dynamic_resolution{};
+	bool m_dynamic_resolution_enabled{ false };
+	bool m_upscale_blit{ false };
+	VkFormat m_depth_format{ VK_FORMAT_UNDEFINED };
+	VkImage m_depth_image{ VK_NULL_HANDLE };
+	VkDeviceMemory m_depth_memory{ VK_NULL_HANDLE };
+	VkImageView m_depth_image_view{ VK_NULL_HANDLE };
+	VkImageView m_depth_sampled_view{ VK_NULL_HANDLE };
+	VkRenderPass m_late_render_pass{ VK_NULL_HANDLE };
+	VkRenderPass m_depth_pre_pass_render_pass{ VK_NULL_HANDLE };
+	VkRenderPass m_depth_equal_render_pass{ VK_NULL_HANDLE };
+	VkPipeline m_depth_pre_pass_pipeline{ VK_NULL_HANDLE };
+	VkPipeline m_depth_equal_pipeline{ VK_NULL_HANDLE };
+	VkFramebuffer m_depth_framebuffer{ VK_NULL_HANDLE };
+	bool m_depth_pre_pass{ false };
+	bool m_depth_pre_pass_key_down{ false };
+	VkDeviceMemory m_offscreen_memory{ VK_NULL_HANDLE };
+	ReadbackRing m_readback_ring{};
+	std::vector<uint8_t> m_captured_frame{};
+	uint64_t m_frame_count{ 0 };
+	FrameGraph m_frame_graph{};
+	FrameGraph::ResourceHandle m_back_buffer{};
+	FrameGraph::ResourceHandle m_scene_color{};
+	FrameGraph::ResourceHandle m_depth_buffer{};
+	FrameGraph::ResourceHandle m_hiz_pyramid{};
+	GpuProfiler m_gpu_profiler{};
+	UploadQueue m_upload_queue{};
+	ShaderCompiler m_shader_compiler{};
+	// Modules compiled at start up, cooked ones stay in the variant pack
+	std::vector<std::vector<uint32_t>> m_compiled_shaders{};
+	// SPIR-V of every RENDERER_SHADER, in enum order, viewing one of the above
+	std::vector<SpirvView> m_shader_code{};
+	// Reflected from m_shader_code, same order
+	std::vector<ReflectedShader> m_shader_reflections{};
+	ShaderVariantDatabase m_shader_variants{};
+	uint32_t m_material_features{ MATERIAL_ALL_FEATURES };
+	// Every forward variant the content can draw with, the forward layout covers them all
+	std::vector<ReflectedShader> m_forward_reflections{};
+	PipelineLayoutCache m_layout_cache{};
+	TextureStreamer m_texture_streamer{};
+	std::vector<std::optional<TextureStreamer::TextureHandle>> m_object_textures{};
+	DynamicBufferRing m_frame_data_ring{};
+	uint32_t m_frame_uniforms_offset{ 0 };
+	uint32_t m_object_transforms_offset{ 0 };
+	// Dynamic offsets each draw binds, one per binding of the ring's set
+	uint32_t m_frame_data_binding_count{ 0 };
+	std::chrono::steady_clock::time_point m_start_time{};
+	float m_last_frame_time{ 0.0f };
+	FrustumCuller m_frustum_culler{};
+	std::vector<ObjectTransform> m_object_transforms{};
+	std::vector<FrustumCuller::ObjectIndex> m_visible_objects{};
+	LodSelector m_lod_selector{};
+	std::vector<std::vector<MeshLevel>> m_object_levels{};
+	// The level each visible object draws at, in m_visible_objects order
+	std::vector<LodSelection> m_lod_selections{};
+	LightClusterer m_light_clusterer{};
+	uint32_t m_lights_offset{ 0 };
+	uint32_t m_light_clusters_offset{ 0 };
+	uint32_t m_light_indices_offset{ 0 };
+	OcclusionCuller m_occlusion_culler{};
+	std::vector<CullCandidate> m_cull_candidates{};
+	bool m_occlusion_culling{ false };
+	uint32_t m_image_index{ 0 };
 	VkCommandPool m_command_pool{};
+	VkCommandPool m_compute_command_pool{ VK_NULL_HANDLE };
 	std::vector<VkCommandBuffer> m_command_buffers{};
 	std::vector<VkSemaphore> m_image_available_semaphores{};
 	std::vector<VkSemaphore> m_render_finished_semaphores{};
-	std::vector<VkFence> m_in_flight_fences{};
+	GpuTimeline m_gpu_timeline{};
+	// Every submission of the frame last recorded in each frame slot
+	std::vector<std::vector<GpuTimeline::Point>> m_frame_submissions{};
 	size_t m_current_frame{0};
 
 private:
 	struct QueueFamilyIndices {
 		std::optional<uint32_t> graphics_family{};
 		std::optional<uint32_t> presentation_family;
+		// Only set for families without graphics support, the graphics queue
+		// covers both jobs otherwise
+		std::optional<uint32_t> compute_family{};
+		std::optional<uint32_t> transfer_family{};
 
 		[[nodiscard]] bool SupportsGraphicsFamily() {
 			return graphics_family.has_value();
@@ -0,0 +1,415 @@
+#include "PreCompiledHeader.hpp"
+#include "ShaderCompiler.h"
+#include "Application.hpp"
+#include "Telemetry.h"
+#include "glslang/Public/ShaderLang.h"
+#include "glslang/Include/revision.h"
+#include "SPIRV/GlslangToSpv.h"
+#include "StandAlone/ResourceLimits.h"
+#include <iomanip>
+
+// Part of every cache key, bumped when the way shaders are compiled changes
+// without glslang changing
+constexpr char const * SHADER_CACHE_VERSION = "1";
+constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+constexpr uint32_t SPIRV_HEADER_WORDS = 5;
+constexpr int GLSL_DEFAULT_VERSION = 450;
+constexpr int GLSL_INPUT_VERSION = 100;
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+namespace
+{
+	std::string ReadText(std::filesystem::path const & t_path)
+	{
+		auto file = std::ifstream{ t_path, std::ios::binary };
+		if (!file) {
+			throw std::runtime_error("Shader compiler - Could not open " + t_path.generic_string());
+		}
+
+		auto text = std::stringstream{};
+		text << file.rdbuf();
+		return text.str();
+	}
+
+	EShLanguage GetStage(std::string const & t_path)
+	{
+		auto extension = std::filesystem::path{ t_path }.extension().string();
+		if (extension == ".vert") { return EShLangVertex; }
+		if (extension == ".tesc") { return EShLangTessControl; }
+		if (extension == ".tese") { return EShLangTessEvaluation; }
+		if (extension == ".geom") { return EShLangGeometry; }
+		if (extension == ".frag") { return EShLangFragment; }
+		if (extension == ".comp") { return EShLangCompute; }
+		throw std::runtime_error("Shader compiler - No stage for the extension of " + t_path);
+	}
+
+	std::optional<std::filesystem::path> ResolveInclude(std::string const & t_name, std::filesystem::path const & t_includer_directory, std::filesystem::path const & t_root_directory)
+	{
+		for (auto const & directory : { t_includer_directory, t_root_directory }) {
+			auto candidate = (directory / t_name).lexically_normal();
+			if (std::filesystem::is_regular_file(candidate)) {
+				return candidate;
+			}
+		}
+		return std::nullopt;
+	}
+
+	// Names of every #include line, whether or not the preprocessor would reach it
+	std::vector<std::string> FindIncludes(std::string const & t_source)
+	{
+		auto includes = std::vector<std::string>{};
+		auto lines = std::istringstream{ t_source };
+		auto line = std::string{};
+
+		while (std::getline(lines, line)) {
+			auto position = line.find_first_not_of(" \t");
+			if (position == std::string::npos || line[position] != '#') {
+				continue;
+			}
+			position = line.find_first_not_of(" \t", position + 1);
+			if (position == std::string::npos || line.compare(position, 7, "include") != 0) {
+				continue;
+			}
+			position = line.find_first_not_of(" \t", position + 7);
+			if (position == std::string::npos || (line[position] != '"' && line[position] != '<')) {
+				continue;
+			}
+			auto closing = line.find(line[position] == '"' ? '"' : '>', position + 1);
+			if (closing != std::string::npos) {
+				includes.emplace_back(line.substr(position + 1, closing - position - 1));
+			}
+		}
+
+		return includes;
+	}
+
+	// FNV-1a, each string is terminated so concatenations hash apart
+	void HashString(uint64_t & t_hash, std::string const & t_string)
+	{
+		for (auto character : t_string) {
+			t_hash = (t_hash ^ static_cast<uint8_t>(character)) * FNV_PRIME;
+		}
+		t_hash = t_hash * FNV_PRIME;
+	}
+
+	std::string ToHex(uint64_t t_value)
+	{
+		auto hex = std::ostringstream{};
+		hex << std::hex << std::setw(16) << std::setfill('0') << t_value;
+		return hex.str();
+	}
+
+	class FileIncluder : public glslang::TShader::Includer
+	{
+	public:
+		explicit FileIncluder(std::filesystem::path const & t_root_directory):
+			m_root_directory{ t_root_directory }
+		{}
+
+		IncludeResult * includeLocal(char const * t_header, char const * t_includer, size_t) override
+		{
+			return Include(t_header, std::filesystem::path{ t_includer }.parent_path());
+		}
+
+		IncludeResult * includeSystem(char const * t_header, char const *, size_t) override
+		{
+			return Include(t_header, m_root_directory);
+		}
+
+		void releaseInclude(IncludeResult * t_result) override
+		{
+			if (t_result != nullptr) {
+				delete static_cast<std::string *>(t_result->userData);
+				delete t_result;
+			}
+		}
+
+	private:
+		// glslang reports a failed include itself when given nothing back
+		IncludeResult * Include(char const * t_header, std::filesystem::path const & t_directory)
+		{
+			auto path = ResolveInclude(t_header, t_directory, m_root_directory);
+			if (!path.has_value()) {
+				return nullptr;
+			}
+
+			try {
+				auto content = std::make_unique<std::string>(ReadText(path.value()));
+				auto result = new IncludeResult{ path->generic_string(), content->data(), content->size(), content.get() };
+				content.release();
+				return result;
+			}
+			catch (std::exception &) {
+				return nullptr;
+			}
+		}
+
+		std::filesystem::path m_root_directory{};
+	};
+}
+
+void ShaderCompiler::Create(std::string const & t_cache_directory, SHADER_OPTIMIZATION t_optimization)
+{
+	if (!glslang::InitializeProcess()) {
+		throw std::runtime_error("Shader compiler - Could not initialise glslang");
+	}
+	m_initialized = true;
+	m_cache_directory = t_cache_directory;
+	m_optimization = t_optimization;
+
+	// Without a cache directory every compile is a miss, nothing else changes
+	auto error = std::error_code{};
+	std::filesystem::create_directories(m_cache_directory, error);
+}
+
+void ShaderCompiler::Destroy() noexcept
+{
+	if (m_initialized) {
+		glslang::FinalizeProcess();
+		m_initialized = false;
+	}
+}
+
+std::vector<uint32_t> ShaderCompiler::Compile(ShaderSource const & t_source) const
+{
+	auto compiled = CompileSource(t_source);
+	ReportOptimization(t_source, compiled);
+	return std::move(compiled.spirv);
+}
+
+std::vector<std::vector<uint32_t>> ShaderCompiler::Compile(std::vector<ShaderSource> const & t_sources) const
+{
+	auto timer = ScopedCpuTimer{ "Shader Compile" };
+
+	auto compiled = std::vector<CompiledShader>(t_sources.size());
+	auto worker_count = std::min<size_t>(t_sources.size(), std::max(std::thread::hardware_concurrency(), 1u));
+
+	// Workers take every worker_count'th source, so one slow shader does not
+	// leave a contiguous run of others waiting behind it
+	auto compile_from = [&](size_t t_first) {
+		for (auto i = t_first; i < t_sources.size(); i += worker_count) {
+			compiled[i] = CompileSource(t_sources[i]);
+		}
+	};
+
+	// The calling thread takes the first worker's share instead of waiting idle
+	auto tasks = std::vector<std::future<void>>{};
+	for (auto worker = size_t{ 1 }; worker < worker_count; ++worker) {
+		tasks.emplace_back(std::async(std::launch::async, compile_from, worker));
+	}
+
+	if (worker_count > 0) {
+		compile_from(0);
+	}
+
+	for (auto & task : tasks) {
+		task.get();
+	}
+
+	// Errors are logged and telemetry recorded only from here, the workers just
+	// report back
+	auto results = std::vector<std::vector<uint32_t>>{};
+	results.reserve(t_sources.size());
+	auto hit_count = size_t{ 0 };
+	for (auto i = size_t{ 0 }; i < t_sources.size(); ++i) {
+		ReportOptimization(t_sources[i], compiled[i]);
+		hit_count += compiled[i].cache_hit ? 1 : 0;
+		results.emplace_back(std::move(compiled[i].spirv));
+	}
+
+	Telemetry::Record(TS_COUNTER, "Shader Cache Hits", static_cast<double>(hit_count));
+	Telemetry::Record(TS_COUNTER, "Shaders Compiled", static_cast<double>(t_sources.size() - hit_count));
+
+	return results;
+}
+
+ShaderCompiler::CompiledShader ShaderCompiler::CompileSource(ShaderSource const & t_source) const
+{
+	if (!m_initialized) {
+		throw std::runtime_error("Shader compiler - Used before being created");
+	}
+
+	auto text = ReadText(t_source.path);
+	auto key = HashInputs(t_source, text);
+
+	auto compiled = CompiledShader{};
+	auto cached = ReadCache(key);
+	compiled.cache_hit = cached.has_value();
+	if (compiled.cache_hit) {
+		compiled.spirv = std::move(cached.value());
+		return compiled;
+	}
+
+	compiled.spirv = CompileGlsl(t_source, text);
+	if (m_optimization != SO_NONE) {
+		try {
+			auto report = ShaderOptimizationReport{};
+			compiled.spirv = ShaderOptimizer::Optimize(compiled.spirv, m_optimization, report);
+			compiled.optimization = report;
+		}
+		catch (std::exception & e) {
+			compiled.optimization_error = e.what();
+		}
+	}
+
+	WriteCache(key, compiled.spirv);
+	return compiled;
+}
+
+uint64_t ShaderCompiler::HashInputs(ShaderSource const & t_source, std::string const & t_text) const
+{
+	auto hash = FNV_OFFSET_BASIS;
+	HashString(hash, SHADER_CACHE_VERSION);
+	HashString(hash, glslang::GetGlslVersionString());
+	HashString(hash, std::to_string(GLSLANG_PATCH_LEVEL));
+	HashString(hash, std::to_string(m_optimization));
+	if (m_optimization != SO_NONE) {
+		HashString(hash, ShaderOptimizer::GetVersion());
+	}
+	HashString(hash, std::filesystem::path{ t_source.path }.extension().string());
+	for (auto const & define : t_source.defines) {
+		HashString(hash, define.name);
+		HashString(hash, define.value);
+	}
+	HashString(hash, t_text);
+
+	// Every file reachable through includes, each once, in the order found
+	auto root_directory = std::filesystem::path{ t_source.path }.parent_path();
+	auto visited = std::set<std::string>{};
+	auto pending = std::queue<std::pair<std::filesystem::path, std::string>>{};
+	pending.emplace(root_directory, t_text);
+
+	while (!pending.empty()) {
+		auto [directory, text] = std::move(pending.front());
+		pending.pop();
+
+		for (auto const & name : FindIncludes(text)) {
+			auto path = ResolveInclude(name, directory, root_directory);
+			if (!path.has_value()) {
+				// Compiling reports the missing file, the name still keys the entry
+				HashString(hash, name);
+				continue;
+			}
+
+			auto normalised = path->generic_string();
+			if (!visited.insert(normalised).second) {
+				continue;
+			}
+
+			auto content = ReadText(path.value());
+			HashString(hash, normalised);
+			HashString(hash, content);
+			pending.emplace(path->parent_path(), std::move(content));
+		}
+	}
+
+	return hash;
+}
+
+std::vector<uint32_t> ShaderCompiler::CompileGlsl(ShaderSource const & t_source, std::string const & t_text)
+{
+	auto stage = GetStage(t_source.path);
+
+	// The include extension is what glslc enables for every shader as well
+	auto preamble = std::string{ "#extension GL_GOOGLE_include_directive : enable\n" };
+	for (auto const & define : t_source.defines) {
+		preamble += "#define " + define.name + " " + define.value + "\n";
+	}
+
+	auto text = t_text.c_str();
+	auto length = static_cast<int>(t_text.size());
+	auto name = t_source.path.c_str();
+
+	auto shader = glslang::TShader{ stage };
+	shader.setStringsWithLengthsAndNames(&text, &length, &name, 1);
+	shader.setPreamble(preamble.c_str());
+	shader.setEnvInput(glslang::EShSourceGlsl, stage, glslang::EShClientVulkan, GLSL_INPUT_VERSION);
+	shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_0);
+	shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_0);
+
+	auto messages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+	auto includer = FileIncluder{ std::filesystem::path{ t_source.path }.parent_path() };
+	if (!shader.parse(&glslang::DefaultTBuiltInResource, GLSL_DEFAULT_VERSION, false, messages, includer)) {
+		throw std::runtime_error("Shader compiler - " + t_source.path + " failed to compile:\n" + shader.getInfoLog());
+	}
+
+	auto program = glslang::TProgram{};
+	program.addShader(&shader);
+	if (!program.link(messages)) {
+		throw std::runtime_error("Shader compiler - " + t_source.path + " failed to link:\n" + program.getInfoLog());
+	}
+
+	auto options = glslang::SpvOptions{};
+	options.disableOptimizer = true;
+
+	auto spirv = std::vector<uint32_t>{};
+	glslang::GlslangToSpv(*program.getIntermediate(stage), spirv, &options);
+	return spirv;
+}
+
+void ShaderCompiler::ReportOptimization(ShaderSource const & t_source, CompiledShader const & t_compiled)
+{
+	if (!t_compiled.optimization_error.empty()) {
+		Application::LogError(t_source.path + ": " + t_compiled.optimization_error);
+	}
+	if (t_compiled.optimization.has_value()) {
+		RecordOptimization(t_source, t_compiled.optimization.value());
+	}
+}
+
+void ShaderCompiler::RecordOptimization(ShaderSource const & t_source, ShaderOptimizationReport const & t_report)
+{
+	// Negative deltas are savings
+	auto name = std::filesystem::path{ t_source.path }.filename().string();
+	auto bytes_before = static_cast<double>(t_report.words_before * sizeof(uint32_t));
+	auto bytes_after = static_cast<double>(t_report.words_after * sizeof(uint32_t));
+	Telemetry::Record(TS_COUNTER, name + " SPIR-V Bytes Delta", bytes_after - bytes_before);
+	Telemetry::Record(TS_COUNTER, name + " SPIR-V Instructions Delta", static_cast<double>(t_report.instructions_after) - static_cast<double>(t_report.instructions_before));
+}
+
+std::optional<std::vector<uint32_t>> ShaderCompiler::ReadCache(uint64_t t_key) const
+{
+	auto file = std::ifstream{ m_cache_directory / (ToHex(t_key) + ".spv"), std::ios::ate | std::ios::binary };
+	if (!file) {
+		return std::nullopt;
+	}
+
+	auto size = static_cast<size_t>(file.tellg());
+	if (size % sizeof(uint32_t) != 0 || size < SPIRV_HEADER_WORDS * sizeof(uint32_t)) {
+		return std::nullopt;
+	}
+
+	auto spirv = std::vector<uint32_t>(size / sizeof(uint32_t));
+	file.seekg(0);
+	file.read(reinterpret_cast<char *>(spirv.data()), static_cast<std::streamsize>(size));
+	if (!file || spirv[0] != SPIRV_MAGIC) {
+		return std::nullopt;
+	}
+
+	return spirv;
+}
+
+void ShaderCompiler::WriteCache(uint64_t t_key, std::vector<uint32_t> const & t_spirv) const
+{
+	// Written aside and renamed into place, so a reader never sees half an entry
+	// and two threads writing the same entry do not interleave
+	auto name = ToHex(t_key);
+	auto final_path = m_cache_directory / (name + ".spv");
+	auto temporary_path = m_cache_directory / (name + "." + ToHex(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp");
+
+	{
+		auto file = std::ofstream{ temporary_path, std::ios::binary };
+		file.write(reinterpret_cast<char const *>(t_spirv.data()), static_cast<std::streamsize>(t_spirv.size() * sizeof(uint32_t)));
+		if (!file) {
+			Application::LogError("Shader compiler - Could not write cache entry " + temporary_path.generic_string());
+			return;
+		}
+	}
+
+	auto error = std::error_code{};
+	std::filesystem::rename(temporary_path, final_path, error);
+	if (error) {
+		std::filesystem::remove(temporary_path, error);
+	}
+}
@@ -0,0 +1,71 @@
+#ifndef SHADER_COMPILER
+#define SHADER_COMPILER
+
+#include "ShaderOptimizer.h"
+
+struct ShaderDefine {
+	std::string name{};
+	std::string value{};
+};
+
+// The stage comes from the extension, as with glslc (.vert, .frag, .comp, ...)
+struct ShaderSource {
+	std::string path{};
+	std::vector<ShaderDefine> defines{};
+};
+
+// GLSL to SPIR-V in process through glslang, targeting Vulkan 1.0. Results are
+// cached on disk under a hash of everything that decides the output: the source,
+// every file it includes, its defines and the compiler version. Includes are
+// found by scanning for #include lines, conditional ones included, so the key is
+// at worst too specific and never stale. A cache hit costs reading the source
+// files and one small read, no glslang work at all.
+//
+// #include "file" resolves against the including file's directory, then
+// against the directory of the shader being compiled.
+//
+// Fresh compiles go through ShaderOptimizer with the recipe given at creation,
+// the recipe and the spirv-tools version are part of the cache key. Size and
+// instruction count before and after are recorded per shader, a module the
+// optimiser cannot handle is logged and kept unoptimised.
+class ShaderCompiler
+{
+public:
+	explicit ShaderCompiler() = default;
+	ShaderCompiler(ShaderCompiler const &) = delete;
+	ShaderCompiler(ShaderCompiler &&) noexcept = default;
+	ShaderCompiler & operator = (ShaderCompiler const &) = delete;
+	ShaderCompiler & operator = (ShaderCompiler &&) noexcept = default;
+	~ShaderCompiler() noexcept = default;
+
+	void Create(std::string const &, SHADER_OPTIMIZATION);
+	void Destroy() noexcept;
+
+	[[nodiscard]] std::vector<uint32_t> Compile(ShaderSource const &) const;
+	// Independent sources compile in parallel, results come back in source order
+	[[nodiscard]] std::vector<std::vector<uint32_t>> Compile(std::vector<ShaderSource> const &) const;
+
+private:
+	struct CompiledShader {
+		std::vector<uint32_t> spirv{};
+		bool cache_hit{ false };
+		std::optional<ShaderOptimizationReport> optimization{};
+		// Why optimising failed, the module is kept unoptimised
+		std::string optimization_error{};
+	};
+
+	[[nodiscard]] CompiledShader CompileSource(ShaderSource const &) const;
+	[[nodiscard]] uint64_t HashInputs(ShaderSource const &, std::string const &) const;
+	[[nodiscard]] static std::vector<uint32_t> CompileGlsl(ShaderSource const &, std::string const &);
+	// Logs and records what optimising a shader did, on the calling thread only
+	static void ReportOptimization(ShaderSource const &, CompiledShader const &);
+	static void RecordOptimization(ShaderSource const &, ShaderOptimizationReport const &);
+	[[nodiscard]] std::optional<std::vector<uint32_t>> ReadCache(uint64_t) const;
+	void WriteCache(uint64_t, std::vector<uint32_t> const &) const;
+
+	std::filesystem::path m_cache_directory{};
+	SHADER_OPTIMIZATION m_optimization{ SO_NONE };
+	bool m_initialized{ false };
+};
+
+#endif // !SHADER_COMPILER
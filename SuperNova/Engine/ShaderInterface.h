@@ -0,0 +1,84 @@
+#ifndef SHADER_INTERFACE
+#define SHADER_INTERFACE
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm/vec4.hpp"
+#include "glm/glm/mat4x4.hpp"
+
+// CPU side mirrors of the blocks declared in the shaders, any change here has to
+// be made in the matching shader as well. Layouts follow std140 for uniforms and std430
+// for storage buffers.
+
+// set 0, binding 0, once per frame from the dynamic buffer ring
+struct FrameUniforms {
+	glm::mat4 view{ 1.0f };
+	glm::mat4 projection{ 1.0f };
+	glm::mat4 view_projection{ 1.0f };
+	glm::vec4 camera_position{ 0.0f, 0.0f, 0.0f, 1.0f };
+	float time{ 0.0f };
+	float delta_time{ 0.0f };
+	float padding[2]{};
+	// Scales vertex colors, lights are added on top
+	glm::vec4 ambient{ 1.0f };
+	// Clusters along x, y and z, w is the light count
+	glm::uvec4 cluster_count{ 0 };
+	// xy pixels per cluster, a fragment's slice is log(view depth) * z + w
+	glm::vec4 cluster_scale{ 0.0f };
+};
+
+// set 0, binding 1, one entry per object drawn this frame
+struct ObjectTransform {
+	glm::mat4 model{ 1.0f };
+};
+
+// set 0, binding 2, world space lights shaded by the clustered forward path
+struct PointLight {
+	glm::vec4 position_radius{ 0.0f };
+	glm::vec4 color_intensity{ 1.0f };
+};
+
+// set 0, binding 3, one per cluster, a range of the light indices at binding 4
+struct LightCluster {
+	uint32_t offset{ 0 };
+	uint32_t count{ 0 };
+};
+
+// Push constants, everything a single draw needs that changes between draws
+struct DrawPushConstants {
+	uint32_t object_index{ 0 };
+	// See LodSelection, 0 when the object is not cross-fading between levels
+	float lod_fade{ 0.0f };
+	uint32_t padding[2]{};
+	glm::vec4 tint{ 1.0f };
+};
+
+// OcclusionCull.comp, the header is followed by an array of candidates
+struct CullInputHeader {
+	glm::mat4 view_projection{ 1.0f };
+	glm::vec2 pyramid_size{ 0.0f };
+	uint32_t pyramid_levels{ 0 };
+	uint32_t candidate_count{ 0 };
+	// Share of the pyramid covered by the rendered area
+	glm::vec2 uv_scale{ 1.0f };
+	glm::vec2 padding{ 0.0f };
+};
+
+struct CullCandidate {
+	glm::vec4 sphere{ 0.0f };
+	uint32_t object{ 0 };
+	uint32_t padding[3]{};
+};
+
+struct CullCounters {
+	uint32_t early_drawn{ 0 };
+	uint32_t late_drawn{ 0 };
+	uint32_t occluded{ 0 };
+	uint32_t padding{ 0 };
+};
+
+static_assert(sizeof(CullInputHeader) % 16 == 0, "Candidates must start 16 byte aligned");
+static_assert(sizeof(FrameUniforms) % 16 == 0, "FrameUniforms must match its std140 block size");
+static_assert(sizeof(DrawPushConstants) <= 128, "Push constants must fit the guaranteed 128 bytes");
+
+#endif // !SHADER_INTERFACE
@@ -0,0 +1,98 @@
+#include "PreCompiledHeader.hpp"
+#include "ShaderOptimizer.h"
+#include "spirv-tools/libspirv.hpp"
+#include "spirv-tools/optimizer.hpp"
+#include "SPIRV/SPVRemapper.h"
+
+constexpr size_t SPIRV_HEADER_WORDS = 5;
+
+namespace
+{
+	spvtools::MessageConsumer CollectMessages(std::string & t_messages)
+	{
+		return [&t_messages](spv_message_level_t, char const *, spv_position_t const & t_position, char const * t_message) {
+			t_messages += "  word " + std::to_string(t_position.index) + ": " + t_message + "\n";
+		};
+	}
+}
+
+std::vector<uint32_t> ShaderOptimizer::Optimize(std::vector<uint32_t> const & t_spirv, SHADER_OPTIMIZATION t_optimization, ShaderOptimizationReport & t_report)
+{
+	t_report.words_before = t_spirv.size();
+	t_report.instructions_before = CountInstructions(t_spirv);
+
+	auto optimized = t_spirv;
+	auto messages = std::string{};
+
+	if (t_optimization != SO_NONE) {
+		auto optimizer = spvtools::Optimizer{ SPV_ENV_VULKAN_1_0 };
+		optimizer.SetMessageConsumer(CollectMessages(messages));
+		if (t_optimization == SO_PERFORMANCE) {
+			optimizer.RegisterPerformancePasses();
+		}
+		else {
+			optimizer.RegisterSizePasses();
+		}
+
+		// The optimiser validates its input before running any pass
+		if (!optimizer.Run(t_spirv.data(), t_spirv.size(), &optimized)) {
+			throw std::runtime_error("Shader optimizer - Optimisation failed:\n" + messages);
+		}
+
+		// Inlining can grow a module past what the size passes win back
+		if (t_optimization == SO_SIZE && optimized.size() >= t_spirv.size()) {
+			optimized = t_spirv;
+		}
+	}
+
+	auto tools = spvtools::SpirvTools{ SPV_ENV_VULKAN_1_0 };
+	tools.SetMessageConsumer(CollectMessages(messages));
+	if (!tools.Validate(optimized)) {
+		throw std::runtime_error("Shader optimizer - Optimised module does not validate:\n" + messages);
+	}
+
+	t_report.words_after = optimized.size();
+	t_report.instructions_after = CountInstructions(optimized);
+	return optimized;
+}
+
+std::vector<uint32_t> ShaderOptimizer::Remap(std::vector<uint32_t> const & t_spirv)
+{
+	// The remapper's handler is global and exits the process unless replaced.
+	// Load and store forwarding is left to the optimiser, its own is unsafe
+	spv::spirvbin_t::registerErrorHandler([](std::string const & t_message) {
+		throw std::runtime_error("Shader optimizer - Remapping failed: " + t_message);
+	});
+
+	auto remapped = t_spirv;
+	spv::spirvbin_t{}.remap(remapped, spv::spirvbin_t::MAP_ALL | spv::spirvbin_t::DCE_ALL | spv::spirvbin_t::STRIP);
+
+	auto messages = std::string{};
+	auto tools = spvtools::SpirvTools{ SPV_ENV_VULKAN_1_0 };
+	tools.SetMessageConsumer(CollectMessages(messages));
+	if (!tools.Validate(remapped)) {
+		throw std::runtime_error("Shader optimizer - Remapped module does not validate:\n" + messages);
+	}
+	return remapped;
+}
+
+uint32_t ShaderOptimizer::CountInstructions(std::vector<uint32_t> const & t_spirv) noexcept
+{
+	// The high half of every instruction's first word is its length in words
+	auto count = uint32_t{ 0 };
+	auto position = SPIRV_HEADER_WORDS;
+	while (position < t_spirv.size()) {
+		auto word_count = t_spirv[position] >> 16;
+		if (word_count == 0) {
+			break;
+		}
+		position += word_count;
+		++count;
+	}
+	return count;
+}
+
+std::string ShaderOptimizer::GetVersion()
+{
+	return spvSoftwareVersionString();
+}
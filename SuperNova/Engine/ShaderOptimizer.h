@@ -0,0 +1,40 @@
+#ifndef SHADER_OPTIMIZER
+#define SHADER_OPTIMIZER
+
+enum SHADER_OPTIMIZATION
+{
+	SO_NONE = 0,
+	SO_PERFORMANCE,
+	SO_SIZE
+};
+
+struct ShaderOptimizationReport {
+	size_t words_before{ 0 };
+	size_t words_after{ 0 };
+	uint32_t instructions_before{ 0 };
+	uint32_t instructions_after{ 0 };
+};
+
+// Cook time SPIR-V optimisation with spirv-tools. Performance runs the recipe
+// spirv-opt -O does (inlining, scalar replacement, constant propagation, dead
+// branch and dead code elimination, block merging and the like), size the one
+// -Os does, keeping the input when that comes out no smaller. The result is
+// validated against Vulkan 1.0 rules, a module failing either step throws with
+// the tools' messages attached.
+class ShaderOptimizer
+{
+public:
+	ShaderOptimizer() = delete;
+
+	[[nodiscard]] static std::vector<uint32_t> Optimize(std::vector<uint32_t> const &, SHADER_OPTIMIZATION, ShaderOptimizationReport &);
+	// For packing, after optimisation. Ids are renumbered canonically with glslang's
+	// remapper, so modules built from the same source come out alike and compress
+	// far better, then dead functions, variables and types and every debug
+	// instruction are dropped. Validated like Optimize
+	[[nodiscard]] static std::vector<uint32_t> Remap(std::vector<uint32_t> const &);
+	[[nodiscard]] static uint32_t CountInstructions(std::vector<uint32_t> const &) noexcept;
+	// Identifies the spirv-tools build, optimised output changes with it
+	[[nodiscard]] static std::string GetVersion();
+};
+
+#endif // !SHADER_OPTIMIZER
@@ -0,0 +1,506 @@
+#include "PreCompiledHeader.hpp"
+#include "ShaderReflection.h"
+#include "SPIRV/spirv.hpp"
+
+constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+constexpr size_t SPIRV_HEADER_WORDS = 5;
+
+namespace
+{
+	struct Type {
+		spv::Op op{ spv::OpNop };
+		// Scalar width, vector and matrix size, image dimension
+		uint32_t width{ 0 };
+		uint32_t count{ 0 };
+		bool is_signed{ false };
+		// Component, column, element or pointee type
+		uint32_t element{ 0 };
+		// Array length constant, image sampled operand
+		uint32_t operand{ 0 };
+		spv::StorageClass storage{ spv::StorageClassMax };
+		std::vector<uint32_t> members{};
+	};
+
+	struct Decorations {
+		std::optional<uint32_t> set{};
+		std::optional<uint32_t> binding{};
+		std::optional<uint32_t> location{};
+		std::optional<uint32_t> spec_id{};
+		uint32_t array_stride{ 0 };
+		bool buffer_block{ false };
+		bool built_in{ false };
+	};
+
+	struct MemberDecorations {
+		uint32_t offset{ 0 };
+		uint32_t matrix_stride{ 0 };
+		bool row_major{ false };
+	};
+
+	struct Variable {
+		uint32_t id{ 0 };
+		uint32_t type{ 0 };
+		spv::StorageClass storage{ spv::StorageClassMax };
+	};
+
+	struct SpecializationConstant {
+		uint32_t id{ 0 };
+		uint32_t type{ 0 };
+	};
+
+	// Everything Reflect needs from one pass over the instructions
+	struct Module {
+		std::optional<spv::ExecutionModel> execution_model{};
+		std::unordered_map<uint32_t, Type> types{};
+		std::unordered_map<uint32_t, Decorations> decorations{};
+		std::unordered_map<uint32_t, std::vector<MemberDecorations>> member_decorations{};
+		std::unordered_map<uint32_t, uint32_t> constants{};
+		std::unordered_map<uint32_t, std::string> names{};
+		std::vector<Variable> variables{};
+		std::vector<SpecializationConstant> specialization_constants{};
+	};
+
+	std::string ReadString(uint32_t const * t_words, size_t t_count)
+	{
+		auto text = reinterpret_cast<char const *>(t_words);
+		return std::string{ text, strnlen(text, t_count * sizeof(uint32_t)) };
+	}
+
+	Module Parse(SpirvView t_spirv)
+	{
+		if (t_spirv.size() < SPIRV_HEADER_WORDS || t_spirv[0] != SPIRV_MAGIC) {
+			throw std::runtime_error("Shader reflection - Not a SPIR-V module");
+		}
+
+		auto module = Module{};
+		auto position = SPIRV_HEADER_WORDS;
+
+		while (position < t_spirv.size()) {
+			auto word_count = size_t{ t_spirv[position] >> 16 };
+			auto op = static_cast<spv::Op>(t_spirv[position] & 0xFFFF);
+			if (word_count == 0 || position + word_count > t_spirv.size()) {
+				throw std::runtime_error("Shader reflection - Malformed instruction at word " + std::to_string(position));
+			}
+
+			auto operands = &t_spirv[position + 1];
+			auto operand_count = word_count - 1;
+			auto operand = [&](size_t t_index) {
+				if (t_index >= operand_count) {
+					throw std::runtime_error("Shader reflection - Truncated instruction at word " + std::to_string(position));
+				}
+				return operands[t_index];
+			};
+
+			switch (op) {
+			case spv::OpEntryPoint:
+				if (module.execution_model.has_value()) {
+					throw std::runtime_error("Shader reflection - Modules with more than one entry point are not supported");
+				}
+				module.execution_model = static_cast<spv::ExecutionModel>(operand(0));
+				break;
+			case spv::OpName:
+				module.names[operand(0)] = ReadString(operands + 1, operand_count - 1);
+				break;
+			case spv::OpDecorate: {
+				auto & decorations = module.decorations[operand(0)];
+				switch (static_cast<spv::Decoration>(operand(1))) {
+				case spv::DecorationDescriptorSet: decorations.set = operand(2); break;
+				case spv::DecorationBinding: decorations.binding = operand(2); break;
+				case spv::DecorationLocation: decorations.location = operand(2); break;
+				case spv::DecorationSpecId: decorations.spec_id = operand(2); break;
+				case spv::DecorationArrayStride: decorations.array_stride = operand(2); break;
+				case spv::DecorationBufferBlock: decorations.buffer_block = true; break;
+				case spv::DecorationBuiltIn: decorations.built_in = true; break;
+				default: break;
+				}
+				break;
+			}
+			case spv::OpMemberDecorate: {
+				auto & members = module.member_decorations[operand(0)];
+				auto member = operand(1);
+				if (members.size() <= member) {
+					members.resize(static_cast<size_t>(member) + 1);
+				}
+				switch (static_cast<spv::Decoration>(operand(2))) {
+				case spv::DecorationOffset: members[member].offset = operand(3); break;
+				case spv::DecorationMatrixStride: members[member].matrix_stride = operand(3); break;
+				case spv::DecorationRowMajor: members[member].row_major = true; break;
+				default: break;
+				}
+				break;
+			}
+			case spv::OpTypeVoid:
+			case spv::OpTypeBool:
+			case spv::OpTypeSampler:
+				module.types[operand(0)] = Type{ op };
+				break;
+			case spv::OpTypeInt:
+				module.types[operand(0)] = Type{ op, operand(1), 1, operand(2) != 0 };
+				break;
+			case spv::OpTypeFloat:
+				module.types[operand(0)] = Type{ op, operand(1), 1, true };
+				break;
+			case spv::OpTypeVector:
+			case spv::OpTypeMatrix: {
+				auto type = Type{ op };
+				type.element = operand(1);
+				type.count = operand(2);
+				module.types[operand(0)] = type;
+				break;
+			}
+			case spv::OpTypeImage: {
+				auto type = Type{ op };
+				type.element = operand(1);
+				type.width = operand(2);
+				type.operand = operand(6);
+				module.types[operand(0)] = type;
+				break;
+			}
+			case spv::OpTypeSampledImage:
+			case spv::OpTypeRuntimeArray: {
+				auto type = Type{ op };
+				type.element = operand(1);
+				module.types[operand(0)] = type;
+				break;
+			}
+			case spv::OpTypeArray: {
+				auto type = Type{ op };
+				type.element = operand(1);
+				type.operand = operand(2);
+				module.types[operand(0)] = type;
+				break;
+			}
+			case spv::OpTypeStruct: {
+				auto type = Type{ op };
+				type.members.assign(operands + 1, operands + operand_count);
+				module.types[operand(0)] = type;
+				break;
+			}
+			case spv::OpTypePointer: {
+				auto type = Type{ op };
+				type.storage = static_cast<spv::StorageClass>(operand(1));
+				type.element = operand(2);
+				module.types[operand(0)] = type;
+				break;
+			}
+			// Array lengths, only the low word matters for them
+			case spv::OpConstant:
+			case spv::OpSpecConstant:
+				module.constants[operand(1)] = operand(2);
+				if (op == spv::OpSpecConstant) {
+					module.specialization_constants.emplace_back(SpecializationConstant{ operand(1), operand(0) });
+				}
+				break;
+			case spv::OpSpecConstantTrue:
+			case spv::OpSpecConstantFalse:
+				module.specialization_constants.emplace_back(SpecializationConstant{ operand(1), operand(0) });
+				break;
+			case spv::OpVariable:
+				module.variables.emplace_back(Variable{ operand(1), operand(0), static_cast<spv::StorageClass>(operand(2)) });
+				break;
+			// Nothing reflection needs comes after the first function
+			case spv::OpFunction:
+				position = t_spirv.size();
+				continue;
+			default:
+				break;
+			}
+
+			position += word_count;
+		}
+
+		if (!module.execution_model.has_value()) {
+			throw std::runtime_error("Shader reflection - Module has no entry point");
+		}
+
+		return module;
+	}
+
+	Type const & GetType(Module const & t_module, uint32_t t_id)
+	{
+		auto type = t_module.types.find(t_id);
+		if (type == t_module.types.end()) {
+			throw std::runtime_error("Shader reflection - Unknown type %" + std::to_string(t_id));
+		}
+		return type->second;
+	}
+
+	Decorations const & GetDecorations(Module const & t_module, uint32_t t_id)
+	{
+		static auto const none = Decorations{};
+		auto decorations = t_module.decorations.find(t_id);
+		return decorations == t_module.decorations.end() ? none : decorations->second;
+	}
+
+	uint32_t GetArrayLength(Module const & t_module, Type const & t_array)
+	{
+		auto length = t_module.constants.find(t_array.operand);
+		if (length == t_module.constants.end()) {
+			throw std::runtime_error("Shader reflection - Array length is not a constant");
+		}
+		return length->second;
+	}
+
+	VkShaderStageFlagBits GetStage(spv::ExecutionModel t_model)
+	{
+		switch (t_model) {
+		case spv::ExecutionModelVertex: return VK_SHADER_STAGE_VERTEX_BIT;
+		case spv::ExecutionModelTessellationControl: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+		case spv::ExecutionModelTessellationEvaluation: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+		case spv::ExecutionModelGeometry: return VK_SHADER_STAGE_GEOMETRY_BIT;
+		case spv::ExecutionModelFragment: return VK_SHADER_STAGE_FRAGMENT_BIT;
+		case spv::ExecutionModelGLCompute: return VK_SHADER_STAGE_COMPUTE_BIT;
+		default: throw std::runtime_error("Shader reflection - Unsupported execution model " + std::to_string(t_model));
+		}
+	}
+
+	// Bytes the type takes in an explicitly laid out block, the stride and
+	// majorness of a matrix come from the member holding it
+	uint32_t GetSize(Module const & t_module, uint32_t t_id, MemberDecorations const & t_member)
+	{
+		auto const & type = GetType(t_module, t_id);
+		switch (type.op) {
+		case spv::OpTypeBool:
+			return sizeof(VkBool32);
+		case spv::OpTypeInt:
+		case spv::OpTypeFloat:
+			return type.width / 8;
+		case spv::OpTypeVector:
+			return type.count * GetSize(t_module, type.element, t_member);
+		case spv::OpTypeMatrix: {
+			auto const & column = GetType(t_module, type.element);
+			if (t_member.matrix_stride == 0) {
+				return type.count * GetSize(t_module, type.element, t_member);
+			}
+			// Row major matrices store a column's components a stride apart
+			return t_member.row_major ? column.count * t_member.matrix_stride : type.count * t_member.matrix_stride;
+		}
+		case spv::OpTypeArray: {
+			auto length = GetArrayLength(t_module, type);
+			auto stride = GetDecorations(t_module, t_id).array_stride;
+			return length * (stride != 0 ? stride : GetSize(t_module, type.element, t_member));
+		}
+		case spv::OpTypeRuntimeArray:
+			return 0;
+		case spv::OpTypeStruct: {
+			auto members = t_module.member_decorations.find(t_id);
+			auto size = uint32_t{ 0 };
+			for (auto i = size_t{ 0 }; i < type.members.size(); ++i) {
+				auto member = members != t_module.member_decorations.end() && i < members->second.size() ? members->second[i] : MemberDecorations{};
+				size = std::max(size, member.offset + GetSize(t_module, type.members[i], member));
+			}
+			return size;
+		}
+		default:
+			throw std::runtime_error("Shader reflection - No size for type %" + std::to_string(t_id));
+		}
+	}
+
+	VkDescriptorType GetDescriptorType(Module const & t_module, uint32_t t_type, spv::StorageClass t_storage)
+	{
+		auto const & type = GetType(t_module, t_type);
+
+		if (t_storage == spv::StorageClassStorageBuffer) {
+			return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		}
+		if (t_storage == spv::StorageClassUniform) {
+			// SPIR-V 1.0 declares storage buffers as uniform blocks decorated BufferBlock
+			return GetDecorations(t_module, t_type).buffer_block ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		}
+
+		switch (type.op) {
+		case spv::OpTypeSampler:
+			return VK_DESCRIPTOR_TYPE_SAMPLER;
+		case spv::OpTypeSampledImage:
+			// GLSL's samplerBuffer is a texel buffer despite carrying a sampler
+			if (GetType(t_module, type.element).width == spv::DimBuffer) {
+				return VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+			}
+			return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		case spv::OpTypeImage: {
+			// The sampled operand is 2 for images used without a sampler
+			auto storage = type.operand == 2;
+			if (type.width == spv::DimBuffer) {
+				return storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+			}
+			if (type.width == spv::DimSubpassData) {
+				return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			}
+			return storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		}
+		default:
+			throw std::runtime_error("Shader reflection - Unsupported descriptor type %" + std::to_string(t_type));
+		}
+	}
+
+	VkFormat GetVertexFormat(Type const & t_component, uint32_t t_count)
+	{
+		static constexpr VkFormat floats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+		static constexpr VkFormat doubles[] = { VK_FORMAT_R64_SFLOAT, VK_FORMAT_R64G64_SFLOAT, VK_FORMAT_R64G64B64_SFLOAT, VK_FORMAT_R64G64B64A64_SFLOAT };
+		static constexpr VkFormat signed_ints[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+		static constexpr VkFormat unsigned_ints[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+		if (t_count == 0 || t_count > 4) {
+			throw std::runtime_error("Shader reflection - Vertex input with " + std::to_string(t_count) + " components");
+		}
+		if (t_component.op == spv::OpTypeFloat && t_component.width == 32) {
+			return floats[t_count - 1];
+		}
+		if (t_component.op == spv::OpTypeFloat && t_component.width == 64) {
+			return doubles[t_count - 1];
+		}
+		if (t_component.op == spv::OpTypeInt && t_component.width == 32) {
+			return t_component.is_signed ? signed_ints[t_count - 1] : unsigned_ints[t_count - 1];
+		}
+		throw std::runtime_error("Shader reflection - Unsupported vertex input component type");
+	}
+
+	// Matrices take a location per column and arrays one per element, 64 bit
+	// vectors of three or four components take two
+	void AddVertexAttributes(Module const & t_module, uint32_t t_type, uint32_t & t_location, std::vector<VkVertexInputAttributeDescription> & t_attributes)
+	{
+		auto const & type = GetType(t_module, t_type);
+		switch (type.op) {
+		case spv::OpTypeArray:
+			for (auto i = GetArrayLength(t_module, type); i > 0; --i) {
+				AddVertexAttributes(t_module, type.element, t_location, t_attributes);
+			}
+			break;
+		case spv::OpTypeMatrix:
+			for (auto i = uint32_t{ 0 }; i < type.count; ++i) {
+				AddVertexAttributes(t_module, type.element, t_location, t_attributes);
+			}
+			break;
+		case spv::OpTypeVector: {
+			auto const & component = GetType(t_module, type.element);
+			t_attributes.emplace_back(VkVertexInputAttributeDescription{ t_location, 0, GetVertexFormat(component, type.count), 0 });
+			t_location += component.width == 64 && type.count > 2 ? 2 : 1;
+			break;
+		}
+		default:
+			t_attributes.emplace_back(VkVertexInputAttributeDescription{ t_location++, 0, GetVertexFormat(type, 1), 0 });
+			break;
+		}
+	}
+
+	uint32_t GetFormatSize(VkFormat t_format)
+	{
+		switch (t_format) {
+		case VK_FORMAT_R32_SFLOAT: case VK_FORMAT_R32_SINT: case VK_FORMAT_R32_UINT: return 4;
+		case VK_FORMAT_R32G32_SFLOAT: case VK_FORMAT_R32G32_SINT: case VK_FORMAT_R32G32_UINT: case VK_FORMAT_R64_SFLOAT: return 8;
+		case VK_FORMAT_R32G32B32_SFLOAT: case VK_FORMAT_R32G32B32_SINT: case VK_FORMAT_R32G32B32_UINT: return 12;
+		case VK_FORMAT_R32G32B32A32_SFLOAT: case VK_FORMAT_R32G32B32A32_SINT: case VK_FORMAT_R32G32B32A32_UINT: case VK_FORMAT_R64G64_SFLOAT: return 16;
+		case VK_FORMAT_R64G64B64_SFLOAT: return 24;
+		case VK_FORMAT_R64G64B64A64_SFLOAT: return 32;
+		default: return 0;
+		}
+	}
+}
+
+ReflectedShader ShaderReflection::Reflect(SpirvView t_spirv)
+{
+	auto module = Parse(t_spirv);
+
+	auto reflected = ReflectedShader{};
+	reflected.stage = GetStage(module.execution_model.value());
+
+	for (auto const & variable : module.variables) {
+		auto const & pointer = GetType(module, variable.type);
+		auto const & decorations = GetDecorations(module, variable.id);
+
+		switch (variable.storage) {
+		case spv::StorageClassUniform:
+		case spv::StorageClassUniformConstant:
+		case spv::StorageClassStorageBuffer: {
+			if (!decorations.binding.has_value()) {
+				continue;
+			}
+
+			// Arrays of descriptors take one binding, runtime sized ones are left to
+			// the caller to size
+			auto binding = ReflectedBinding{ decorations.set.value_or(0), decorations.binding.value() };
+			auto type = pointer.element;
+			while (GetType(module, type).op == spv::OpTypeArray || GetType(module, type).op == spv::OpTypeRuntimeArray) {
+				auto const & array = GetType(module, type);
+				binding.count *= array.op == spv::OpTypeArray ? GetArrayLength(module, array) : 0;
+				type = array.element;
+			}
+			binding.type = GetDescriptorType(module, type, variable.storage);
+			reflected.bindings.emplace_back(binding);
+			break;
+		}
+		case spv::StorageClassPushConstant: {
+			auto const & block = GetType(module, pointer.element);
+			auto members = module.member_decorations.find(pointer.element);
+			if (block.members.empty() || members == module.member_decorations.end()) {
+				continue;
+			}
+
+			// The range starts at the first member, blocks may leave room before it
+			// for another stage's constants
+			auto begin = std::numeric_limits<uint32_t>::max();
+			for (auto const & member : members->second) {
+				begin = std::min(begin, member.offset);
+			}
+			auto end = GetSize(module, pointer.element, MemberDecorations{});
+			reflected.push_constant_ranges.emplace_back(VkPushConstantRange{ static_cast<VkShaderStageFlags>(reflected.stage), begin, end - begin });
+			break;
+		}
+		case spv::StorageClassInput: {
+			if (reflected.stage != VK_SHADER_STAGE_VERTEX_BIT || decorations.built_in || !decorations.location.has_value()) {
+				continue;
+			}
+			auto location = decorations.location.value();
+			AddVertexAttributes(module, pointer.element, location, reflected.vertex_attributes);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	std::sort(reflected.bindings.begin(), reflected.bindings.end(), [](auto const & t_a, auto const & t_b) {
+		return std::tie(t_a.set, t_a.binding) < std::tie(t_b.set, t_b.binding);
+	});
+
+	// Attributes are packed in location order into a single interleaved binding
+	std::sort(reflected.vertex_attributes.begin(), reflected.vertex_attributes.end(), [](auto const & t_a, auto const & t_b) {
+		return t_a.location < t_b.location;
+	});
+	auto stride = uint32_t{ 0 };
+	for (auto & attribute : reflected.vertex_attributes) {
+		attribute.offset = stride;
+		stride += GetFormatSize(attribute.format);
+	}
+	if (!reflected.vertex_attributes.empty()) {
+		reflected.vertex_bindings.emplace_back(VkVertexInputBindingDescription{ 0, stride, VK_VERTEX_INPUT_RATE_VERTEX });
+	}
+
+	for (auto const & constant : module.specialization_constants) {
+		auto const & decorations = GetDecorations(module, constant.id);
+		if (!decorations.spec_id.has_value()) {
+			continue;
+		}
+		auto name = module.names.find(constant.id);
+		reflected.specialization_constants.emplace_back(ReflectedSpecializationConstant{
+			decorations.spec_id.value(),
+			GetSize(module, constant.type, MemberDecorations{}),
+			name == module.names.end() ? std::string{} : name->second });
+	}
+	std::sort(reflected.specialization_constants.begin(), reflected.specialization_constants.end(), [](auto const & t_a, auto const & t_b) {
+		return t_a.id < t_b.id;
+	});
+
+	return reflected;
+}
+
+std::vector<VkSpecializationMapEntry> ShaderReflection::GetSpecializationMap(ReflectedShader const & t_shader)
+{
+	auto entries = std::vector<VkSpecializationMapEntry>{};
+	auto offset = uint32_t{ 0 };
+	for (auto const & constant : t_shader.specialization_constants) {
+		entries.emplace_back(VkSpecializationMapEntry{ constant.id, offset, constant.size });
+		offset += constant.size;
+	}
+	return entries;
+}
@@ -0,0 +1,50 @@
+#ifndef SHADER_REFLECTION
+#define SHADER_REFLECTION
+
+#include "vulkan/vulkan.h"
+#include "SpirvView.h"
+
+struct ReflectedBinding {
+	uint32_t set{ 0 };
+	uint32_t binding{ 0 };
+	VkDescriptorType type{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER };
+	uint32_t count{ 1 };
+};
+
+struct ReflectedSpecializationConstant {
+	uint32_t id{ 0 };
+	uint32_t size{ 0 };
+	// Empty once debug names are stripped
+	std::string name{};
+};
+
+struct ReflectedShader {
+	VkShaderStageFlagBits stage{ VK_SHADER_STAGE_VERTEX_BIT };
+	// Sorted by set, then binding
+	std::vector<ReflectedBinding> bindings{};
+	// At most one range, covering every member of the push constant block
+	std::vector<VkPushConstantRange> push_constant_ranges{};
+	// Vertex stage inputs, interleaved in one binding in location order
+	std::vector<VkVertexInputBindingDescription> vertex_bindings{};
+	std::vector<VkVertexInputAttributeDescription> vertex_attributes{};
+	// Sorted by id
+	std::vector<ReflectedSpecializationConstant> specialization_constants{};
+};
+
+// Reads what a pipeline needs to know about a shader straight from its SPIR-V,
+// so layouts and vertex input follow the shaders instead of being kept in step
+// by hand. Modules are expected to hold one entry point, as glslang produces.
+// Sizes follow the explicit offsets and strides in the module, so push
+// constants come out the size the shader sees whatever layout it declared.
+class ShaderReflection
+{
+public:
+	ShaderReflection() = delete;
+
+	[[nodiscard]] static ReflectedShader Reflect(SpirvView);
+	// One entry per constant, packed in id order, data is as long as the last
+	// entry's offset and size
+	[[nodiscard]] static std::vector<VkSpecializationMapEntry> GetSpecializationMap(ReflectedShader const &);
+};
+
+#endif // !SHADER_REFLECTION
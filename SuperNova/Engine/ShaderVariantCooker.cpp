@@ -0,0 +1,131 @@
+#include "PreCompiledHeader.hpp"
+#include "ShaderVariantCooker.h"
+#include "LzCodec.h"
+
+namespace
+{
+	uint64_t AlignFileOffset(uint64_t t_offset)
+	{
+		return (t_offset + SHADER_VARIANT_FILE_ALIGNMENT - 1) & ~(SHADER_VARIANT_FILE_ALIGNMENT - 1);
+	}
+}
+
+std::vector<uint32_t> ShaderVariantCooker::ReadMaterials(std::string const & t_path)
+{
+	auto file = std::ifstream{ t_path };
+	if (!file) {
+		throw std::runtime_error("Shader variant cooker - Could not open " + t_path);
+	}
+
+	auto materials = std::vector<uint32_t>{};
+	auto line = std::string{};
+	while (std::getline(file, line)) {
+		auto words = std::vector<std::string>{};
+		auto stream = std::istringstream{ line };
+		for (auto word = std::string{}; stream >> word;) {
+			words.emplace_back(std::move(word));
+		}
+		if (words.empty() || words.front().front() == '#') {
+			continue;
+		}
+
+		// The first word only names the material for whoever edits the list
+		materials.emplace_back(ShaderVariants::ParseFeatures(std::vector<std::string>(words.begin() + 1, words.end())));
+	}
+
+	if (materials.empty()) {
+		throw std::runtime_error("Shader variant cooker - " + t_path + " lists no materials");
+	}
+	return materials;
+}
+
+ShaderVariantCooker::Report ShaderVariantCooker::Cook(std::vector<uint32_t> const & t_materials, std::string const & t_path, ShaderCompiler const & t_compiler)
+{
+	auto keys = std::vector<std::pair<uint32_t, uint32_t>>{};
+	for (auto features : t_materials) {
+		for (auto stage = uint32_t{ 0 }; stage < MS_COUNT; ++stage) {
+			keys.emplace_back(stage, ShaderVariants::GetVariantKey(features, static_cast<MATERIAL_STAGE>(stage)));
+		}
+	}
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+	auto variant_count = static_cast<uint32_t>(keys.size());
+
+	auto sources = std::vector<ShaderSource>{};
+	sources.reserve(keys.size() + ES_COUNT);
+	for (auto const & key : keys) {
+		sources.emplace_back(ShaderVariants::GetSource(key.second, static_cast<MATERIAL_STAGE>(key.first)));
+	}
+	for (auto shader = uint32_t{ 0 }; shader < ES_COUNT; ++shader) {
+		keys.emplace_back(SHADER_VARIANT_ENGINE_STAGE, shader);
+		sources.emplace_back(ShaderVariants::GetEngineSource(static_cast<ENGINE_SHADER>(shader)));
+	}
+	auto variants = t_compiler.Compile(sources);
+
+	auto report = Report{};
+	auto stored = std::vector<std::vector<uint8_t>>{};
+	stored.reserve(variants.size());
+	for (auto & variant : variants) {
+		report.compiled_bytes += variant.size() * sizeof(uint32_t);
+		variant = ShaderOptimizer::Remap(variant);
+
+		auto bytes = reinterpret_cast<uint8_t const *>(variant.data());
+		auto size = variant.size() * sizeof(uint32_t);
+		auto compressed = LzCodec::Compress(bytes, size);
+		if (compressed.size() >= size) {
+			compressed.assign(bytes, bytes + size);
+		}
+		report.stored_bytes += compressed.size();
+		stored.emplace_back(std::move(compressed));
+	}
+
+	auto header = ShaderVariantFileHeader{};
+	header.variant_count = static_cast<uint32_t>(keys.size());
+	header.material_count = static_cast<uint32_t>(t_materials.size());
+
+	auto entries = std::vector<ShaderVariantFileEntry>(keys.size());
+	auto offset = AlignFileOffset(sizeof(ShaderVariantFileHeader) + sizeof(ShaderVariantFileEntry) * entries.size() + sizeof(uint32_t) * t_materials.size());
+	for (size_t i = 0; i < entries.size(); ++i) {
+		entries[i].stage = keys[i].first;
+		entries[i].key = keys[i].second;
+		entries[i].offset = offset;
+		entries[i].size = variants[i].size() * sizeof(uint32_t);
+		entries[i].stored_size = stored[i].size();
+		offset = AlignFileOffset(offset + entries[i].stored_size);
+	}
+
+	auto file = std::ofstream{ t_path, std::ios::binary };
+	if (!file) {
+		throw std::runtime_error("Shader variant cooker - Could not create " + t_path);
+	}
+
+	file.write(reinterpret_cast<char const *>(&header), sizeof(ShaderVariantFileHeader));
+	file.write(reinterpret_cast<char const *>(entries.data()), static_cast<std::streamsize>(sizeof(ShaderVariantFileEntry) * entries.size()));
+	file.write(reinterpret_cast<char const *>(t_materials.data()), static_cast<std::streamsize>(sizeof(uint32_t) * t_materials.size()));
+
+	auto position = static_cast<uint64_t>(sizeof(ShaderVariantFileHeader) + sizeof(ShaderVariantFileEntry) * entries.size() + sizeof(uint32_t) * t_materials.size());
+	char const padding[SHADER_VARIANT_FILE_ALIGNMENT]{};
+	for (size_t i = 0; i < entries.size(); ++i) {
+		file.write(padding, static_cast<std::streamsize>(entries[i].offset - position));
+		file.write(reinterpret_cast<char const *>(stored[i].data()), static_cast<std::streamsize>(entries[i].stored_size));
+		position = entries[i].offset + entries[i].stored_size;
+	}
+
+	if (!file) {
+		throw std::runtime_error("Shader variant cooker - Could not write " + t_path);
+	}
+
+	report.materials = header.material_count;
+	report.variants = variant_count;
+	report.engine_shaders = ES_COUNT;
+	for (auto stage = uint32_t{ 0 }; stage < MS_COUNT; ++stage) {
+		report.pruned += ShaderVariants::GetVariantCount(static_cast<MATERIAL_STAGE>(stage));
+	}
+	report.pruned -= report.variants;
+	return report;
+}
+
+ShaderVariantCooker::Report ShaderVariantCooker::CookFile(std::string const & t_materials, std::string const & t_destination, ShaderCompiler const & t_compiler)
+{
+	return Cook(ReadMaterials(t_materials), t_destination, t_compiler);
+}
@@ -0,0 +1,41 @@
+#ifndef SHADER_VARIANT_COOKER
+#define SHADER_VARIANT_COOKER
+
+#include "ShaderCompiler.h"
+#include "ShaderVariantFormat.h"
+#include "ShaderVariants.h"
+
+// Cook time side of the material variants. A material list names every
+// material the content uses and its features, one per line:
+//
+//     # comment
+//     opaque clustered-lighting lod-fade vertex-tint
+//     unlit vertex-tint
+//
+// The materials are reduced to the variant keys they need per stage and only
+// those are compiled, every other permutation is pruned. Compiled variants are
+// remapped and stripped by ShaderOptimizer::Remap and compressed, the engine's
+// own shaders along with them. Materials keep their list order, so a material
+// index means the same thing in the list and the database.
+class ShaderVariantCooker
+{
+public:
+	struct Report {
+		uint32_t materials{ 0 };
+		uint32_t variants{ 0 };
+		uint32_t engine_shaders{ 0 };
+		// Permutations no material referenced
+		uint32_t pruned{ 0 };
+		// SPIR-V as compiled, and what the pack holds after remapping and compression
+		uint64_t compiled_bytes{ 0 };
+		uint64_t stored_bytes{ 0 };
+	};
+
+	ShaderVariantCooker() = delete;
+
+	[[nodiscard]] static std::vector<uint32_t> ReadMaterials(std::string const &);
+	static Report Cook(std::vector<uint32_t> const &, std::string const &, ShaderCompiler const &);
+	static Report CookFile(std::string const &, std::string const &, ShaderCompiler const &);
+};
+
+#endif // !SHADER_VARIANT_COOKER
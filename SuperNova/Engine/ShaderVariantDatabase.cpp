@@ -0,0 +1,132 @@
+#include "PreCompiledHeader.hpp"
+#include "ShaderVariantDatabase.h"
+#include "LzCodec.h"
+#include <tuple>
+
+void ShaderVariantDatabase::Create(std::string const & t_path)
+{
+	m_file.Create(t_path);
+	auto data = m_file.GetData();
+	auto size = m_file.GetSize();
+
+	try {
+		auto header = ShaderVariantFileHeader{};
+		if (size < sizeof(header)) {
+			throw std::runtime_error("Shader variant database - Not a shader variant file " + t_path);
+		}
+		std::memcpy(&header, data, sizeof(header));
+		if (header.magic != SHADER_VARIANT_FILE_MAGIC || header.version != SHADER_VARIANT_FILE_VERSION) {
+			throw std::runtime_error("Shader variant database - Not a shader variant file " + t_path);
+		}
+
+		auto entries_offset = uint64_t{ sizeof(ShaderVariantFileHeader) };
+		auto materials_offset = entries_offset + sizeof(ShaderVariantFileEntry) * uint64_t{ header.variant_count };
+		if (materials_offset + sizeof(uint32_t) * uint64_t{ header.material_count } > size) {
+			throw std::runtime_error("Shader variant database - Truncated tables in " + t_path);
+		}
+
+		// The cooker aligned both tables and the mapping starts on a page
+		auto entries = reinterpret_cast<ShaderVariantFileEntry const *>(data + entries_offset);
+		m_materials = reinterpret_cast<uint32_t const *>(data + materials_offset);
+		m_material_count = header.material_count;
+
+		auto decompressed_words = uint64_t{ 0 };
+		for (auto i = uint32_t{ 0 }; i < header.variant_count; ++i) {
+			auto const & entry = entries[i];
+			auto engine = entry.stage == SHADER_VARIANT_ENGINE_STAGE;
+			if ((entry.stage >= MS_COUNT && !engine) || (engine && entry.key >= ES_COUNT) || entry.size % sizeof(uint32_t) != 0 || entry.offset % sizeof(uint32_t) != 0 || entry.stored_size > entry.size) {
+				throw std::runtime_error("Shader variant database - Bad variant entry in " + t_path);
+			}
+			if (entry.offset > size || entry.stored_size > size - entry.offset) {
+				throw std::runtime_error("Shader variant database - Truncated variant in " + t_path);
+			}
+			if (entry.stored_size != entry.size) {
+				decompressed_words += entry.size / sizeof(uint32_t);
+			}
+		}
+
+		// Sized first, views into the buffer must not move
+		m_decompressed.resize(static_cast<size_t>(decompressed_words));
+		auto destination = m_decompressed.data();
+
+		m_variants.clear();
+		m_variants.reserve(header.variant_count);
+		m_engine_shaders.fill(SpirvView{});
+		for (auto i = uint32_t{ 0 }; i < header.variant_count; ++i) {
+			auto const & entry = entries[i];
+			auto word_count = static_cast<size_t>(entry.size / sizeof(uint32_t));
+			auto words = reinterpret_cast<uint32_t const *>(data + entry.offset);
+			if (entry.stored_size != entry.size) {
+				LzCodec::Decompress(data + entry.offset, static_cast<size_t>(entry.stored_size), reinterpret_cast<uint8_t *>(destination), static_cast<size_t>(entry.size));
+				words = destination;
+				destination += word_count;
+			}
+			if (entry.stage == SHADER_VARIANT_ENGINE_STAGE) {
+				m_engine_shaders[entry.key] = SpirvView{ words, word_count };
+			}
+			else {
+				m_variants.emplace_back(Variant{ static_cast<MATERIAL_STAGE>(entry.stage), entry.key, SpirvView{ words, word_count } });
+			}
+		}
+
+		auto sorted = std::is_sorted(m_variants.begin(), m_variants.end(), [](auto const & t_a, auto const & t_b) {
+			return std::tie(t_a.stage, t_a.key) < std::tie(t_b.stage, t_b.key);
+		});
+		if (!sorted) {
+			throw std::runtime_error("Shader variant database - Variant table of " + t_path + " is not sorted");
+		}
+	}
+	catch (...) {
+		Destroy();
+		throw;
+	}
+}
+
+void ShaderVariantDatabase::Destroy() noexcept
+{
+	m_variants.clear();
+	m_engine_shaders.fill(SpirvView{});
+	m_materials = nullptr;
+	m_material_count = 0;
+	m_decompressed.clear();
+	m_file.Destroy();
+}
+
+uint32_t ShaderVariantDatabase::GetMaterialCount() const noexcept
+{
+	return m_material_count;
+}
+
+uint32_t ShaderVariantDatabase::GetMaterialFeatures(uint32_t t_material) const
+{
+	if (t_material >= m_material_count) {
+		throw std::runtime_error("Shader variant database - No material " + std::to_string(t_material));
+	}
+	return m_materials[t_material];
+}
+
+ShaderVariantDatabase::Variant const * ShaderVariantDatabase::Find(uint32_t t_features, MATERIAL_STAGE t_stage) const noexcept
+{
+	auto key = ShaderVariants::GetVariantKey(t_features, t_stage);
+	auto variant = std::lower_bound(m_variants.begin(), m_variants.end(), std::make_pair(t_stage, key), [](auto const & t_variant, auto const & t_key) {
+		return std::tie(t_variant.stage, t_variant.key) < std::tie(t_key.first, t_key.second);
+	});
+	if (variant == m_variants.end() || variant->stage != t_stage || variant->key != key) {
+		return nullptr;
+	}
+	return &*variant;
+}
+
+std::vector<ShaderVariantDatabase::Variant> const & ShaderVariantDatabase::GetVariants() const noexcept
+{
+	return m_variants;
+}
+
+SpirvView ShaderVariantDatabase::GetEngineShader(ENGINE_SHADER t_shader) const
+{
+	auto const & shader = m_engine_shaders.at(t_shader);
+	if (shader.empty()) {
+		throw std::runtime_error("Shader variant database - Engine shader " + std::to_string(t_shader) + " was not cooked");
+	}
+	return shader;
+}
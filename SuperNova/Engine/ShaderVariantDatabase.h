@@ -0,0 +1,54 @@
+#ifndef SHADER_VARIANT_DATABASE
+#define SHADER_VARIANT_DATABASE
+
+#include "MappedFile.h"
+#include "ShaderVariantFormat.h"
+#include "ShaderVariants.h"
+#include "SpirvView.h"
+
+// Runtime side of the cooked material variants. The pack is mapped once and the
+// tables are checked against its size, after that materials are looked up by
+// index and variants by stage and key with a binary search over the sorted
+// table, nothing is parsed or hashed. Compressed variants are decoded up front
+// into one buffer, stored ones are viewed in the mapping; either way no file is
+// opened per shader and views stay valid until Destroy. The engine's own shaders
+// are looked up directly by ENGINE_SHADER.
+// A material whose variant is missing means the database and the material list
+// went out of sync.
+class ShaderVariantDatabase
+{
+public:
+	struct Variant {
+		MATERIAL_STAGE stage{ MS_VERTEX };
+		uint32_t key{ 0 };
+		SpirvView spirv{};
+	};
+
+	explicit ShaderVariantDatabase() = default;
+	ShaderVariantDatabase(ShaderVariantDatabase const &) = delete;
+	ShaderVariantDatabase(ShaderVariantDatabase &&) noexcept = default;
+	ShaderVariantDatabase & operator = (ShaderVariantDatabase const &) = delete;
+	ShaderVariantDatabase & operator = (ShaderVariantDatabase &&) noexcept = default;
+	~ShaderVariantDatabase() noexcept = default;
+
+	void Create(std::string const &);
+	void Destroy() noexcept;
+
+	[[nodiscard]] uint32_t GetMaterialCount() const noexcept;
+	[[nodiscard]] uint32_t GetMaterialFeatures(uint32_t) const;
+	// nullptr when no material needed the variant
+	[[nodiscard]] Variant const * Find(uint32_t, MATERIAL_STAGE) const noexcept;
+	// Sorted by stage, then key
+	[[nodiscard]] std::vector<Variant> const & GetVariants() const noexcept;
+	[[nodiscard]] SpirvView GetEngineShader(ENGINE_SHADER) const;
+
+private:
+	MappedFile m_file{};
+	std::vector<Variant> m_variants{};
+	std::array<SpirvView, ES_COUNT> m_engine_shaders{};
+	uint32_t const * m_materials{ nullptr };
+	uint32_t m_material_count{ 0 };
+	std::vector<uint32_t> m_decompressed{};
+};
+
+#endif // !SHADER_VARIANT_DATABASE
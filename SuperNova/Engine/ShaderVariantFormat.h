@@ -0,0 +1,44 @@
+#ifndef SHADER_VARIANT_FORMAT
+#define SHADER_VARIANT_FORMAT
+
+// Layout of the cooked shader variant database. A header, the variant table
+// sorted by stage then key, the feature mask of every material in the order the
+// material list gave them, then the SPIR-V of each variant at its own offset.
+// Only variants some material uses are present. The engine's own shaders follow
+// the variants in the same table, under SHADER_VARIANT_ENGINE_STAGE and keyed by
+// ENGINE_SHADER, so a cooked build compiles nothing at start up.
+//
+// The file is read through a mapping. Every table and module sits at an offset
+// aligned for its contents, so the runtime uses them where they lie. Modules are
+// remapped and stripped, then stored LzCodec compressed unless that saves
+// nothing, a stored size equal to the size marks a module kept as is.
+constexpr uint32_t SHADER_VARIANT_FILE_MAGIC = 0x56534E53; // "SNSV"
+constexpr uint32_t SHADER_VARIANT_FILE_VERSION = 3;
+constexpr uint64_t SHADER_VARIANT_FILE_ALIGNMENT = 16;
+// Above every MATERIAL_STAGE, engine shaders sort last
+constexpr uint32_t SHADER_VARIANT_ENGINE_STAGE = 0xFFFFFFFF;
+
+struct ShaderVariantFileHeader {
+	uint32_t magic{ SHADER_VARIANT_FILE_MAGIC };
+	uint32_t version{ SHADER_VARIANT_FILE_VERSION };
+	// Entries in the table, engine shaders included
+	uint32_t variant_count{ 0 };
+	uint32_t material_count{ 0 };
+};
+
+struct ShaderVariantFileEntry {
+	// MATERIAL_STAGE and ShaderVariants::GetVariantKey, or
+	// SHADER_VARIANT_ENGINE_STAGE and ENGINE_SHADER
+	uint32_t stage{ 0 };
+	uint32_t key{ 0 };
+	uint64_t offset{ 0 };
+	// Bytes of SPIR-V
+	uint64_t size{ 0 };
+	// Bytes in the file
+	uint64_t stored_size{ 0 };
+};
+
+static_assert(sizeof(ShaderVariantFileHeader) == 16, "Shader variant file header layout changed");
+static_assert(sizeof(ShaderVariantFileEntry) == 32, "Shader variant file entry layout changed");
+
+#endif // !SHADER_VARIANT_FORMAT
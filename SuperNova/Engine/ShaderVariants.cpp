@@ -0,0 +1,90 @@
+#include "PreCompiledHeader.hpp"
+#include "ShaderVariants.h"
+
+constexpr char const * MATERIAL_SHADER_PATHS[MS_COUNT] = { "Vertex.vert", "Fragment.frag" };
+constexpr char const * ENGINE_SHADER_PATHS[ES_COUNT] = { "HiZDownsample.comp", "OcclusionCull.comp" };
+
+constexpr std::array<MaterialFeature, MF_COUNT> MATERIAL_FEATURES = { {
+	{ "clustered-lighting", MS_FRAGMENT, FB_PREPROCESSOR, "MATERIAL_CLUSTERED_LIGHTING", 0 },
+	{ "lod-fade", MS_FRAGMENT, FB_SPECIALIZATION, "", 0 },
+	{ "vertex-tint", MS_VERTEX, FB_SPECIALIZATION, "", 0 }
+} };
+
+MaterialFeature const & ShaderVariants::GetFeature(MATERIAL_FEATURE t_feature) noexcept
+{
+	return MATERIAL_FEATURES[t_feature];
+}
+
+uint32_t ShaderVariants::GetVariantKey(uint32_t t_features, MATERIAL_STAGE t_stage) noexcept
+{
+	auto key = uint32_t{ 0 };
+	for (auto i = uint32_t{ 0 }; i < MF_COUNT; ++i) {
+		if (MATERIAL_FEATURES[i].stage == t_stage && MATERIAL_FEATURES[i].binding == FB_PREPROCESSOR) {
+			key |= t_features & (1u << i);
+		}
+	}
+	return key;
+}
+
+uint32_t ShaderVariants::GetVariantCount(MATERIAL_STAGE t_stage) noexcept
+{
+	return 1u << static_cast<uint32_t>(std::count_if(MATERIAL_FEATURES.begin(), MATERIAL_FEATURES.end(), [t_stage](auto const & t_feature) {
+		return t_feature.stage == t_stage && t_feature.binding == FB_PREPROCESSOR;
+	}));
+}
+
+ShaderSource ShaderVariants::GetSource(uint32_t t_features, MATERIAL_STAGE t_stage)
+{
+	auto source = ShaderSource{ MATERIAL_SHADER_PATHS[t_stage] };
+	auto key = GetVariantKey(t_features, t_stage);
+	for (auto i = uint32_t{ 0 }; i < MF_COUNT; ++i) {
+		if ((key & (1u << i)) != 0) {
+			source.defines.emplace_back(ShaderDefine{ MATERIAL_FEATURES[i].define, "1" });
+		}
+	}
+	return source;
+}
+
+ShaderSource ShaderVariants::GetEngineSource(ENGINE_SHADER t_shader)
+{
+	return ShaderSource{ ENGINE_SHADER_PATHS[t_shader] };
+}
+
+uint32_t ShaderVariants::ParseFeatures(std::vector<std::string> const & t_names)
+{
+	auto features = uint32_t{ 0 };
+	for (auto const & name : t_names) {
+		auto feature = std::find_if(MATERIAL_FEATURES.begin(), MATERIAL_FEATURES.end(), [&name](auto const & t_feature) {
+			return name == t_feature.name;
+		});
+		if (feature == MATERIAL_FEATURES.end()) {
+			throw std::runtime_error("Shader variants - Unknown material feature " + name);
+		}
+		features |= 1u << static_cast<uint32_t>(feature - MATERIAL_FEATURES.begin());
+	}
+	return features;
+}
+
+MaterialSpecialization::MaterialSpecialization(uint32_t t_features, MATERIAL_STAGE t_stage) noexcept
+{
+	auto count = uint32_t{ 0 };
+	for (auto i = uint32_t{ 0 }; i < MF_COUNT; ++i) {
+		auto const & feature = MATERIAL_FEATURES[i];
+		if (feature.stage != t_stage || feature.binding != FB_SPECIALIZATION) {
+			continue;
+		}
+		m_values[count] = (t_features & (1u << i)) != 0 ? VK_TRUE : VK_FALSE;
+		m_entries[count] = VkSpecializationMapEntry{ feature.constant_id, static_cast<uint32_t>(count * sizeof(VkBool32)), sizeof(VkBool32) };
+		++count;
+	}
+
+	m_info.mapEntryCount = count;
+	m_info.pMapEntries = m_entries.data();
+	m_info.dataSize = count * sizeof(VkBool32);
+	m_info.pData = m_values.data();
+}
+
+VkSpecializationInfo const * MaterialSpecialization::GetInfo() const noexcept
+{
+	return m_info.mapEntryCount > 0 ? &m_info : nullptr;
+}
@@ -0,0 +1,95 @@
+#ifndef SHADER_VARIANTS
+#define SHADER_VARIANTS
+
+#include "vulkan/vulkan.h"
+#include "ShaderCompiler.h"
+#include <array>
+
+enum MATERIAL_FEATURE
+{
+	MF_CLUSTERED_LIGHTING = 0,
+	MF_LOD_FADE,
+	MF_VERTEX_TINT,
+	MF_COUNT
+};
+
+enum MATERIAL_STAGE
+{
+	MS_VERTEX = 0,
+	MS_FRAGMENT,
+	MS_COUNT
+};
+
+enum FEATURE_BINDING
+{
+	// Compiled in or out, each combination is its own cooked variant
+	FB_PREPROCESSOR = 0,
+	// A bool constant_id, one variant serves both settings
+	FB_SPECIALIZATION
+};
+
+// Shaders of the engine's own passes, cooked into the pack next to the material
+// variants
+enum ENGINE_SHADER
+{
+	ES_HIZ_DOWNSAMPLE = 0,
+	ES_OCCLUSION_CULL,
+	ES_COUNT
+};
+
+// Feature masks have bit n set for MATERIAL_FEATURE n
+constexpr uint32_t MATERIAL_ALL_FEATURES = (1u << MF_COUNT) - 1;
+
+struct MaterialFeature {
+	// As written in material lists
+	char const * name{ "" };
+	MATERIAL_STAGE stage{ MS_FRAGMENT };
+	FEATURE_BINDING binding{ FB_SPECIALIZATION };
+	char const * define{ "" };
+	uint32_t constant_id{ 0 };
+};
+
+// The material shaders and the features they can be built with. Features that
+// change what a shader declares, or that would leave a branch in every pixel,
+// are preprocessor permutations; cheap toggles are specialization constants,
+// which the driver folds when it builds the pipeline. A variant is keyed by the
+// preprocessor features of its stage only, so materials differing in constants
+// alone share one module.
+class ShaderVariants
+{
+public:
+	ShaderVariants() = delete;
+
+	[[nodiscard]] static MaterialFeature const & GetFeature(MATERIAL_FEATURE) noexcept;
+	[[nodiscard]] static uint32_t GetVariantKey(uint32_t, MATERIAL_STAGE) noexcept;
+	// Number of distinct variant keys the stage has
+	[[nodiscard]] static uint32_t GetVariantCount(MATERIAL_STAGE) noexcept;
+	[[nodiscard]] static ShaderSource GetSource(uint32_t, MATERIAL_STAGE);
+	[[nodiscard]] static ShaderSource GetEngineSource(ENGINE_SHADER);
+	// Cook time only, unknown names throw
+	[[nodiscard]] static uint32_t ParseFeatures(std::vector<std::string> const &);
+};
+
+// Specialization constants of one stage for a feature mask, built without any
+// string work. Entries for constants a variant was optimised without are
+// ignored by Vulkan. The info points into the object, which therefore stays
+// where it was made.
+class MaterialSpecialization
+{
+public:
+	explicit MaterialSpecialization(uint32_t, MATERIAL_STAGE) noexcept;
+	MaterialSpecialization(MaterialSpecialization const &) = delete;
+	MaterialSpecialization(MaterialSpecialization &&) = delete;
+	MaterialSpecialization & operator = (MaterialSpecialization const &) = delete;
+	MaterialSpecialization & operator = (MaterialSpecialization &&) = delete;
+	~MaterialSpecialization() noexcept = default;
+
+	[[nodiscard]] VkSpecializationInfo const * GetInfo() const noexcept;
+
+private:
+	std::array<VkSpecializationMapEntry, MF_COUNT> m_entries{};
+	std::array<VkBool32, MF_COUNT> m_values{};
+	VkSpecializationInfo m_info{};
+};
+
+#endif // !SHADER_VARIANTS
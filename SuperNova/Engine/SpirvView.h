@@ -0,0 +1,29 @@
+#ifndef SPIRV_VIEW
+#define SPIRV_VIEW
+
+// Non owning view of a SPIR-V module, words in a vector or in a mapped pack
+class SpirvView
+{
+public:
+	SpirvView() noexcept = default;
+	SpirvView(uint32_t const * t_words, size_t t_size) noexcept :
+		m_words{ t_words },
+		m_size{ t_size }
+	{}
+	SpirvView(std::vector<uint32_t> const & t_code) noexcept :
+		m_words{ t_code.data() },
+		m_size{ t_code.size() }
+	{}
+
+	[[nodiscard]] uint32_t const * data() const noexcept { return m_words; }
+	// Words, not bytes
+	[[nodiscard]] size_t size() const noexcept { return m_size; }
+	[[nodiscard]] bool empty() const noexcept { return m_size == 0; }
+	[[nodiscard]] uint32_t const & operator [] (size_t t_index) const noexcept { return m_words[t_index]; }
+
+private:
+	uint32_t const * m_words{ nullptr };
+	size_t m_size{ 0 };
+};
+
+#endif // !SPIRV_VIEW
@@ -0,0 +1,119 @@
+#include "PreCompiledHeader.hpp"
+#include "Telemetry.h"
+#include "date.h"
+
+std::ofstream Telemetry::m_file{};
+std::vector<Telemetry::Sample> Telemetry::m_samples{};
+uint64_t Telemetry::m_frame{ 0 };
+
+void Telemetry::BeginFrame() noexcept
+{
+	++m_frame;
+}
+
+void Telemetry::EndFrame() noexcept
+{
+	if (m_samples.empty()) {
+		return;
+	}
+
+	if (!m_file.is_open()) {
+		CreateTelemetryFile();
+	}
+
+	if (m_file.is_open()) {
+		for (auto const & sample : m_samples) {
+			m_file << sample.frame << ',' << GetSourceName(sample.source) << ',' << sample.name << ',' << sample.value << '\n';
+		}
+	}
+
+	m_samples.clear();
+}
+
+void Telemetry::Close() noexcept
+{
+	EndFrame();
+	if (m_file.is_open()) {
+		m_file.close();
+	}
+}
+
+void Telemetry::Record(TELEMETRY_SOURCE t_source, std::string const & t_name, double t_value) noexcept
+{
+	Record(t_source, t_name, t_value, m_frame);
+}
+
+void Telemetry::Record(TELEMETRY_SOURCE t_source, std::string const & t_name, double t_value, uint64_t t_frame) noexcept
+{
+	try {
+		m_samples.emplace_back(Sample{ t_frame, t_source, t_name, t_value });
+	}
+	catch (std::exception &) {
+		// Losing a sample is preferable to taking the frame down
+	}
+}
+
+uint64_t Telemetry::GetFrame() noexcept
+{
+	return m_frame;
+}
+
+void Telemetry::CreateTelemetryFile() noexcept
+{
+	try {
+		using namespace std::chrono;
+		using namespace std::filesystem;
+
+		auto file_path = path{ current_path() };
+		file_path /= "Telemetry";
+		if (!exists(file_path) && !create_directories(file_path)) {
+			std::cerr << "Telemetry directory could not be created\n";
+			return;
+		}
+
+		auto time = system_clock::now();
+		auto daypoint = date::floor<date::days>(time);
+		auto year_month_day = date::year_month_day{ daypoint };
+		auto time_of_day = date::make_time(time - daypoint);
+
+		std::stringstream s;
+		s << "Telemetry_" << year_month_day << "_" <<
+			time_of_day.hours().count() << "-" <<
+			time_of_day.minutes().count() << "-" <<
+			time_of_day.seconds().count() << ".csv";
+
+		file_path /= s.str();
+		m_file.open(file_path);
+		m_file << "frame,source,name,value\n";
+	}
+	catch (std::exception & exception) {
+		std::cerr << "Could not create Telemetry file: " << exception.what();
+	}
+}
+
+char const * Telemetry::GetSourceName(TELEMETRY_SOURCE t_source) noexcept
+{
+	switch (t_source)
+	{
+	case TS_CPU: return "CPU";
+	case TS_GPU: return "GPU";
+	case TS_COUNTER: return "Counter";
+	default: return "Unknown";
+	}
+}
+
+ScopedCpuTimer::ScopedCpuTimer(std::string const & t_name) :
+	m_name{ t_name },
+	m_start{ std::chrono::steady_clock::now() }
+{}
+
+ScopedCpuTimer::ScopedCpuTimer(std::string&& t_name) noexcept :
+	m_name{ std::move(t_name) },
+	m_start{ std::chrono::steady_clock::now() }
+{}
+
+ScopedCpuTimer::~ScopedCpuTimer() noexcept
+{
+	auto elapsed = std::chrono::duration<double, std::milli>{ std::chrono::steady_clock::now() - m_start };
+	Telemetry::Record(TS_CPU, m_name, elapsed.count());
+}
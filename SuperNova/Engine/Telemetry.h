@@ -0,0 +1,60 @@
+#ifndef TELEMETRY
+#define TELEMETRY
+
+enum TELEMETRY_SOURCE
+{
+	TS_CPU = 0,
+	TS_GPU,
+	TS_COUNTER
+};
+
+// Per frame timing samples from every part of the engine, written as one csv
+// stream so CPU and GPU costs of the same frame can be lined up. Timings are in
+// milliseconds, counter samples (culled objects and the like) are plain counts.
+class Telemetry
+{
+public:
+	Telemetry() = delete;
+
+	static void BeginFrame() noexcept;
+	static void EndFrame() noexcept;
+	static void Close() noexcept;
+
+	static void Record(TELEMETRY_SOURCE, std::string const &, double) noexcept;
+	static void Record(TELEMETRY_SOURCE, std::string const &, double, uint64_t) noexcept;
+
+	[[nodiscard]] static uint64_t GetFrame() noexcept;
+
+private:
+	struct Sample {
+		uint64_t frame{ 0 };
+		TELEMETRY_SOURCE source{ TS_CPU };
+		std::string name{};
+		double value{ 0.0 };
+	};
+
+	static void CreateTelemetryFile() noexcept;
+	[[nodiscard]] static char const * GetSourceName(TELEMETRY_SOURCE) noexcept;
+
+	static std::ofstream m_file;
+	static std::vector<Sample> m_samples;
+	static uint64_t m_frame;
+};
+
+class ScopedCpuTimer
+{
+public:
+	explicit ScopedCpuTimer(std::string const &);
+	explicit ScopedCpuTimer(std::string&&) noexcept;
+	ScopedCpuTimer(ScopedCpuTimer const &) = delete;
+	ScopedCpuTimer(ScopedCpuTimer &&) = delete;
+	ScopedCpuTimer & operator = (ScopedCpuTimer const &) = delete;
+	ScopedCpuTimer & operator = (ScopedCpuTimer &&) = delete;
+	~ScopedCpuTimer() noexcept;
+
+private:
+	std::string m_name{};
+	std::chrono::steady_clock::time_point m_start{};
+};
+
+#endif // !TELEMETRY
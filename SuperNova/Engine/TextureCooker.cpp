@@ -0,0 +1,713 @@
+#include "PreCompiledHeader.hpp"
+#include "TextureCooker.h"
+#include "Telemetry.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm/vec4.hpp"
+#include "glm/glm/mat4x4.hpp"
+#include "glm/glm/common.hpp"
+#include "glm/glm/geometric.hpp"
+#include <cmath>
+
+// SSE2 is part of every x64 CPU, the filter needs nothing wider
+#if GLM_ARCH & GLM_ARCH_X86_BIT
+#	include <emmintrin.h>
+#	define TEXTURE_COOKER_X86
+#endif
+
+constexpr uint32_t BLOCK_DIMENSION = 4;
+constexpr uint32_t BLOCK_TEXELS = BLOCK_DIMENSION * BLOCK_DIMENSION;
+// Smallest number of blocks worth handing to another thread
+constexpr uint32_t MIN_ENCODE_CHUNK_BLOCKS = 1024;
+// Resolution of the linear to sRGB table, fine enough to hit every 8 bit value
+constexpr uint32_t LINEAR_TO_SRGB_STEPS = 4096;
+constexpr uint32_t POWER_ITERATIONS = 8;
+// Interpolation weights of BC7 4 bit indices, out of 64
+constexpr uint32_t BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+constexpr uint32_t BC7_MODE_6 = 6;
+
+namespace
+{
+	struct Block {
+		uint8_t texels[BLOCK_TEXELS][4]{};
+	};
+
+	// Four floats per texel, colour in linear space
+	struct LinearImage {
+		uint32_t width{ 0 };
+		uint32_t height{ 0 };
+		std::vector<float> texels{};
+	};
+
+	// 128 bit block filled from the least significant bit up
+	struct BlockBits {
+		uint64_t low{ 0 };
+		uint64_t high{ 0 };
+		uint32_t position{ 0 };
+
+		void Put(uint32_t t_value, uint32_t t_bits)
+		{
+			auto value = static_cast<uint64_t>(t_value) & ((uint64_t{ 1 } << t_bits) - 1);
+			if (position >= 64) {
+				high |= value << (position - 64);
+			}
+			else {
+				low |= value << position;
+				if (position + t_bits > 64) {
+					high |= value >> (64 - position);
+				}
+			}
+			position += t_bits;
+		}
+	};
+
+	float SrgbToLinear(float t_value)
+	{
+		return t_value <= 0.04045f ? t_value / 12.92f : std::pow((t_value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSrgb(float t_value)
+	{
+		return t_value <= 0.0031308f ? t_value * 12.92f : 1.055f * std::pow(t_value, 1.0f / 2.4f) - 0.055f;
+	}
+
+	std::vector<float> const & GetDecodeTable()
+	{
+		static auto const table = []() {
+			auto values = std::vector<float>(256);
+			for (auto i = size_t{ 0 }; i < values.size(); ++i) {
+				values[i] = SrgbToLinear(static_cast<float>(i) / 255.0f);
+			}
+			return values;
+		}();
+		return table;
+	}
+
+	std::vector<uint8_t> const & GetEncodeTable()
+	{
+		static auto const table = []() {
+			auto values = std::vector<uint8_t>(LINEAR_TO_SRGB_STEPS);
+			for (auto i = size_t{ 0 }; i < values.size(); ++i) {
+				auto linear = static_cast<float>(i) / static_cast<float>(LINEAR_TO_SRGB_STEPS - 1);
+				values[i] = static_cast<uint8_t>(std::lround(LinearToSrgb(linear) * 255.0f));
+			}
+			return values;
+		}();
+		return table;
+	}
+
+	LinearImage ToLinear(TextureImage const & t_image, bool t_srgb)
+	{
+		auto const & decode = GetDecodeTable();
+
+		auto linear = LinearImage{ t_image.width, t_image.height, std::vector<float>(t_image.texels.size()) };
+		for (auto i = size_t{ 0 }; i < t_image.texels.size(); ++i) {
+			auto value = t_image.texels[i];
+			linear.texels[i] = t_srgb && i % 4 != 3 ? decode[value] : static_cast<float>(value) / 255.0f;
+		}
+		return linear;
+	}
+
+	std::vector<uint8_t> ToBytes(LinearImage const & t_linear, bool t_srgb)
+	{
+		auto const & encode = GetEncodeTable();
+
+		auto bytes = std::vector<uint8_t>(t_linear.texels.size());
+		for (auto i = size_t{ 0 }; i < t_linear.texels.size(); ++i) {
+			auto value = std::clamp(t_linear.texels[i], 0.0f, 1.0f);
+			bytes[i] = t_srgb && i % 4 != 3 ?
+				encode[static_cast<size_t>(std::lround(value * static_cast<float>(LINEAR_TO_SRGB_STEPS - 1)))] :
+				static_cast<uint8_t>(std::lround(value * 255.0f));
+		}
+		return bytes;
+	}
+
+	// Source texels feeding one destination texel along an axis
+	struct FilterTaps {
+		uint32_t index[3]{};
+		float weight[3]{};
+		uint32_t count{ 0 };
+	};
+
+	// Even sizes average pairs. Odd ones weigh three texels by how much of each the
+	// wider destination texel covers, so every source texel counts exactly once
+	// and no row or column is lost.
+	std::vector<FilterTaps> GetDownsampleTaps(uint32_t t_source_size, uint32_t t_destination_size)
+	{
+		auto taps = std::vector<FilterTaps>(t_destination_size);
+		auto size = static_cast<float>(t_source_size);
+
+		for (auto i = uint32_t{ 0 }; i < t_destination_size; ++i) {
+			if (t_source_size == 1) {
+				taps[i] = FilterTaps{ { 0 }, { 1.0f }, 1 };
+			}
+			else if (t_source_size % 2 == 0) {
+				taps[i] = FilterTaps{ { i * 2, i * 2 + 1 }, { 0.5f, 0.5f }, 2 };
+			}
+			else {
+				taps[i] = FilterTaps{ { i * 2, i * 2 + 1, i * 2 + 2 }, {
+					static_cast<float>(t_destination_size - i) / size,
+					static_cast<float>(t_destination_size) / size,
+					static_cast<float>(i + 1) / size }, 3 };
+			}
+		}
+
+		return taps;
+	}
+
+	// Box filter halving each side, odd sides use the three tap weights above
+	LinearImage Downsample(LinearImage const & t_source)
+	{
+		auto destination = LinearImage{};
+		destination.width = std::max(t_source.width / 2, 1u);
+		destination.height = std::max(t_source.height / 2, 1u);
+		destination.texels.resize(static_cast<size_t>(destination.width) * destination.height * 4);
+
+		auto const columns = GetDownsampleTaps(t_source.width, destination.width);
+		auto const rows = GetDownsampleTaps(t_source.height, destination.height);
+		auto row_floats = static_cast<size_t>(t_source.width) * 4;
+		auto output = destination.texels.data();
+
+		for (auto y = uint32_t{ 0 }; y < destination.height; ++y) {
+			auto const & row_taps = rows[y];
+
+			for (auto x = uint32_t{ 0 }; x < destination.width; ++x, output += 4) {
+				auto const & column_taps = columns[x];
+#ifdef TEXTURE_COOKER_X86
+				auto sum = _mm_setzero_ps();
+				for (auto row = uint32_t{ 0 }; row < row_taps.count; ++row) {
+					auto source = t_source.texels.data() + row_taps.index[row] * row_floats;
+					auto row_sum = _mm_setzero_ps();
+					for (auto column = uint32_t{ 0 }; column < column_taps.count; ++column) {
+						row_sum = _mm_add_ps(row_sum, _mm_mul_ps(_mm_loadu_ps(source + column_taps.index[column] * 4), _mm_set1_ps(column_taps.weight[column])));
+					}
+					sum = _mm_add_ps(sum, _mm_mul_ps(row_sum, _mm_set1_ps(row_taps.weight[row])));
+				}
+				_mm_storeu_ps(output, sum);
+#else
+				for (auto channel = size_t{ 0 }; channel < 4; ++channel) {
+					auto sum = 0.0f;
+					for (auto row = uint32_t{ 0 }; row < row_taps.count; ++row) {
+						auto source = t_source.texels.data() + row_taps.index[row] * row_floats;
+						auto row_sum = 0.0f;
+						for (auto column = uint32_t{ 0 }; column < column_taps.count; ++column) {
+							row_sum += source[column_taps.index[column] * 4 + channel] * column_taps.weight[column];
+						}
+						sum += row_sum * row_taps.weight[row];
+					}
+					output[channel] = sum;
+				}
+#endif
+			}
+		}
+
+		return destination;
+	}
+
+	// Texels past the level's edge repeat the last row and column
+	void LoadBlock(uint8_t const * t_texels, uint32_t t_width, uint32_t t_height, uint32_t t_block_x, uint32_t t_block_y, Block & t_block)
+	{
+		for (auto y = uint32_t{ 0 }; y < BLOCK_DIMENSION; ++y) {
+			auto source_y = std::min(t_block_y * BLOCK_DIMENSION + y, t_height - 1);
+			for (auto x = uint32_t{ 0 }; x < BLOCK_DIMENSION; ++x) {
+				auto source_x = std::min(t_block_x * BLOCK_DIMENSION + x, t_width - 1);
+				std::memcpy(t_block.texels[y * BLOCK_DIMENSION + x], t_texels + (static_cast<size_t>(source_y) * t_width + source_x) * 4, 4);
+			}
+		}
+	}
+
+	glm::vec4 GetTexel(Block const & t_block, uint32_t t_index, glm::vec4 const & t_mask)
+	{
+		auto const & texel = t_block.texels[t_index];
+		return glm::vec4{ texel[0], texel[1], texel[2], texel[3] } * t_mask;
+	}
+
+	// End points of the line through the block's texels along their principal
+	// axis, found by power iteration on the covariance. Masked out channels stay 0
+	void FitLine(Block const & t_block, glm::vec4 const & t_mask, glm::vec4 & t_low, glm::vec4 & t_high)
+	{
+		auto mean = glm::vec4{ 0.0f };
+		for (auto i = uint32_t{ 0 }; i < BLOCK_TEXELS; ++i) {
+			mean += GetTexel(t_block, i, t_mask);
+		}
+		mean /= static_cast<float>(BLOCK_TEXELS);
+
+		auto covariance = glm::mat4{ 0.0f };
+		for (auto i = uint32_t{ 0 }; i < BLOCK_TEXELS; ++i) {
+			auto offset = GetTexel(t_block, i, t_mask) - mean;
+			for (auto column = 0; column < 4; ++column) {
+				covariance[column] += offset * offset[column];
+			}
+		}
+
+		// Starting from the channel that varies most, a start orthogonal to the
+		// principal axis (the bounding box diagonal of anti-correlated channels)
+		// can not happen
+		auto widest = 0;
+		for (auto channel = 1; channel < 4; ++channel) {
+			if (covariance[channel][channel] > covariance[widest][widest]) {
+				widest = channel;
+			}
+		}
+
+		auto axis = covariance[widest];
+		for (auto iteration = uint32_t{ 0 }; iteration < POWER_ITERATIONS; ++iteration) {
+			axis = covariance * axis;
+			auto largest = std::max(std::max(std::abs(axis.x), std::abs(axis.y)), std::max(std::abs(axis.z), std::abs(axis.w)));
+			if (largest < 1e-6f) {
+				break;
+			}
+			axis /= largest;
+		}
+
+		auto length = glm::length(axis);
+		if (length < 1e-6f) {
+			t_low = mean;
+			t_high = mean;
+			return;
+		}
+		axis /= length;
+
+		auto first = std::numeric_limits<float>::max();
+		auto last = std::numeric_limits<float>::lowest();
+		for (auto i = uint32_t{ 0 }; i < BLOCK_TEXELS; ++i) {
+			auto projection = glm::dot(GetTexel(t_block, i, t_mask) - mean, axis);
+			first = std::min(first, projection);
+			last = std::max(last, projection);
+		}
+
+		t_low = glm::clamp(mean + axis * first, glm::vec4{ 0.0f }, glm::vec4{ 255.0f });
+		t_high = glm::clamp(mean + axis * last, glm::vec4{ 0.0f }, glm::vec4{ 255.0f });
+	}
+
+	uint32_t SquaredDistance(uint8_t const * t_a, uint32_t const * t_b, uint32_t t_channels)
+	{
+		auto distance = uint32_t{ 0 };
+		for (auto channel = uint32_t{ 0 }; channel < t_channels; ++channel) {
+			auto difference = static_cast<int32_t>(t_a[channel]) - static_cast<int32_t>(t_b[channel]);
+			distance += static_cast<uint32_t>(difference * difference);
+		}
+		return distance;
+	}
+
+	uint32_t FindClosest(uint8_t const * t_texel, uint32_t const (*t_palette)[4], uint32_t t_palette_size, uint32_t t_channels)
+	{
+		auto best = uint32_t{ 0 };
+		auto best_distance = std::numeric_limits<uint32_t>::max();
+		for (auto entry = uint32_t{ 0 }; entry < t_palette_size; ++entry) {
+			auto distance = SquaredDistance(t_texel, t_palette[entry], t_channels);
+			if (distance < best_distance) {
+				best = entry;
+				best_distance = distance;
+			}
+		}
+		return best;
+	}
+
+	uint16_t Pack565(glm::vec4 const & t_color)
+	{
+		auto red = static_cast<uint32_t>(std::lround(t_color.r * 31.0f / 255.0f));
+		auto green = static_cast<uint32_t>(std::lround(t_color.g * 63.0f / 255.0f));
+		auto blue = static_cast<uint32_t>(std::lround(t_color.b * 31.0f / 255.0f));
+		return static_cast<uint16_t>((red << 11) | (green << 5) | blue);
+	}
+
+	void Unpack565(uint16_t t_color, uint32_t (&t_rgb)[4])
+	{
+		auto red = (t_color >> 11) & 31u;
+		auto green = (t_color >> 5) & 63u;
+		auto blue = t_color & 31u;
+		t_rgb[0] = (red << 3) | (red >> 2);
+		t_rgb[1] = (green << 2) | (green >> 4);
+		t_rgb[2] = (blue << 3) | (blue >> 2);
+		t_rgb[3] = 255;
+	}
+
+	// Always the four colour mode, BC3 has no other
+	void EncodeBc1(Block const & t_block, uint8_t * t_output)
+	{
+		auto low = glm::vec4{};
+		auto high = glm::vec4{};
+		FitLine(t_block, glm::vec4{ 1.0f, 1.0f, 1.0f, 0.0f }, low, high);
+
+		auto color0 = Pack565(high);
+		auto color1 = Pack565(low);
+		if (color0 < color1) {
+			std::swap(color0, color1);
+		}
+
+		uint32_t palette[4][4]{};
+		Unpack565(color0, palette[0]);
+		Unpack565(color1, palette[1]);
+		for (auto channel = 0; channel < 3; ++channel) {
+			palette[2][channel] = (2 * palette[0][channel] + palette[1][channel]) / 3;
+			palette[3][channel] = (palette[0][channel] + 2 * palette[1][channel]) / 3;
+		}
+
+		// Equal end points would select the three colour mode, index 0 is right in both
+		auto indices = uint32_t{ 0 };
+		if (color0 != color1) {
+			for (auto i = uint32_t{ 0 }; i < BLOCK_TEXELS; ++i) {
+				indices |= FindClosest(t_block.texels[i], palette, 4, 3) << (i * 2);
+			}
+		}
+
+		t_output[0] = static_cast<uint8_t>(color0 & 0xFF);
+		t_output[1] = static_cast<uint8_t>(color0 >> 8);
+		t_output[2] = static_cast<uint8_t>(color1 & 0xFF);
+		t_output[3] = static_cast<uint8_t>(color1 >> 8);
+		for (auto byte = 0; byte < 4; ++byte) {
+			t_output[4 + byte] = static_cast<uint8_t>(indices >> (byte * 8));
+		}
+	}
+
+	// Single channel block, the eight value mode between the channel's extremes
+	void EncodeBc4(Block const & t_block, uint32_t t_channel, uint8_t * t_output)
+	{
+		auto minimum = uint32_t{ 255 };
+		auto maximum = uint32_t{ 0 };
+		for (auto i = uint32_t{ 0 }; i < BLOCK_TEXELS; ++i) {
+			minimum = std::min<uint32_t>(minimum, t_block.texels[i][t_channel]);
+			maximum = std::max<uint32_t>(maximum, t_block.texels[i][t_channel]);
+		}
+
+		uint32_t palette[8][4]{};
+		palette[0][0] = maximum;
+		palette[1][0] = minimum;
+		for (auto entry = uint32_t{ 2 }; entry < 8; ++entry) {
+			palette[entry][0] = ((8 - entry) * maximum + (entry - 1) * minimum + 3) / 7;
+		}
+
+		auto indices = uint64_t{ 0 };
+		if (maximum != minimum) {
+			for (auto i = uint32_t{ 0 }; i < BLOCK_TEXELS; ++i) {
+				indices |= static_cast<uint64_t>(FindClosest(&t_block.texels[i][t_channel], palette, 8, 1)) << (i * 3);
+			}
+		}
+
+		t_output[0] = static_cast<uint8_t>(maximum);
+		t_output[1] = static_cast<uint8_t>(minimum);
+		for (auto byte = 0; byte < 6; ++byte) {
+			t_output[2 + byte] = static_cast<uint8_t>(indices >> (byte * 8));
+		}
+	}
+
+	// Seven bits per channel plus a p-bit shared by the end point's channels
+	void QuantizeBc7EndPoint(glm::vec4 const & t_end_point, uint32_t (&t_quantized)[4], uint32_t & t_p_bit)
+	{
+		auto best_error = std::numeric_limits<float>::max();
+		for (auto p_bit = uint32_t{ 0 }; p_bit < 2; ++p_bit) {
+			uint32_t quantized[4]{};
+			auto error = 0.0f;
+			for (auto channel = 0; channel < 4; ++channel) {
+				auto value = std::lround((t_end_point[channel] - static_cast<float>(p_bit)) * 0.5f);
+				quantized[channel] = static_cast<uint32_t>(std::clamp(value, 0l, 127l));
+				auto difference = static_cast<float>((quantized[channel] << 1) | p_bit) - t_end_point[channel];
+				error += difference * difference;
+			}
+			if (error < best_error) {
+				best_error = error;
+				t_p_bit = p_bit;
+				std::copy(std::begin(quantized), std::end(quantized), std::begin(t_quantized));
+			}
+		}
+	}
+
+	void EncodeBc7(Block const & t_block, uint8_t * t_output)
+	{
+		auto low = glm::vec4{};
+		auto high = glm::vec4{};
+		FitLine(t_block, glm::vec4{ 1.0f }, low, high);
+
+		uint32_t quantized[2][4]{};
+		uint32_t p_bits[2]{};
+		QuantizeBc7EndPoint(low, quantized[0], p_bits[0]);
+		QuantizeBc7EndPoint(high, quantized[1], p_bits[1]);
+
+		uint32_t palette[16][4]{};
+		for (auto entry = uint32_t{ 0 }; entry < 16; ++entry) {
+			for (auto channel = 0; channel < 4; ++channel) {
+				auto end0 = (quantized[0][channel] << 1) | p_bits[0];
+				auto end1 = (quantized[1][channel] << 1) | p_bits[1];
+				palette[entry][channel] = ((64 - BC7_WEIGHTS[entry]) * end0 + BC7_WEIGHTS[entry] * end1 + 32) >> 6;
+			}
+		}
+
+		uint32_t indices[BLOCK_TEXELS]{};
+		for (auto i = uint32_t{ 0 }; i < BLOCK_TEXELS; ++i) {
+			indices[i] = FindClosest(t_block.texels[i], palette, 16, 4);
+		}
+
+		// The first index is stored without its top bit, which must be clear. The
+		// weights are symmetric, so swapping end points mirrors the indices
+		if (indices[0] & 8) {
+			std::swap(quantized[0], quantized[1]);
+			std::swap(p_bits[0], p_bits[1]);
+			for (auto & index : indices) {
+				index = 15 - index;
+			}
+		}
+
+		auto bits = BlockBits{};
+		bits.Put(1u << BC7_MODE_6, BC7_MODE_6 + 1);
+		for (auto channel = 0; channel < 4; ++channel) {
+			bits.Put(quantized[0][channel], 7);
+			bits.Put(quantized[1][channel], 7);
+		}
+		bits.Put(p_bits[0], 1);
+		bits.Put(p_bits[1], 1);
+		bits.Put(indices[0], 3);
+		for (auto i = uint32_t{ 1 }; i < BLOCK_TEXELS; ++i) {
+			bits.Put(indices[i], 4);
+		}
+
+		for (auto byte = 0; byte < 8; ++byte) {
+			t_output[byte] = static_cast<uint8_t>(bits.low >> (byte * 8));
+			t_output[8 + byte] = static_cast<uint8_t>(bits.high >> (byte * 8));
+		}
+	}
+
+	void EncodeBlock(Block const & t_block, TEXTURE_ENCODING t_encoding, uint8_t * t_output)
+	{
+		switch (t_encoding)
+		{
+		case TE_BC1: EncodeBc1(t_block, t_output); break;
+		case TE_BC3: EncodeBc4(t_block, 3, t_output); EncodeBc1(t_block, t_output + 8); break;
+		case TE_BC5: EncodeBc4(t_block, 0, t_output); EncodeBc4(t_block, 1, t_output + 8); break;
+		case TE_BC7: EncodeBc7(t_block, t_output); break;
+		default: break;
+		}
+	}
+
+	std::vector<uint8_t> EncodeLevel(std::vector<uint8_t> const & t_texels, uint32_t t_width, uint32_t t_height, TEXTURE_ENCODING t_encoding)
+	{
+		auto block_bytes = TextureCooker::GetBlockBytes(t_encoding);
+		if (block_bytes == 0) {
+			return t_texels;
+		}
+
+		auto blocks_x = (t_width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+		auto blocks_y = (t_height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+		auto encoded = std::vector<uint8_t>(static_cast<size_t>(blocks_x) * blocks_y * block_bytes);
+
+		auto encode_rows = [&](uint32_t t_begin, uint32_t t_end) {
+			auto block = Block{};
+			for (auto block_y = t_begin; block_y < t_end; ++block_y) {
+				for (auto block_x = uint32_t{ 0 }; block_x < blocks_x; ++block_x) {
+					LoadBlock(t_texels.data(), t_width, t_height, block_x, block_y, block);
+					EncodeBlock(block, t_encoding, encoded.data() + (static_cast<size_t>(block_y) * blocks_x + block_x) * block_bytes);
+				}
+			}
+		};
+
+		auto chunk_count = std::min(
+			(blocks_x * blocks_y + MIN_ENCODE_CHUNK_BLOCKS - 1) / MIN_ENCODE_CHUNK_BLOCKS,
+			std::min(std::max(std::thread::hardware_concurrency(), 1u), blocks_y));
+		auto rows_per_chunk = (blocks_y + chunk_count - 1) / chunk_count;
+
+		// The calling thread takes the first chunk instead of waiting idle
+		auto tasks = std::vector<std::future<void>>{};
+		tasks.reserve(chunk_count - 1);
+		for (auto chunk = uint32_t{ 1 }; chunk < chunk_count; ++chunk) {
+			auto begin = std::min(chunk * rows_per_chunk, blocks_y);
+			auto end = std::min(begin + rows_per_chunk, blocks_y);
+			tasks.emplace_back(std::async(std::launch::async, encode_rows, begin, end));
+		}
+
+		encode_rows(0, std::min(rows_per_chunk, blocks_y));
+
+		for (auto & task : tasks) {
+			task.get();
+		}
+
+		return encoded;
+	}
+
+	uint32_t ReadHeaderValue(std::istream & t_file, std::string const & t_path)
+	{
+		t_file >> std::ws;
+		while (t_file.peek() == '#') {
+			t_file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+			t_file >> std::ws;
+		}
+
+		auto value = uint32_t{ 0 };
+		t_file >> value;
+		if (!t_file) {
+			throw std::runtime_error("Texture cooker - Bad image header in " + t_path);
+		}
+		return value;
+	}
+
+	uint64_t AlignFileOffset(uint64_t t_offset)
+	{
+		return (t_offset + TEXTURE_FILE_ALIGNMENT - 1) & ~(TEXTURE_FILE_ALIGNMENT - 1);
+	}
+}
+
+CookedTexture TextureCooker::Cook(TextureImage const & t_image, Settings const & t_settings)
+{
+	auto timer = ScopedCpuTimer{ "Texture Cook" };
+
+	if (t_image.width == 0 || t_image.height == 0 || t_image.texels.size() != static_cast<size_t>(t_image.width) * t_image.height * 4) {
+		throw std::runtime_error("Texture cooker - Image size does not match its texels");
+	}
+
+	auto srgb = t_settings.srgb && t_settings.encoding != TE_BC5;
+	auto full_chain = static_cast<uint32_t>(std::floor(std::log2(static_cast<float>(std::max(t_image.width, t_image.height))))) + 1;
+	auto mip_count = t_settings.max_mips == 0 ? full_chain : std::min(t_settings.max_mips, full_chain);
+
+	auto cooked = CookedTexture{};
+	cooked.header.format = GetFormat(t_settings.encoding, srgb);
+	cooked.header.width = t_image.width;
+	cooked.header.height = t_image.height;
+	cooked.header.mip_count = mip_count;
+
+	// Level 0 is encoded straight from the source, every other level is rounded
+	// to 8 bits once, right before encoding
+	auto linear = ToLinear(t_image, srgb);
+	for (auto level = uint32_t{ 0 }; level < mip_count; ++level) {
+		if (level == 0) {
+			cooked.levels.emplace_back(EncodeLevel(t_image.texels, linear.width, linear.height, t_settings.encoding));
+		}
+		else {
+			linear = Downsample(linear);
+			cooked.levels.emplace_back(EncodeLevel(ToBytes(linear, srgb), linear.width, linear.height, t_settings.encoding));
+		}
+
+		auto mip = TextureFileMip{};
+		mip.size = cooked.levels.back().size();
+		mip.width = linear.width;
+		mip.height = linear.height;
+		cooked.mips.emplace_back(mip);
+	}
+
+	return cooked;
+}
+
+void TextureCooker::Write(std::string const & t_path, CookedTexture const & t_cooked)
+{
+	if (t_cooked.mips.size() != t_cooked.levels.size() || t_cooked.mips.size() != t_cooked.header.mip_count) {
+		throw std::runtime_error("Texture cooker - Mip table does not match the encoded levels");
+	}
+
+	auto mips = t_cooked.mips;
+	auto offset = AlignFileOffset(sizeof(TextureFileHeader) + sizeof(TextureFileMip) * mips.size());
+	for (auto level = mips.size(); level-- > 0;) {
+		mips[level].offset = offset;
+		mips[level].size = t_cooked.levels[level].size();
+		offset = AlignFileOffset(offset + mips[level].size);
+	}
+
+	auto file = std::ofstream{ t_path, std::ios::binary };
+	if (!file) {
+		throw std::runtime_error("Texture cooker - Could not create " + t_path);
+	}
+
+	file.write(reinterpret_cast<char const *>(&t_cooked.header), sizeof(TextureFileHeader));
+	file.write(reinterpret_cast<char const *>(mips.data()), static_cast<std::streamsize>(sizeof(TextureFileMip) * mips.size()));
+
+	auto position = static_cast<uint64_t>(sizeof(TextureFileHeader) + sizeof(TextureFileMip) * mips.size());
+	char const padding[TEXTURE_FILE_ALIGNMENT]{};
+	for (auto level = mips.size(); level-- > 0;) {
+		file.write(padding, static_cast<std::streamsize>(mips[level].offset - position));
+		file.write(reinterpret_cast<char const *>(t_cooked.levels[level].data()), static_cast<std::streamsize>(mips[level].size));
+		position = mips[level].offset + mips[level].size;
+	}
+
+	if (!file) {
+		throw std::runtime_error("Texture cooker - Could not write " + t_path);
+	}
+}
+
+void TextureCooker::CookFile(std::string const & t_source, std::string const & t_destination, Settings const & t_settings)
+{
+	Write(t_destination, Cook(ReadImage(t_source), t_settings));
+}
+
+TextureImage TextureCooker::ReadImage(std::string const & t_path)
+{
+	auto file = std::ifstream{ t_path, std::ios::binary };
+	if (!file) {
+		throw std::runtime_error("Texture cooker - Could not open " + t_path);
+	}
+
+	auto image = TextureImage{};
+	auto channels = uint32_t{ 0 };
+	auto max_value = uint32_t{ 0 };
+
+	auto magic = std::string{};
+	file >> magic;
+	if (magic == "P6") {
+		image.width = ReadHeaderValue(file, t_path);
+		image.height = ReadHeaderValue(file, t_path);
+		max_value = ReadHeaderValue(file, t_path);
+		channels = 3;
+	}
+	else if (magic == "P7") {
+		auto key = std::string{};
+		while (file >> key && key != "ENDHDR") {
+			if (key == "WIDTH") { image.width = ReadHeaderValue(file, t_path); }
+			else if (key == "HEIGHT") { image.height = ReadHeaderValue(file, t_path); }
+			else if (key == "DEPTH") { channels = ReadHeaderValue(file, t_path); }
+			else if (key == "MAXVAL") { max_value = ReadHeaderValue(file, t_path); }
+			else { file.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); }
+		}
+	}
+	else {
+		throw std::runtime_error("Texture cooker - " + t_path + " is not a binary PPM or PAM image");
+	}
+
+	// A single whitespace character separates the header from the pixels
+	(void)file.get();
+
+	if (!file || image.width == 0 || image.height == 0 || channels == 0 || channels > 4 || max_value != 255) {
+		throw std::runtime_error("Texture cooker - Unsupported image layout in " + t_path);
+	}
+
+	auto texel_count = static_cast<size_t>(image.width) * image.height;
+	auto raw = std::vector<uint8_t>(texel_count * channels);
+	file.read(reinterpret_cast<char *>(raw.data()), static_cast<std::streamsize>(raw.size()));
+	if (!file) {
+		throw std::runtime_error("Texture cooker - Truncated pixel data in " + t_path);
+	}
+
+	// Grey images fill the colour channels, missing alpha is opaque
+	image.texels.resize(texel_count * 4);
+	for (auto i = size_t{ 0 }; i < texel_count; ++i) {
+		auto source = raw.data() + i * channels;
+		auto destination = image.texels.data() + i * 4;
+		auto grey = channels < 3;
+		destination[0] = source[0];
+		destination[1] = grey ? source[0] : source[1];
+		destination[2] = grey ? source[0] : source[2];
+		destination[3] = channels == 2 ? source[1] : channels == 4 ? source[3] : 255;
+	}
+
+	return image;
+}
+
+VkFormat TextureCooker::GetFormat(TEXTURE_ENCODING t_encoding, bool t_srgb) noexcept
+{
+	switch (t_encoding)
+	{
+	case TE_BC1: return t_srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	case TE_BC3: return t_srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+	case TE_BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+	case TE_BC7: return t_srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+	default: return t_srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+	}
+}
+
+uint32_t TextureCooker::GetBlockBytes(TEXTURE_ENCODING t_encoding) noexcept
+{
+	switch (t_encoding)
+	{
+	case TE_BC1: return 8;
+	case TE_BC3:
+	case TE_BC5:
+	case TE_BC7: return 16;
+	default: return 0;
+	}
+}
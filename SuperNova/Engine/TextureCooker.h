@@ -0,0 +1,66 @@
+#ifndef TEXTURE_COOKER
+#define TEXTURE_COOKER
+
+#include "vulkan/vulkan.h"
+#include "TextureFormat.h"
+
+enum TEXTURE_ENCODING
+{
+	TE_BC1 = 0,
+	TE_BC3,
+	TE_BC5,
+	TE_BC7,
+	TE_RGBA8
+};
+
+// Source pixels, 8 bit RGBA rows top to bottom
+struct TextureImage {
+	uint32_t width{ 0 };
+	uint32_t height{ 0 };
+	std::vector<uint8_t> texels{};
+};
+
+// Encoded levels in the order of the file's mip table, mip 0 the largest
+struct CookedTexture {
+	TextureFileHeader header{};
+	std::vector<TextureFileMip> mips{};
+	std::vector<std::vector<uint8_t>> levels{};
+};
+
+// Cook time texture processing. The mip chain is box filtered in linear space
+// (colour channels of sRGB sources are decoded first, alpha never is) on float
+// texels, four channels to an SSE register, so no level is requantised before it
+// is encoded. Levels are encoded block by block with chunks of blocks spread over
+// all cores.
+//
+// The encoders favour speed over the last bit of quality, endpoints come from
+// the principal axis of each block's colours. BC7 always uses mode 6, one subset
+// with alpha and 4 bit indices, which every decoder handles and most content
+// compresses well with. BC5 is for normal maps and similar data, it ignores sRGB.
+class TextureCooker
+{
+public:
+	struct Settings {
+		TEXTURE_ENCODING encoding{ TE_BC7 };
+		bool srgb{ true };
+		// 0 builds the full chain down to 1x1
+		uint32_t max_mips{ 0 };
+	};
+
+	TextureCooker() = delete;
+
+	[[nodiscard]] static CookedTexture Cook(TextureImage const &, Settings const &);
+	// Mip data goes smallest level first, so the tail every load reads is one
+	// contiguous range right after the mip table
+	static void Write(std::string const &, CookedTexture const &);
+	static void CookFile(std::string const &, std::string const &, Settings const &);
+
+	// Binary netpbm, P6 (PPM) or P7 (PAM) with 1 to 4 channels of 8 bits
+	[[nodiscard]] static TextureImage ReadImage(std::string const &);
+
+	[[nodiscard]] static VkFormat GetFormat(TEXTURE_ENCODING, bool) noexcept;
+	// 0 for uncompressed encodings
+	[[nodiscard]] static uint32_t GetBlockBytes(TEXTURE_ENCODING) noexcept;
+};
+
+#endif // !TEXTURE_COOKER
@@ -0,0 +1,37 @@
+#ifndef TEXTURE_FORMAT
+#define TEXTURE_FORMAT
+
+#include "vulkan/vulkan.h"
+
+// Layout of cooked texture files. A header, then one table entry per mip with
+// mip 0 the largest, then the mip data in whatever order the cooker wrote it.
+// Every mip is found through its own offset so a streamer can read any one of
+// them alone. Data is exactly what vkCmdCopyBufferToImage expects for the
+// format, tightly packed.
+constexpr uint32_t TEXTURE_FILE_MAGIC = 0x58544E53; // "SNTX"
+constexpr uint32_t TEXTURE_FILE_VERSION = 1;
+// Mip data offsets are aligned to this, enough for any texel block
+constexpr uint64_t TEXTURE_FILE_ALIGNMENT = 16;
+
+struct TextureFileHeader {
+	uint32_t magic{ TEXTURE_FILE_MAGIC };
+	uint32_t version{ TEXTURE_FILE_VERSION };
+	VkFormat format{ VK_FORMAT_UNDEFINED };
+	uint32_t width{ 0 };
+	uint32_t height{ 0 };
+	uint32_t mip_count{ 0 };
+	uint32_t flags{ 0 };
+	uint32_t reserved{ 0 };
+};
+
+struct TextureFileMip {
+	uint64_t offset{ 0 };
+	uint64_t size{ 0 };
+	uint32_t width{ 0 };
+	uint32_t height{ 0 };
+};
+
+static_assert(sizeof(TextureFileHeader) == 32, "Texture file header layout changed");
+static_assert(sizeof(TextureFileMip) == 24, "Texture file mip layout changed");
+
+#endif // !TEXTURE_FORMAT
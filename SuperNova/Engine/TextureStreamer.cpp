@@ -0,0 +1,374 @@
+#include "PreCompiledHeader.hpp"
+#include "TextureStreamer.h"
+#include "Application.hpp"
+#include "Telemetry.h"
+#include "VulkanUtils.h"
+#include <cmath>
+
+// Mips this size and smaller make up the tail that is loaded with the texture
+constexpr uint32_t TAIL_SIZE = 64;
+// File reads running at once, evictions included
+constexpr uint32_t MAX_CONCURRENT_LOADS = 4;
+
+void TextureStreamer::Create(VkPhysicalDevice const & t_physical_device, UploadQueue & t_upload_queue, GpuTimeline & t_timeline, VkDeviceSize t_budget)
+{
+	m_physical_device = t_physical_device;
+	m_upload_queue = &t_upload_queue;
+	m_timeline = &t_timeline;
+	m_budget = t_budget;
+	m_resident_bytes = 0;
+	m_frame = 0;
+}
+
+void TextureStreamer::Destroy(VkDevice const & t_device) noexcept
+{
+	for (auto & texture : m_textures) {
+		if (texture.pending.has_value()) {
+			texture.pending->data.wait();
+		}
+		Release(t_device, texture);
+	}
+	m_textures.clear();
+	m_resident_bytes = 0;
+}
+
+TextureStreamer::TextureHandle TextureStreamer::Load(VkDevice const & t_device, std::string const & t_path)
+{
+	auto texture = Texture{};
+	texture.path = t_path;
+
+	auto file = std::ifstream{ t_path, std::ios::binary };
+	if (!file) {
+		throw std::runtime_error("Texture streamer - Could not open " + t_path);
+	}
+
+	file.read(reinterpret_cast<char *>(&texture.header), sizeof(texture.header));
+	if (!file || texture.header.magic != TEXTURE_FILE_MAGIC || texture.header.version != TEXTURE_FILE_VERSION || texture.header.mip_count == 0) {
+		throw std::runtime_error("Texture streamer - Not a texture file " + t_path);
+	}
+
+	texture.mips.resize(texture.header.mip_count);
+	file.read(reinterpret_cast<char *>(texture.mips.data()), static_cast<std::streamsize>(sizeof(TextureFileMip) * texture.mips.size()));
+	if (!file) {
+		throw std::runtime_error("Texture streamer - Truncated mip table in " + t_path);
+	}
+
+	auto format_properties = VkFormatProperties{};
+	vkGetPhysicalDeviceFormatProperties(m_physical_device, texture.header.format, &format_properties);
+	if ((format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) == 0) {
+		throw std::runtime_error("Texture streamer - Format of " + t_path + " can not be sampled on this device");
+	}
+
+	texture.tail_mip = texture.header.mip_count - 1;
+	for (auto mip = uint32_t{ 0 }; mip < texture.header.mip_count; ++mip) {
+		if (std::max(texture.mips[mip].width, texture.mips[mip].height) <= TAIL_SIZE) {
+			texture.tail_mip = mip;
+			break;
+		}
+	}
+	texture.desired_mip = texture.tail_mip;
+
+	Rebuild(t_device, texture, texture.tail_mip, ReadMips(t_path, texture.mips, texture.tail_mip));
+
+	m_textures.emplace_back(std::move(texture));
+	return static_cast<TextureHandle>(m_textures.size() - 1);
+}
+
+void TextureStreamer::ReportCoverage(TextureHandle t_handle, float t_pixels)
+{
+	auto & texture = m_textures.at(t_handle);
+	if (t_pixels <= 0.0f) {
+		return;
+	}
+
+	// One texel per pixel along the texture's longer side
+	auto size = static_cast<float>(std::max(texture.header.width, texture.header.height));
+	auto mip = std::clamp(std::floor(std::log2(size / t_pixels)), 0.0f, static_cast<float>(texture.tail_mip));
+
+	texture.desired_mip = std::min(texture.desired_mip, static_cast<uint32_t>(mip));
+	texture.last_demanded = m_frame;
+}
+
+void TextureStreamer::Update(VkDevice const & t_device, uint64_t t_frame)
+{
+	CompleteLoads(t_device);
+
+	auto in_flight = static_cast<uint32_t>(std::count_if(m_textures.begin(), m_textures.end(),
+		[](Texture const & t_texture) { return t_texture.pending.has_value(); }));
+
+	// The textures furthest from what the screen asks for are served first
+	auto starved = std::vector<Texture *>{};
+	for (auto & texture : m_textures) {
+		if (!texture.pending.has_value() && texture.desired_mip < texture.resident_mip) {
+			starved.emplace_back(&texture);
+		}
+	}
+	std::sort(starved.begin(), starved.end(), [](Texture const * t_a, Texture const * t_b) {
+		return t_a->resident_mip - t_a->desired_mip > t_b->resident_mip - t_b->desired_mip;
+	});
+
+	for (auto texture : starved) {
+		if (in_flight >= MAX_CONCURRENT_LOADS) {
+			break;
+		}
+
+		auto growth = GetMipBytes(*texture, texture->desired_mip) - GetMipBytes(*texture, texture->resident_mip);
+		MakeRoom(growth, m_frame, in_flight);
+		if (in_flight >= MAX_CONCURRENT_LOADS || GetCommittedBytes() + growth > m_budget) {
+			continue;
+		}
+
+		StartLoad(*texture, texture->desired_mip);
+		++in_flight;
+	}
+
+	// Demand is rebuilt from scratch by every frame's reports
+	for (auto & texture : m_textures) {
+		texture.desired_mip = texture.tail_mip;
+	}
+	m_frame = t_frame;
+
+	Telemetry::Record(TS_COUNTER, "Texture Resident MiB", static_cast<double>(m_resident_bytes) / (1024.0 * 1024.0));
+	Telemetry::Record(TS_COUNTER, "Texture Loads In Flight", in_flight);
+}
+
+VkImageView TextureStreamer::GetView(TextureHandle t_handle) const
+{
+	return m_textures.at(t_handle).view;
+}
+
+uint32_t TextureStreamer::GetResidentMip(TextureHandle t_handle) const
+{
+	return m_textures.at(t_handle).resident_mip;
+}
+
+VkDeviceSize TextureStreamer::GetResidentBytes() const noexcept
+{
+	return m_resident_bytes;
+}
+
+std::vector<uint8_t> TextureStreamer::ReadMips(std::string const & t_path, std::vector<TextureFileMip> const & t_mips, uint32_t t_first_mip)
+{
+	auto size = uint64_t{ 0 };
+	for (auto mip = t_first_mip; mip < t_mips.size(); ++mip) {
+		size += t_mips[mip].size;
+	}
+
+	auto file = std::ifstream{ t_path, std::ios::binary };
+	if (!file) {
+		throw std::runtime_error("Texture streamer - Could not open " + t_path);
+	}
+
+	auto data = std::vector<uint8_t>(static_cast<size_t>(size));
+	auto destination = data.data();
+	for (auto mip = t_first_mip; mip < t_mips.size(); ++mip) {
+		file.seekg(static_cast<std::streamoff>(t_mips[mip].offset));
+		file.read(reinterpret_cast<char *>(destination), static_cast<std::streamsize>(t_mips[mip].size));
+		destination += t_mips[mip].size;
+	}
+
+	if (!file) {
+		throw std::runtime_error("Texture streamer - Truncated mip data in " + t_path);
+	}
+
+	return data;
+}
+
+VkDeviceSize TextureStreamer::GetMipBytes(Texture const & t_texture, uint32_t t_first_mip) noexcept
+{
+	auto size = VkDeviceSize{ 0 };
+	for (auto mip = t_first_mip; mip < t_texture.mips.size(); ++mip) {
+		size += t_texture.mips[mip].size;
+	}
+	return size;
+}
+
+void TextureStreamer::Rebuild(VkDevice const & t_device, Texture & t_texture, uint32_t t_first_mip, std::vector<uint8_t> const & t_data)
+{
+	auto const & top = t_texture.mips[t_first_mip];
+	auto levels = t_texture.header.mip_count - t_first_mip;
+
+	// Checked before anything is created, a full upload queue fails cheaply
+	if (!m_upload_queue->CanStage(static_cast<VkDeviceSize>(t_data.size()))) {
+		throw std::runtime_error("Texture streamer - No upload batch free for " + t_texture.path);
+	}
+
+	auto image_info = VkImageCreateInfo{};
+	image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_info.imageType = VK_IMAGE_TYPE_2D;
+	image_info.format = t_texture.header.format;
+	image_info.extent = { top.width, top.height, 1 };
+	image_info.mipLevels = levels;
+	image_info.arrayLayers = 1;
+	image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	auto image = VkImage{ VK_NULL_HANDLE };
+	auto result = vkCreateImage(t_device, &image_info, nullptr, &image);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("create streamed texture", result);
+	}
+
+	auto requirements = VkMemoryRequirements{};
+	vkGetImageMemoryRequirements(t_device, image, &requirements);
+
+	auto allocate_info = VkMemoryAllocateInfo{};
+	allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocate_info.allocationSize = requirements.size;
+	allocate_info.memoryTypeIndex = vulkan_utils::FindMemoryType(m_physical_device, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	auto memory = VkDeviceMemory{ VK_NULL_HANDLE };
+	result = vkAllocateMemory(t_device, &allocate_info, nullptr, &memory);
+	if (result != VK_SUCCESS) {
+		vkDestroyImage(t_device, image, nullptr);
+		vulkan_utils::ThrowError("allocate streamed texture memory", result);
+	}
+	vkBindImageMemory(t_device, image, memory, 0);
+
+	auto view_info = VkImageViewCreateInfo{};
+	view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	view_info.image = image;
+	view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	view_info.format = t_texture.header.format;
+	view_info.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levels, 0, 1 };
+
+	auto view = VkImageView{ VK_NULL_HANDLE };
+	result = vkCreateImageView(t_device, &view_info, nullptr, &view);
+	if (result != VK_SUCCESS) {
+		vkFreeMemory(t_device, memory, nullptr);
+		vkDestroyImage(t_device, image, nullptr);
+		vulkan_utils::ThrowError("create streamed texture view", result);
+	}
+
+	auto upload = UploadQueue::ImageUpload{};
+	upload.image = image;
+	upload.mip_levels = levels;
+	auto offset = VkDeviceSize{ 0 };
+	for (auto mip = t_first_mip; mip < t_texture.header.mip_count; ++mip) {
+		auto region = VkBufferImageCopy{};
+		region.bufferOffset = offset;
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - t_first_mip, 0, 1 };
+		region.imageExtent = { t_texture.mips[mip].width, t_texture.mips[mip].height, 1 };
+		upload.regions.emplace_back(region);
+		offset += t_texture.mips[mip].size;
+	}
+
+	try {
+		(void)m_upload_queue->UploadImage(t_device, upload, t_data.data(), static_cast<VkDeviceSize>(t_data.size()),
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	}
+	catch (...) {
+		vkDestroyImageView(t_device, view, nullptr);
+		vkDestroyImage(t_device, image, nullptr);
+		vkFreeMemory(t_device, memory, nullptr);
+		throw;
+	}
+
+	// Frames up to the one being recorded may still sample the old image
+	if (t_texture.image != VK_NULL_HANDLE) {
+		m_timeline->Retire(m_timeline->GetNextPoint(GQ_GRAPHICS),
+			[old_image = t_texture.image, old_view = t_texture.view, old_memory = t_texture.memory](VkDevice const & t_retired_device) {
+				vkDestroyImageView(t_retired_device, old_view, nullptr);
+				vkDestroyImage(t_retired_device, old_image, nullptr);
+				vkFreeMemory(t_retired_device, old_memory, nullptr);
+			});
+	}
+
+	m_resident_bytes = m_resident_bytes - t_texture.resident_bytes + requirements.size;
+	t_texture.image = image;
+	t_texture.memory = memory;
+	t_texture.view = view;
+	t_texture.resident_bytes = requirements.size;
+	t_texture.resident_mip = t_first_mip;
+}
+
+void TextureStreamer::StartLoad(Texture & t_texture, uint32_t t_first_mip)
+{
+	auto read = [path = t_texture.path, mips = t_texture.mips, t_first_mip]() {
+		return ReadMips(path, mips, t_first_mip);
+	};
+	t_texture.pending = PendingLoad{ t_first_mip, std::async(std::launch::async, std::move(read)) };
+}
+
+void TextureStreamer::CompleteLoads(VkDevice const & t_device)
+{
+	for (auto & texture : m_textures) {
+		if (!texture.pending.has_value() || texture.pending->data.wait_for(std::chrono::seconds{ 0 }) != std::future_status::ready) {
+			continue;
+		}
+
+		// The read is kept until a later frame has room to upload it
+		auto first_mip = texture.pending->first_mip;
+		if (!m_upload_queue->CanStage(GetMipBytes(texture, first_mip))) {
+			continue;
+		}
+
+		try {
+			auto data = texture.pending->data.get();
+			texture.pending.reset();
+			Rebuild(t_device, texture, first_mip, data);
+		}
+		catch (std::exception & error) {
+			texture.pending.reset();
+			Application::LogError(std::string{ "Texture streamer - Could not stream " } + texture.path + ": " + error.what());
+		}
+	}
+}
+
+void TextureStreamer::MakeRoom(VkDeviceSize t_bytes, uint64_t t_frame, uint32_t & t_in_flight)
+{
+	auto committed = GetCommittedBytes();
+	if (committed + t_bytes <= m_budget) {
+		return;
+	}
+
+	// Anything the last frame asked for stays, the rest drops to its tail starting
+	// with what went longest without being needed
+	auto idle = std::vector<Texture *>{};
+	for (auto & texture : m_textures) {
+		if (!texture.pending.has_value() && texture.resident_mip < texture.tail_mip && texture.last_demanded < t_frame) {
+			idle.emplace_back(&texture);
+		}
+	}
+	std::sort(idle.begin(), idle.end(), [](Texture const * t_a, Texture const * t_b) {
+		return t_a->last_demanded < t_b->last_demanded;
+	});
+
+	// Memory is only freed once the smaller image replaces the old one, the load
+	// asking for room goes ahead on a later frame. Evictions reread the tail and
+	// take load slots like any other load.
+	auto freed = VkDeviceSize{ 0 };
+	for (auto texture : idle) {
+		if (committed - freed + t_bytes <= m_budget || t_in_flight >= MAX_CONCURRENT_LOADS) {
+			break;
+		}
+		freed += texture->resident_bytes - std::min(texture->resident_bytes, GetMipBytes(*texture, texture->tail_mip));
+		StartLoad(*texture, texture->tail_mip);
+		++t_in_flight;
+	}
+}
+
+VkDeviceSize TextureStreamer::GetCommittedBytes() const noexcept
+{
+	auto committed = VkDeviceSize{ 0 };
+	for (auto const & texture : m_textures) {
+		committed += texture.pending.has_value() ?
+			std::max(texture.resident_bytes, GetMipBytes(texture, texture.pending->first_mip)) :
+			texture.resident_bytes;
+	}
+	return committed;
+}
+
+void TextureStreamer::Release(VkDevice const & t_device, Texture & t_texture) noexcept
+{
+	vkDestroyImageView(t_device, t_texture.view, nullptr);
+	vkDestroyImage(t_device, t_texture.image, nullptr);
+	vkFreeMemory(t_device, t_texture.memory, nullptr);
+	t_texture.view = VK_NULL_HANDLE;
+	t_texture.image = VK_NULL_HANDLE;
+	t_texture.memory = VK_NULL_HANDLE;
+	t_texture.resident_bytes = 0;
+}
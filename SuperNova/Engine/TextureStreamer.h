@@ -0,0 +1,93 @@
+#ifndef TEXTURE_STREAMER
+#define TEXTURE_STREAMER
+
+#include "vulkan/vulkan.h"
+#include "GpuTimeline.h"
+#include "TextureFormat.h"
+#include "UploadQueue.h"
+
+// Keeps each texture's mips resident only as far down as the screen asks for.
+// Loading a texture uploads its small mip tail at once, larger mips follow once
+// rendering reports the texture covering enough pixels to need them. File reads
+// run on worker threads and a finished read replaces the texture's image with
+// one holding the new resident range, the old one is retired on the GPU timeline.
+//
+// Without sparse residency an image can not grow or shrink in place, so both
+// streaming in and evicting rebuild the image and upload every resident mip
+// again. The mips below the new top one add at most a third to the upload.
+//
+// Above the budget the least recently demanded textures fall back to their tail
+// until the pending loads fit.
+class TextureStreamer
+{
+public:
+	using TextureHandle = uint32_t;
+
+	explicit TextureStreamer() = default;
+	TextureStreamer(TextureStreamer const &) = delete;
+	TextureStreamer(TextureStreamer &&) noexcept = default;
+	TextureStreamer & operator = (TextureStreamer const &) = delete;
+	TextureStreamer & operator = (TextureStreamer &&) noexcept = default;
+	~TextureStreamer() noexcept = default;
+
+	// The upload queue and timeline have to outlive the streamer
+	void Create(VkPhysicalDevice const &, UploadQueue &, GpuTimeline &, VkDeviceSize);
+	void Destroy(VkDevice const &) noexcept;
+
+	[[nodiscard]] TextureHandle Load(VkDevice const &, std::string const &);
+
+	// Called while rendering with the texture's on screen size in pixels, the
+	// largest report of the frame wins
+	void ReportCoverage(TextureHandle, float);
+
+	// Once per frame, before the upload queue submits
+	void Update(VkDevice const &, uint64_t);
+
+	// Views change whenever the resident range does
+	[[nodiscard]] VkImageView GetView(TextureHandle) const;
+	[[nodiscard]] uint32_t GetResidentMip(TextureHandle) const;
+	[[nodiscard]] VkDeviceSize GetResidentBytes() const noexcept;
+
+private:
+	struct PendingLoad {
+		uint32_t first_mip{ 0 };
+		std::future<std::vector<uint8_t>> data{};
+	};
+
+	struct Texture {
+		std::string path{};
+		TextureFileHeader header{};
+		std::vector<TextureFileMip> mips{};
+		VkImage image{ VK_NULL_HANDLE };
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+		VkImageView view{ VK_NULL_HANDLE };
+		VkDeviceSize resident_bytes{ 0 };
+		uint32_t resident_mip{ 0 };
+		// First mip of the tail that always stays resident
+		uint32_t tail_mip{ 0 };
+		uint32_t desired_mip{ 0 };
+		uint64_t last_demanded{ 0 };
+		std::optional<PendingLoad> pending{};
+	};
+
+	[[nodiscard]] static std::vector<uint8_t> ReadMips(std::string const &, std::vector<TextureFileMip> const &, uint32_t);
+	[[nodiscard]] static VkDeviceSize GetMipBytes(Texture const &, uint32_t) noexcept;
+	// Leaves the texture as it was when it throws
+	void Rebuild(VkDevice const &, Texture &, uint32_t, std::vector<uint8_t> const &);
+	void StartLoad(Texture &, uint32_t);
+	void CompleteLoads(VkDevice const &);
+	void MakeRoom(VkDeviceSize, uint64_t, uint32_t &);
+	[[nodiscard]] VkDeviceSize GetCommittedBytes() const noexcept;
+	void Release(VkDevice const &, Texture &) noexcept;
+
+	VkPhysicalDevice m_physical_device{ VK_NULL_HANDLE };
+	UploadQueue * m_upload_queue{ nullptr };
+	GpuTimeline * m_timeline{ nullptr };
+	std::vector<Texture> m_textures{};
+	VkDeviceSize m_budget{ 0 };
+	VkDeviceSize m_resident_bytes{ 0 };
+	// Frame coverage reports are counted against
+	uint64_t m_frame{ 0 };
+};
+
+#endif // !TEXTURE_STREAMER
@@ -0,0 +1,361 @@
+#include "PreCompiledHeader.hpp"
+#include "UploadQueue.h"
+#include "VulkanUtils.h"
+
+// Covers the texel block size of every compressed format as well as the 4 byte
+// alignment buffer copies require
+constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+void UploadQueue::Create(
+	VkDevice const & t_device,
+	VkPhysicalDevice const & t_physical_device,
+	GpuTimeline & t_timeline,
+	VkQueue t_queue,
+	uint32_t t_transfer_family,
+	uint32_t t_graphics_family,
+	uint32_t t_batch_count,
+	VkDeviceSize t_staging_size)
+{
+	m_physical_device = t_physical_device;
+	m_timeline = &t_timeline;
+	m_queue = t_queue;
+	m_transfer_family = t_transfer_family;
+	m_graphics_family = t_graphics_family;
+	m_current_batch = 0;
+
+	auto pool_info = VkCommandPoolCreateInfo{};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.queueFamilyIndex = t_transfer_family;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	auto result = vkCreateCommandPool(t_device, &pool_info, nullptr, &m_command_pool);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("create upload command pool", result);
+	}
+
+	auto command_buffers = std::vector<VkCommandBuffer>(t_batch_count);
+
+	auto alloc_info = VkCommandBufferAllocateInfo{};
+	alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	alloc_info.commandPool = m_command_pool;
+	alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	alloc_info.commandBufferCount = t_batch_count;
+
+	result = vkAllocateCommandBuffers(t_device, &alloc_info, command_buffers.data());
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("allocate upload command buffers", result);
+	}
+
+	auto semaphore_info = VkSemaphoreCreateInfo{};
+	semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	m_batches.resize(t_batch_count);
+	for (auto i = 0u; i < t_batch_count; ++i) {
+		auto & batch = m_batches[i];
+		batch.command_buffer = command_buffers[i];
+
+		result = vkCreateSemaphore(t_device, &semaphore_info, nullptr, &batch.semaphore);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("create upload semaphore", result);
+		}
+
+		CreateStaging(t_device, batch, t_staging_size);
+	}
+}
+
+void UploadQueue::Destroy(VkDevice const & t_device) noexcept
+{
+	for (auto & batch : m_batches) {
+		DestroyStaging(t_device, batch);
+		vkDestroySemaphore(t_device, batch.semaphore, nullptr);
+	}
+	m_batches.clear();
+
+	if (m_command_pool != VK_NULL_HANDLE) {
+		vkDestroyCommandPool(t_device, m_command_pool, nullptr);
+		m_command_pool = VK_NULL_HANDLE;
+	}
+}
+
+GpuTimeline::Point UploadQueue::UploadBuffer(
+	VkDevice const & t_device,
+	VkBuffer t_buffer,
+	VkDeviceSize t_offset,
+	void const * t_data,
+	VkDeviceSize t_size,
+	VkPipelineStageFlags t_destination_stages,
+	VkAccessFlags t_destination_access)
+{
+	auto staging_offset = Stage(t_device, t_data, t_size, t_destination_stages);
+	auto & batch = m_batches[m_current_batch];
+	// The recording batch is always the next transfer submission
+	auto completion = m_timeline->GetNextPoint(GQ_TRANSFER);
+
+	auto region = VkBufferCopy{};
+	region.srcOffset = staging_offset;
+	region.dstOffset = t_offset;
+	region.size = t_size;
+	vkCmdCopyBuffer(batch.command_buffer, batch.staging_buffer, t_buffer, 1, &region);
+
+	if (!IsDedicated()) {
+		return completion;
+	}
+
+	auto barrier = VkBufferMemoryBarrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	barrier.srcQueueFamilyIndex = m_transfer_family;
+	barrier.dstQueueFamilyIndex = m_graphics_family;
+	barrier.buffer = t_buffer;
+	barrier.offset = t_offset;
+	barrier.size = t_size;
+
+	vkCmdPipelineBarrier(batch.command_buffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+		0, nullptr, 1, &barrier, 0, nullptr);
+
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = t_destination_access;
+	batch.buffer_acquires.emplace_back(barrier);
+	return completion;
+}
+
+GpuTimeline::Point UploadQueue::UploadImage(
+	VkDevice const & t_device,
+	ImageUpload const & t_upload,
+	void const * t_data,
+	VkDeviceSize t_size,
+	VkPipelineStageFlags t_destination_stages,
+	VkAccessFlags t_destination_access)
+{
+	auto staging_offset = Stage(t_device, t_data, t_size, t_destination_stages);
+	auto & batch = m_batches[m_current_batch];
+
+	auto barrier = VkImageMemoryBarrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = t_upload.image;
+	barrier.subresourceRange.aspectMask = t_upload.aspect;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = t_upload.mip_levels;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	vkCmdPipelineBarrier(batch.command_buffer,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		0, nullptr, 0, nullptr, 1, &barrier);
+
+	auto regions = t_upload.regions;
+	for (auto & region : regions) {
+		region.bufferOffset += staging_offset;
+	}
+
+	vkCmdCopyBufferToImage(batch.command_buffer, batch.staging_buffer, t_upload.image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+	// Released with the final layout transition, the acquire repeats it
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = t_upload.final_layout;
+	if (IsDedicated()) {
+		barrier.srcQueueFamilyIndex = m_transfer_family;
+		barrier.dstQueueFamilyIndex = m_graphics_family;
+	}
+
+	vkCmdPipelineBarrier(batch.command_buffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+		0, nullptr, 0, nullptr, 1, &barrier);
+
+	if (IsDedicated()) {
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = t_destination_access;
+		batch.image_acquires.emplace_back(barrier);
+	}
+
+	return m_timeline->GetNextPoint(GQ_TRANSFER);
+}
+
+void UploadQueue::Submit(VkDevice const & t_device)
+{
+	if (!m_batches.empty() && m_batches[m_current_batch].recording) {
+		SubmitBatch(t_device, m_batches[m_current_batch]);
+	}
+}
+
+void UploadQueue::RecordAcquires(VkCommandBuffer t_command_buffer)
+{
+	auto buffer_barriers = std::vector<VkBufferMemoryBarrier>{};
+	auto image_barriers = std::vector<VkImageMemoryBarrier>{};
+	auto destination_stages = VkPipelineStageFlags{ 0 };
+
+	for (auto & batch : m_batches) {
+		if (!batch.pending) {
+			continue;
+		}
+		buffer_barriers.insert(buffer_barriers.end(), batch.buffer_acquires.begin(), batch.buffer_acquires.end());
+		image_barriers.insert(image_barriers.end(), batch.image_acquires.begin(), batch.image_acquires.end());
+		destination_stages |= batch.wait_stages;
+		batch.buffer_acquires.clear();
+		batch.image_acquires.clear();
+	}
+
+	if (buffer_barriers.empty() && image_barriers.empty()) {
+		return;
+	}
+
+	vkCmdPipelineBarrier(t_command_buffer,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, destination_stages, 0,
+		0, nullptr,
+		static_cast<uint32_t>(buffer_barriers.size()), buffer_barriers.data(),
+		static_cast<uint32_t>(image_barriers.size()), image_barriers.data());
+}
+
+void UploadQueue::AppendWaitSemaphores(std::vector<VkSemaphore> & t_wait_semaphores, std::vector<VkPipelineStageFlags> & t_wait_stages)
+{
+	for (auto & batch : m_batches) {
+		if (!batch.pending) {
+			continue;
+		}
+		t_wait_semaphores.emplace_back(batch.semaphore);
+		t_wait_stages.emplace_back(batch.wait_stages);
+		batch.pending = false;
+	}
+}
+
+bool UploadQueue::CanStage(VkDeviceSize t_size) const noexcept
+{
+	if (m_batches.empty()) {
+		return false;
+	}
+
+	// Mirrors Stage: a full batch is submitted and the next one begun
+	auto const & batch = m_batches[m_current_batch];
+	if (!batch.recording) {
+		return !batch.pending;
+	}
+
+	auto offset = (batch.used + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+	return offset + t_size <= batch.capacity || !m_batches[(m_current_batch + 1) % m_batches.size()].pending;
+}
+
+bool UploadQueue::IsDedicated() const noexcept
+{
+	return m_transfer_family != m_graphics_family;
+}
+
+VkDeviceSize UploadQueue::Stage(VkDevice const & t_device, void const * t_data, VkDeviceSize t_size, VkPipelineStageFlags t_destination_stages)
+{
+	if (m_batches.empty()) {
+		throw std::runtime_error("Upload queue - Used before being created");
+	}
+
+	auto * batch = &m_batches[m_current_batch];
+	auto offset = (batch->used + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+
+	if (batch->recording && offset + t_size > batch->capacity) {
+		SubmitBatch(t_device, *batch);
+		batch = &m_batches[m_current_batch];
+	}
+
+	if (!batch->recording) {
+		BeginBatch(t_device, t_size);
+		offset = 0;
+	}
+
+	std::memcpy(batch->mapped + offset, t_data, static_cast<size_t>(t_size));
+	batch->used = offset + t_size;
+	batch->wait_stages |= t_destination_stages;
+	return offset;
+}
+
+void UploadQueue::BeginBatch(VkDevice const & t_device, VkDeviceSize t_size)
+{
+	auto & batch = m_batches[m_current_batch];
+
+	if (batch.pending) {
+		throw std::runtime_error("Upload queue - More uploads in flight than batches, the graphics queue has not consumed them yet");
+	}
+
+	// Normally signalled long ago, the batch was submitted several frames back
+	m_timeline->Wait(t_device, batch.completion);
+
+	if (batch.capacity < t_size) {
+		DestroyStaging(t_device, batch);
+		CreateStaging(t_device, batch, std::max(t_size, batch.capacity * 2));
+	}
+
+	batch.used = 0;
+	batch.wait_stages = 0;
+	batch.buffer_acquires.clear();
+	batch.image_acquires.clear();
+
+	auto begin_info = VkCommandBufferBeginInfo{};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	auto result = vkBeginCommandBuffer(batch.command_buffer, &begin_info);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("begin upload command buffer", result);
+	}
+
+	batch.recording = true;
+}
+
+void UploadQueue::SubmitBatch(VkDevice const & t_device, Batch & t_batch)
+{
+	auto result = vkEndCommandBuffer(t_batch.command_buffer);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("record upload command buffer", result);
+	}
+
+	auto submit_info = VkSubmitInfo{};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &t_batch.command_buffer;
+	submit_info.signalSemaphoreCount = 1;
+	submit_info.pSignalSemaphores = &t_batch.semaphore;
+
+	t_batch.completion = m_timeline->Submit(t_device, GQ_TRANSFER, m_queue, submit_info);
+
+	t_batch.recording = false;
+	t_batch.pending = true;
+	m_current_batch = (m_current_batch + 1) % static_cast<uint32_t>(m_batches.size());
+}
+
+void UploadQueue::CreateStaging(VkDevice const & t_device, Batch & t_batch, VkDeviceSize t_size)
+{
+	vulkan_utils::CreateBuffer(t_device, m_physical_device, t_size,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		0,
+		t_batch.staging_buffer, t_batch.staging_memory);
+
+	void * mapped = nullptr;
+	auto result = vkMapMemory(t_device, t_batch.staging_memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("map staging buffer", result);
+	}
+
+	t_batch.mapped = static_cast<uint8_t *>(mapped);
+	t_batch.capacity = t_size;
+}
+
+void UploadQueue::DestroyStaging(VkDevice const & t_device, Batch & t_batch) noexcept
+{
+	if (t_batch.mapped != nullptr) {
+		vkUnmapMemory(t_device, t_batch.staging_memory);
+		t_batch.mapped = nullptr;
+	}
+	vkDestroyBuffer(t_device, t_batch.staging_buffer, nullptr);
+	vkFreeMemory(t_device, t_batch.staging_memory, nullptr);
+	t_batch.staging_buffer = VK_NULL_HANDLE;
+	t_batch.staging_memory = VK_NULL_HANDLE;
+	t_batch.capacity = 0;
+}
@@ -0,0 +1,84 @@
+#ifndef UPLOAD_QUEUE
+#define UPLOAD_QUEUE
+
+#include "vulkan/vulkan.h"
+#include "GpuTimeline.h"
+
+// Uploads are staged in host visible memory and copied on the transfer queue, off
+// the graphics queue's timeline. When the transfer queue belongs to another family
+// each copy releases its resource and the graphics queue acquires it at the start
+// of the next frame, after waiting on the batch's semaphore. Batches signal the
+// transfer queue's timeline, which is also what uploads report completion with.
+class UploadQueue
+{
+public:
+	struct ImageUpload {
+		VkImage image{ VK_NULL_HANDLE };
+		VkImageAspectFlags aspect{ VK_IMAGE_ASPECT_COLOR_BIT };
+		uint32_t mip_levels{ 1 };
+		// Buffer offsets are relative to the start of the uploaded data
+		std::vector<VkBufferImageCopy> regions{};
+		VkImageLayout final_layout{ VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	};
+
+	explicit UploadQueue() = default;
+	UploadQueue(UploadQueue const &) = delete;
+	UploadQueue(UploadQueue &&) noexcept = default;
+	UploadQueue & operator = (UploadQueue const &) = delete;
+	UploadQueue & operator = (UploadQueue &&) noexcept = default;
+	~UploadQueue() noexcept = default;
+
+	// The timeline has to outlive the queue
+	void Create(VkDevice const &, VkPhysicalDevice const &, GpuTimeline &, VkQueue, uint32_t, uint32_t, uint32_t, VkDeviceSize);
+	void Destroy(VkDevice const &) noexcept;
+
+	// The returned point is reached once the copy is done, with a dedicated
+	// transfer queue the graphics queue still acquires the resource next frame
+	GpuTimeline::Point UploadBuffer(VkDevice const &, VkBuffer, VkDeviceSize, void const *, VkDeviceSize, VkPipelineStageFlags, VkAccessFlags);
+	GpuTimeline::Point UploadImage(VkDevice const &, ImageUpload const &, void const *, VkDeviceSize, VkPipelineStageFlags, VkAccessFlags);
+
+	// Once per frame: Submit, then RecordAcquires into the first graphics command
+	// buffer and AppendWaitSemaphores to that command buffer's submission
+	void Submit(VkDevice const &);
+	void RecordAcquires(VkCommandBuffer);
+	void AppendWaitSemaphores(std::vector<VkSemaphore> &, std::vector<VkPipelineStageFlags> &);
+
+	// Whether an upload of the size can be staged now, uploads throw when every
+	// batch is still waiting for the graphics queue
+	[[nodiscard]] bool CanStage(VkDeviceSize) const noexcept;
+	[[nodiscard]] bool IsDedicated() const noexcept;
+
+private:
+	struct Batch {
+		VkCommandBuffer command_buffer{ VK_NULL_HANDLE };
+		GpuTimeline::Point completion{ GQ_TRANSFER, 0 };
+		VkSemaphore semaphore{ VK_NULL_HANDLE };
+		VkBuffer staging_buffer{ VK_NULL_HANDLE };
+		VkDeviceMemory staging_memory{ VK_NULL_HANDLE };
+		uint8_t * mapped{ nullptr };
+		VkDeviceSize capacity{ 0 };
+		VkDeviceSize used{ 0 };
+		bool recording{ false };
+		bool pending{ false };
+		VkPipelineStageFlags wait_stages{ 0 };
+		std::vector<VkBufferMemoryBarrier> buffer_acquires{};
+		std::vector<VkImageMemoryBarrier> image_acquires{};
+	};
+
+	[[nodiscard]] VkDeviceSize Stage(VkDevice const &, void const *, VkDeviceSize, VkPipelineStageFlags);
+	void BeginBatch(VkDevice const &, VkDeviceSize);
+	void SubmitBatch(VkDevice const &, Batch &);
+	void CreateStaging(VkDevice const &, Batch &, VkDeviceSize);
+	static void DestroyStaging(VkDevice const &, Batch &) noexcept;
+
+	VkPhysicalDevice m_physical_device{ VK_NULL_HANDLE };
+	GpuTimeline * m_timeline{ nullptr };
+	VkQueue m_queue{ VK_NULL_HANDLE };
+	VkCommandPool m_command_pool{ VK_NULL_HANDLE };
+	std::vector<Batch> m_batches{};
+	uint32_t m_current_batch{ 0 };
+	uint32_t m_transfer_family{ 0 };
+	uint32_t m_graphics_family{ 0 };
+};
+
+#endif // !UPLOAD_QUEUE
@@ -1,11 +1,42 @@
 #version 450
 
+layout(set = 0, binding = 0) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    mat4 view_projection;
+    vec4 camera_position;
+    float time;
+    float delta_time;
+    vec4 ambient;
+    uvec4 cluster_count;
+    vec4 cluster_scale;
+} frame;
+
+layout(std430, set = 0, binding = 1) readonly buffer ObjectTransforms {
+    mat4 models[];
+} objects;
+
+layout(push_constant) uniform DrawPushConstants {
+    uint object_index;
+    float lod_fade;
+    vec4 tint;
+} draw;
+
+// Material feature, see ShaderVariants
+layout(constant_id = 0) const bool VERTEX_TINT = true;
+
+// The depth pre-pass and the main pass are separate pipelines, the main pass
+// tests depth EQUAL against what the pre-pass wrote
+invariant gl_Position;
+
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosition;
+layout(location = 2) out vec3 fragNormal;
 
 vec2 positions[3] = vec2[](
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
+    vec2(0.0, 0.5),
+    vec2(0.5, -0.5),
+    vec2(-0.5, -0.5)
 );
 
 vec3 colors[3] = vec3[](
@@ -15,6 +46,12 @@ vec3 colors[3] = vec3[](
 );
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-	    fragColor = colors[gl_VertexIndex];
+    // Indirect draws select the object through firstInstance
+    mat4 model = objects.models[draw.object_index + gl_InstanceIndex];
+    vec4 world_position = model * vec4(positions[gl_VertexIndex], 0.0, 1.0);
+    gl_Position = frame.view_projection * world_position;
+    fragPosition = world_position.xyz;
+    // Transforms carry no non-uniform scale yet, so the model matrix serves for normals
+    fragNormal = mat3(model) * vec3(0.0, 0.0, 1.0);
+    fragColor = VERTEX_TINT ? colors[gl_VertexIndex] * draw.tint.rgb : colors[gl_VertexIndex];
 } 
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include "PreCompiledHeader.hpp"
+#include "VulkanUtils.h"
+
+std::string vulkan_utils::ResultToString(VkResult const & t_result)
+{
+	switch (t_result)
+	{
+	case VK_SUCCESS: return "Success";
+	case VK_NOT_READY: return "Not ready";
+	case VK_TIMEOUT: return "Timeout";
+	case VK_ERROR_OUT_OF_HOST_MEMORY: return "Out of host memory";
+	case VK_ERROR_OUT_OF_DEVICE_MEMORY: return "Out of device memory";
+	case VK_ERROR_INITIALIZATION_FAILED: return "Initialization failed";
+	case VK_ERROR_DEVICE_LOST: return "Device lost";
+	case VK_ERROR_MEMORY_MAP_FAILED: return "Memory map failed";
+	case VK_ERROR_LAYER_NOT_PRESENT: return "Layer not present";
+	case VK_ERROR_EXTENSION_NOT_PRESENT: return "Extension not present";
+	case VK_ERROR_FEATURE_NOT_PRESENT: return "Feature not present";
+	case VK_ERROR_INCOMPATIBLE_DRIVER: return "Incompatible driver";
+	case VK_ERROR_TOO_MANY_OBJECTS: return "Too many objects";
+	case VK_ERROR_FORMAT_NOT_SUPPORTED: return "Format not supported";
+	case VK_ERROR_OUT_OF_DATE_KHR: return "Out of date";
+	case VK_ERROR_SURFACE_LOST_KHR: return "Surface lost";
+	default: return "Unidentified error";
+	}
+}
+
+void vulkan_utils::ThrowError(std::string const & t_action, VkResult const & t_result)
+{
+	throw std::runtime_error("Vulkan - Failed to " + t_action + " - " + ResultToString(t_result));
+}
+
+std::optional<uint32_t> vulkan_utils::FindOptionalMemoryType(VkPhysicalDevice const & t_physical_device, uint32_t t_type_filter, VkMemoryPropertyFlags t_properties)
+{
+	auto memory_properties = VkPhysicalDeviceMemoryProperties{};
+	vkGetPhysicalDeviceMemoryProperties(t_physical_device, &memory_properties);
+
+	for (uint32_t i = 0; i < memory_properties.memoryTypeCount; ++i) {
+		if ((t_type_filter & (1u << i)) && (memory_properties.memoryTypes[i].propertyFlags & t_properties) == t_properties) {
+			return i;
+		}
+	}
+
+	return std::nullopt;
+}
+
+uint32_t vulkan_utils::FindMemoryType(VkPhysicalDevice const & t_physical_device, uint32_t t_type_filter, VkMemoryPropertyFlags t_properties)
+{
+	auto memory_type = FindOptionalMemoryType(t_physical_device, t_type_filter, t_properties);
+
+	if (!memory_type.has_value()) {
+		throw std::runtime_error("Vulkan - Failed to find a suitable memory type!");
+	}
+
+	return memory_type.value();
+}
+
+void vulkan_utils::CreateBuffer(
+	VkDevice const & t_device,
+	VkPhysicalDevice const & t_physical_device,
+	VkDeviceSize t_size,
+	VkBufferUsageFlags t_usage,
+	VkMemoryPropertyFlags t_required_properties,
+	VkMemoryPropertyFlags t_preferred_properties,
+	VkBuffer & t_buffer,
+	VkDeviceMemory & t_memory)
+{
+	CreateBuffer(t_device, t_physical_device, t_size, t_usage, t_required_properties, t_preferred_properties, {}, t_buffer, t_memory);
+}
+
+void vulkan_utils::CreateBuffer(
+	VkDevice const & t_device,
+	VkPhysicalDevice const & t_physical_device,
+	VkDeviceSize t_size,
+	VkBufferUsageFlags t_usage,
+	VkMemoryPropertyFlags t_required_properties,
+	VkMemoryPropertyFlags t_preferred_properties,
+	std::vector<uint32_t> const & t_queue_families,
+	VkBuffer & t_buffer,
+	VkDeviceMemory & t_memory)
+{
+	auto buffer_info = VkBufferCreateInfo{};
+	buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_info.size = t_size;
+	buffer_info.usage = t_usage;
+	if (t_queue_families.size() > 1) {
+		buffer_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		buffer_info.queueFamilyIndexCount = static_cast<uint32_t>(t_queue_families.size());
+		buffer_info.pQueueFamilyIndices = t_queue_families.data();
+	}
+	else {
+		buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+
+	auto result = vkCreateBuffer(t_device, &buffer_info, nullptr, &t_buffer);
+	if (result != VK_SUCCESS) {
+		ThrowError("create buffer", result);
+	}
+
+	auto requirements = VkMemoryRequirements{};
+	vkGetBufferMemoryRequirements(t_device, t_buffer, &requirements);
+
+	auto memory_type = FindOptionalMemoryType(t_physical_device, requirements.memoryTypeBits, t_required_properties | t_preferred_properties);
+	if (!memory_type.has_value()) {
+		memory_type = FindMemoryType(t_physical_device, requirements.memoryTypeBits, t_required_properties);
+	}
+
+	auto allocate_info = VkMemoryAllocateInfo{};
+	allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocate_info.allocationSize = requirements.size;
+	allocate_info.memoryTypeIndex = memory_type.value();
+
+	result = vkAllocateMemory(t_device, &allocate_info, nullptr, &t_memory);
+	if (result != VK_SUCCESS) {
+		ThrowError("allocate buffer memory", result);
+	}
+
+	vkBindBufferMemory(t_device, t_buffer, t_memory, 0);
+}
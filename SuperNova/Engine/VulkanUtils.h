@@ -0,0 +1,39 @@
+#ifndef VULKAN_UTILS
+#define VULKAN_UTILS
+
+#include "vulkan/vulkan.h"
+
+namespace vulkan_utils
+{
+	[[nodiscard]] std::string ResultToString(VkResult const &);
+	[[noreturn]] void ThrowError(std::string const &, VkResult const &);
+
+	[[nodiscard]] std::optional<uint32_t> FindOptionalMemoryType(VkPhysicalDevice const &, uint32_t, VkMemoryPropertyFlags);
+	[[nodiscard]] uint32_t FindMemoryType(VkPhysicalDevice const &, uint32_t, VkMemoryPropertyFlags);
+
+	// Memory is taken from a type with the required and preferred properties when
+	// there is one, otherwise from one with only the required properties
+	void CreateBuffer(
+		VkDevice const &,
+		VkPhysicalDevice const &,
+		VkDeviceSize,
+		VkBufferUsageFlags,
+		VkMemoryPropertyFlags,
+		VkMemoryPropertyFlags,
+		VkBuffer &,
+		VkDeviceMemory &);
+	// Shared concurrently by the queue families when there is more than one,
+	// exclusive otherwise
+	void CreateBuffer(
+		VkDevice const &,
+		VkPhysicalDevice const &,
+		VkDeviceSize,
+		VkBufferUsageFlags,
+		VkMemoryPropertyFlags,
+		VkMemoryPropertyFlags,
+		std::vector<uint32_t> const &,
+		VkBuffer &,
+		VkDeviceMemory &);
+}
+
+#endif // !VULKAN_UTILS
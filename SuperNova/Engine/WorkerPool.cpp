@@ -0,0 +1,109 @@
+#include "PreCompiledHeader.hpp"
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(uint32_t t_worker_count)
+{
+	m_threads.reserve(t_worker_count);
+	for (auto i = uint32_t{ 0 }; i < t_worker_count; ++i) {
+		m_threads.emplace_back(&WorkerPool::WorkerLoop, this);
+	}
+}
+
+WorkerPool::~WorkerPool() noexcept
+{
+	{
+		auto lock = std::lock_guard<std::mutex>{ m_mutex };
+		m_stopping = true;
+	}
+	m_work_ready.notify_all();
+
+	for (auto & thread : m_threads) {
+		thread.join();
+	}
+}
+
+void WorkerPool::Run(uint32_t t_task_count, Task const & t_task)
+{
+	if (t_task_count == 0) {
+		return;
+	}
+
+	{
+		// Workers that woke too late for the previous job may still be leaving it
+		auto lock = std::unique_lock<std::mutex>{ m_mutex };
+		m_work_done.wait(lock, [this]() { return m_busy_workers == 0; });
+
+		m_task = &t_task;
+		m_task_count = t_task_count;
+		m_next_task = 0;
+		m_error = nullptr;
+		++m_generation;
+	}
+	if (t_task_count > 1) {
+		m_work_ready.notify_all();
+	}
+
+	Execute();
+
+	// Every task has been taken, the ones still running belong to busy workers
+	auto lock = std::unique_lock<std::mutex>{ m_mutex };
+	m_work_done.wait(lock, [this]() { return m_busy_workers == 0; });
+	m_task = nullptr;
+	m_task_count = 0;
+
+	auto error = m_error;
+	m_error = nullptr;
+	if (error != nullptr) {
+		std::rethrow_exception(error);
+	}
+}
+
+uint32_t WorkerPool::GetWorkerCount() const noexcept
+{
+	return static_cast<uint32_t>(m_threads.size());
+}
+
+void WorkerPool::WorkerLoop()
+{
+	auto generation = uint64_t{ 0 };
+	auto lock = std::unique_lock<std::mutex>{ m_mutex };
+
+	while (true) {
+		m_work_ready.wait(lock, [this, &generation]() { return m_stopping || m_generation != generation; });
+		if (m_stopping) {
+			return;
+		}
+
+		generation = m_generation;
+		++m_busy_workers;
+		lock.unlock();
+
+		Execute();
+
+		lock.lock();
+		if (--m_busy_workers == 0) {
+			m_work_done.notify_all();
+		}
+	}
+}
+
+void WorkerPool::Execute()
+{
+	while (true) {
+		auto task = m_next_task.fetch_add(1);
+		if (task >= m_task_count) {
+			return;
+		}
+
+		try {
+			(*m_task)(task);
+		}
+		catch (...) {
+			auto lock = std::lock_guard<std::mutex>{ m_mutex };
+			if (m_error == nullptr) {
+				m_error = std::current_exception();
+			}
+			m_next_task = m_task_count;
+		}
+	}
+}
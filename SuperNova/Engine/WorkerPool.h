@@ -0,0 +1,49 @@
+#ifndef WORKER_POOL
+#define WORKER_POOL
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+// Threads started once and parked between jobs, for per frame work too short to
+// pay for creating a thread each time. A job is a number of tasks taken in index
+// order by the workers and the calling thread alike; Run returns once every task
+// has finished. One job runs at a time.
+class WorkerPool
+{
+public:
+	using Task = std::function<void(uint32_t)>;
+
+	explicit WorkerPool(uint32_t);
+	WorkerPool(WorkerPool const &) = delete;
+	WorkerPool(WorkerPool &&) = delete;
+	WorkerPool & operator = (WorkerPool const &) = delete;
+	WorkerPool & operator = (WorkerPool &&) = delete;
+	~WorkerPool() noexcept;
+
+	// Calls the task once per index below the count. The first exception thrown
+	// stops the remaining tasks from starting and is rethrown here.
+	void Run(uint32_t, Task const &);
+
+	[[nodiscard]] uint32_t GetWorkerCount() const noexcept;
+
+private:
+	void WorkerLoop();
+	// Takes tasks of the current job until none are left
+	void Execute();
+
+	std::vector<std::thread> m_threads{};
+	std::mutex m_mutex{};
+	std::condition_variable m_work_ready{};
+	std::condition_variable m_work_done{};
+	// The job only changes while no worker is executing it
+	Task const * m_task{ nullptr };
+	uint32_t m_task_count{ 0 };
+	std::atomic<uint32_t> m_next_task{ 0 };
+	uint64_t m_generation{ 0 };
+	uint32_t m_busy_workers{ 0 };
+	std::exception_ptr m_error{};
+	bool m_stopping{ false };
+};
+
+#endif // !WORKER_POOL
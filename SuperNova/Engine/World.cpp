@@ -0,0 +1,184 @@
+#include "PreCompiledHeader.hpp"
+#include "World.h"
+#include "Telemetry.h"
+
+World::World():
+	Module{ "World" }
+{
+	// The empty archetype is where entities without components live
+	m_archetypes.emplace_back(ComponentMask{ 0 });
+	m_archetype_lookup.emplace(ComponentMask{ 0 }, 0);
+}
+
+void World::Start()
+{}
+
+void World::PreUpdate()
+{}
+
+void World::Update()
+{
+	for (auto const & system : m_systems) {
+		auto timer = ScopedCpuTimer{ m_name + " - " + system.name };
+		system.function(*this);
+	}
+}
+
+void World::PostUpdate()
+{}
+
+void World::CleanUp() noexcept
+{
+	m_systems.clear();
+	for (auto & archetype : m_archetypes) {
+		archetype.Clear();
+	}
+	m_entities.clear();
+	m_free_entities.clear();
+	m_entity_count = 0;
+}
+
+void World::AddSystem(std::string const & t_name, System t_system)
+{
+	m_systems.emplace_back(NamedSystem{ t_name, std::move(t_system) });
+}
+
+void World::DestroyEntity(Entity t_entity)
+{
+	CheckStructuralChange();
+
+	auto & record = GetRecord(t_entity);
+	auto moved = m_archetypes[record.archetype].Remove(record.row);
+	if (moved != NULL_ENTITY) {
+		m_entities[moved.index].row = record.row;
+	}
+
+	// Generation 0 marks null handles, wrapping skips it
+	if (++record.generation == 0) {
+		record.generation = 1;
+	}
+	m_free_entities.push_back(t_entity.index);
+	--m_entity_count;
+}
+
+bool World::IsAlive(Entity t_entity) const noexcept
+{
+	return t_entity.index < m_entities.size() && m_entities[t_entity.index].generation == t_entity.generation;
+}
+
+uint32_t World::GetEntityCount() const noexcept
+{
+	return m_entity_count;
+}
+
+uint32_t World::GetArchetypeCount() const noexcept
+{
+	return static_cast<uint32_t>(m_archetypes.size());
+}
+
+Entity World::AllocateEntity()
+{
+	if (!m_free_entities.empty()) {
+		auto index = m_free_entities.back();
+		m_free_entities.pop_back();
+		return Entity{ index, m_entities[index].generation };
+	}
+
+	m_entities.emplace_back(EntityRecord{});
+	return Entity{ static_cast<uint32_t>(m_entities.size() - 1), m_entities.back().generation };
+}
+
+World::EntityRecord & World::GetRecord(Entity t_entity)
+{
+	if (!IsAlive(t_entity)) {
+		throw std::runtime_error("World - The entity was destroyed");
+	}
+	return m_entities[t_entity.index];
+}
+
+World::EntityRecord const & World::GetRecord(Entity t_entity) const
+{
+	if (!IsAlive(t_entity)) {
+		throw std::runtime_error("World - The entity was destroyed");
+	}
+	return m_entities[t_entity.index];
+}
+
+uint32_t World::GetArchetype(ComponentMask t_mask)
+{
+	auto found = m_archetype_lookup.find(t_mask);
+	if (found != m_archetype_lookup.end()) {
+		return found->second;
+	}
+
+	auto index = static_cast<uint32_t>(m_archetypes.size());
+	m_archetypes.emplace_back(t_mask);
+	m_archetype_lookup.emplace(t_mask, index);
+	for (auto & query : m_queries) {
+		if ((t_mask & query.first) == query.first) {
+			query.second.push_back(index);
+		}
+	}
+	return index;
+}
+
+uint32_t World::GetAddTarget(uint32_t t_archetype, ComponentId t_component)
+{
+	auto target = m_archetypes[t_archetype].GetAddEdge(t_component);
+	if (target == ARCHETYPE_NONE) {
+		target = GetArchetype(m_archetypes[t_archetype].GetMask() | (ComponentMask{ 1 } << t_component));
+		m_archetypes[t_archetype].SetAddEdge(t_component, target);
+		m_archetypes[target].SetRemoveEdge(t_component, t_archetype);
+	}
+	return target;
+}
+
+uint32_t World::GetRemoveTarget(uint32_t t_archetype, ComponentId t_component)
+{
+	auto target = m_archetypes[t_archetype].GetRemoveEdge(t_component);
+	if (target == ARCHETYPE_NONE) {
+		target = GetArchetype(m_archetypes[t_archetype].GetMask() & ~(ComponentMask{ 1 } << t_component));
+		m_archetypes[t_archetype].SetRemoveEdge(t_component, target);
+		m_archetypes[target].SetAddEdge(t_component, t_archetype);
+	}
+	return target;
+}
+
+void World::MoveEntity(Entity t_entity, EntityRecord & t_record, uint32_t t_target)
+{
+	auto & source = m_archetypes[t_record.archetype];
+	auto & target = m_archetypes[t_target];
+
+	auto row = target.Add(t_entity);
+	source.CopyTo(t_record.row, target, row);
+	auto moved = source.Remove(t_record.row);
+	if (moved != NULL_ENTITY) {
+		m_entities[moved.index].row = t_record.row;
+	}
+
+	t_record.archetype = t_target;
+	t_record.row = row;
+}
+
+std::vector<uint32_t> const & World::GetQuery(ComponentMask t_mask)
+{
+	auto found = m_queries.find(t_mask);
+	if (found != m_queries.end()) {
+		return found->second;
+	}
+
+	auto archetypes = std::vector<uint32_t>{};
+	for (auto i = uint32_t{ 0 }; i < m_archetypes.size(); ++i) {
+		if ((m_archetypes[i].GetMask() & t_mask) == t_mask) {
+			archetypes.push_back(i);
+		}
+	}
+	return m_queries.emplace(t_mask, std::move(archetypes)).first->second;
+}
+
+void World::CheckStructuralChange() const
+{
+	if (m_iterating > 0) {
+		throw std::runtime_error("World - Entities and components cannot change while a query runs");
+	}
+}
@@ -0,0 +1,190 @@
+#ifndef WORLD
+#define WORLD
+
+#include "Module.h"
+#include "Archetype.h"
+#include <unordered_map>
+
+// Game objects as entities with plain data components. Entities with the same
+// set of components share an archetype, whose chunks keep every component as a
+// contiguous array, so systems iterate millions of entities as linear streams.
+// Adding or removing a component moves the entity's row to the archetype of the
+// new set and fills the hole with the source's last row, both O(1) through the
+// cached archetype edges. Handles are index plus generation, stale ones are
+// detected instead of aliasing whatever reused the slot.
+//
+// Queries are cached per component mask and kept up to date as archetypes
+// appear, a query costs one hash lookup however many archetypes exist. Entities
+// and components may not be created, added or removed while a query runs;
+// writing components in place is fine.
+class World : public Module
+{
+public:
+	using System = std::function<void(World &)>;
+
+	explicit World();
+	World(World const &) = delete;
+	World(World &&) noexcept = default;
+	World & operator = (World const &) = delete;
+	World & operator = (World &&) noexcept = default;
+	~World() noexcept = default;
+
+	void Start() final;
+	void PreUpdate() final;
+	void Update() final;
+	void PostUpdate() final;
+	void CleanUp() noexcept final;
+
+	// Systems run in the order they were added, every Update
+	void AddSystem(std::string const &, System);
+
+	template<typename... Ts>
+	[[nodiscard]] Entity CreateEntity(Ts const &...);
+	void DestroyEntity(Entity);
+	[[nodiscard]] bool IsAlive(Entity) const noexcept;
+
+	// Overwrites the component if the entity has it already
+	template<typename T>
+	void AddComponent(Entity, T const &);
+	template<typename T>
+	void RemoveComponent(Entity);
+	template<typename T>
+	[[nodiscard]] bool HasComponent(Entity) const;
+	template<typename T>
+	[[nodiscard]] T & GetComponent(Entity);
+
+	// Calls the function with the components of every entity having all of them
+	template<typename... Ts, typename F>
+	void Each(F &&);
+	// Calls the function per chunk with the row count, the entities and one
+	// array per component, for loops the compiler can vectorise
+	template<typename... Ts, typename F>
+	void EachChunk(F &&);
+
+	[[nodiscard]] uint32_t GetEntityCount() const noexcept;
+	[[nodiscard]] uint32_t GetArchetypeCount() const noexcept;
+
+private:
+	struct EntityRecord {
+		uint32_t archetype{ 0 };
+		uint32_t row{ 0 };
+		uint32_t generation{ 1 };
+	};
+
+	struct NamedSystem {
+		std::string name{};
+		System function{};
+	};
+
+	[[nodiscard]] Entity AllocateEntity();
+	[[nodiscard]] EntityRecord & GetRecord(Entity);
+	[[nodiscard]] EntityRecord const & GetRecord(Entity) const;
+	[[nodiscard]] uint32_t GetArchetype(ComponentMask);
+	[[nodiscard]] uint32_t GetAddTarget(uint32_t, ComponentId);
+	[[nodiscard]] uint32_t GetRemoveTarget(uint32_t, ComponentId);
+	void MoveEntity(Entity, EntityRecord &, uint32_t);
+	[[nodiscard]] std::vector<uint32_t> const & GetQuery(ComponentMask);
+	void CheckStructuralChange() const;
+
+	std::vector<Archetype> m_archetypes{};
+	std::unordered_map<ComponentMask, uint32_t> m_archetype_lookup{};
+	std::unordered_map<ComponentMask, std::vector<uint32_t>> m_queries{};
+	std::vector<EntityRecord> m_entities{};
+	std::vector<uint32_t> m_free_entities{};
+	std::vector<NamedSystem> m_systems{};
+	uint32_t m_entity_count{ 0 };
+	// Queries running, structural changes are refused while non zero
+	uint32_t m_iterating{ 0 };
+};
+
+template<typename... Ts>
+Entity World::CreateEntity(Ts const &... t_components)
+{
+	CheckStructuralChange();
+
+	auto archetype = GetArchetype(ComponentRegistry::GetMask<Ts...>());
+	auto entity = AllocateEntity();
+	auto row = m_archetypes[archetype].Add(entity);
+	(new (m_archetypes[archetype].GetComponent(ComponentRegistry::GetId<Ts>(), row)) Ts{ t_components }, ...);
+
+	auto & record = m_entities[entity.index];
+	record.archetype = archetype;
+	record.row = row;
+	++m_entity_count;
+	return entity;
+}
+
+template<typename T>
+void World::AddComponent(Entity t_entity, T const & t_component)
+{
+	auto id = ComponentRegistry::GetId<T>();
+	auto & record = GetRecord(t_entity);
+	if (!m_archetypes[record.archetype].HasComponent(id)) {
+		CheckStructuralChange();
+		MoveEntity(t_entity, record, GetAddTarget(record.archetype, id));
+	}
+	new (m_archetypes[record.archetype].GetComponent(id, record.row)) T{ t_component };
+}
+
+template<typename T>
+void World::RemoveComponent(Entity t_entity)
+{
+	auto id = ComponentRegistry::GetId<T>();
+	auto & record = GetRecord(t_entity);
+	if (m_archetypes[record.archetype].HasComponent(id)) {
+		CheckStructuralChange();
+		MoveEntity(t_entity, record, GetRemoveTarget(record.archetype, id));
+	}
+}
+
+template<typename T>
+bool World::HasComponent(Entity t_entity) const
+{
+	return m_archetypes[GetRecord(t_entity).archetype].HasComponent(ComponentRegistry::GetId<T>());
+}
+
+template<typename T>
+T & World::GetComponent(Entity t_entity)
+{
+	auto id = ComponentRegistry::GetId<T>();
+	auto const & record = GetRecord(t_entity);
+	auto & archetype = m_archetypes[record.archetype];
+	if (!archetype.HasComponent(id)) {
+		throw std::runtime_error("World - Entity does not have the component");
+	}
+	return *static_cast<T *>(archetype.GetComponent(id, record.row));
+}
+
+template<typename... Ts, typename F>
+void World::Each(F && t_function)
+{
+	EachChunk<Ts...>([&t_function](uint32_t t_count, Entity const *, Ts *... t_arrays) {
+		for (auto i = uint32_t{ 0 }; i < t_count; ++i) {
+			t_function(t_arrays[i]...);
+		}
+	});
+}
+
+template<typename... Ts, typename F>
+void World::EachChunk(F && t_function)
+{
+	auto const & archetypes = GetQuery(ComponentRegistry::GetMask<Ts...>());
+
+	++m_iterating;
+	try {
+		for (auto index : archetypes) {
+			auto & archetype = m_archetypes[index];
+			auto chunk_count = archetype.GetChunkCount();
+			for (auto chunk = uint32_t{ 0 }; chunk < chunk_count; ++chunk) {
+				t_function(archetype.GetChunkSize(chunk), archetype.GetEntities(chunk), archetype.template GetArray<Ts>(chunk)...);
+			}
+		}
+	}
+	catch (...) {
+		--m_iterating;
+		throw;
+	}
+	--m_iterating;
+}
+
+#endif // !WORLD
@@ -1,3 +0,0 @@
-%~dp0/VulkanSDK/1.2.131.2/Bin/glslc.exe Vertex.vert -o Shaders/vert.spv
-%~dp0/VulkanSDK/1.2.131.2/Bin/glslc.exe Fragment.frag -o Shaders/frag.spv
-pause
\ No newline at end of file
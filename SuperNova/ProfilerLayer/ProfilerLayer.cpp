@@ -0,0 +1,294 @@
+#include "ProfilerLayer.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+constexpr char const * REDUNDANT_CALL_NAMES[RC_COUNT] = {
+	"Redundant Pipeline Binds",
+	"Redundant Descriptor Set Binds",
+	"Redundant Vertex Buffer Binds",
+	"Redundant Index Buffer Binds",
+	"Redundant Viewports",
+	"Redundant Scissors",
+	"Redundant Push Constants"
+};
+
+namespace
+{
+	// Start of the call in flight on this thread, layers see no nested calls
+	thread_local std::chrono::steady_clock::time_point call_start{};
+
+	template<typename T>
+	bool SameBytes(T const & t_a, T const & t_b)
+	{
+		return std::memcmp(&t_a, &t_b, sizeof(T)) == 0;
+	}
+
+	// Compares the slots a call sets with what is bound, then binds them
+	template<typename T>
+	bool UpdateSlots(std::vector<T> & t_bound, uint32_t t_first, uint32_t t_count, T const * t_values)
+	{
+		if (t_bound.size() < size_t{ t_first } + t_count) {
+			t_bound.resize(size_t{ t_first } + t_count);
+			std::copy(t_values, t_values + t_count, t_bound.begin() + t_first);
+			return false;
+		}
+
+		auto same = std::equal(t_values, t_values + t_count, t_bound.begin() + t_first, [](auto const & t_a, auto const & t_b) {
+			return SameBytes(t_a, t_b);
+		});
+		std::copy(t_values, t_values + t_count, t_bound.begin() + t_first);
+		return same;
+	}
+}
+
+ProfilerLayer::ProfilerLayer()
+{
+	layer_name = "SuperNovaProfiler";
+
+	if (auto frame_call = std::getenv("SUPERNOVA_PROFILER_FRAME_CALL")) {
+		m_frame_call_name = frame_call;
+	}
+	if (auto file_path = std::getenv("SUPERNOVA_PROFILER_FILE")) {
+		m_file_path = file_path;
+	}
+}
+
+ProfilerLayer::~ProfilerLayer() noexcept
+{
+	// The last frame never reached its boundary call. Nothing is reported
+	// through the debug callbacks this late, the instance is gone
+	try {
+		auto lock = std::lock_guard<std::mutex>{ m_mutex };
+		auto pending = std::any_of(m_entry_points.begin(), m_entry_points.end(), [](auto const & t_entry_point) {
+			return t_entry_point.second.calls > 0;
+		});
+		if (pending && m_file.is_open()) {
+			EndFrame();
+		}
+	}
+	catch (std::exception &) {
+	}
+}
+
+void ProfilerLayer::PreCallApiFunction(char const * t_api_name)
+{
+	{
+		auto lock = std::lock_guard<std::mutex>{ m_mutex };
+		++m_entry_points[t_api_name].calls;
+	}
+	call_start = std::chrono::steady_clock::now();
+}
+
+void ProfilerLayer::PostCallApiFunction(char const * t_api_name)
+{
+	auto elapsed = std::chrono::steady_clock::now() - call_start;
+
+	auto lock = std::lock_guard<std::mutex>{ m_mutex };
+	m_entry_points[t_api_name].time += elapsed;
+
+	if (m_frame_call == nullptr && m_frame_call_name == t_api_name) {
+		m_frame_call = t_api_name;
+	}
+	if (t_api_name == m_frame_call) {
+		EndFrame();
+	}
+}
+
+void ProfilerLayer::PostCallApiFunction(char const * t_api_name, VkResult)
+{
+	PostCallApiFunction(t_api_name);
+}
+
+VkResult ProfilerLayer::PreCallBeginCommandBuffer(VkCommandBuffer t_command_buffer, VkCommandBufferBeginInfo const * t_begin_info)
+{
+	{
+		// Nothing is bound in a freshly begun command buffer, secondary ones
+		// included, they inherit no state
+		auto lock = std::lock_guard<std::mutex>{ m_mutex };
+		auto & state = m_command_buffers[t_command_buffer];
+		state.pipelines.fill(VK_NULL_HANDLE);
+		for (auto & bind : state.descriptor_binds) {
+			bind.layout = VK_NULL_HANDLE;
+			bind.sets.clear();
+			bind.dynamic_offsets.clear();
+		}
+		state.vertex_buffers.clear();
+		state.index_buffer = VK_NULL_HANDLE;
+		state.index_type = VK_INDEX_TYPE_MAX_ENUM;
+		state.viewports.clear();
+		state.scissors.clear();
+		state.push_constants.clear();
+		state.push_constants_set.clear();
+	}
+	return layer_factory::PreCallBeginCommandBuffer(t_command_buffer, t_begin_info);
+}
+
+void ProfilerLayer::PreCallFreeCommandBuffers(VkDevice t_device, VkCommandPool t_pool, uint32_t t_count, VkCommandBuffer const * t_command_buffers)
+{
+	{
+		auto lock = std::lock_guard<std::mutex>{ m_mutex };
+		for (auto i = uint32_t{ 0 }; i < t_count; ++i) {
+			m_command_buffers.erase(t_command_buffers[i]);
+		}
+	}
+	layer_factory::PreCallFreeCommandBuffers(t_device, t_pool, t_count, t_command_buffers);
+}
+
+void ProfilerLayer::PreCallCmdBindPipeline(VkCommandBuffer t_command_buffer, VkPipelineBindPoint t_bind_point, VkPipeline t_pipeline)
+{
+	if (t_bind_point < BIND_POINTS) {
+		auto lock = std::lock_guard<std::mutex>{ m_mutex };
+		auto & bound = m_command_buffers[t_command_buffer].pipelines[t_bind_point];
+		CountRedundant(RC_PIPELINE, bound == t_pipeline);
+		bound = t_pipeline;
+	}
+	layer_factory::PreCallCmdBindPipeline(t_command_buffer, t_bind_point, t_pipeline);
+}
+
+void ProfilerLayer::PreCallCmdBindDescriptorSets(VkCommandBuffer t_command_buffer, VkPipelineBindPoint t_bind_point, VkPipelineLayout t_layout,
+	uint32_t t_first_set, uint32_t t_set_count, VkDescriptorSet const * t_sets, uint32_t t_dynamic_offset_count, uint32_t const * t_dynamic_offsets)
+{
+	if (t_bind_point < BIND_POINTS) {
+		auto lock = std::lock_guard<std::mutex>{ m_mutex };
+		auto & previous = m_command_buffers[t_command_buffer].descriptor_binds[t_bind_point];
+		auto same = previous.layout == t_layout && previous.first_set == t_first_set &&
+			std::equal(previous.sets.begin(), previous.sets.end(), t_sets, t_sets + t_set_count) &&
+			std::equal(previous.dynamic_offsets.begin(), previous.dynamic_offsets.end(), t_dynamic_offsets, t_dynamic_offsets + t_dynamic_offset_count);
+		CountRedundant(RC_DESCRIPTOR_SETS, same);
+
+		previous.layout = t_layout;
+		previous.first_set = t_first_set;
+		previous.sets.assign(t_sets, t_sets + t_set_count);
+		previous.dynamic_offsets.assign(t_dynamic_offsets, t_dynamic_offsets + t_dynamic_offset_count);
+	}
+	layer_factory::PreCallCmdBindDescriptorSets(t_command_buffer, t_bind_point, t_layout, t_first_set, t_set_count, t_sets, t_dynamic_offset_count, t_dynamic_offsets);
+}
+
+void ProfilerLayer::PreCallCmdBindVertexBuffers(VkCommandBuffer t_command_buffer, uint32_t t_first_binding, uint32_t t_binding_count, VkBuffer const * t_buffers, VkDeviceSize const * t_offsets)
+{
+	{
+		auto bindings = std::vector<std::pair<VkBuffer, VkDeviceSize>>{};
+		bindings.reserve(t_binding_count);
+		for (auto i = uint32_t{ 0 }; i < t_binding_count; ++i) {
+			bindings.emplace_back(t_buffers[i], t_offsets[i]);
+		}
+
+		auto lock = std::lock_guard<std::mutex>{ m_mutex };
+		auto & state = m_command_buffers[t_command_buffer];
+		CountRedundant(RC_VERTEX_BUFFERS, UpdateSlots(state.vertex_buffers, t_first_binding, t_binding_count, bindings.data()));
+	}
+	layer_factory::PreCallCmdBindVertexBuffers(t_command_buffer, t_first_binding, t_binding_count, t_buffers, t_offsets);
+}
+
+void ProfilerLayer::PreCallCmdBindIndexBuffer(VkCommandBuffer t_command_buffer, VkBuffer t_buffer, VkDeviceSize t_offset, VkIndexType t_index_type)
+{
+	{
+		auto lock = std::lock_guard<std::mutex>{ m_mutex };
+		auto & state = m_command_buffers[t_command_buffer];
+		CountRedundant(RC_INDEX_BUFFER, state.index_buffer == t_buffer && state.index_offset == t_offset && state.index_type == t_index_type);
+		state.index_buffer = t_buffer;
+		state.index_offset = t_offset;
+		state.index_type = t_index_type;
+	}
+	layer_factory::PreCallCmdBindIndexBuffer(t_command_buffer, t_buffer, t_offset, t_index_type);
+}
+
+void ProfilerLayer::PreCallCmdSetViewport(VkCommandBuffer t_command_buffer, uint32_t t_first_viewport, uint32_t t_viewport_count, VkViewport const * t_viewports)
+{
+	{
+		auto lock = std::lock_guard<std::mutex>{ m_mutex };
+		auto & state = m_command_buffers[t_command_buffer];
+		CountRedundant(RC_VIEWPORT, UpdateSlots(state.viewports, t_first_viewport, t_viewport_count, t_viewports));
+	}
+	layer_factory::PreCallCmdSetViewport(t_command_buffer, t_first_viewport, t_viewport_count, t_viewports);
+}
+
+void ProfilerLayer::PreCallCmdSetScissor(VkCommandBuffer t_command_buffer, uint32_t t_first_scissor, uint32_t t_scissor_count, VkRect2D const * t_scissors)
+{
+	{
+		auto lock = std::lock_guard<std::mutex>{ m_mutex };
+		auto & state = m_command_buffers[t_command_buffer];
+		CountRedundant(RC_SCISSOR, UpdateSlots(state.scissors, t_first_scissor, t_scissor_count, t_scissors));
+	}
+	layer_factory::PreCallCmdSetScissor(t_command_buffer, t_first_scissor, t_scissor_count, t_scissors);
+}
+
+void ProfilerLayer::PreCallCmdPushConstants(VkCommandBuffer t_command_buffer, VkPipelineLayout t_layout, VkShaderStageFlags t_stages, uint32_t t_offset, uint32_t t_size, void const * t_values)
+{
+	{
+		// Layouts with compatible push constant ranges share the values, stages and
+		// layouts are not compared
+		auto lock = std::lock_guard<std::mutex>{ m_mutex };
+		auto & state = m_command_buffers[t_command_buffer];
+		auto bytes = static_cast<uint8_t const *>(t_values);
+		auto end = size_t{ t_offset } + t_size;
+		if (state.push_constants.size() < end) {
+			state.push_constants.resize(end);
+			state.push_constants_set.resize(end, false);
+		}
+
+		auto same = std::all_of(state.push_constants_set.begin() + t_offset, state.push_constants_set.begin() + end, [](bool t_set) { return t_set; }) &&
+			std::memcmp(state.push_constants.data() + t_offset, bytes, t_size) == 0;
+		CountRedundant(RC_PUSH_CONSTANTS, same);
+
+		std::memcpy(state.push_constants.data() + t_offset, bytes, t_size);
+		std::fill(state.push_constants_set.begin() + t_offset, state.push_constants_set.begin() + end, true);
+	}
+	layer_factory::PreCallCmdPushConstants(t_command_buffer, t_layout, t_stages, t_offset, t_size, t_values);
+}
+
+void ProfilerLayer::CountRedundant(REDUNDANT_CALL t_call, bool t_redundant)
+{
+	if (t_redundant) {
+		++m_redundant[t_call];
+	}
+}
+
+void ProfilerLayer::EndFrame()
+{
+	if (!m_file.is_open()) {
+		m_file.open(m_file_path);
+		if (!m_file) {
+			Error("SuperNova profiler - Could not create " + m_file_path);
+			return;
+		}
+		m_file << "frame,source,name,value\n";
+	}
+
+	// Sorted so frames line up row for row whatever the hash order
+	auto entry_points = std::vector<std::pair<std::string, EntryPoint>>{};
+	for (auto & entry_point : m_entry_points) {
+		if (entry_point.second.calls > 0) {
+			entry_points.emplace_back(entry_point.first, entry_point.second);
+		}
+		entry_point.second = EntryPoint{};
+	}
+	std::sort(entry_points.begin(), entry_points.end(), [](auto const & t_a, auto const & t_b) {
+		return t_a.first < t_b.first;
+	});
+
+	auto total_calls = uint64_t{ 0 };
+	auto total_time = std::chrono::steady_clock::duration{};
+	for (auto const & entry_point : entry_points) {
+		auto milliseconds = std::chrono::duration<double, std::milli>{ entry_point.second.time }.count();
+		WriteRow("Counter", entry_point.first + " Calls", static_cast<double>(entry_point.second.calls));
+		WriteRow("CPU", entry_point.first, milliseconds);
+		total_calls += entry_point.second.calls;
+		total_time += entry_point.second.time;
+	}
+
+	WriteRow("Counter", "Vulkan Calls", static_cast<double>(total_calls));
+	WriteRow("CPU", "Vulkan Driver Time", std::chrono::duration<double, std::milli>{ total_time }.count());
+	for (auto call = 0; call < RC_COUNT; ++call) {
+		WriteRow("Counter", REDUNDANT_CALL_NAMES[call], static_cast<double>(m_redundant[call]));
+	}
+
+	m_redundant.fill(0);
+	++m_frame;
+}
+
+void ProfilerLayer::WriteRow(char const * t_source, std::string const & t_name, double t_value)
+{
+	m_file << m_frame << ',' << t_source << ',' << t_name << ',' << t_value << '\n';
+}
@@ -0,0 +1,113 @@
+#ifndef PROFILER_LAYER
+#define PROFILER_LAYER
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "vk_layer_logging.h"
+#include "layer_factory.h"
+
+enum REDUNDANT_CALL
+{
+	RC_PIPELINE = 0,
+	RC_DESCRIPTOR_SETS,
+	RC_VERTEX_BUFFERS,
+	RC_INDEX_BUFFER,
+	RC_VIEWPORT,
+	RC_SCISSOR,
+	RC_PUSH_CONSTANTS,
+	RC_COUNT
+};
+
+// Vulkan layer counting every call the application makes and the CPU time each
+// entry point spends below the layer, in the driver and any layers under this
+// one. Binds and state changes that repeat what the command buffer already has
+// are counted as redundant: a pipeline or buffer bind, viewport, scissor or push
+// constants identical to the current ones, or a descriptor set bind repeating
+// the previous one at that bind point.
+//
+// Every frame is written as rows of the engine's telemetry csv, call counts and
+// redundant binds as counters and driver time as CPU milliseconds, so captures
+// from any driver, software ones in CI included, compare with a diff. Frames end
+// at vkQueuePresentKHR. Runs that never present, like --headless, name a call
+// made once per frame instead, vkCmdResetQueryPool for the engine.
+//
+// Environment:
+//     SUPERNOVA_PROFILER_FILE        csv to write, VulkanProfile.csv by default
+//     SUPERNOVA_PROFILER_FRAME_CALL  entry point ending each frame
+class ProfilerLayer : public layer_factory
+{
+public:
+	explicit ProfilerLayer();
+	ProfilerLayer(ProfilerLayer const &) = delete;
+	ProfilerLayer(ProfilerLayer &&) = delete;
+	ProfilerLayer & operator = (ProfilerLayer const &) = delete;
+	ProfilerLayer & operator = (ProfilerLayer &&) = delete;
+	~ProfilerLayer() noexcept;
+
+	void PreCallApiFunction(char const *) final;
+	void PostCallApiFunction(char const *) final;
+	void PostCallApiFunction(char const *, VkResult) final;
+
+	VkResult PreCallBeginCommandBuffer(VkCommandBuffer, VkCommandBufferBeginInfo const *) final;
+	void PreCallFreeCommandBuffers(VkDevice, VkCommandPool, uint32_t, VkCommandBuffer const *) final;
+	void PreCallCmdBindPipeline(VkCommandBuffer, VkPipelineBindPoint, VkPipeline) final;
+	void PreCallCmdBindDescriptorSets(VkCommandBuffer, VkPipelineBindPoint, VkPipelineLayout, uint32_t, uint32_t, VkDescriptorSet const *, uint32_t, uint32_t const *) final;
+	void PreCallCmdBindVertexBuffers(VkCommandBuffer, uint32_t, uint32_t, VkBuffer const *, VkDeviceSize const *) final;
+	void PreCallCmdBindIndexBuffer(VkCommandBuffer, VkBuffer, VkDeviceSize, VkIndexType) final;
+	void PreCallCmdSetViewport(VkCommandBuffer, uint32_t, uint32_t, VkViewport const *) final;
+	void PreCallCmdSetScissor(VkCommandBuffer, uint32_t, uint32_t, VkRect2D const *) final;
+	void PreCallCmdPushConstants(VkCommandBuffer, VkPipelineLayout, VkShaderStageFlags, uint32_t, uint32_t, void const *) final;
+
+private:
+	// Graphics and compute
+	static constexpr size_t BIND_POINTS = 2;
+
+	struct EntryPoint {
+		uint64_t calls{ 0 };
+		std::chrono::steady_clock::duration time{};
+	};
+
+	struct DescriptorBind {
+		VkPipelineLayout layout{ VK_NULL_HANDLE };
+		uint32_t first_set{ 0 };
+		std::vector<VkDescriptorSet> sets{};
+		std::vector<uint32_t> dynamic_offsets{};
+	};
+
+	struct CommandBufferState {
+		std::array<VkPipeline, BIND_POINTS> pipelines{};
+		std::array<DescriptorBind, BIND_POINTS> descriptor_binds{};
+		std::vector<std::pair<VkBuffer, VkDeviceSize>> vertex_buffers{};
+		VkBuffer index_buffer{ VK_NULL_HANDLE };
+		VkDeviceSize index_offset{ 0 };
+		VkIndexType index_type{ VK_INDEX_TYPE_MAX_ENUM };
+		std::vector<VkViewport> viewports{};
+		std::vector<VkRect2D> scissors{};
+		std::vector<uint8_t> push_constants{};
+		// Bytes of push_constants the command buffer has set
+		std::vector<bool> push_constants_set{};
+	};
+
+	void CountRedundant(REDUNDANT_CALL, bool);
+	void EndFrame();
+	void WriteRow(char const *, std::string const &, double);
+
+	std::mutex m_mutex{};
+	// Entry point names are the generated layer's string literals, their
+	// addresses are stable keys
+	std::unordered_map<char const *, EntryPoint> m_entry_points{};
+	std::unordered_map<VkCommandBuffer, CommandBufferState> m_command_buffers{};
+	std::array<uint64_t, RC_COUNT> m_redundant{};
+	std::string m_frame_call_name{ "vkQueuePresentKHR" };
+	char const * m_frame_call{ nullptr };
+	uint64_t m_frame{ 1 };
+	std::string m_file_path{ "VulkanProfile.csv" };
+	std::ofstream m_file{};
+};
+
+#endif // !PROFILER_LAYER
@@ -0,0 +1,5 @@
+// Included by the LayerFactory's layer_factory.cpp once its interceptor list is
+// defined, every interceptor is constructed here so it registers after that
+#include "ProfilerLayer.h"
+
+ProfilerLayer profiler_layer{};
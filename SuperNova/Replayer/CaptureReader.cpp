@@ -0,0 +1,155 @@
+#include "CaptureReader.h"
+#include "MappedFile.h"
+#include "LzCodec.h"
+#include <cstring>
+#include <stdexcept>
+
+void CaptureReader::Create(std::string const & t_path)
+{
+	Destroy();
+
+	auto file = MappedFile{};
+	file.Create(t_path);
+	auto data = file.GetData();
+	auto size = file.GetSize();
+
+	auto header = CaptureFileHeader{};
+	if (size < sizeof(header)) {
+		throw std::runtime_error("Capture reader - " + t_path + " is not a capture");
+	}
+	std::memcpy(&header, data, sizeof(header));
+	if (header.magic != CAPTURE_FILE_MAGIC) {
+		throw std::runtime_error("Capture reader - " + t_path + " is not a capture");
+	}
+	if (header.version != CAPTURE_FILE_VERSION) {
+		throw std::runtime_error("Capture reader - " + t_path + " is version " + std::to_string(header.version) +
+			", expected " + std::to_string(CAPTURE_FILE_VERSION));
+	}
+	if (header.pointer_size != sizeof(void *)) {
+		throw std::runtime_error("Capture reader - " + t_path + " was made by a " + std::to_string(header.pointer_size * 8) +
+			" bit build and replays on those only");
+	}
+
+	// Block headers follow unaligned stored data, they are copied out. The
+	// first pass sizes the stream so it is allocated once.
+	auto blocks = std::vector<std::pair<uint64_t, CaptureBlockHeader>>{};
+	auto stream_size = uint64_t{ 0 };
+	for (auto offset = uint64_t{ sizeof(header) }; offset < size;) {
+		auto block = CaptureBlockHeader{};
+		if (size - offset < sizeof(block)) {
+			throw std::runtime_error("Capture reader - " + t_path + " is truncated");
+		}
+		std::memcpy(&block, data + offset, sizeof(block));
+		offset += sizeof(block);
+		if (block.stored_size > block.size || size - offset < block.stored_size) {
+			throw std::runtime_error("Capture reader - " + t_path + " is truncated");
+		}
+		blocks.emplace_back(offset, block);
+		stream_size += block.size;
+		offset += block.stored_size;
+	}
+
+	m_stream.resize(static_cast<size_t>(stream_size));
+	auto position = size_t{ 0 };
+	for (auto const & block : blocks) {
+		auto stored = data + block.first;
+		auto block_size = static_cast<size_t>(block.second.size);
+		if (block.second.stored_size == block.second.size) {
+			std::memcpy(m_stream.data() + position, stored, block_size);
+		}
+		else {
+			LzCodec::Decompress(stored, static_cast<size_t>(block.second.stored_size), m_stream.data() + position, block_size);
+		}
+		position += block_size;
+	}
+
+	m_frame_count = header.frame_count;
+	file.Destroy();
+}
+
+void CaptureReader::Destroy() noexcept
+{
+	m_stream = std::vector<uint8_t>{};
+	m_position = 0;
+	m_frame_count = 0;
+}
+
+uint32_t CaptureReader::GetFrameCount() const noexcept
+{
+	return m_frame_count;
+}
+
+uint64_t CaptureReader::GetStreamSize() const noexcept
+{
+	return m_stream.size();
+}
+
+bool CaptureReader::IsAtEnd() const noexcept
+{
+	return m_position >= m_stream.size();
+}
+
+CAPTURE_CALL CaptureReader::ReadCall()
+{
+	auto call = Read<CAPTURE_CALL>();
+	if (call >= CC_COUNT) {
+		throw std::runtime_error("Capture reader - Unknown call " + std::to_string(call) + " in the stream");
+	}
+	return call;
+}
+
+CaptureBytes CaptureReader::ReadBytes()
+{
+	auto bytes = CaptureBytes{};
+	bytes.size = Read<uint64_t>();
+	if (bytes.size > 0) {
+		bytes.data = Take(static_cast<size_t>(bytes.size), alignof(uint64_t));
+	}
+	return bytes;
+}
+
+char const * CaptureReader::ReadString()
+{
+	return ReadArray<char>().data;
+}
+
+void const * CaptureReader::ReadNext()
+{
+	auto first = static_cast<VkBaseOutStructure *>(nullptr);
+	auto last = static_cast<VkBaseOutStructure *>(nullptr);
+	for (auto type = Read<VkStructureType>(); type != VK_STRUCTURE_TYPE_MAX_ENUM; type = Read<VkStructureType>()) {
+		auto next = static_cast<VkBaseOutStructure *>(nullptr);
+		if (type == VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO) {
+			auto timeline = static_cast<VkTimelineSemaphoreSubmitInfo *>(Take(sizeof(VkTimelineSemaphoreSubmitInfo), alignof(VkTimelineSemaphoreSubmitInfo)));
+			timeline->pWaitSemaphoreValues = ReadArray<uint64_t>().data;
+			timeline->pSignalSemaphoreValues = ReadArray<uint64_t>().data;
+			next = reinterpret_cast<VkBaseOutStructure *>(timeline);
+		}
+		else if (auto size = GetPlainNextSize(type)) {
+			next = static_cast<VkBaseOutStructure *>(Take(size, alignof(VkBaseOutStructure)));
+		}
+		else {
+			throw std::runtime_error("Capture reader - Unknown struct " + std::to_string(type) + " in a pNext chain");
+		}
+
+		next->pNext = nullptr;
+		if (last != nullptr) {
+			last->pNext = next;
+		}
+		else {
+			first = next;
+		}
+		last = next;
+	}
+	return first;
+}
+
+void * CaptureReader::Take(size_t t_size, size_t t_alignment)
+{
+	auto position = (m_position + t_alignment - 1) / t_alignment * t_alignment;
+	if (position > m_stream.size() || m_stream.size() - position < t_size) {
+		throw std::runtime_error("Capture reader - The stream ends inside a record");
+	}
+	m_position = position + t_size;
+	return m_stream.data() + position;
+}
@@ -0,0 +1,88 @@
+#ifndef CAPTURE_READER
+#define CAPTURE_READER
+
+#include "CaptureFormat.h"
+#include <string>
+#include <vector>
+
+template<typename T>
+struct CaptureArray {
+	T const * data{ nullptr };
+	uint32_t count{ 0 };
+
+	[[nodiscard]] T const * begin() const noexcept { return data; }
+	[[nodiscard]] T const * end() const noexcept { return data + count; }
+};
+
+struct CaptureBytes {
+	void const * data{ nullptr };
+	uint64_t size{ 0 };
+};
+
+// Reads back the call stream of a capture file, see CaptureFormat.h. The blocks
+// are decompressed up front into one buffer laid out as the writer counted its
+// offsets, so every value and array is used where it lies. Arrays come back
+// null when empty, matching the writer writing null arrays empty. A stream that
+// ends inside a record throws.
+class CaptureReader
+{
+public:
+	explicit CaptureReader() = default;
+	CaptureReader(CaptureReader const &) = delete;
+	CaptureReader(CaptureReader &&) noexcept = default;
+	CaptureReader & operator = (CaptureReader const &) = delete;
+	CaptureReader & operator = (CaptureReader &&) noexcept = default;
+	~CaptureReader() noexcept = default;
+
+	void Create(std::string const &);
+	void Destroy() noexcept;
+
+	[[nodiscard]] uint32_t GetFrameCount() const noexcept;
+	[[nodiscard]] uint64_t GetStreamSize() const noexcept;
+	[[nodiscard]] bool IsAtEnd() const noexcept;
+
+	[[nodiscard]] CAPTURE_CALL ReadCall();
+
+	template<typename T>
+	[[nodiscard]] T const & Read()
+	{
+		return *static_cast<T const *>(Take(sizeof(T), alignof(T)));
+	}
+
+	template<typename T>
+	void Skip()
+	{
+		Take(sizeof(T), alignof(T));
+	}
+
+	template<typename T>
+	[[nodiscard]] CaptureArray<T> ReadArray()
+	{
+		auto array = CaptureArray<T>{};
+		array.count = Read<uint32_t>();
+		if (array.count > 0) {
+			array.data = static_cast<T const *>(Take(sizeof(T) * array.count, alignof(T)));
+		}
+		return array;
+	}
+
+	template<typename T>
+	[[nodiscard]] T const * ReadOptional()
+	{
+		return Read<VkBool32>() == VK_TRUE ? &Read<T>() : nullptr;
+	}
+
+	[[nodiscard]] CaptureBytes ReadBytes();
+	[[nodiscard]] char const * ReadString();
+	// Links the structs in place, the chain lives as long as the reader
+	[[nodiscard]] void const * ReadNext();
+
+private:
+	void * Take(size_t, size_t);
+
+	std::vector<uint8_t> m_stream{};
+	size_t m_position{ 0 };
+	uint32_t m_frame_count{ 0 };
+};
+
+#endif // !CAPTURE_READER
@@ -0,0 +1,77 @@
+#include "Replayer.h"
+#include <fstream>
+#include <iostream>
+#include <numeric>
+
+// Replays a capture made with the SuperNova capture layer and reports how long
+// every frame took. The first frame holds everything the application did
+// before it, loading included, and is reported apart as setup. Frames count
+// from 1 on the console and in the csv alike, as in the engine's telemetry and
+// the profiler layer.
+//
+//     Replayer <capture> [--validate] [--csv <file>]
+int main(int argc, char** argv)
+{
+	auto arguments = std::vector<std::string>(argv + 1, argv + argc);
+	auto capture_path = std::string{};
+	auto csv_path = std::string{};
+	auto validate = false;
+	for (size_t i = 0; i < arguments.size(); ++i) {
+		if (arguments[i] == "--validate") {
+			validate = true;
+		}
+		else if (arguments[i] == "--csv" && i + 1 < arguments.size()) {
+			csv_path = arguments[++i];
+		}
+		else if (capture_path.empty()) {
+			capture_path = arguments[i];
+		}
+		else {
+			std::cerr << "Replayer - Ignoring unknown argument " << arguments[i] << '\n';
+		}
+	}
+	if (capture_path.empty()) {
+		std::cerr << "Usage: Replayer <capture> [--validate] [--csv <file>]\n";
+		return EXIT_FAILURE;
+	}
+
+	auto frames = std::vector<double>{};
+	auto replayer = Replayer{};
+	try {
+		replayer.Create(capture_path, validate);
+		std::cout << "Replaying " << replayer.GetFrameCount() << " frames, " << replayer.GetStreamSize() / 1024 << " KiB of calls\n";
+		frames = replayer.Run();
+	}
+	catch (std::exception & error) {
+		std::cerr << error.what() << '\n';
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "Replayed on " << replayer.GetDeviceName() << '\n';
+	for (size_t i = 0; i < frames.size(); ++i) {
+		std::cout << "Frame " << i + 1 << ": " << frames[i] << " ms" << (i == 0 ? " (setup)" : "") << '\n';
+	}
+	if (frames.size() > 1) {
+		auto first = frames.begin() + 1;
+		auto total = std::accumulate(first, frames.end(), 0.0);
+		auto average = total / static_cast<double>(frames.size() - 1);
+		std::cout << "Frames 2-" << frames.size() << ": min " << *std::min_element(first, frames.end()) << " ms, average " << average
+			<< " ms, max " << *std::max_element(first, frames.end()) << " ms, " << 1000.0 / average << " fps\n";
+	}
+
+	// Rows as the engine's telemetry writes them, so both line up in one sheet
+	if (!csv_path.empty()) {
+		auto csv = std::ofstream{ csv_path, std::ios::trunc };
+		if (!csv) {
+			std::cerr << "Replayer - Could not create " << csv_path << '\n';
+			return EXIT_FAILURE;
+		}
+		csv << "frame,source,name,value\n";
+		for (size_t i = 0; i < frames.size(); ++i) {
+			csv << i + 1 << ",CPU,Replay frame," << frames[i] << '\n';
+		}
+	}
+
+	replayer.Destroy();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,1366 @@
+#include "PreCompiledHeader.hpp"
+#include "Replayer.h"
+#include "VulkanUtils.h"
+#include <chrono>
+#include <iostream>
+
+Replayer::~Replayer() noexcept
+{
+	Destroy();
+}
+
+void Replayer::Create(std::string const & t_path, bool t_validate)
+{
+	Destroy();
+	m_reader.Create(t_path);
+	m_validate = t_validate;
+}
+
+void Replayer::Destroy() noexcept
+{
+	if (m_device != VK_NULL_HANDLE) {
+		vkDeviceWaitIdle(m_device);
+
+		// Swapchain images go last, after the views of them. Command buffers
+		// and descriptor sets go with their pools.
+		for (auto const & swapchain : m_swapchains) {
+			for (auto image : swapchain.second.captured_images) {
+				m_objects.erase(ObjectKey{ VK_OBJECT_TYPE_IMAGE, ToValue(image) });
+			}
+		}
+		auto objects = std::vector<std::pair<ObjectKey, Object>>{ m_objects.begin(), m_objects.end() };
+		std::sort(objects.begin(), objects.end(), [](auto const & t_first, auto const & t_second) {
+			return t_first.second.order > t_second.second.order;
+		});
+		for (auto const & object : objects) {
+			try {
+				DestroyObject(object.first.type, object.first.handle);
+			}
+			catch (std::exception &) {
+			}
+		}
+		auto swapchains = std::vector<uint64_t>{};
+		for (auto const & swapchain : m_swapchains) {
+			swapchains.emplace_back(swapchain.first);
+		}
+		for (auto swapchain : swapchains) {
+			DestroySwapchain(swapchain);
+		}
+		vkDestroyDevice(m_device, nullptr);
+		m_device = VK_NULL_HANDLE;
+	}
+	if (m_instance != VK_NULL_HANDLE) {
+		vkDestroyInstance(m_instance, nullptr);
+		m_instance = VK_NULL_HANDLE;
+	}
+
+	m_objects.clear();
+	m_memory.clear();
+	m_swapchains.clear();
+	m_physical_device = VK_NULL_HANDLE;
+	m_queue = VK_NULL_HANDLE;
+	m_reader.Destroy();
+}
+
+uint32_t Replayer::GetFrameCount() const noexcept
+{
+	return m_reader.GetFrameCount();
+}
+
+uint64_t Replayer::GetStreamSize() const noexcept
+{
+	return m_reader.GetStreamSize();
+}
+
+std::string const & Replayer::GetDeviceName() const noexcept
+{
+	return m_device_name;
+}
+
+std::vector<double> Replayer::Run()
+{
+	auto frames = std::vector<double>{};
+	frames.reserve(m_reader.GetFrameCount());
+
+	auto frame_start = std::chrono::steady_clock::now();
+	while (!m_reader.IsAtEnd()) {
+		auto call = m_reader.ReadCall();
+		if (call == CC_FRAME_END) {
+			auto now = std::chrono::steady_clock::now();
+			frames.emplace_back(std::chrono::duration<double, std::milli>(now - frame_start).count());
+			frame_start = now;
+			continue;
+		}
+
+		m_scratch_block = 0;
+		m_scratch_used = 0;
+		Replay(call);
+	}
+
+	if (m_device != VK_NULL_HANDLE) {
+		vkDeviceWaitIdle(m_device);
+	}
+	return frames;
+}
+
+void Replayer::Replay(CAPTURE_CALL t_call)
+{
+	switch (t_call) {
+	case CC_CREATE_INSTANCE:
+		CreateInstance(m_reader.Read<uint32_t>());
+		break;
+	case CC_CREATE_DEVICE:
+		CreateDevice();
+		break;
+	case CC_GET_DEVICE_QUEUE:
+	case CC_DEVICE_WAIT_IDLE:
+	case CC_QUEUE_WAIT_IDLE:
+	case CC_QUEUE_SUBMIT:
+	case CC_WAIT_FOR_FENCES:
+	case CC_RESET_FENCES:
+	case CC_WAIT_SEMAPHORES:
+	case CC_GET_QUERY_POOL_RESULTS:
+		ReplayDevice(t_call);
+		break;
+	case CC_ALLOCATE_MEMORY:
+	case CC_FREE_MEMORY:
+	case CC_MAP_MEMORY:
+	case CC_UNMAP_MEMORY:
+	case CC_MEMORY_WRITE:
+	case CC_BIND_BUFFER_MEMORY:
+	case CC_BIND_IMAGE_MEMORY:
+		ReplayMemory(t_call);
+		break;
+	case CC_CREATE_BUFFER:
+	case CC_CREATE_IMAGE:
+	case CC_CREATE_IMAGE_VIEW:
+	case CC_CREATE_SAMPLER:
+	case CC_CREATE_SEMAPHORE:
+	case CC_CREATE_FENCE:
+	case CC_CREATE_QUERY_POOL:
+	case CC_DESTROY:
+		ReplayObjects(t_call);
+		break;
+	case CC_CREATE_SHADER_MODULE:
+	case CC_CREATE_DESCRIPTOR_SET_LAYOUT:
+	case CC_CREATE_PIPELINE_LAYOUT:
+	case CC_CREATE_RENDER_PASS:
+	case CC_CREATE_FRAMEBUFFER:
+	case CC_CREATE_GRAPHICS_PIPELINES:
+	case CC_CREATE_COMPUTE_PIPELINES:
+		ReplayPipelines(t_call);
+		break;
+	case CC_CREATE_DESCRIPTOR_POOL:
+	case CC_RESET_DESCRIPTOR_POOL:
+	case CC_ALLOCATE_DESCRIPTOR_SETS:
+	case CC_FREE_DESCRIPTOR_SETS:
+	case CC_UPDATE_DESCRIPTOR_SETS:
+		ReplayDescriptors(t_call);
+		break;
+	case CC_CREATE_COMMAND_POOL:
+	case CC_RESET_COMMAND_POOL:
+	case CC_ALLOCATE_COMMAND_BUFFERS:
+	case CC_FREE_COMMAND_BUFFERS:
+	case CC_BEGIN_COMMAND_BUFFER:
+	case CC_END_COMMAND_BUFFER:
+	case CC_RESET_COMMAND_BUFFER:
+		ReplayCommandBuffers(t_call);
+		break;
+	case CC_CREATE_SWAPCHAIN:
+	case CC_GET_SWAPCHAIN_IMAGES:
+	case CC_ACQUIRE_NEXT_IMAGE:
+	case CC_QUEUE_PRESENT:
+		ReplaySwapchain(t_call);
+		break;
+	default:
+		ReplayCommands(t_call);
+		break;
+	}
+}
+
+void Replayer::ReplayDevice(CAPTURE_CALL t_call)
+{
+	switch (t_call) {
+	case CC_GET_DEVICE_QUEUE: {
+		auto family = m_reader.Read<uint32_t>();
+		auto index = m_reader.Read<uint32_t>();
+		auto captured = m_reader.Read<VkQueue>();
+		auto queue = VkQueue{ VK_NULL_HANDLE };
+		vkGetDeviceQueue(m_device, family, index, &queue);
+		Bind(VK_OBJECT_TYPE_QUEUE, captured, queue);
+		if (m_queue == VK_NULL_HANDLE) {
+			m_queue = queue;
+		}
+		break;
+	}
+	case CC_DEVICE_WAIT_IDLE: {
+		auto result = vkDeviceWaitIdle(m_device);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("wait for the device", result);
+		}
+		break;
+	}
+	case CC_QUEUE_WAIT_IDLE: {
+		auto result = vkQueueWaitIdle(Map(VK_OBJECT_TYPE_QUEUE, m_reader.Read<VkQueue>()));
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("wait for a queue", result);
+		}
+		break;
+	}
+	case CC_QUEUE_SUBMIT: {
+		auto queue = Map(VK_OBJECT_TYPE_QUEUE, m_reader.Read<VkQueue>());
+		auto fence = Map(VK_OBJECT_TYPE_FENCE, m_reader.Read<VkFence>());
+		auto count = m_reader.Read<uint32_t>();
+		auto submits = Allocate<VkSubmitInfo>(count);
+		for (auto i = uint32_t{ 0 }; i < count; ++i) {
+			auto & submit = submits[i];
+			submit = m_reader.Read<VkSubmitInfo>();
+			submit.pNext = m_reader.ReadNext();
+			submit.pWaitSemaphores = MapArray(VK_OBJECT_TYPE_SEMAPHORE, m_reader.ReadArray<VkSemaphore>());
+			submit.pWaitDstStageMask = m_reader.ReadArray<VkPipelineStageFlags>().data;
+			submit.pCommandBuffers = MapArray(VK_OBJECT_TYPE_COMMAND_BUFFER, m_reader.ReadArray<VkCommandBuffer>());
+			submit.pSignalSemaphores = MapArray(VK_OBJECT_TYPE_SEMAPHORE, m_reader.ReadArray<VkSemaphore>());
+		}
+		auto result = vkQueueSubmit(queue, count, submits, fence);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("submit", result);
+		}
+		break;
+	}
+	case CC_WAIT_FOR_FENCES: {
+		auto fences = m_reader.ReadArray<VkFence>();
+		auto wait_all = m_reader.Read<VkBool32>();
+		auto result = vkWaitForFences(m_device, fences.count, MapArray(VK_OBJECT_TYPE_FENCE, fences), wait_all, UINT64_MAX);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("wait for fences", result);
+		}
+		break;
+	}
+	case CC_RESET_FENCES: {
+		auto fences = m_reader.ReadArray<VkFence>();
+		auto result = vkResetFences(m_device, fences.count, MapArray(VK_OBJECT_TYPE_FENCE, fences));
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("reset fences", result);
+		}
+		break;
+	}
+	case CC_WAIT_SEMAPHORES: {
+		auto info = m_reader.Read<VkSemaphoreWaitInfo>();
+		info.pNext = nullptr;
+		info.pSemaphores = MapArray(VK_OBJECT_TYPE_SEMAPHORE, m_reader.ReadArray<VkSemaphore>());
+		info.pValues = m_reader.ReadArray<uint64_t>().data;
+		auto result = m_wait_semaphores(m_device, &info, UINT64_MAX);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("wait for semaphores", result);
+		}
+		break;
+	}
+	case CC_GET_QUERY_POOL_RESULTS: {
+		// The application saw these results, the replay waits until they are there
+		auto pool = Map(VK_OBJECT_TYPE_QUERY_POOL, m_reader.Read<VkQueryPool>());
+		auto first = m_reader.Read<uint32_t>();
+		auto count = m_reader.Read<uint32_t>();
+		auto size = static_cast<size_t>(m_reader.Read<uint64_t>());
+		auto stride = m_reader.Read<VkDeviceSize>();
+		auto flags = m_reader.Read<VkQueryResultFlags>();
+		m_query_results.resize(size);
+		auto result = vkGetQueryPoolResults(m_device, pool, first, count, size, m_query_results.data(), stride, flags | VK_QUERY_RESULT_WAIT_BIT);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("get query results", result);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void Replayer::ReplayMemory(CAPTURE_CALL t_call)
+{
+	switch (t_call) {
+	case CC_ALLOCATE_MEMORY: {
+		auto captured = m_reader.Read<VkDeviceMemory>();
+		auto info = m_reader.Read<VkMemoryAllocateInfo>();
+		auto flags = m_reader.Read<VkMemoryPropertyFlags>();
+		info.pNext = m_reader.ReadNext();
+		info.memoryTypeIndex = FindMemoryType(info.memoryTypeIndex, flags);
+
+		auto memory = Memory{};
+		memory.size = info.allocationSize;
+		memory.type = info.memoryTypeIndex;
+		auto result = vkAllocateMemory(m_device, &info, nullptr, &memory.memory);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("allocate memory", result);
+		}
+		Bind(VK_OBJECT_TYPE_DEVICE_MEMORY, captured, memory.memory);
+
+		if ((m_memory_properties.memoryTypes[memory.type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0) {
+			auto data = static_cast<void *>(nullptr);
+			result = vkMapMemory(m_device, memory.memory, 0, VK_WHOLE_SIZE, 0, &data);
+			if (result != VK_SUCCESS) {
+				vulkan_utils::ThrowError("map memory", result);
+			}
+			std::memset(data, 0, static_cast<size_t>(memory.size));
+			vkUnmapMemory(m_device, memory.memory);
+		}
+		m_memory[ToValue(captured)] = memory;
+		break;
+	}
+	case CC_FREE_MEMORY:
+		DestroyObject(VK_OBJECT_TYPE_DEVICE_MEMORY, ToValue(m_reader.Read<VkDeviceMemory>()));
+		break;
+	case CC_MAP_MEMORY: {
+		auto & memory = m_memory.at(ToValue(m_reader.Read<VkDeviceMemory>()));
+		auto offset = m_reader.Read<VkDeviceSize>();
+		auto size = m_reader.Read<VkDeviceSize>();
+		auto flags = m_reader.Read<VkMemoryMapFlags>();
+		auto data = static_cast<void *>(nullptr);
+		auto result = vkMapMemory(m_device, memory.memory, offset, size, flags, &data);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("map memory", result);
+		}
+		memory.mapped = static_cast<uint8_t *>(data);
+		memory.mapped_offset = offset;
+		break;
+	}
+	case CC_UNMAP_MEMORY: {
+		auto & memory = m_memory.at(ToValue(m_reader.Read<VkDeviceMemory>()));
+		vkUnmapMemory(m_device, memory.memory);
+		memory.mapped = nullptr;
+		break;
+	}
+	case CC_MEMORY_WRITE: {
+		auto & memory = m_memory.at(ToValue(m_reader.Read<VkDeviceMemory>()));
+		auto offset = m_reader.Read<uint64_t>();
+		auto bytes = m_reader.ReadBytes();
+		if (memory.mapped == nullptr || offset < memory.mapped_offset) {
+			throw std::runtime_error("Replayer - The capture writes memory that is not mapped");
+		}
+		std::memcpy(memory.mapped + (offset - memory.mapped_offset), bytes.data, static_cast<size_t>(bytes.size));
+		break;
+	}
+	case CC_BIND_BUFFER_MEMORY: {
+		auto buffer = Map(VK_OBJECT_TYPE_BUFFER, m_reader.Read<VkBuffer>());
+		auto captured = ToValue(m_reader.Read<VkDeviceMemory>());
+		auto offset = m_reader.Read<VkDeviceSize>();
+		auto requirements = VkMemoryRequirements{};
+		vkGetBufferMemoryRequirements(m_device, buffer, &requirements);
+		CheckBinding(requirements, captured, offset);
+		auto result = vkBindBufferMemory(m_device, buffer, m_memory.at(captured).memory, offset);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("bind buffer memory", result);
+		}
+		break;
+	}
+	case CC_BIND_IMAGE_MEMORY: {
+		auto image = Map(VK_OBJECT_TYPE_IMAGE, m_reader.Read<VkImage>());
+		auto captured = ToValue(m_reader.Read<VkDeviceMemory>());
+		auto offset = m_reader.Read<VkDeviceSize>();
+		auto requirements = VkMemoryRequirements{};
+		vkGetImageMemoryRequirements(m_device, image, &requirements);
+		CheckBinding(requirements, captured, offset);
+		auto result = vkBindImageMemory(m_device, image, m_memory.at(captured).memory, offset);
+		if (result != VK_SUCCESS) {
+			vulkan_utils::ThrowError("bind image memory", result);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void Replayer::ReplayObjects(CAPTURE_CALL t_call)
+{
+	auto result = VK_SUCCESS;
+	switch (t_call) {
+	case CC_CREATE_BUFFER: {
+		auto captured = m_reader.Read<VkBuffer>();
+		auto info = m_reader.Read<VkBufferCreateInfo>();
+		info.pNext = nullptr;
+		info.pQueueFamilyIndices = m_reader.ReadArray<uint32_t>().data;
+		auto buffer = VkBuffer{ VK_NULL_HANDLE };
+		result = vkCreateBuffer(m_device, &info, nullptr, &buffer);
+		Bind(VK_OBJECT_TYPE_BUFFER, captured, buffer);
+		break;
+	}
+	case CC_CREATE_IMAGE: {
+		auto captured = m_reader.Read<VkImage>();
+		auto info = m_reader.Read<VkImageCreateInfo>();
+		info.pNext = nullptr;
+		info.pQueueFamilyIndices = m_reader.ReadArray<uint32_t>().data;
+		auto image = VkImage{ VK_NULL_HANDLE };
+		result = vkCreateImage(m_device, &info, nullptr, &image);
+		Bind(VK_OBJECT_TYPE_IMAGE, captured, image);
+		break;
+	}
+	case CC_CREATE_IMAGE_VIEW: {
+		auto captured = m_reader.Read<VkImageView>();
+		auto info = m_reader.Read<VkImageViewCreateInfo>();
+		info.pNext = nullptr;
+		info.image = Map(VK_OBJECT_TYPE_IMAGE, info.image);
+		auto view = VkImageView{ VK_NULL_HANDLE };
+		result = vkCreateImageView(m_device, &info, nullptr, &view);
+		Bind(VK_OBJECT_TYPE_IMAGE_VIEW, captured, view);
+		break;
+	}
+	case CC_CREATE_SAMPLER: {
+		auto captured = m_reader.Read<VkSampler>();
+		auto info = m_reader.Read<VkSamplerCreateInfo>();
+		info.pNext = nullptr;
+		auto sampler = VkSampler{ VK_NULL_HANDLE };
+		result = vkCreateSampler(m_device, &info, nullptr, &sampler);
+		Bind(VK_OBJECT_TYPE_SAMPLER, captured, sampler);
+		break;
+	}
+	case CC_CREATE_SEMAPHORE: {
+		auto captured = m_reader.Read<VkSemaphore>();
+		auto info = m_reader.Read<VkSemaphoreCreateInfo>();
+		info.pNext = m_reader.ReadNext();
+		auto semaphore = VkSemaphore{ VK_NULL_HANDLE };
+		result = vkCreateSemaphore(m_device, &info, nullptr, &semaphore);
+		Bind(VK_OBJECT_TYPE_SEMAPHORE, captured, semaphore);
+		break;
+	}
+	case CC_CREATE_FENCE: {
+		auto captured = m_reader.Read<VkFence>();
+		auto info = m_reader.Read<VkFenceCreateInfo>();
+		info.pNext = nullptr;
+		auto fence = VkFence{ VK_NULL_HANDLE };
+		result = vkCreateFence(m_device, &info, nullptr, &fence);
+		Bind(VK_OBJECT_TYPE_FENCE, captured, fence);
+		break;
+	}
+	case CC_CREATE_QUERY_POOL: {
+		auto captured = m_reader.Read<VkQueryPool>();
+		auto info = m_reader.Read<VkQueryPoolCreateInfo>();
+		info.pNext = nullptr;
+		auto pool = VkQueryPool{ VK_NULL_HANDLE };
+		result = vkCreateQueryPool(m_device, &info, nullptr, &pool);
+		Bind(VK_OBJECT_TYPE_QUERY_POOL, captured, pool);
+		break;
+	}
+	case CC_DESTROY: {
+		auto type = m_reader.Read<VkObjectType>();
+		auto handle = m_reader.Read<uint64_t>();
+		if (type == VK_OBJECT_TYPE_SWAPCHAIN_KHR) {
+			DestroySwapchain(handle);
+		}
+		else {
+			DestroyObject(type, handle);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError(std::string{ "replay " } + CAPTURE_CALL_NAMES[t_call], result);
+	}
+}
+
+void Replayer::ReplayPipelines(CAPTURE_CALL t_call)
+{
+	auto result = VK_SUCCESS;
+	switch (t_call) {
+	case CC_CREATE_SHADER_MODULE: {
+		auto captured = m_reader.Read<VkShaderModule>();
+		auto info = m_reader.Read<VkShaderModuleCreateInfo>();
+		auto code = m_reader.ReadBytes();
+		info.pNext = nullptr;
+		info.codeSize = static_cast<size_t>(code.size);
+		info.pCode = static_cast<uint32_t const *>(code.data);
+		auto module = VkShaderModule{ VK_NULL_HANDLE };
+		result = vkCreateShaderModule(m_device, &info, nullptr, &module);
+		Bind(VK_OBJECT_TYPE_SHADER_MODULE, captured, module);
+		break;
+	}
+	case CC_CREATE_DESCRIPTOR_SET_LAYOUT: {
+		auto captured = m_reader.Read<VkDescriptorSetLayout>();
+		auto info = m_reader.Read<VkDescriptorSetLayoutCreateInfo>();
+		info.pNext = m_reader.ReadNext();
+		auto bindings = Allocate<VkDescriptorSetLayoutBinding>(info.bindingCount);
+		for (auto i = uint32_t{ 0 }; i < info.bindingCount; ++i) {
+			bindings[i] = m_reader.Read<VkDescriptorSetLayoutBinding>();
+			bindings[i].pImmutableSamplers = MapArray(VK_OBJECT_TYPE_SAMPLER, m_reader.ReadArray<VkSampler>());
+		}
+		info.pBindings = bindings;
+		auto layout = VkDescriptorSetLayout{ VK_NULL_HANDLE };
+		result = vkCreateDescriptorSetLayout(m_device, &info, nullptr, &layout);
+		Bind(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, captured, layout);
+		break;
+	}
+	case CC_CREATE_PIPELINE_LAYOUT: {
+		auto captured = m_reader.Read<VkPipelineLayout>();
+		auto info = m_reader.Read<VkPipelineLayoutCreateInfo>();
+		info.pNext = nullptr;
+		info.pSetLayouts = MapArray(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, m_reader.ReadArray<VkDescriptorSetLayout>());
+		info.pPushConstantRanges = m_reader.ReadArray<VkPushConstantRange>().data;
+		auto layout = VkPipelineLayout{ VK_NULL_HANDLE };
+		result = vkCreatePipelineLayout(m_device, &info, nullptr, &layout);
+		Bind(VK_OBJECT_TYPE_PIPELINE_LAYOUT, captured, layout);
+		break;
+	}
+	case CC_CREATE_RENDER_PASS: {
+		auto captured = m_reader.Read<VkRenderPass>();
+		auto info = m_reader.Read<VkRenderPassCreateInfo>();
+		info.pNext = nullptr;
+		info.pAttachments = m_reader.ReadArray<VkAttachmentDescription>().data;
+		auto subpasses = Allocate<VkSubpassDescription>(info.subpassCount);
+		for (auto i = uint32_t{ 0 }; i < info.subpassCount; ++i) {
+			auto & subpass = subpasses[i];
+			subpass = m_reader.Read<VkSubpassDescription>();
+			subpass.pInputAttachments = m_reader.ReadArray<VkAttachmentReference>().data;
+			subpass.pColorAttachments = m_reader.ReadArray<VkAttachmentReference>().data;
+			subpass.pResolveAttachments = m_reader.ReadArray<VkAttachmentReference>().data;
+			subpass.pDepthStencilAttachment = m_reader.ReadOptional<VkAttachmentReference>();
+			subpass.pPreserveAttachments = m_reader.ReadArray<uint32_t>().data;
+		}
+		info.pSubpasses = subpasses;
+		info.pDependencies = m_reader.ReadArray<VkSubpassDependency>().data;
+		auto render_pass = VkRenderPass{ VK_NULL_HANDLE };
+		result = vkCreateRenderPass(m_device, &info, nullptr, &render_pass);
+		Bind(VK_OBJECT_TYPE_RENDER_PASS, captured, render_pass);
+		break;
+	}
+	case CC_CREATE_FRAMEBUFFER: {
+		auto captured = m_reader.Read<VkFramebuffer>();
+		auto info = m_reader.Read<VkFramebufferCreateInfo>();
+		info.pNext = nullptr;
+		info.renderPass = Map(VK_OBJECT_TYPE_RENDER_PASS, info.renderPass);
+		info.pAttachments = MapArray(VK_OBJECT_TYPE_IMAGE_VIEW, m_reader.ReadArray<VkImageView>());
+		auto framebuffer = VkFramebuffer{ VK_NULL_HANDLE };
+		result = vkCreateFramebuffer(m_device, &info, nullptr, &framebuffer);
+		Bind(VK_OBJECT_TYPE_FRAMEBUFFER, captured, framebuffer);
+		break;
+	}
+	case CC_CREATE_GRAPHICS_PIPELINES:
+		CreateGraphicsPipelines();
+		break;
+	case CC_CREATE_COMPUTE_PIPELINES: {
+		auto captured = m_reader.ReadArray<VkPipeline>();
+		auto infos = Allocate<VkComputePipelineCreateInfo>(captured.count);
+		for (auto i = uint32_t{ 0 }; i < captured.count; ++i) {
+			infos[i] = m_reader.Read<VkComputePipelineCreateInfo>();
+			infos[i].pNext = nullptr;
+			infos[i].stage = ReadStage();
+			infos[i].layout = Map(VK_OBJECT_TYPE_PIPELINE_LAYOUT, infos[i].layout);
+			infos[i].basePipelineHandle = Map(VK_OBJECT_TYPE_PIPELINE, infos[i].basePipelineHandle);
+		}
+		auto pipelines = Allocate<VkPipeline>(captured.count);
+		result = vkCreateComputePipelines(m_device, VK_NULL_HANDLE, captured.count, infos, nullptr, pipelines);
+		for (auto i = uint32_t{ 0 }; i < captured.count; ++i) {
+			Bind(VK_OBJECT_TYPE_PIPELINE, captured.data[i], pipelines[i]);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError(std::string{ "replay " } + CAPTURE_CALL_NAMES[t_call], result);
+	}
+}
+
+void Replayer::ReplayDescriptors(CAPTURE_CALL t_call)
+{
+	auto result = VK_SUCCESS;
+	switch (t_call) {
+	case CC_CREATE_DESCRIPTOR_POOL: {
+		auto captured = m_reader.Read<VkDescriptorPool>();
+		auto info = m_reader.Read<VkDescriptorPoolCreateInfo>();
+		info.pNext = nullptr;
+		info.pPoolSizes = m_reader.ReadArray<VkDescriptorPoolSize>().data;
+		auto pool = VkDescriptorPool{ VK_NULL_HANDLE };
+		result = vkCreateDescriptorPool(m_device, &info, nullptr, &pool);
+		Bind(VK_OBJECT_TYPE_DESCRIPTOR_POOL, captured, pool);
+		break;
+	}
+	case CC_RESET_DESCRIPTOR_POOL: {
+		auto pool = Map(VK_OBJECT_TYPE_DESCRIPTOR_POOL, m_reader.Read<VkDescriptorPool>());
+		result = vkResetDescriptorPool(m_device, pool, m_reader.Read<VkDescriptorPoolResetFlags>());
+		break;
+	}
+	case CC_ALLOCATE_DESCRIPTOR_SETS: {
+		auto info = m_reader.Read<VkDescriptorSetAllocateInfo>();
+		info.pNext = m_reader.ReadNext();
+		info.descriptorPool = Map(VK_OBJECT_TYPE_DESCRIPTOR_POOL, info.descriptorPool);
+		info.pSetLayouts = MapArray(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, m_reader.ReadArray<VkDescriptorSetLayout>());
+		auto captured = m_reader.ReadArray<VkDescriptorSet>();
+		auto sets = Allocate<VkDescriptorSet>(captured.count);
+		result = vkAllocateDescriptorSets(m_device, &info, sets);
+		for (auto i = uint32_t{ 0 }; result == VK_SUCCESS && i < captured.count; ++i) {
+			Bind(VK_OBJECT_TYPE_DESCRIPTOR_SET, captured.data[i], sets[i]);
+		}
+		break;
+	}
+	case CC_FREE_DESCRIPTOR_SETS: {
+		auto pool = Map(VK_OBJECT_TYPE_DESCRIPTOR_POOL, m_reader.Read<VkDescriptorPool>());
+		auto captured = m_reader.ReadArray<VkDescriptorSet>();
+		result = vkFreeDescriptorSets(m_device, pool, captured.count, MapArray(VK_OBJECT_TYPE_DESCRIPTOR_SET, captured));
+		for (auto set : captured) {
+			m_objects.erase(ObjectKey{ VK_OBJECT_TYPE_DESCRIPTOR_SET, ToValue(set) });
+		}
+		break;
+	}
+	case CC_UPDATE_DESCRIPTOR_SETS:
+		UpdateDescriptorSets();
+		break;
+	default:
+		break;
+	}
+
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError(std::string{ "replay " } + CAPTURE_CALL_NAMES[t_call], result);
+	}
+}
+
+void Replayer::ReplayCommandBuffers(CAPTURE_CALL t_call)
+{
+	auto result = VK_SUCCESS;
+	switch (t_call) {
+	case CC_CREATE_COMMAND_POOL: {
+		auto captured = m_reader.Read<VkCommandPool>();
+		auto info = m_reader.Read<VkCommandPoolCreateInfo>();
+		info.pNext = nullptr;
+		auto pool = VkCommandPool{ VK_NULL_HANDLE };
+		result = vkCreateCommandPool(m_device, &info, nullptr, &pool);
+		Bind(VK_OBJECT_TYPE_COMMAND_POOL, captured, pool);
+		break;
+	}
+	case CC_RESET_COMMAND_POOL: {
+		auto pool = Map(VK_OBJECT_TYPE_COMMAND_POOL, m_reader.Read<VkCommandPool>());
+		result = vkResetCommandPool(m_device, pool, m_reader.Read<VkCommandPoolResetFlags>());
+		break;
+	}
+	case CC_ALLOCATE_COMMAND_BUFFERS: {
+		auto info = m_reader.Read<VkCommandBufferAllocateInfo>();
+		info.pNext = nullptr;
+		info.commandPool = Map(VK_OBJECT_TYPE_COMMAND_POOL, info.commandPool);
+		auto captured = m_reader.ReadArray<VkCommandBuffer>();
+		auto command_buffers = Allocate<VkCommandBuffer>(captured.count);
+		result = vkAllocateCommandBuffers(m_device, &info, command_buffers);
+		for (auto i = uint32_t{ 0 }; result == VK_SUCCESS && i < captured.count; ++i) {
+			Bind(VK_OBJECT_TYPE_COMMAND_BUFFER, captured.data[i], command_buffers[i]);
+		}
+		break;
+	}
+	case CC_FREE_COMMAND_BUFFERS: {
+		auto pool = Map(VK_OBJECT_TYPE_COMMAND_POOL, m_reader.Read<VkCommandPool>());
+		auto captured = m_reader.ReadArray<VkCommandBuffer>();
+		vkFreeCommandBuffers(m_device, pool, captured.count, MapArray(VK_OBJECT_TYPE_COMMAND_BUFFER, captured));
+		for (auto command_buffer : captured) {
+			m_objects.erase(ObjectKey{ VK_OBJECT_TYPE_COMMAND_BUFFER, ToValue(command_buffer) });
+		}
+		break;
+	}
+	case CC_BEGIN_COMMAND_BUFFER: {
+		auto command_buffer = Map(VK_OBJECT_TYPE_COMMAND_BUFFER, m_reader.Read<VkCommandBuffer>());
+		auto info = m_reader.Read<VkCommandBufferBeginInfo>();
+		info.pNext = nullptr;
+		if (auto captured = m_reader.ReadOptional<VkCommandBufferInheritanceInfo>()) {
+			auto inheritance = Copy(*captured);
+			inheritance->pNext = nullptr;
+			inheritance->renderPass = Map(VK_OBJECT_TYPE_RENDER_PASS, inheritance->renderPass);
+			inheritance->framebuffer = Map(VK_OBJECT_TYPE_FRAMEBUFFER, inheritance->framebuffer);
+			info.pInheritanceInfo = inheritance;
+		}
+		else {
+			info.pInheritanceInfo = nullptr;
+		}
+		result = vkBeginCommandBuffer(command_buffer, &info);
+		break;
+	}
+	case CC_END_COMMAND_BUFFER:
+		result = vkEndCommandBuffer(Map(VK_OBJECT_TYPE_COMMAND_BUFFER, m_reader.Read<VkCommandBuffer>()));
+		break;
+	case CC_RESET_COMMAND_BUFFER: {
+		auto command_buffer = Map(VK_OBJECT_TYPE_COMMAND_BUFFER, m_reader.Read<VkCommandBuffer>());
+		result = vkResetCommandBuffer(command_buffer, m_reader.Read<VkCommandBufferResetFlags>());
+		break;
+	}
+	default:
+		break;
+	}
+
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError(std::string{ "replay " } + CAPTURE_CALL_NAMES[t_call], result);
+	}
+}
+
+void Replayer::ReplayCommands(CAPTURE_CALL t_call)
+{
+	auto command_buffer = Map(VK_OBJECT_TYPE_COMMAND_BUFFER, m_reader.Read<VkCommandBuffer>());
+	switch (t_call) {
+	case CC_CMD_BIND_PIPELINE: {
+		auto bind_point = m_reader.Read<VkPipelineBindPoint>();
+		vkCmdBindPipeline(command_buffer, bind_point, Map(VK_OBJECT_TYPE_PIPELINE, m_reader.Read<VkPipeline>()));
+		break;
+	}
+	case CC_CMD_BIND_DESCRIPTOR_SETS: {
+		auto bind_point = m_reader.Read<VkPipelineBindPoint>();
+		auto layout = Map(VK_OBJECT_TYPE_PIPELINE_LAYOUT, m_reader.Read<VkPipelineLayout>());
+		auto first_set = m_reader.Read<uint32_t>();
+		auto sets = m_reader.ReadArray<VkDescriptorSet>();
+		auto offsets = m_reader.ReadArray<uint32_t>();
+		vkCmdBindDescriptorSets(command_buffer, bind_point, layout, first_set, sets.count, MapArray(VK_OBJECT_TYPE_DESCRIPTOR_SET, sets), offsets.count, offsets.data);
+		break;
+	}
+	case CC_CMD_BIND_VERTEX_BUFFERS: {
+		auto first_binding = m_reader.Read<uint32_t>();
+		auto buffers = m_reader.ReadArray<VkBuffer>();
+		auto offsets = m_reader.ReadArray<VkDeviceSize>();
+		vkCmdBindVertexBuffers(command_buffer, first_binding, buffers.count, MapArray(VK_OBJECT_TYPE_BUFFER, buffers), offsets.data);
+		break;
+	}
+	case CC_CMD_BIND_INDEX_BUFFER: {
+		auto buffer = Map(VK_OBJECT_TYPE_BUFFER, m_reader.Read<VkBuffer>());
+		auto offset = m_reader.Read<VkDeviceSize>();
+		vkCmdBindIndexBuffer(command_buffer, buffer, offset, m_reader.Read<VkIndexType>());
+		break;
+	}
+	case CC_CMD_SET_VIEWPORT: {
+		auto first = m_reader.Read<uint32_t>();
+		auto viewports = m_reader.ReadArray<VkViewport>();
+		vkCmdSetViewport(command_buffer, first, viewports.count, viewports.data);
+		break;
+	}
+	case CC_CMD_SET_SCISSOR: {
+		auto first = m_reader.Read<uint32_t>();
+		auto scissors = m_reader.ReadArray<VkRect2D>();
+		vkCmdSetScissor(command_buffer, first, scissors.count, scissors.data);
+		break;
+	}
+	case CC_CMD_PUSH_CONSTANTS: {
+		auto layout = Map(VK_OBJECT_TYPE_PIPELINE_LAYOUT, m_reader.Read<VkPipelineLayout>());
+		auto stages = m_reader.Read<VkShaderStageFlags>();
+		auto offset = m_reader.Read<uint32_t>();
+		auto values = m_reader.ReadBytes();
+		vkCmdPushConstants(command_buffer, layout, stages, offset, static_cast<uint32_t>(values.size), values.data);
+		break;
+	}
+	case CC_CMD_DRAW: {
+		auto vertex_count = m_reader.Read<uint32_t>();
+		auto instance_count = m_reader.Read<uint32_t>();
+		auto first_vertex = m_reader.Read<uint32_t>();
+		vkCmdDraw(command_buffer, vertex_count, instance_count, first_vertex, m_reader.Read<uint32_t>());
+		break;
+	}
+	case CC_CMD_DRAW_INDEXED: {
+		auto index_count = m_reader.Read<uint32_t>();
+		auto instance_count = m_reader.Read<uint32_t>();
+		auto first_index = m_reader.Read<uint32_t>();
+		auto vertex_offset = m_reader.Read<int32_t>();
+		vkCmdDrawIndexed(command_buffer, index_count, instance_count, first_index, vertex_offset, m_reader.Read<uint32_t>());
+		break;
+	}
+	case CC_CMD_DRAW_INDIRECT:
+	case CC_CMD_DRAW_INDEXED_INDIRECT: {
+		auto buffer = Map(VK_OBJECT_TYPE_BUFFER, m_reader.Read<VkBuffer>());
+		auto offset = m_reader.Read<VkDeviceSize>();
+		auto draw_count = m_reader.Read<uint32_t>();
+		auto stride = m_reader.Read<uint32_t>();
+		if (t_call == CC_CMD_DRAW_INDIRECT) {
+			vkCmdDrawIndirect(command_buffer, buffer, offset, draw_count, stride);
+		}
+		else {
+			vkCmdDrawIndexedIndirect(command_buffer, buffer, offset, draw_count, stride);
+		}
+		break;
+	}
+	case CC_CMD_DRAW_INDIRECT_COUNT: {
+		auto buffer = Map(VK_OBJECT_TYPE_BUFFER, m_reader.Read<VkBuffer>());
+		auto offset = m_reader.Read<VkDeviceSize>();
+		auto count_buffer = Map(VK_OBJECT_TYPE_BUFFER, m_reader.Read<VkBuffer>());
+		auto count_offset = m_reader.Read<VkDeviceSize>();
+		auto max_draw_count = m_reader.Read<uint32_t>();
+		auto stride = m_reader.Read<uint32_t>();
+		if (m_draw_indirect_count == nullptr) {
+			throw std::runtime_error("Replayer - The capture draws with an indirect count the device does not support");
+		}
+		m_draw_indirect_count(command_buffer, buffer, offset, count_buffer, count_offset, max_draw_count, stride);
+		break;
+	}
+	case CC_CMD_DISPATCH: {
+		auto x = m_reader.Read<uint32_t>();
+		auto y = m_reader.Read<uint32_t>();
+		vkCmdDispatch(command_buffer, x, y, m_reader.Read<uint32_t>());
+		break;
+	}
+	case CC_CMD_COPY_BUFFER: {
+		auto source = Map(VK_OBJECT_TYPE_BUFFER, m_reader.Read<VkBuffer>());
+		auto destination = Map(VK_OBJECT_TYPE_BUFFER, m_reader.Read<VkBuffer>());
+		auto regions = m_reader.ReadArray<VkBufferCopy>();
+		vkCmdCopyBuffer(command_buffer, source, destination, regions.count, regions.data);
+		break;
+	}
+	case CC_CMD_COPY_IMAGE: {
+		auto source = Map(VK_OBJECT_TYPE_IMAGE, m_reader.Read<VkImage>());
+		auto source_layout = m_reader.Read<VkImageLayout>();
+		auto destination = Map(VK_OBJECT_TYPE_IMAGE, m_reader.Read<VkImage>());
+		auto destination_layout = m_reader.Read<VkImageLayout>();
+		auto regions = m_reader.ReadArray<VkImageCopy>();
+		vkCmdCopyImage(command_buffer, source, source_layout, destination, destination_layout, regions.count, regions.data);
+		break;
+	}
+	case CC_CMD_COPY_BUFFER_TO_IMAGE: {
+		auto source = Map(VK_OBJECT_TYPE_BUFFER, m_reader.Read<VkBuffer>());
+		auto destination = Map(VK_OBJECT_TYPE_IMAGE, m_reader.Read<VkImage>());
+		auto layout = m_reader.Read<VkImageLayout>();
+		auto regions = m_reader.ReadArray<VkBufferImageCopy>();
+		vkCmdCopyBufferToImage(command_buffer, source, destination, layout, regions.count, regions.data);
+		break;
+	}
+	case CC_CMD_COPY_IMAGE_TO_BUFFER: {
+		auto source = Map(VK_OBJECT_TYPE_IMAGE, m_reader.Read<VkImage>());
+		auto layout = m_reader.Read<VkImageLayout>();
+		auto destination = Map(VK_OBJECT_TYPE_BUFFER, m_reader.Read<VkBuffer>());
+		auto regions = m_reader.ReadArray<VkBufferImageCopy>();
+		vkCmdCopyImageToBuffer(command_buffer, source, layout, destination, regions.count, regions.data);
+		break;
+	}
+	case CC_CMD_BLIT_IMAGE: {
+		auto source = Map(VK_OBJECT_TYPE_IMAGE, m_reader.Read<VkImage>());
+		auto source_layout = m_reader.Read<VkImageLayout>();
+		auto destination = Map(VK_OBJECT_TYPE_IMAGE, m_reader.Read<VkImage>());
+		auto destination_layout = m_reader.Read<VkImageLayout>();
+		auto regions = m_reader.ReadArray<VkImageBlit>();
+		auto filter = m_reader.Read<VkFilter>();
+		vkCmdBlitImage(command_buffer, source, source_layout, destination, destination_layout, regions.count, regions.data, filter);
+		break;
+	}
+	case CC_CMD_FILL_BUFFER: {
+		auto buffer = Map(VK_OBJECT_TYPE_BUFFER, m_reader.Read<VkBuffer>());
+		auto offset = m_reader.Read<VkDeviceSize>();
+		auto size = m_reader.Read<VkDeviceSize>();
+		vkCmdFillBuffer(command_buffer, buffer, offset, size, m_reader.Read<uint32_t>());
+		break;
+	}
+	case CC_CMD_UPDATE_BUFFER: {
+		auto buffer = Map(VK_OBJECT_TYPE_BUFFER, m_reader.Read<VkBuffer>());
+		auto offset = m_reader.Read<VkDeviceSize>();
+		auto data = m_reader.ReadBytes();
+		vkCmdUpdateBuffer(command_buffer, buffer, offset, data.size, data.data);
+		break;
+	}
+	case CC_CMD_PIPELINE_BARRIER: {
+		auto source_stages = m_reader.Read<VkPipelineStageFlags>();
+		auto destination_stages = m_reader.Read<VkPipelineStageFlags>();
+		auto dependencies = m_reader.Read<VkDependencyFlags>();
+		auto memory_captured = m_reader.ReadArray<VkMemoryBarrier>();
+		auto memory_barriers = Copy(memory_captured);
+		for (auto i = uint32_t{ 0 }; i < memory_captured.count; ++i) {
+			memory_barriers[i].pNext = nullptr;
+		}
+		auto buffer_captured = m_reader.ReadArray<VkBufferMemoryBarrier>();
+		auto buffer_barriers = Copy(buffer_captured);
+		for (auto i = uint32_t{ 0 }; i < buffer_captured.count; ++i) {
+			buffer_barriers[i].pNext = nullptr;
+			buffer_barriers[i].buffer = Map(VK_OBJECT_TYPE_BUFFER, buffer_barriers[i].buffer);
+		}
+		auto image_captured = m_reader.ReadArray<VkImageMemoryBarrier>();
+		auto image_barriers = Copy(image_captured);
+		for (auto i = uint32_t{ 0 }; i < image_captured.count; ++i) {
+			image_barriers[i].pNext = nullptr;
+			image_barriers[i].image = Map(VK_OBJECT_TYPE_IMAGE, image_barriers[i].image);
+		}
+		vkCmdPipelineBarrier(command_buffer, source_stages, destination_stages, dependencies, memory_captured.count, memory_barriers,
+			buffer_captured.count, buffer_barriers, image_captured.count, image_barriers);
+		break;
+	}
+	case CC_CMD_BEGIN_RENDER_PASS: {
+		auto info = m_reader.Read<VkRenderPassBeginInfo>();
+		info.pNext = nullptr;
+		info.renderPass = Map(VK_OBJECT_TYPE_RENDER_PASS, info.renderPass);
+		info.framebuffer = Map(VK_OBJECT_TYPE_FRAMEBUFFER, info.framebuffer);
+		info.pClearValues = m_reader.ReadArray<VkClearValue>().data;
+		vkCmdBeginRenderPass(command_buffer, &info, m_reader.Read<VkSubpassContents>());
+		break;
+	}
+	case CC_CMD_NEXT_SUBPASS:
+		vkCmdNextSubpass(command_buffer, m_reader.Read<VkSubpassContents>());
+		break;
+	case CC_CMD_END_RENDER_PASS:
+		vkCmdEndRenderPass(command_buffer);
+		break;
+	case CC_CMD_RESET_QUERY_POOL: {
+		auto pool = Map(VK_OBJECT_TYPE_QUERY_POOL, m_reader.Read<VkQueryPool>());
+		auto first = m_reader.Read<uint32_t>();
+		vkCmdResetQueryPool(command_buffer, pool, first, m_reader.Read<uint32_t>());
+		break;
+	}
+	case CC_CMD_WRITE_TIMESTAMP: {
+		auto stage = m_reader.Read<VkPipelineStageFlagBits>();
+		auto pool = Map(VK_OBJECT_TYPE_QUERY_POOL, m_reader.Read<VkQueryPool>());
+		vkCmdWriteTimestamp(command_buffer, stage, pool, m_reader.Read<uint32_t>());
+		break;
+	}
+	default:
+		throw std::runtime_error(std::string{ "Replayer - Unexpected " } + CAPTURE_CALL_NAMES[t_call] + " record");
+	}
+}
+
+void Replayer::ReplaySwapchain(CAPTURE_CALL t_call)
+{
+	switch (t_call) {
+	case CC_CREATE_SWAPCHAIN: {
+		auto captured = ToValue(m_reader.Read<VkSwapchainKHR>());
+		auto & swapchain = m_swapchains[captured];
+		swapchain.info = m_reader.Read<VkSwapchainCreateInfoKHR>();
+		swapchain.info.pNext = nullptr;
+		swapchain.info.pQueueFamilyIndices = nullptr;
+		break;
+	}
+	case CC_GET_SWAPCHAIN_IMAGES: {
+		auto & swapchain = m_swapchains.at(ToValue(m_reader.Read<VkSwapchainKHR>()));
+		auto captured = m_reader.ReadArray<VkImage>();
+		for (auto i = static_cast<uint32_t>(swapchain.images.size()); i < captured.count; ++i) {
+			auto info = VkImageCreateInfo{};
+			info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			info.imageType = VK_IMAGE_TYPE_2D;
+			info.format = swapchain.info.imageFormat;
+			info.extent = VkExtent3D{ swapchain.info.imageExtent.width, swapchain.info.imageExtent.height, 1 };
+			info.mipLevels = 1;
+			info.arrayLayers = swapchain.info.imageArrayLayers;
+			info.samples = VK_SAMPLE_COUNT_1_BIT;
+			info.tiling = VK_IMAGE_TILING_OPTIMAL;
+			info.usage = swapchain.info.imageUsage;
+			info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			auto image = SwapchainImage{};
+			auto result = vkCreateImage(m_device, &info, nullptr, &image.image);
+			if (result != VK_SUCCESS) {
+				vulkan_utils::ThrowError("create a swapchain image", result);
+			}
+			swapchain.images.emplace_back(image);
+
+			auto requirements = VkMemoryRequirements{};
+			vkGetImageMemoryRequirements(m_device, image.image, &requirements);
+			auto allocate_info = VkMemoryAllocateInfo{};
+			allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocate_info.allocationSize = requirements.size;
+			allocate_info.memoryTypeIndex = vulkan_utils::FindMemoryType(m_physical_device, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			result = vkAllocateMemory(m_device, &allocate_info, nullptr, &swapchain.images.back().memory);
+			if (result == VK_SUCCESS) {
+				result = vkBindImageMemory(m_device, image.image, swapchain.images.back().memory, 0);
+			}
+			if (result != VK_SUCCESS) {
+				vulkan_utils::ThrowError("allocate a swapchain image", result);
+			}
+		}
+
+		swapchain.captured_images.assign(captured.begin(), captured.end());
+		for (auto i = uint32_t{ 0 }; i < captured.count; ++i) {
+			Bind(VK_OBJECT_TYPE_IMAGE, captured.data[i], swapchain.images[i].image);
+		}
+		break;
+	}
+	case CC_ACQUIRE_NEXT_IMAGE: {
+		m_reader.Skip<VkSwapchainKHR>();
+		auto semaphore = Map(VK_OBJECT_TYPE_SEMAPHORE, m_reader.Read<VkSemaphore>());
+		auto fence = Map(VK_OBJECT_TYPE_FENCE, m_reader.Read<VkFence>());
+		m_reader.Skip<uint32_t>();
+		SubmitEmpty(m_queue, VK_NULL_HANDLE, semaphore, fence);
+		break;
+	}
+	case CC_QUEUE_PRESENT: {
+		auto queue = Map(VK_OBJECT_TYPE_QUEUE, m_reader.Read<VkQueue>());
+		for (auto semaphore : m_reader.ReadArray<VkSemaphore>()) {
+			SubmitEmpty(queue, Map(VK_OBJECT_TYPE_SEMAPHORE, semaphore), VK_NULL_HANDLE, VK_NULL_HANDLE);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void Replayer::CreateInstance(uint32_t t_api_version)
+{
+	if (m_instance != VK_NULL_HANDLE) {
+		throw std::runtime_error("Replayer - The capture creates a second instance");
+	}
+
+	auto application_info = VkApplicationInfo{};
+	application_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	application_info.pApplicationName = "SuperNova Replayer";
+	application_info.pEngineName = "SuperNova";
+	application_info.apiVersion = t_api_version;
+
+	// VK_KHR_swapchain needs the surface extension, captured render passes and
+	// barriers may use its layouts even though nothing is presented
+	auto extension_count = uint32_t{ 0 };
+	vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, nullptr);
+	auto extensions = std::vector<VkExtensionProperties>(extension_count);
+	vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, extensions.data());
+	auto enabled_extensions = std::vector<char const *>{};
+	for (auto const & extension : extensions) {
+		if (std::strcmp(extension.extensionName, VK_KHR_SURFACE_EXTENSION_NAME) == 0) {
+			enabled_extensions.emplace_back(VK_KHR_SURFACE_EXTENSION_NAME);
+		}
+	}
+	char const * validation_layer = "VK_LAYER_KHRONOS_validation";
+
+	auto info = VkInstanceCreateInfo{};
+	info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	info.pApplicationInfo = &application_info;
+	info.enabledExtensionCount = static_cast<uint32_t>(enabled_extensions.size());
+	info.ppEnabledExtensionNames = enabled_extensions.data();
+	info.enabledLayerCount = m_validate ? 1 : 0;
+	info.ppEnabledLayerNames = &validation_layer;
+	auto result = vkCreateInstance(&info, nullptr, &m_instance);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("create the replay instance", result);
+	}
+}
+
+void Replayer::CreateDevice()
+{
+	m_reader.Skip<VkDevice>();
+	auto const & device_info = m_reader.Read<CaptureDeviceInfo>();
+	auto info = m_reader.Read<VkDeviceCreateInfo>();
+	info.pNext = m_reader.ReadNext();
+	auto queue_infos = Allocate<VkDeviceQueueCreateInfo>(info.queueCreateInfoCount);
+	for (auto i = uint32_t{ 0 }; i < info.queueCreateInfoCount; ++i) {
+		queue_infos[i] = m_reader.Read<VkDeviceQueueCreateInfo>();
+		queue_infos[i].pNext = nullptr;
+		queue_infos[i].pQueuePriorities = m_reader.ReadArray<float>().data;
+	}
+	info.pQueueCreateInfos = queue_infos;
+	auto extensions = Allocate<char const *>(info.enabledExtensionCount);
+	for (auto i = uint32_t{ 0 }; i < info.enabledExtensionCount; ++i) {
+		extensions[i] = m_reader.ReadString();
+	}
+	info.ppEnabledExtensionNames = extensions;
+	info.enabledLayerCount = 0;
+	info.ppEnabledLayerNames = nullptr;
+	info.pEnabledFeatures = m_reader.ReadOptional<VkPhysicalDeviceFeatures>();
+
+	if (m_instance == VK_NULL_HANDLE || m_device != VK_NULL_HANDLE) {
+		throw std::runtime_error("Replayer - The capture creates a device outside its single instance");
+	}
+
+	auto device_count = uint32_t{ 0 };
+	vkEnumeratePhysicalDevices(m_instance, &device_count, nullptr);
+	auto physical_devices = std::vector<VkPhysicalDevice>(device_count);
+	vkEnumeratePhysicalDevices(m_instance, &device_count, physical_devices.data());
+	if (physical_devices.empty()) {
+		throw std::runtime_error("Replayer - No Vulkan device to replay on");
+	}
+
+	m_physical_device = physical_devices.front();
+	for (auto physical_device : physical_devices) {
+		auto properties = VkPhysicalDeviceProperties{};
+		vkGetPhysicalDeviceProperties(physical_device, &properties);
+		if (properties.vendorID == device_info.vendor_id && properties.deviceID == device_info.device_id) {
+			m_physical_device = physical_device;
+			break;
+		}
+	}
+
+	auto properties = VkPhysicalDeviceProperties{};
+	vkGetPhysicalDeviceProperties(m_physical_device, &properties);
+	vkGetPhysicalDeviceMemoryProperties(m_physical_device, &m_memory_properties);
+	m_device_name = properties.deviceName;
+	if (properties.vendorID != device_info.vendor_id || properties.deviceID != device_info.device_id) {
+		std::cout << "Replayer - " << device_info.device_name << " the capture was made on is not present, replaying on " << m_device_name << '\n';
+	}
+	else if (properties.driverVersion != device_info.driver_version) {
+		std::cout << "Replayer - Replaying on driver " << properties.driverVersion << ", the capture was made on " << device_info.driver_version << '\n';
+	}
+
+	auto result = vkCreateDevice(m_physical_device, &info, nullptr, &m_device);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("create the replay device", result);
+	}
+
+	m_wait_semaphores = reinterpret_cast<PFN_vkWaitSemaphores>(vkGetDeviceProcAddr(m_device, "vkWaitSemaphores"));
+	if (m_wait_semaphores == nullptr) {
+		m_wait_semaphores = reinterpret_cast<PFN_vkWaitSemaphores>(vkGetDeviceProcAddr(m_device, "vkWaitSemaphoresKHR"));
+	}
+	m_draw_indirect_count = reinterpret_cast<PFN_vkCmdDrawIndirectCount>(vkGetDeviceProcAddr(m_device, "vkCmdDrawIndirectCount"));
+	if (m_draw_indirect_count == nullptr) {
+		m_draw_indirect_count = reinterpret_cast<PFN_vkCmdDrawIndirectCount>(vkGetDeviceProcAddr(m_device, "vkCmdDrawIndirectCountKHR"));
+	}
+}
+
+VkPipelineShaderStageCreateInfo Replayer::ReadStage()
+{
+	auto stage = m_reader.Read<VkPipelineShaderStageCreateInfo>();
+	stage.pNext = nullptr;
+	stage.module = Map(VK_OBJECT_TYPE_SHADER_MODULE, stage.module);
+	stage.pName = m_reader.ReadString();
+	stage.pSpecializationInfo = nullptr;
+	if (auto captured = m_reader.ReadOptional<VkSpecializationInfo>()) {
+		auto specialization = Copy(*captured);
+		specialization->pMapEntries = m_reader.ReadArray<VkSpecializationMapEntry>().data;
+		auto data = m_reader.ReadBytes();
+		specialization->dataSize = static_cast<size_t>(data.size);
+		specialization->pData = data.data;
+		stage.pSpecializationInfo = specialization;
+	}
+	return stage;
+}
+
+void Replayer::CreateGraphicsPipelines()
+{
+	// Every state struct is copied so its pNext can be cleared, the stream
+	// holds the application's pointer values
+	auto read_state = [this](auto t_state) {
+		using State = std::remove_const_t<std::remove_pointer_t<decltype(t_state)>>;
+		auto captured = m_reader.ReadOptional<State>();
+		if (captured == nullptr) {
+			return static_cast<State *>(nullptr);
+		}
+		auto state = Copy(*captured);
+		state->pNext = nullptr;
+		return state;
+	};
+
+	auto captured = m_reader.ReadArray<VkPipeline>();
+	auto infos = Allocate<VkGraphicsPipelineCreateInfo>(captured.count);
+	for (auto i = uint32_t{ 0 }; i < captured.count; ++i) {
+		auto & info = infos[i];
+		info = m_reader.Read<VkGraphicsPipelineCreateInfo>();
+		info.pNext = nullptr;
+		auto stages = Allocate<VkPipelineShaderStageCreateInfo>(info.stageCount);
+		for (auto j = uint32_t{ 0 }; j < info.stageCount; ++j) {
+			stages[j] = ReadStage();
+		}
+		info.pStages = stages;
+
+		auto vertex_input = read_state(info.pVertexInputState);
+		if (vertex_input != nullptr) {
+			vertex_input->pVertexBindingDescriptions = m_reader.ReadArray<VkVertexInputBindingDescription>().data;
+			vertex_input->pVertexAttributeDescriptions = m_reader.ReadArray<VkVertexInputAttributeDescription>().data;
+		}
+		info.pVertexInputState = vertex_input;
+		info.pInputAssemblyState = read_state(info.pInputAssemblyState);
+		info.pTessellationState = read_state(info.pTessellationState);
+		auto viewport = read_state(info.pViewportState);
+		if (viewport != nullptr) {
+			viewport->pViewports = m_reader.ReadArray<VkViewport>().data;
+			viewport->pScissors = m_reader.ReadArray<VkRect2D>().data;
+		}
+		info.pViewportState = viewport;
+		info.pRasterizationState = read_state(info.pRasterizationState);
+		auto multisample = read_state(info.pMultisampleState);
+		if (multisample != nullptr) {
+			multisample->pSampleMask = m_reader.ReadArray<VkSampleMask>().data;
+		}
+		info.pMultisampleState = multisample;
+		info.pDepthStencilState = read_state(info.pDepthStencilState);
+		auto color_blend = read_state(info.pColorBlendState);
+		if (color_blend != nullptr) {
+			color_blend->pAttachments = m_reader.ReadArray<VkPipelineColorBlendAttachmentState>().data;
+		}
+		info.pColorBlendState = color_blend;
+		auto dynamic = read_state(info.pDynamicState);
+		if (dynamic != nullptr) {
+			dynamic->pDynamicStates = m_reader.ReadArray<VkDynamicState>().data;
+		}
+		info.pDynamicState = dynamic;
+
+		info.layout = Map(VK_OBJECT_TYPE_PIPELINE_LAYOUT, info.layout);
+		info.renderPass = Map(VK_OBJECT_TYPE_RENDER_PASS, info.renderPass);
+		info.basePipelineHandle = Map(VK_OBJECT_TYPE_PIPELINE, info.basePipelineHandle);
+	}
+
+	auto pipelines = Allocate<VkPipeline>(captured.count);
+	auto result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, captured.count, infos, nullptr, pipelines);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("replay vkCreateGraphicsPipelines", result);
+	}
+	for (auto i = uint32_t{ 0 }; i < captured.count; ++i) {
+		Bind(VK_OBJECT_TYPE_PIPELINE, captured.data[i], pipelines[i]);
+	}
+}
+
+void Replayer::UpdateDescriptorSets()
+{
+	auto write_count = m_reader.Read<uint32_t>();
+	auto writes = Allocate<VkWriteDescriptorSet>(write_count);
+	for (auto i = uint32_t{ 0 }; i < write_count; ++i) {
+		auto & write = writes[i];
+		write = m_reader.Read<VkWriteDescriptorSet>();
+		write.pNext = nullptr;
+		write.dstSet = Map(VK_OBJECT_TYPE_DESCRIPTOR_SET, write.dstSet);
+		write.pImageInfo = nullptr;
+		write.pBufferInfo = nullptr;
+		write.pTexelBufferView = nullptr;
+
+		switch (write.descriptorType) {
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT: {
+			auto captured = m_reader.ReadArray<VkDescriptorImageInfo>();
+			auto images = Copy(captured);
+			for (auto j = uint32_t{ 0 }; j < captured.count; ++j) {
+				images[j].sampler = Map(VK_OBJECT_TYPE_SAMPLER, images[j].sampler);
+				images[j].imageView = Map(VK_OBJECT_TYPE_IMAGE_VIEW, images[j].imageView);
+			}
+			write.pImageInfo = images;
+			break;
+		}
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+			write.pTexelBufferView = MapArray(VK_OBJECT_TYPE_BUFFER_VIEW, m_reader.ReadArray<VkBufferView>());
+			break;
+		default: {
+			auto captured = m_reader.ReadArray<VkDescriptorBufferInfo>();
+			auto buffers = Copy(captured);
+			for (auto j = uint32_t{ 0 }; j < captured.count; ++j) {
+				buffers[j].buffer = Map(VK_OBJECT_TYPE_BUFFER, buffers[j].buffer);
+			}
+			write.pBufferInfo = buffers;
+			break;
+		}
+		}
+	}
+
+	auto copies_captured = m_reader.ReadArray<VkCopyDescriptorSet>();
+	auto copies = Copy(copies_captured);
+	for (auto i = uint32_t{ 0 }; i < copies_captured.count; ++i) {
+		copies[i].pNext = nullptr;
+		copies[i].srcSet = Map(VK_OBJECT_TYPE_DESCRIPTOR_SET, copies[i].srcSet);
+		copies[i].dstSet = Map(VK_OBJECT_TYPE_DESCRIPTOR_SET, copies[i].dstSet);
+	}
+	vkUpdateDescriptorSets(m_device, write_count, writes, copies_captured.count, copies);
+}
+
+void Replayer::DestroyObject(VkObjectType t_type, uint64_t t_captured)
+{
+	auto object = m_objects.find(ObjectKey{ t_type, t_captured });
+	if (object == m_objects.end()) {
+		throw std::runtime_error("Replayer - The capture destroys an object of type " + std::to_string(t_type) + " it never created");
+	}
+	auto handle = object->second.handle;
+	m_objects.erase(object);
+
+	switch (t_type) {
+	case VK_OBJECT_TYPE_DEVICE_MEMORY:
+		vkFreeMemory(m_device, FromValue<VkDeviceMemory>(handle), nullptr);
+		m_memory.erase(t_captured);
+		break;
+	case VK_OBJECT_TYPE_BUFFER:
+		vkDestroyBuffer(m_device, FromValue<VkBuffer>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_IMAGE:
+		vkDestroyImage(m_device, FromValue<VkImage>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_IMAGE_VIEW:
+		vkDestroyImageView(m_device, FromValue<VkImageView>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_SAMPLER:
+		vkDestroySampler(m_device, FromValue<VkSampler>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_SEMAPHORE:
+		vkDestroySemaphore(m_device, FromValue<VkSemaphore>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_FENCE:
+		vkDestroyFence(m_device, FromValue<VkFence>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_QUERY_POOL:
+		vkDestroyQueryPool(m_device, FromValue<VkQueryPool>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_SHADER_MODULE:
+		vkDestroyShaderModule(m_device, FromValue<VkShaderModule>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT:
+		vkDestroyDescriptorSetLayout(m_device, FromValue<VkDescriptorSetLayout>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+		vkDestroyPipelineLayout(m_device, FromValue<VkPipelineLayout>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_RENDER_PASS:
+		vkDestroyRenderPass(m_device, FromValue<VkRenderPass>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_FRAMEBUFFER:
+		vkDestroyFramebuffer(m_device, FromValue<VkFramebuffer>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_PIPELINE:
+		vkDestroyPipeline(m_device, FromValue<VkPipeline>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_DESCRIPTOR_POOL:
+		vkDestroyDescriptorPool(m_device, FromValue<VkDescriptorPool>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_COMMAND_POOL:
+		vkDestroyCommandPool(m_device, FromValue<VkCommandPool>(handle), nullptr);
+		break;
+	default:
+		// Queues, command buffers and descriptor sets have no destroy of their own
+		break;
+	}
+}
+
+void Replayer::DestroySwapchain(uint64_t t_captured) noexcept
+{
+	auto swapchain = m_swapchains.find(t_captured);
+	if (swapchain == m_swapchains.end()) {
+		return;
+	}
+
+	for (auto image : swapchain->second.captured_images) {
+		m_objects.erase(ObjectKey{ VK_OBJECT_TYPE_IMAGE, ToValue(image) });
+	}
+	for (auto const & image : swapchain->second.images) {
+		vkDestroyImage(m_device, image.image, nullptr);
+		vkFreeMemory(m_device, image.memory, nullptr);
+	}
+	m_swapchains.erase(swapchain);
+}
+
+uint32_t Replayer::FindMemoryType(uint32_t t_captured_type, VkMemoryPropertyFlags t_captured_flags) const
+{
+	// The capture's own type where it means the same, as on the device it was made on
+	if (t_captured_type < m_memory_properties.memoryTypeCount && m_memory_properties.memoryTypes[t_captured_type].propertyFlags == t_captured_flags) {
+		return t_captured_type;
+	}
+
+	// Memory writes are replayed without flushes, host visible memory has to be coherent
+	auto flags = t_captured_flags;
+	if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0) {
+		flags |= VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	}
+	auto type = vulkan_utils::FindOptionalMemoryType(m_physical_device, ~0u, flags);
+	if (!type.has_value()) {
+		type = vulkan_utils::FindOptionalMemoryType(m_physical_device, ~0u, flags & (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+	}
+	if (!type.has_value()) {
+		throw std::runtime_error("Replayer - The device has no memory type like the capture's " + std::to_string(t_captured_type));
+	}
+	return type.value();
+}
+
+void Replayer::CheckBinding(VkMemoryRequirements const & t_requirements, uint64_t t_captured_memory, VkDeviceSize t_offset) const
+{
+	auto const & memory = m_memory.at(t_captured_memory);
+	if ((t_requirements.memoryTypeBits & (1u << memory.type)) == 0 || t_offset % t_requirements.alignment != 0 || t_offset + t_requirements.size > memory.size) {
+		throw std::runtime_error("Replayer - A resource no longer fits where the capture bound it, the device lays resources out differently");
+	}
+}
+
+void Replayer::SubmitEmpty(VkQueue t_queue, VkSemaphore t_wait, VkSemaphore t_signal, VkFence t_fence)
+{
+	if (t_wait == VK_NULL_HANDLE && t_signal == VK_NULL_HANDLE && t_fence == VK_NULL_HANDLE) {
+		return;
+	}
+
+	auto stage = VkPipelineStageFlags{ VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+	auto submit = VkSubmitInfo{};
+	submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit.waitSemaphoreCount = t_wait != VK_NULL_HANDLE ? 1 : 0;
+	submit.pWaitSemaphores = &t_wait;
+	submit.pWaitDstStageMask = &stage;
+	submit.signalSemaphoreCount = t_signal != VK_NULL_HANDLE ? 1 : 0;
+	submit.pSignalSemaphores = &t_signal;
+	auto result = vkQueueSubmit(t_queue, 1, &submit, t_fence);
+	if (result != VK_SUCCESS) {
+		vulkan_utils::ThrowError("emulate the swapchain", result);
+	}
+}
@@ -0,0 +1,226 @@
+#ifndef REPLAYER
+#define REPLAYER
+
+#include "CaptureReader.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+// Issues the call stream of a capture again, as fast as the recorded waits let
+// it, and times every frame. Objects are created under the replay's own handles
+// and found through the capture time ones; any the stream uses without having
+// created throw.
+//
+// The replay runs on its own instance, on the device the capture names when it
+// is present and on the first one otherwise. Memory types are translated by
+// their properties, binds that no longer fit a captured allocation throw, a
+// capture from one device replays on another only if their resources lay out
+// alike. Host visible memory is zeroed when allocated, as the capture's copies
+// started zeroed, and replayed memory writes keep it equal to the application's.
+//
+// There is no window, swapchain images are plain device local images. Acquires
+// signal and presents wait through empty submits so the semaphores and fences
+// the application tied to them behave as they did.
+class Replayer
+{
+public:
+	explicit Replayer() = default;
+	Replayer(Replayer const &) = delete;
+	Replayer(Replayer &&) = delete;
+	Replayer & operator = (Replayer const &) = delete;
+	Replayer & operator = (Replayer &&) = delete;
+	~Replayer() noexcept;
+
+	void Create(std::string const &, bool);
+	void Destroy() noexcept;
+
+	[[nodiscard]] uint32_t GetFrameCount() const noexcept;
+	[[nodiscard]] uint64_t GetStreamSize() const noexcept;
+	[[nodiscard]] std::string const & GetDeviceName() const noexcept;
+
+	// Replays the whole stream, returns the milliseconds each frame took
+	[[nodiscard]] std::vector<double> Run();
+
+private:
+	struct ObjectKey {
+		VkObjectType type{ VK_OBJECT_TYPE_UNKNOWN };
+		uint64_t handle{ 0 };
+
+		[[nodiscard]] bool operator == (ObjectKey const & t_other) const noexcept
+		{
+			return type == t_other.type && handle == t_other.handle;
+		}
+	};
+
+	struct ObjectKeyHash {
+		[[nodiscard]] size_t operator () (ObjectKey const & t_key) const noexcept
+		{
+			return std::hash<uint64_t>{}(t_key.handle ^ (static_cast<uint64_t>(t_key.type) << 48));
+		}
+	};
+
+	struct Object {
+		uint64_t handle{ 0 };
+		// Creation order, the replay's objects are destroyed in reverse
+		uint64_t order{ 0 };
+	};
+
+	struct Memory {
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+		VkDeviceSize size{ 0 };
+		uint32_t type{ 0 };
+		uint8_t * mapped{ nullptr };
+		VkDeviceSize mapped_offset{ 0 };
+	};
+
+	struct SwapchainImage {
+		VkImage image{ VK_NULL_HANDLE };
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+	};
+
+	struct Swapchain {
+		VkSwapchainCreateInfoKHR info{};
+		std::vector<VkImage> captured_images{};
+		std::vector<SwapchainImage> images{};
+	};
+
+	void Replay(CAPTURE_CALL);
+	void ReplayDevice(CAPTURE_CALL);
+	void ReplayMemory(CAPTURE_CALL);
+	void ReplayObjects(CAPTURE_CALL);
+	void ReplayPipelines(CAPTURE_CALL);
+	void ReplayDescriptors(CAPTURE_CALL);
+	void ReplayCommandBuffers(CAPTURE_CALL);
+	void ReplayCommands(CAPTURE_CALL);
+	void ReplaySwapchain(CAPTURE_CALL);
+
+	void CreateInstance(uint32_t);
+	void CreateDevice();
+	void CreateGraphicsPipelines();
+	void UpdateDescriptorSets();
+	void DestroyObject(VkObjectType, uint64_t);
+	void DestroySwapchain(uint64_t) noexcept;
+	[[nodiscard]] uint32_t FindMemoryType(uint32_t, VkMemoryPropertyFlags) const;
+	void CheckBinding(VkMemoryRequirements const &, uint64_t, VkDeviceSize) const;
+	void SubmitEmpty(VkQueue, VkSemaphore, VkSemaphore, VkFence);
+	[[nodiscard]] VkPipelineShaderStageCreateInfo ReadStage();
+
+	template<typename T>
+	[[nodiscard]] static uint64_t ToValue(T t_handle) noexcept
+	{
+		if constexpr (std::is_pointer_v<T>) {
+			return reinterpret_cast<uint64_t>(t_handle);
+		}
+		else {
+			return static_cast<uint64_t>(t_handle);
+		}
+	}
+
+	template<typename T>
+	[[nodiscard]] static T FromValue(uint64_t t_value) noexcept
+	{
+		if constexpr (std::is_pointer_v<T>) {
+			return reinterpret_cast<T>(static_cast<uintptr_t>(t_value));
+		}
+		else {
+			return static_cast<T>(t_value);
+		}
+	}
+
+	template<typename T>
+	[[nodiscard]] T Map(VkObjectType t_type, T t_captured) const
+	{
+		if (t_captured == VK_NULL_HANDLE) {
+			return VK_NULL_HANDLE;
+		}
+		auto object = m_objects.find(ObjectKey{ t_type, ToValue(t_captured) });
+		if (object == m_objects.end()) {
+			throw std::runtime_error("Replayer - The capture uses an object of type " + std::to_string(t_type) + " it never created");
+		}
+		return FromValue<T>(object->second.handle);
+	}
+
+	// A copy the replay can point into, valid until the next record
+	template<typename T>
+	[[nodiscard]] T * MapArray(VkObjectType t_type, CaptureArray<T> t_captured)
+	{
+		auto replayed = Copy(t_captured);
+		for (auto i = uint32_t{ 0 }; i < t_captured.count; ++i) {
+			replayed[i] = Map(t_type, replayed[i]);
+		}
+		return replayed;
+	}
+
+	template<typename T>
+	void Bind(VkObjectType t_type, T t_captured, T t_replayed)
+	{
+		m_objects[ObjectKey{ t_type, ToValue(t_captured) }] = Object{ ToValue(t_replayed), m_object_order++ };
+	}
+
+	template<typename T>
+	[[nodiscard]] T * Copy(CaptureArray<T> t_captured)
+	{
+		if (t_captured.count == 0) {
+			return nullptr;
+		}
+		auto copy = Allocate<T>(t_captured.count);
+		std::memcpy(copy, t_captured.data, sizeof(T) * t_captured.count);
+		return copy;
+	}
+
+	template<typename T>
+	[[nodiscard]] T * Copy(T const & t_captured)
+	{
+		auto copy = Allocate<T>(1);
+		std::memcpy(copy, &t_captured, sizeof(T));
+		return copy;
+	}
+
+	// Scratch for the record in flight, reused once it is issued
+	template<typename T>
+	[[nodiscard]] T * Allocate(size_t t_count)
+	{
+		static_assert(alignof(T) <= alignof(std::max_align_t), "Scratch is aligned for fundamental types only");
+		auto size = (sizeof(T) * t_count + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+		while (m_scratch_block < m_scratch.size() && m_scratch[m_scratch_block].size() - m_scratch_used < size) {
+			++m_scratch_block;
+			m_scratch_used = 0;
+		}
+		if (m_scratch_block == m_scratch.size()) {
+			m_scratch.emplace_back(std::max(size, REPLAY_SCRATCH_BLOCK));
+			m_scratch_used = 0;
+		}
+		auto memory = m_scratch[m_scratch_block].data() + m_scratch_used;
+		m_scratch_used += size;
+		return reinterpret_cast<T *>(memory);
+	}
+
+	static constexpr size_t REPLAY_SCRATCH_BLOCK = 4096;
+
+	CaptureReader m_reader{};
+	VkInstance m_instance{ VK_NULL_HANDLE };
+	VkPhysicalDevice m_physical_device{ VK_NULL_HANDLE };
+	VkPhysicalDeviceMemoryProperties m_memory_properties{};
+	std::string m_device_name{};
+	bool m_validate{ false };
+	VkDevice m_device{ VK_NULL_HANDLE };
+	// Where acquires and presents are emulated
+	VkQueue m_queue{ VK_NULL_HANDLE };
+	PFN_vkWaitSemaphores m_wait_semaphores{ nullptr };
+	PFN_vkCmdDrawIndirectCount m_draw_indirect_count{ nullptr };
+
+	std::unordered_map<ObjectKey, Object, ObjectKeyHash> m_objects{};
+	uint64_t m_object_order{ 0 };
+	std::unordered_map<uint64_t, Memory> m_memory{};
+	std::unordered_map<uint64_t, Swapchain> m_swapchains{};
+	std::vector<uint8_t> m_query_results{};
+
+	std::vector<std::vector<std::max_align_t>> m_scratch{};
+	size_t m_scratch_block{ 0 };
+	size_t m_scratch_used{ 0 };
+};
+
+#endif // !REPLAYER
@@ -0,0 +1,91 @@
+# Renders a few frames headless on lavapipe, Mesa's CPU Vulkan driver, and checks
+# that the run logged no errors, wrote its capture and kept occlusion culling on.
+# Needs no GPU or display, so it runs on build agents.
+#
+#   powershell -ExecutionPolicy Bypass -File Scripts\lavapipe_headless.ps1 -Icd C:\mesa\x64\lvp_icd.x86_64.json
+
+param(
+	# lavapipe's ICD manifest
+	[Parameter(Mandatory = $true)][string]$Icd,
+	[string]$Engine = "$PSScriptRoot\..\x64\Release\Engine.exe",
+	# Shaders, Logs and Telemetry are resolved against the engine's working directory
+	[string]$WorkingDirectory = "$PSScriptRoot\..\Engine",
+	[int]$Frames = 60,
+	[int]$Width = 320,
+	[int]$Height = 240
+)
+
+$ErrorActionPreference = "Stop"
+
+function Fail([string]$message) {
+	Write-Host "FAIL: $message"
+	exit 1
+}
+
+$Icd = (Resolve-Path $Icd).Path
+$Engine = (Resolve-Path $Engine).Path
+$WorkingDirectory = (Resolve-Path $WorkingDirectory).Path
+$capture = Join-Path $env:TEMP "supernova_lavapipe.ppm"
+Remove-Item $capture -ErrorAction SilentlyContinue
+
+# Only lavapipe is visible to the loader, whatever else is installed
+$env:VK_ICD_FILENAMES = $Icd
+$env:VK_DRIVER_FILES = $Icd
+
+$start = Get-Date
+Push-Location $WorkingDirectory
+try {
+	$process = Start-Process -FilePath $Engine -NoNewWindow -Wait -PassThru -ArgumentList @(
+		"--headless", "--frames", $Frames, "--width", $Width, "--height", $Height, "--capture", "`"$capture`"")
+}
+finally {
+	Pop-Location
+}
+
+if ($process.ExitCode -ne 0) {
+	Fail "the engine exited with code $($process.ExitCode)"
+}
+
+# The log only receives errors, any new line is a failure
+$logs = Get-ChildItem (Join-Path $WorkingDirectory "Logs") -Filter "Log_*.txt" -ErrorAction SilentlyContinue |
+	Where-Object { $_.LastWriteTime -ge $start -and $_.Length -gt 0 }
+if ($logs) {
+	$logs | ForEach-Object { Get-Content $_.FullName }
+	Fail "the run logged errors"
+}
+
+# P6 header plus three bytes per pixel
+if (-not (Test-Path $capture)) {
+	Fail "no capture was written"
+}
+$header = "P6`n$Width $Height`n255`n"
+if ((Get-Item $capture).Length -ne $header.Length + $Width * $Height * 3) {
+	Fail "the capture does not have the requested size"
+}
+
+$telemetry = Get-ChildItem (Join-Path $WorkingDirectory "Telemetry") -Filter "Telemetry_*.csv" |
+	Where-Object { $_.LastWriteTime -ge $start } | Sort-Object LastWriteTime | Select-Object -Last 1
+if (-not $telemetry) {
+	Fail "no telemetry was written"
+}
+$rows = Import-Csv $telemetry.FullName
+
+# Frames count from 1, start up records under frame 0
+$frames = ($rows | Measure-Object -Property frame -Maximum).Maximum
+if ($frames -lt $Frames) {
+	Fail "telemetry covers $frames frames, expected $Frames"
+}
+
+# Occlusion culling turns itself off when the device lacks what it needs, lavapipe
+# has all of it
+$candidates = $rows | Where-Object { $_.name -eq "Occlusion Candidates" -and [double]$_.value -gt 0 }
+if (-not $candidates) {
+	Fail "occlusion culling did not run"
+}
+$drawn = $rows | Where-Object { ($_.name -eq "Occlusion Early Drawn" -or $_.name -eq "Occlusion Late Drawn") -and [double]$_.value -gt 0 }
+if (-not $drawn) {
+	Fail "occlusion culling drew nothing"
+}
+
+Write-Host "PASS: $frames frames on lavapipe, capture $capture"
+exit 0
@@ -0,0 +1,140 @@
+# Renders a few frames headless under the SuperNova profiler layer and checks its
+# csv: every frame counts its calls, draws and binds, and no frame repeats state
+# more often than allowed. With -Baseline the steady frames must also stay within
+# -Tolerance of an earlier profile's call counts. -Icd runs on one driver only,
+# lavapipe on build agents.
+#
+#   powershell -ExecutionPolicy Bypass -File Scripts\profiler_check.ps1 -Icd C:\mesa\x64\lvp_icd.x86_64.json
+
+param(
+	# Only this driver is visible to the loader when given
+	[string]$Icd = "",
+	[string]$Engine = "$PSScriptRoot\..\x64\Release\Engine.exe",
+	# Holds VkLayer_supernova_profiler.dll and its manifest
+	[string]$LayerDirectory = "$PSScriptRoot\..\x64\Release",
+	# Shaders and Logs are resolved against the engine's working directory
+	[string]$WorkingDirectory = "$PSScriptRoot\..\Engine",
+	[int]$Frames = 60,
+	[int]$Width = 320,
+	[int]$Height = 240,
+	# Redundant binds and state changes allowed per frame, per kind
+	[int]$MaxRedundant = 0,
+	# Profile of an earlier run to compare call counts with
+	[string]$Baseline = "",
+	# Growth in a call count over the baseline allowed, in percent
+	[double]$Tolerance = 10
+)
+
+$ErrorActionPreference = "Stop"
+
+$REDUNDANT_NAMES = @(
+	"Redundant Pipeline Binds",
+	"Redundant Descriptor Set Binds",
+	"Redundant Vertex Buffer Binds",
+	"Redundant Index Buffer Binds",
+	"Redundant Viewports",
+	"Redundant Scissors",
+	"Redundant Push Constants"
+)
+
+function Fail([string]$message) {
+	Write-Host "FAIL: $message"
+	exit 1
+}
+
+# Call counters of the frames between the first, which creates everything, and the
+# last, which the layer flushes on shutdown wherever it got to. Frames count from 1
+function Get-SteadyCounts($rows) {
+	$last = ($rows | Measure-Object -Property frame -Maximum).Maximum
+	$counts = @{}
+	$rows | Where-Object { $_.source -eq "Counter" -and $_.name -like "* Calls" -and [int]$_.frame -gt 1 -and [int]$_.frame -lt $last } |
+		Group-Object name | ForEach-Object {
+			$counts[$_.Name] = ($_.Group | Measure-Object -Property value -Maximum).Maximum
+		}
+	return $counts
+}
+
+$Engine = (Resolve-Path $Engine).Path
+$LayerDirectory = (Resolve-Path $LayerDirectory).Path
+$WorkingDirectory = (Resolve-Path $WorkingDirectory).Path
+if (-not (Test-Path (Join-Path $LayerDirectory "VkLayer_supernova_profiler.json"))) {
+	Fail "no profiler layer manifest in $LayerDirectory"
+}
+$csv = Join-Path $env:TEMP "supernova_profile.csv"
+Remove-Item $csv -ErrorAction SilentlyContinue
+
+if ($Icd) {
+	$Icd = (Resolve-Path $Icd).Path
+	$env:VK_ICD_FILENAMES = $Icd
+	$env:VK_DRIVER_FILES = $Icd
+}
+$env:VK_LAYER_PATH = $LayerDirectory
+$env:VK_INSTANCE_LAYERS = "VK_LAYER_SUPERNOVA_profiler"
+$env:SUPERNOVA_PROFILER_FILE = $csv
+# --headless never presents, the GPU profiler resets its queries once per frame
+$env:SUPERNOVA_PROFILER_FRAME_CALL = "vkCmdResetQueryPool"
+
+Push-Location $WorkingDirectory
+try {
+	$process = Start-Process -FilePath $Engine -NoNewWindow -Wait -PassThru -ArgumentList @(
+		"--headless", "--frames", $Frames, "--width", $Width, "--height", $Height)
+}
+finally {
+	Pop-Location
+}
+
+if ($process.ExitCode -ne 0) {
+	Fail "the engine exited with code $($process.ExitCode)"
+}
+if (-not (Test-Path $csv)) {
+	Fail "the profiler wrote nothing, is the layer loading?"
+}
+$rows = Import-Csv $csv
+
+$frames = ($rows | Measure-Object -Property frame -Maximum).Maximum
+if ($frames -lt $Frames) {
+	Fail "the profile covers $frames frames, expected $Frames"
+}
+
+# Every frame records and submits its work
+foreach ($call in @("vkQueueSubmit Calls", "vkCmdBindPipeline Calls", "vkCmdDispatch Calls")) {
+	$counted = @($rows | Where-Object { $_.source -eq "Counter" -and $_.name -eq $call -and [double]$_.value -gt 0 }).Count
+	if ($counted -lt $frames - 1) {
+		Fail "$call counted in $counted of $frames frames"
+	}
+}
+$draws = @($rows | Where-Object { $_.source -eq "Counter" -and $_.name -like "vkCmdDraw* Calls" -and [double]$_.value -gt 0 } |
+	Select-Object -ExpandProperty frame -Unique).Count
+if ($draws -lt $frames - 1) {
+	Fail "draws counted in $draws of $frames frames"
+}
+
+# The layer writes every kind every frame, zeroes included
+foreach ($name in $REDUNDANT_NAMES) {
+	$counters = @($rows | Where-Object { $_.source -eq "Counter" -and $_.name -eq $name })
+	if ($counters.Count -ne $frames) {
+		Fail "$name written for $($counters.Count) of $frames frames"
+	}
+	$worst = ($counters | Measure-Object -Property value -Maximum).Maximum
+	if ($worst -gt $MaxRedundant) {
+		$frame = ($counters | Sort-Object { [double]$_.value } | Select-Object -Last 1).frame
+		Fail "$name reached $worst in frame $frame, $MaxRedundant allowed"
+	}
+}
+
+$counts = Get-SteadyCounts $rows
+if ($Baseline) {
+	$expected = Get-SteadyCounts (Import-Csv (Resolve-Path $Baseline).Path)
+	foreach ($name in $counts.Keys) {
+		if (-not $expected.ContainsKey($name)) {
+			Fail "$name is new since the baseline, $($counts[$name]) per frame"
+		}
+		$limit = [math]::Floor($expected[$name] * (1 + $Tolerance / 100))
+		if ($counts[$name] -gt $limit) {
+			Fail "$name rose to $($counts[$name]) per frame, the baseline has $($expected[$name])"
+		}
+	}
+}
+
+Write-Host "PASS: $frames frames, $($counts["Vulkan Calls"]) Vulkan calls per steady frame, profile $csv"
+exit 0